@@ -0,0 +1,183 @@
+/*
+ * findloop-test.c: check that findloop_add_edge and
+ * findloop_remove_edge keep a findloopstate in agreement with a fresh
+ * findloop_run, over random sequences of edge changes to random
+ * graphs, and that findloop_add_edge reports exactly the other edges
+ * whose status changed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "puzzles.h"
+
+struct graph {
+    int n;
+    bool *adj;                         /* n*n adjacency matrix */
+    bool *wasloop, *changed;           /* n*n, per edge */
+    int u, v;                          /* iteration state for neighbour */
+};
+
+static int graph_neighbour(int vertex, void *vctx)
+{
+    struct graph *g = (struct graph *)vctx;
+
+    if (vertex >= 0) {
+        g->u = vertex;
+        g->v = -1;
+    }
+    while (++g->v < g->n)
+        if (g->adj[g->u * g->n + g->v])
+            return g->v;
+    return -1;
+}
+
+static void note_changed(int u, int v, void *vctx)
+{
+    struct graph *g = (struct graph *)vctx;
+
+    g->changed[u * g->n + v] = g->changed[v * g->n + u] = true;
+}
+
+/*
+ * Check the edges reported by findloop_add_edge against the ones
+ * whose status differs between two fresh runs, before and after
+ * the u-v edge was toggled.
+ */
+static const char *compare_changed(struct graph *g, struct findloopstate *ref,
+                                   int tu, int tv, int *fu, int *fv)
+{
+    int u, v;
+
+    for (u = 0; u < g->n; u++)
+        for (v = u+1; v < g->n; v++) {
+            bool expected;
+
+            if (!g->adj[u * g->n + v] || (u == tu && v == tv) ||
+                (u == tv && v == tu))
+                continue;
+            *fu = u;
+            *fv = v;
+            expected = (g->wasloop[u * g->n + v] !=
+                        findloop_is_loop_edge(ref, u, v));
+            if (expected && !g->changed[u * g->n + v])
+                return "changed edge not reported";
+            if (!expected && g->changed[u * g->n + v])
+                return "unchanged edge reported";
+        }
+    return NULL;
+}
+
+static const char *compare(struct graph *g, struct findloopstate *inc,
+                           struct findloopstate *ref, int *fu, int *fv)
+{
+    int u, v;
+
+    for (u = 0; u < g->n; u++)
+        for (v = u+1; v < g->n; v++) {
+            int iu, iv, ru, rv;
+            bool ib, rb;
+
+            if (!g->adj[u * g->n + v])
+                continue;
+            *fu = u;
+            *fv = v;
+            if (findloop_is_loop_edge(inc, u, v) !=
+                findloop_is_loop_edge(ref, u, v))
+                return "loop edge status differs";
+            ib = findloop_is_bridge(inc, u, v, &iu, &iv);
+            rb = findloop_is_bridge(ref, u, v, &ru, &rv);
+            if (ib != rb)
+                return "bridge status differs";
+            if (ib && (iu != ru || iv != rv))
+                return "bridge component sizes differ";
+        }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int iteration, nfallback = 0, nincremental = 0;
+    unsigned seed;
+
+    seed = (argc > 1 ? strtoul(argv[1], NULL, 0) : time(NULL));
+    printf("Random seed = %u\n", seed);
+    srand(seed);
+
+    for (iteration = 0; iteration < 2000; iteration++) {
+        struct graph g;
+        struct findloopstate *inc, *ref;
+        int i, step;
+
+        /*
+         * Sparse graphs, so that there are plenty of bridges and of
+         * separate components to be joined up.
+         */
+        g.n = 2 + rand() % 40;
+        g.adj = snewn(g.n * g.n, bool);
+        g.wasloop = snewn(g.n * g.n, bool);
+        g.changed = snewn(g.n * g.n, bool);
+        memset(g.adj, 0, g.n * g.n * sizeof(bool));
+        for (i = 0; i < g.n; i++) {
+            int u = rand() % g.n, v = rand() % g.n;
+            if (u != v)
+                g.adj[u * g.n + v] = g.adj[v * g.n + u] = true;
+        }
+
+        inc = findloop_new_state(g.n);
+        ref = findloop_new_state(g.n);
+        findloop_run(inc, g.n, graph_neighbour, &g);
+        findloop_run(ref, g.n, graph_neighbour, &g);
+
+        for (step = 0; step < 100; step++) {
+            int u = rand() % g.n, v = rand() % g.n, fu, fv;
+            bool ok;
+            const char *fail;
+
+            if (u == v)
+                continue;
+            for (i = 0; i < g.n * g.n; i++) {
+                g.wasloop[i] = (g.adj[i] &&
+                                findloop_is_loop_edge(ref, i / g.n, i % g.n));
+                g.changed[i] = false;
+            }
+            if (g.adj[u * g.n + v]) {
+                g.adj[u * g.n + v] = g.adj[v * g.n + u] = false;
+                ok = findloop_remove_edge(inc, u, v);
+            } else {
+                g.adj[u * g.n + v] = g.adj[v * g.n + u] = true;
+                ok = findloop_add_edge(inc, u, v, note_changed, &g);
+            }
+            if (ok) {
+                nincremental++;
+            } else {
+                nfallback++;
+                findloop_run(inc, g.n, graph_neighbour, &g);
+            }
+
+            findloop_run(ref, g.n, graph_neighbour, &g);
+            fail = compare(&g, inc, ref, &fu, &fv);
+            if (!fail && ok)
+                fail = compare_changed(&g, ref, u, v, &fu, &fv);
+            if (fail) {
+                printf("Failed at iteration %d step %d, after %s %d-%d: "
+                       "%s for edge %d-%d\n", iteration, step,
+                       g.adj[u * g.n + v] ? "adding" : "removing", u, v,
+                       fail, fu, fv);
+                return 1;
+            }
+        }
+
+        findloop_free_state(inc);
+        findloop_free_state(ref);
+        sfree(g.adj);
+        sfree(g.wasloop);
+        sfree(g.changed);
+    }
+
+    printf("OK (%d incremental updates, %d full runs)\n",
+           nincremental, nfallback);
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * gridbench.c: time the construction of grids by grid.c, in
+ * particular the aperiodic ones, which are by far the slowest.
+ *
+ * Usage:
+ *
+ *   gridbench [--iterations <n>] [--seed <seed>] [<type>[:<w>x<h>] ...]
+ *
+ * <type> is one of the lower-case grid names in GRIDGEN_LIST (e.g.
+ * "penrose_p2_kite" or "hats"); <w>x<h> defaults to 50x50. With no
+ * grids named, the Penrose and hat grids are timed.
+ *
+ * For each grid, <n> (default 10) random grid descriptions are made
+ * from the seed, and the time taken by grid_new to build each one is
+ * measured. Making the descriptions isn't timed. The results are
+ * reported as the number of faces (tiles) built per second.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "puzzles.h"
+#include "grid.h"
+
+#define NAME(upper,lower) #lower,
+static const char *const grid_names[] = { GRIDGEN_LIST(NAME) };
+#undef NAME
+
+static const char *const default_grids[] = {
+    "penrose_p2_kite", "penrose_p3_thick", "hats",
+};
+
+static void usage_exit(const char *pname, const char *msg)
+{
+    if (msg)
+        fprintf(stderr, "%s: %s\n", pname, msg);
+    fprintf(stderr, "usage: %s [--iterations <n>] [--seed <seed>] "
+            "[<type>[:<w>x<h>] ...]\n", pname);
+    exit(1);
+}
+
+static bool bench_grid(const char *pname, const char *spec, int iterations,
+                       const char *seed)
+{
+    const char *colon = strchr(spec, ':');
+    size_t len = colon ? colon - spec : strlen(spec);
+    int type, w = 50, h = 50, i;
+    long faces = 0;
+    double secs = 0;
+    const char *err;
+    random_state *rs;
+
+    for (type = 0; type < GRID_TYPE_MAX; type++)
+        if (strlen(grid_names[type]) == len &&
+            !memcmp(grid_names[type], spec, len))
+            break;
+    if (type == GRID_TYPE_MAX) {
+        fprintf(stderr, "%s: unrecognised grid type '%.*s'\n",
+                pname, (int)len, spec);
+        return false;
+    }
+    if (colon && sscanf(colon + 1, "%dx%d", &w, &h) != 2) {
+        fprintf(stderr, "%s: bad grid size '%s'\n", pname, colon + 1);
+        return false;
+    }
+    err = grid_validate_params(type, w, h);
+    if (err) {
+        fprintf(stderr, "%s: %s:%dx%d: %s\n", pname, grid_names[type],
+                w, h, err);
+        return false;
+    }
+
+    rs = random_new(seed, strlen(seed));
+    for (i = 0; i < iterations; i++) {
+        char *desc = grid_new_desc(type, w, h, rs);
+        clock_t start = clock();
+        grid *g = grid_new(type, w, h, desc);
+
+        faces += g->num_faces;
+        grid_free(g);
+        grid_cache_clear();      /* so the next one is built from scratch */
+        secs += (double)(clock() - start) / CLOCKS_PER_SEC;
+        sfree(desc);
+    }
+    random_free(rs);
+
+    printf("%s:%dx%d: %d grids, %ld faces in %.3fs: %.0f faces/s\n",
+           grid_names[type], w, h, iterations, faces, secs,
+           secs > 0 ? faces / secs : 0.0);
+    fflush(stdout);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *pname = argv[0];
+    const char *seed = "gridbench";
+    const char **grids = snewn(argc, const char *);
+    int iterations = 10, ngrids = 0, i;
+    bool ok = true;
+
+    while (--argc > 0) {
+        const char *p = *++argv;
+        if (!strcmp(p, "--iterations")) {
+            if (--argc <= 0)
+                usage_exit(pname, "option requires an argument");
+            iterations = atoi(*++argv);
+            if (iterations < 1)
+                usage_exit(pname, "--iterations must be at least 1");
+        } else if (!strcmp(p, "--seed")) {
+            if (--argc <= 0)
+                usage_exit(pname, "option requires an argument");
+            seed = *++argv;
+        } else if (!strcmp(p, "--help")) {
+            usage_exit(pname, NULL);
+        } else if (p[0] == '-') {
+            usage_exit(pname, "unrecognised option");
+        } else {
+            grids[ngrids++] = p;
+        }
+    }
+
+    if (ngrids == 0) {
+        for (i = 0; i < lenof(default_grids); i++)
+            if (!bench_grid(pname, default_grids[i], iterations, seed))
+                ok = false;
+    } else {
+        for (i = 0; i < ngrids; i++)
+            if (!bench_grid(pname, grids[i], iterations, seed))
+                ok = false;
+    }
+
+    sfree(grids);
+    return ok ? 0 : 1;
+}
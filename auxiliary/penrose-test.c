@@ -71,6 +71,7 @@ int main(int argc, char *argv[])
     ps.start_size = atoi(argv[1]);
     ps.max_depth = atoi(argv[2]);
     ps.new_tile = test_cb;
+    ps.clip = false;
 
     ntiles = nfinal = 0;
 
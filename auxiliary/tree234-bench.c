@@ -0,0 +1,207 @@
+/*
+ * tree234-bench.c: time the operations of the tree234.h API.
+ *
+ * Usage:
+ *
+ *   tree234-bench [--size <n>] [--seed <seed>]
+ *
+ * This is built twice: as tree234-bench, using the 2-3-4 tree in
+ * tree234.c, and as btree234-bench, using the B+-tree in btree234.c,
+ * so that the two can be compared by running both with the same
+ * arguments.
+ *
+ * Each test works on trees of <n> (default 100000) integer elements,
+ * in an order made from the seed, and reports the time per
+ * operation. It also prints a checksum of what the operations
+ * returned, which should be the same for both implementations.
+ * (tree234-test checks the 2-3-4 tree much more thoroughly.)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "puzzles.h"
+#include "tree234.h"
+
+static int intcmp(void *av, void *bv)
+{
+    int a = *(int *)av, b = *(int *)bv;
+    return a < b ? -1 : a > b ? +1 : 0;
+}
+
+struct bench {
+    int n;
+    int *values;                       /* values[i] == 2*i */
+    int *order;                        /* a random permutation of 0..n-1 */
+    int *probes;                       /* random values in 0..2n-1 */
+    void **sorted;                     /* pointers to values, in order */
+    unsigned long check;
+    clock_t start;
+};
+
+static void checksum(struct bench *b, void *p)
+{
+    b->check = b->check * 31 + (p ? *(int *)p + 1 : 0);
+}
+
+static void start(struct bench *b)
+{
+    b->check = 0;
+    b->start = clock();
+}
+
+static void report(struct bench *b, const char *name, long ops)
+{
+    double secs = (double)(clock() - b->start) / CLOCKS_PER_SEC;
+    printf("%-16s %9.1f ns/op   check %08lx\n", name,
+           secs * 1e9 / ops, b->check & 0xFFFFFFFFUL);
+    fflush(stdout);
+}
+
+static tree234 *build_by_adding(struct bench *b)
+{
+    tree234 *t = newtree234(intcmp);
+    int i;
+
+    for (i = 0; i < b->n; i++)
+        add234(t, &b->values[b->order[i]]);
+    return t;
+}
+
+static void run(struct bench *b)
+{
+    tree234 *t;
+    cursor234 c;
+    void *p;
+    int n = b->n, i, index;
+
+    start(b);
+    t = build_by_adding(b);
+    checksum(b, index234(t, n / 2));
+    report(b, "add234", n);
+    freetree234(t);
+
+    start(b);
+    t = newtree234(intcmp);
+    for (i = 0; i < n; i++)
+        add234(t, &b->values[i]);
+    checksum(b, index234(t, n / 2));
+    report(b, "add234 in order", n);
+    freetree234(t);
+
+    start(b);
+    t = buildtree234(intcmp, b->sorted, n);
+    checksum(b, index234(t, n / 2));
+    report(b, "buildtree234", n);
+
+    start(b);
+    for (i = 0; i < n; i++)
+        checksum(b, find234(t, &b->probes[i], NULL));
+    report(b, "find234", n);
+
+    start(b);
+    for (i = 0; i < n; i++) {
+        p = findrelpos234(t, &b->probes[i], NULL, REL234_GE, &index);
+        checksum(b, p);
+        b->check += p ? index : 0;
+    }
+    report(b, "findrelpos234", n);
+
+    start(b);
+    for (i = 0; i < n; i++)
+        checksum(b, index234(t, b->order[i]));
+    report(b, "index234", n);
+
+    start(b);
+    for (i = 0; (p = index234(t, i)) != NULL; i++)
+        checksum(b, p);
+    report(b, "index234 walk", n);
+
+    start(b);
+    for (p = cursorindex234(t, 0, &c); p; p = cursornext234(&c))
+        checksum(b, p);
+    report(b, "cursor234 walk", n);
+
+    start(b);
+    for (i = 0; i < n; i++)
+        checksum(b, del234(t, &b->values[b->order[i]]));
+    report(b, "del234", n);
+    freetree234(t);
+
+    /*
+     * An unsorted tree used as a queue, as several puzzles do.
+     */
+    start(b);
+    t = newtree234(NULL);
+    for (i = 0; i < n; i++) {
+        addpos234(t, &b->values[i], count234(t));
+        if (i % 2)
+            checksum(b, delpos234(t, 0));
+    }
+    while ((p = delpos234(t, 0)) != NULL)
+        checksum(b, p);
+    report(b, "queue", n);
+    freetree234(t);
+}
+
+static void usage_exit(const char *pname, const char *msg)
+{
+    if (msg)
+        fprintf(stderr, "%s: %s\n", pname, msg);
+    fprintf(stderr, "usage: %s [--size <n>] [--seed <seed>]\n", pname);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *pname = argv[0];
+    const char *seed = "tree234-bench";
+    struct bench b;
+    random_state *rs;
+    int i;
+
+    b.n = 100000;
+
+    while (--argc > 0) {
+        const char *p = *++argv;
+        if (!strcmp(p, "--size")) {
+            if (--argc <= 0)
+                usage_exit(pname, "option requires an argument");
+            b.n = atoi(*++argv);
+            if (b.n < 1)
+                usage_exit(pname, "--size must be at least 1");
+        } else if (!strcmp(p, "--seed")) {
+            if (--argc <= 0)
+                usage_exit(pname, "option requires an argument");
+            seed = *++argv;
+        } else if (!strcmp(p, "--help")) {
+            usage_exit(pname, NULL);
+        } else {
+            usage_exit(pname, "unrecognised option");
+        }
+    }
+
+    b.values = snewn(b.n, int);
+    b.order = snewn(b.n, int);
+    b.probes = snewn(b.n, int);
+    b.sorted = snewn(b.n, void *);
+    rs = random_new(seed, strlen(seed));
+    for (i = 0; i < b.n; i++) {
+        b.values[i] = 2 * i;
+        b.order[i] = i;
+        b.probes[i] = random_upto(rs, 2 * b.n);
+        b.sorted[i] = &b.values[i];
+    }
+    shuffle(b.order, b.n, sizeof(*b.order), rs);
+    random_free(rs);
+
+    run(&b);
+
+    sfree(b.values);
+    sfree(b.order);
+    sfree(b.probes);
+    sfree(b.sorted);
+    return 0;
+}
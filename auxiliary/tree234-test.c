@@ -19,6 +19,12 @@
  * definition correctly ordered. It also ensures all nodes are
  * distinct, because the enum functions would get caught in a loop
  * if not.)
+ *
+ * Built with TEST_BTREE234 defined, as btree234-test, this tests the
+ * B+-tree in btree234.c instead. That has no internals this code can
+ * see, so the node checks above are left out, and what remains
+ * compares everything the API shows (contents, counts, searches,
+ * cursors, split and join) against the array.
  */
 
 #include <assert.h>
@@ -29,7 +35,9 @@
 
 #include "puzzles.h"
 
+#ifndef TEST_BTREE234
 #define TREE234_INTERNALS
+#endif
 #include "tree234.h"
 
 /*
@@ -52,6 +60,7 @@ static cmpfn234 cmp;
 /* The tree representation of the same data. */
 static tree234 *tree;
 
+#ifdef TREE234_INTERNALS
 /*
  * Routines to provide a diagnostic printout of a tree. Currently
  * relies on every element in the tree being a one-character string
@@ -184,12 +193,29 @@ static void disptree(tree234 *t) {
     sfree(ctx.levels);
     sfree(leveldata);
 }
+#else
+/*
+ * Without the node structure, just print the elements in order.
+ */
+static void disptree(tree234 *t) {
+    cursor234 cur;
+    void *p;
+
+    if (!count234(t))
+	printf("[empty tree]\n");
+    for (p = cursorindex234(t, 0, &cur); p; p = cursornext234(&cur))
+	printf(" %s", (char *)p);
+    printf("\n");
+}
+#endif
 
 typedef struct {
     int treedepth;
     int elemcount;
 } chkctx;
 
+#ifdef TREE234_INTERNALS
+
 static int chknode(chkctx *ctx, int level, node234 *node,
                    void *lowbound, void *highbound) {
     int nkids, nelems;
@@ -299,14 +325,17 @@ static int chknode(chkctx *ctx, int level, node234 *node,
 
     return count;
 }
+#endif
 
 static void verifytree(tree234 *tree, void **array, int arraylen) {
     chkctx ctx;
+    cursor234 cur;
     int i;
     void *p;
 
     ctx.treedepth = -1;                /* depth unknown yet */
     ctx.elemcount = 0;                 /* no elements seen yet */
+#ifdef TREE234_INTERNALS
     /*
      * Verify validity of tree properties.
      */
@@ -316,6 +345,13 @@ static void verifytree(tree234 *tree, void **array, int arraylen) {
         chknode(&ctx, 0, tree->root, NULL, NULL);
     }
     printf("tree depth: %d\n", ctx.treedepth);
+#else
+    /*
+     * The best we can do is to trust count234, and check it against
+     * everything else.
+     */
+    ctx.elemcount = count234(tree);
+#endif
     /*
      * Enumerate the tree and ensure it matches up to the array.
      */
@@ -338,6 +374,25 @@ static void verifytree(tree234 *tree, void **array, int arraylen) {
         error("tree really contains %d elements, count234 gave %d",
 	      ctx.elemcount, i);
     }
+    /*
+     * Enumerate it again with a cursor, in each direction.
+     */
+    for (i = 0, p = cursorindex234(tree, 0, &cur); p;
+	 i++, p = cursornext234(&cur)) {
+        if (i >= arraylen || array[i] != p)
+            error("cursor enum at position %d: array says %s, tree says %s",
+                  i, i < arraylen ? array[i] : "nothing", p);
+    }
+    if (i != arraylen)
+        error("cursor enum gave %d elements, array has %d", i, arraylen);
+    for (i = arraylen-1, p = cursorindex234(tree, i, &cur); p;
+	 i--, p = cursorprev234(&cur)) {
+        if (i < 0 || array[i] != p)
+            error("reverse cursor enum at position %d: array says %s, "
+                  "tree says %s", i, i >= 0 ? array[i] : "nothing", p);
+    }
+    if (i != -1)
+        error("reverse cursor enum stopped at position %d", i);
 }
 static void verify(void) { verifytree(tree, array, arraylen); }
 
@@ -403,7 +458,7 @@ static void delpostest(int i) {
     }
     arraylen--;			       /* delete elem from array */
 
-    if (tree->cmp)
+    if (cmp)
 	ret = del234(tree, elem);
     else
 	ret = delpos234(tree, index);
@@ -577,7 +632,10 @@ static void splittest(tree234 *tree, void **array, int arraylen) {
 int main(void) {
     int in[NSTR];
     int i, j, k;
-    int tworoot, tmplen;
+    int tmplen;
+#ifdef TREE234_INTERNALS
+    int tworoot;
+#endif
     unsigned seed = 0;
     tree234 *tree2, *tree3, *tree4;
 
@@ -648,17 +706,26 @@ int main(void) {
      * Split tests. Split the tree at every possible point and
      * check the resulting subtrees.
      */
+#ifdef TREE234_INTERNALS
     tworoot = (!tree2->root->elems[1]);/* see if it has a 2-root */
+#endif
     splittest(tree2, array, arraylen);
     /*
      * Now do the split test again, but on a tree that has a 2-root
      * (if the previous one didn't) or doesn't (if the previous one
-     * did).
+     * did). For the B+-tree, which has no such thing, settle for a
+     * tree of half the size.
      */
     tmplen = arraylen;
+#ifdef TREE234_INTERNALS
     while ((!tree2->root->elems[1]) == tworoot) {
 	delpos234(tree2, --tmplen);
     }
+#else
+    while (tmplen > arraylen / 2) {
+	delpos234(tree2, --tmplen);
+    }
+#endif
     printf("now trying splits on second tree\n");
     splittest(tree2, array, tmplen);
     freetree234(tree2);
@@ -741,6 +808,27 @@ int main(void) {
     assert(tree3 == join234(tree3, tree));
     verifytree(tree3, array, 2);
     verifytree(tree, array, 0);
+    freetree234(tree);
+    freetree234(tree2);
+    freetree234(tree3);
+    freetree234(tree4);
+
+    /*
+     * Test buildtree234 on every length of sorted input up to the
+     * full set of strings.
+     */
+    tree = newtree234(mycmp);
+    cmp = mycmp;
+    arraylen = 0;
+    for (i = 0; i < (int)NSTR; i++)
+	addtest(strings[i]);
+    for (i = 0; i <= arraylen; i++) {
+	printf("building tree of size %d\n", i);
+	tree2 = buildtree234(mycmp, array, i);
+	verifytree(tree2, array, i);
+	freetree234(tree2);
+    }
+    freetree234(tree);
 
     return 0;
 }
@@ -6,6 +6,10 @@
 # Expects to be run in the cmake build directory, where it can find
 # both the game binaries themselves and the file gamelist.txt that
 # lists them.
+#
+# For more detailed, machine-readable timings (percentiles, and
+# separate figures for generation, validation and solving), see the
+# 'benchpuzz' program built alongside the puzzles.
 
 # If any arguments are provided, use those as the list of games to
 # benchmark. Otherwise, read the full list from gamelist.txt.
@@ -0,0 +1,393 @@
+/*
+ * benchpuzz.c: Benchmarking frontend to all puzzles.
+ *
+ * This is a more thorough replacement for running each puzzle binary
+ * with '--time-generation' (as benchmark.sh does). For every preset
+ * of every puzzle (or just the ones named on the command line), it
+ * generates a fixed set of random seeds, and times each of the
+ * back end's new_desc, validate_desc, new_game and solve functions
+ * separately. The results are written to standard output as JSON,
+ * giving the mean, median, 95th and 99th percentiles and maximum
+ * time for each phase, so that runs from different versions of the
+ * code can be compared mechanically.
+ *
+ * Usage:
+ *
+ *   benchpuzz [--iterations <n>] [--warmup <n>] [--seed <seed>]
+ *             [<game>[:<params>] ...]
+ *
+ * <game> is matched against either the puzzle's name or its help
+ * topic (e.g. "Same Game" or "samegame"). If <params> is given, only
+ * that parameter string is benchmarked, instead of every preset.
+ *
+ * The ith timed generation for each preset uses the same random seed
+ * as '--generate <n> <params>#<seed>' would for its ith game, so the
+ * slowest case reported can be reproduced with the ordinary puzzle
+ * binary.
+ */
+
+#if !defined _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L /* for clock_gettime under -std=c99 */
+#endif
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "puzzles.h"
+
+enum { PH_NEW_DESC, PH_VALIDATE_DESC, PH_NEW_GAME, PH_SOLVE, PH_TOTAL,
+       NPHASES };
+static const char *const phase_names[NPHASES] = {
+    "new_desc", "validate_desc", "new_game", "solve", "total"
+};
+
+struct bench_options {
+    int iterations, warmup;
+    const char *seed;
+};
+
+static bool first_result = true;
+
+/*
+ * Wall-clock time in seconds. Not clock(), which adds up the CPU time
+ * of every thread in the process: Mines makes several generation
+ * attempts at once in separate threads, and throws most of them away.
+ */
+static double now(void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static int compare_doubles(const void *av, const void *bv)
+{
+    double a = *(const double *)av, b = *(const double *)bv;
+    return a < b ? -1 : a > b ? +1 : 0;
+}
+
+/* Nearest-rank percentile of a sorted array. */
+static double percentile(const double *sorted, int n, int pct)
+{
+    int rank = (n * pct + 99) / 100;
+    if (rank < 1)
+        rank = 1;
+    return sorted[rank - 1];
+}
+
+static void print_json_string(const char *s)
+{
+    putchar('"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            printf("\\%c", c);
+        else if (c < 0x20)
+            printf("\\u%04x", c);
+        else
+            putchar(c);
+    }
+    putchar('"');
+}
+
+/*
+ * Seed string for the ith generation of a run, matching the
+ * convention used by the --generate loop in the GTK front end.
+ */
+static char *make_seed(const char *prefix, const char *tag, int i)
+{
+    char *seed = snewn(strlen(prefix) + strlen(tag) + 40, char);
+    if (i == 0 && !*tag)
+        strcpy(seed, prefix);
+    else
+        sprintf(seed, "%s-%s%d", prefix, tag, i);
+    return seed;
+}
+
+/*
+ * Run all four phases once. Returns NULL on success, filling in
+ * times[] (with a negative solve time if the puzzle can't solve
+ * without its aux_info), or an error message on failure.
+ */
+static const char *bench_one(midend *me, const game *ourgame,
+                             const game_params *params, const char *seed,
+                             double *times)
+{
+    random_state *rs;
+    char *desc, *aux = NULL, *move;
+    const char *err;
+    game_state *state;
+    double start;
+
+    rs = random_new_from_seed(seed);
+    start = now();
+    desc = ourgame->new_desc(params, rs, &aux, false);
+    times[PH_NEW_DESC] = now() - start;
+    random_free(rs);
+
+    start = now();
+    err = ourgame->validate_desc(params, desc);
+    times[PH_VALIDATE_DESC] = now() - start;
+    if (err) {
+        sfree(desc);
+        sfree(aux);
+        return err;
+    }
+
+    start = now();
+    state = ourgame->new_game(me, params, desc);
+    times[PH_NEW_GAME] = now() - start;
+
+    times[PH_SOLVE] = -1.0;
+    if (ourgame->can_solve) {
+        /*
+         * Solve without the aux_info, as '--test-solve' does, so that
+         * we time the puzzle's actual solver. As there, "Solution not
+         * known" just means the puzzle has no solver of its own.
+         */
+        err = NULL;
+        start = now();
+        move = ourgame->solve(state, state, NULL, &err);
+        if (move) {
+            times[PH_SOLVE] = now() - start;
+            sfree(move);
+        } else if (err && strcmp(err, "Solution not known for this puzzle")) {
+            ourgame->free_game(state);
+            sfree(desc);
+            sfree(aux);
+            return err;
+        }
+    }
+
+    times[PH_TOTAL] = times[PH_NEW_DESC] + times[PH_VALIDATE_DESC] +
+        times[PH_NEW_GAME] + (times[PH_SOLVE] > 0 ? times[PH_SOLVE] : 0);
+
+    ourgame->free_game(state);
+    sfree(desc);
+    sfree(aux);
+    return NULL;
+}
+
+static void print_stats(const char *name, double *samples, int n)
+{
+    double total = 0.0;
+    int i;
+
+    qsort(samples, n, sizeof(*samples), compare_doubles);
+    for (i = 0; i < n; i++)
+        total += samples[i];
+
+    printf("        \"%s\": {\"mean\": %.9f, \"p50\": %.9f, "
+           "\"p95\": %.9f, \"p99\": %.9f, \"max\": %.9f}",
+           name, total / n, percentile(samples, n, 50),
+           percentile(samples, n, 95), percentile(samples, n, 99),
+           samples[n-1]);
+}
+
+/*
+ * Benchmark one set of parameters and print its JSON result object.
+ * Returns false if any generation failed.
+ */
+static bool bench_params(midend *me, const game *ourgame,
+                         const game_params *params, const char *title,
+                         const struct bench_options *opts)
+{
+    double times[NPHASES], *samples[NPHASES], slowest = -1.0;
+    char *paramstr, *seed, *slowest_seed = NULL;
+    const char *err = NULL;
+    int i, p, nsolved = 0;
+
+    paramstr = ourgame->encode_params(params, true);
+
+    for (i = 0; i < opts->warmup && !err; i++) {
+        seed = make_seed(opts->seed, "w", i);
+        err = bench_one(me, ourgame, params, seed, times);
+        sfree(seed);
+    }
+
+    for (p = 0; p < NPHASES; p++)
+        samples[p] = snewn(opts->iterations, double);
+
+    for (i = 0; i < opts->iterations && !err; i++) {
+        seed = make_seed(opts->seed, "", i);
+        err = bench_one(me, ourgame, params, seed, times);
+        if (!err) {
+            for (p = 0; p < NPHASES; p++)
+                if (p != PH_SOLVE)
+                    samples[p][i] = times[p];
+            if (times[PH_SOLVE] >= 0)
+                samples[PH_SOLVE][nsolved++] = times[PH_SOLVE];
+            if (times[PH_TOTAL] > slowest) {
+                slowest = times[PH_TOTAL];
+                sfree(slowest_seed);
+                slowest_seed = seed;
+                seed = NULL;
+            }
+        }
+        sfree(seed);
+    }
+
+    printf("%s    {\n      \"game\": ", first_result ? "" : ",\n");
+    first_result = false;
+    print_json_string(ourgame->name);
+    printf(",\n      \"preset\": ");
+    print_json_string(title);
+    printf(",\n      \"params\": ");
+    print_json_string(paramstr);
+    if (err) {
+        printf(",\n      \"error\": ");
+        print_json_string(err);
+        fprintf(stderr, "%s %s: %s\n", ourgame->name, paramstr, err);
+    } else {
+        printf(",\n      \"slowest_seed\": ");
+        print_json_string(slowest_seed);
+        printf(",\n      \"phases\": {\n");
+        for (p = 0; p < NPHASES; p++) {
+            if (p == PH_SOLVE && nsolved == 0)
+                continue;
+            if (p > 0)
+                printf(",\n");
+            print_stats(phase_names[p], samples[p],
+                        p == PH_SOLVE ? nsolved : opts->iterations);
+        }
+        printf("\n      }");
+    }
+    printf("\n    }");
+
+    for (p = 0; p < NPHASES; p++)
+        sfree(samples[p]);
+    sfree(slowest_seed);
+    sfree(paramstr);
+    return err == NULL;
+}
+
+static bool bench_menu(midend *me, const game *ourgame,
+                       struct preset_menu *menu,
+                       const struct bench_options *opts)
+{
+    bool ok = true;
+    int i;
+
+    for (i = 0; i < menu->n_entries; i++) {
+        if (menu->entries[i].params) {
+            if (!bench_params(me, ourgame, menu->entries[i].params,
+                              menu->entries[i].title, opts))
+                ok = false;
+        } else {
+            if (!bench_menu(me, ourgame, menu->entries[i].submenu, opts))
+                ok = false;
+        }
+    }
+    return ok;
+}
+
+static bool bench_game(const game *ourgame, const char *paramstr,
+                       const struct bench_options *opts)
+{
+    midend *me = midend_new(NULL, ourgame, NULL, NULL);
+    bool ok;
+
+    if (paramstr) {
+        game_params *params = ourgame->default_params();
+        const char *err;
+
+        ourgame->decode_params(params, paramstr);
+        err = ourgame->validate_params(params, true);
+        if (err) {
+            fprintf(stderr, "%s %s: %s\n", ourgame->name, paramstr, err);
+            ok = false;
+        } else {
+            ok = bench_params(me, ourgame, params, paramstr, opts);
+        }
+        ourgame->free_params(params);
+    } else {
+        ok = bench_menu(me, ourgame, midend_get_presets(me, NULL), opts);
+    }
+
+    midend_free(me);
+    return ok;
+}
+
+static const char usage[] =
+    "[--iterations <n>] [--warmup <n>] [--seed <seed>] "
+    "[<game>[:<params>] ...]";
+
+int main(int argc, char **argv)
+{
+    const char *pname = argv[0];
+    struct bench_options opts;
+    const char **games = snewn(argc, const char *);
+    int ngames = 0, i;
+    bool ok = true;
+
+    opts.iterations = 100;
+    opts.warmup = 3;
+    opts.seed = "benchpuzz";
+
+    while (--argc > 0) {
+        const char *p = *++argv;
+        if (!strcmp(p, "--iterations") || !strcmp(p, "--warmup")) {
+            int n;
+            if (--argc <= 0)
+                usage_exit(pname, "option requires an argument", usage);
+            n = atoi(*++argv);
+            if (!strcmp(p, "--iterations")) {
+                if (n < 1)
+                    usage_exit(pname, "--iterations must be at least 1",
+                               usage);
+                opts.iterations = n;
+            } else {
+                if (n < 0)
+                    usage_exit(pname, "--warmup must not be negative", usage);
+                opts.warmup = n;
+            }
+        } else if (!strcmp(p, "--seed")) {
+            if (--argc <= 0)
+                usage_exit(pname, "option requires an argument", usage);
+            opts.seed = *++argv;
+        } else if (!strcmp(p, "--help")) {
+            usage_exit(pname, NULL, usage);
+        } else if (p[0] == '-') {
+            usage_exit(pname, "unrecognised option", usage);
+        } else {
+            games[ngames++] = p;
+        }
+    }
+
+    printf("{\n  \"iterations\": %d,\n  \"warmup\": %d,\n  \"seed\": ",
+           opts.iterations, opts.warmup);
+    print_json_string(opts.seed);
+    printf(",\n  \"results\": [\n");
+
+    if (ngames == 0) {
+        for (i = 0; i < gamecount; i++)
+            if (!bench_game(gamelist[i], NULL, &opts))
+                ok = false;
+    } else {
+        for (i = 0; i < ngames; i++) {
+            const char *colon = strchr(games[i], ':');
+            size_t len = colon ? colon - games[i] : strlen(games[i]);
+            const game *ourgame = find_game(games[i], len);
+
+            if (!ourgame) {
+                fprintf(stderr, "%s: unrecognised game '%.*s'\n",
+                        pname, (int)len, games[i]);
+                ok = false;
+                continue;
+            }
+            if (!bench_game(ourgame, colon ? colon + 1 : NULL, &opts))
+                ok = false;
+        }
+    }
+
+    printf("\n  ]\n}\n");
+    sfree(games);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,895 @@
+/*
+ * btree234.c: an alternative implementation of the API in
+ * tree234.h, as a counted B+-tree.
+ *
+ * The 2-3-4 tree in tree234.c has at most three elements in a node,
+ * so a search in a big tree follows a long chain of pointers, most
+ * of which miss the cache. Here each node holds up to BMAX entries,
+ * which makes the tree several times shallower, and a search spends
+ * its time scanning contiguous arrays instead.
+ *
+ * All the elements live in the leaves, which are linked together in
+ * order, so that a cursor can step from one to the next without
+ * going back up the tree. An internal node keeps, for each of its
+ * children, the number of elements in that subtree (for indexed
+ * access) and a copy of the smallest element in it (for sorted
+ * access). Those copies are always elements still in the tree, so
+ * the comparison function never sees one that the user has deleted
+ * and perhaps freed.
+ *
+ * To build the puzzles with this in place of tree234.c, configure
+ * with -DPUZZLES_BTREE234=ON.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tree234.h"
+
+#include "puzzles.h"
+
+/*
+ * Maximum number of entries in a node. Every node except the root
+ * is kept at least half full.
+ *
+ * A leaf's elements then fill two 64-byte cache lines, and so do
+ * the subtree minima of an internal node, which are all a search
+ * through it looks at.
+ */
+#define BMAX 16
+#define BMIN (BMAX / 2)
+
+/*
+ * A tree of 2^31 elements with nodes at least half full is nowhere
+ * near this deep.
+ */
+#define BMAXDEPTH 32
+
+typedef struct bnode234 bnode234;
+typedef struct bleaf234 bleaf234;
+typedef struct binternal234 binternal234;
+
+struct bnode234 {
+    int n;                             /* number of entries in use */
+    bool leaf;
+    /*
+     * In a leaf, the elements themselves. In an internal node, the
+     * smallest element in each child's subtree.
+     */
+    void *elems[BMAX];
+};
+
+struct bleaf234 {
+    bnode234 node;
+    bleaf234 *prev, *next;
+};
+
+struct binternal234 {
+    bnode234 node;
+    bnode234 *kids[BMAX];
+    int counts[BMAX];
+};
+
+#define LEAF(n) ((bleaf234 *)(n))
+#define INTERNAL(n) ((binternal234 *)(n))
+
+struct tree234_Tag {
+    bnode234 *root;                    /* NULL if the tree is empty */
+    int count;
+    cmpfn234 cmp;
+};
+
+/*
+ * One step of a path from the root down to a leaf: the internal
+ * node, and which of its children we went into.
+ */
+struct bstep234 {
+    binternal234 *n;
+    int ki;
+};
+
+static bnode234 *newnode234(bool leaf)
+{
+    bnode234 *n;
+
+    if (leaf) {
+        bleaf234 *l = snew(bleaf234);
+        l->prev = l->next = NULL;
+        n = &l->node;
+    } else {
+        binternal234 *in = snew(binternal234);
+        n = &in->node;
+    }
+    n->n = 0;
+    n->leaf = leaf;
+    return n;
+}
+
+static void freenode234(bnode234 *n)
+{
+    if (!n->leaf) {
+        int i;
+        for (i = 0; i < n->n; i++)
+            freenode234(INTERNAL(n)->kids[i]);
+        sfree(INTERNAL(n));
+    } else {
+        sfree(LEAF(n));
+    }
+}
+
+static int countnode234(bnode234 *n)
+{
+    int i, count;
+
+    if (n->leaf)
+        return n->n;
+    for (i = count = 0; i < n->n; i++)
+        count += INTERNAL(n)->counts[i];
+    return count;
+}
+
+tree234 *newtree234(cmpfn234 cmp)
+{
+    tree234 *t = snew(tree234);
+    t->root = NULL;
+    t->count = 0;
+    t->cmp = cmp;
+    return t;
+}
+
+void freetree234(tree234 *t)
+{
+    if (t->root)
+        freenode234(t->root);
+    sfree(t);
+}
+
+int count234(tree234 *t)
+{
+    return t->count;
+}
+
+/*
+ * Copy entries [from, from+len) of node src to position 'to' of node
+ * dst, which may be the same node. Both must be at the same level.
+ */
+static void moveentries234(bnode234 *dst, int to, bnode234 *src, int from,
+                           int len)
+{
+    memmove(dst->elems + to, src->elems + from, len * sizeof(void *));
+    if (!src->leaf) {
+        memmove(INTERNAL(dst)->kids + to, INTERNAL(src)->kids + from,
+                len * sizeof(bnode234 *));
+        memmove(INTERNAL(dst)->counts + to, INTERNAL(src)->counts + from,
+                len * sizeof(int));
+    }
+}
+
+/*
+ * Insert an entry at position pos of node n: an element, if n is a
+ * leaf, or a child with its count and smallest element if not. If n
+ * was full, it's split in two, and the new right half is returned
+ * for the caller to insert into the parent.
+ */
+static bnode234 *nodeinsert234(bnode234 *n, int pos, void *e,
+                               bnode234 *kid, int count)
+{
+    bnode234 *right = NULL, *dst = n;
+
+    if (n->n == BMAX) {
+        right = newnode234(n->leaf);
+        moveentries234(right, 0, n, BMIN, BMAX - BMIN);
+        right->n = BMAX - BMIN;
+        n->n = BMIN;
+        if (n->leaf) {
+            bleaf234 *l = LEAF(n), *r = LEAF(right);
+            r->next = l->next;
+            if (r->next)
+                r->next->prev = r;
+            r->prev = l;
+            l->next = r;
+        }
+        if (pos > BMIN) {
+            dst = right;
+            pos -= BMIN;
+        }
+    }
+
+    moveentries234(dst, pos+1, dst, pos, dst->n - pos);
+    dst->elems[pos] = e;
+    if (!dst->leaf) {
+        INTERNAL(dst)->kids[pos] = kid;
+        INTERNAL(dst)->counts[pos] = count;
+    }
+    dst->n++;
+
+    return right;
+}
+
+/*
+ * Insert e at position pos of a leaf, given the path down to it, and
+ * fix up everything above.
+ */
+static void leafinsert234(tree234 *t, struct bstep234 *path, int depth,
+                          bleaf234 *leaf, int pos, void *e)
+{
+    bnode234 *right;
+    int d;
+
+    right = nodeinsert234(&leaf->node, pos, e, NULL, 0);
+
+    for (d = depth; d-- > 0 ;) {
+        binternal234 *p = path[d].n;
+        int ki = path[d].ki;
+
+        p->counts[ki]++;
+        p->node.elems[ki] = p->kids[ki]->elems[0];
+        if (right) {
+            int rcount = countnode234(right);
+            p->counts[ki] -= rcount;
+            right = nodeinsert234(&p->node, ki+1, right->elems[0],
+                                  right, rcount);
+        }
+    }
+
+    if (right) {
+        /*
+         * The root has split, so the tree gets a level deeper.
+         */
+        binternal234 *root = INTERNAL(newnode234(false));
+        root->kids[0] = t->root;
+        root->counts[0] = countnode234(t->root);
+        root->node.elems[0] = t->root->elems[0];
+        root->kids[1] = right;
+        root->counts[1] = countnode234(right);
+        root->node.elems[1] = right->elems[0];
+        root->node.n = 2;
+        t->root = &root->node;
+    }
+
+    t->count++;
+}
+
+/*
+ * Find the leaf holding the element at a given index, and that
+ * element's position in it, recording the path down. If 'inserting'
+ * is set, then the index may be equal to the element count, and
+ * we're looking for the place to insert a new element so that it
+ * ends up with that index.
+ */
+static bleaf234 *descendindex234(tree234 *t, int index, bool inserting,
+                                 struct bstep234 *path, int *depth,
+                                 int *pos)
+{
+    bnode234 *n = t->root;
+    int d = 0;
+
+    while (!n->leaf) {
+        binternal234 *in = INTERNAL(n);
+        int ki;
+
+        for (ki = 0; ki < n->n - 1; ki++) {
+            if (index < in->counts[ki] + (inserting ? 1 : 0))
+                break;
+            index -= in->counts[ki];
+        }
+        assert(d < BMAXDEPTH);
+        path[d].n = in;
+        path[d].ki = ki;
+        d++;
+        n = in->kids[ki];
+    }
+
+    *depth = d;
+    *pos = index;
+    return LEAF(n);
+}
+
+/*
+ * Find the leaf in which e would belong, and the position in it of
+ * the first element not less than e. *base is filled in with the
+ * number of elements in the tree to the left of that leaf, and the
+ * path down is recorded if 'path' is non-NULL.
+ */
+static bleaf234 *descendkey234(tree234 *t, void *e, cmpfn234 cmp,
+                               struct bstep234 *path, int *depth,
+                               int *base, int *pos)
+{
+    bnode234 *n = t->root;
+    int d = 0, idx = 0, lo, hi;
+
+    while (!n->leaf) {
+        binternal234 *in = INTERNAL(n);
+        int ki, i;
+
+        /*
+         * Go into the last child whose smallest element is not
+         * greater than e, or the first child if there isn't one.
+         */
+        lo = 1;
+        hi = n->n;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (cmp(e, n->elems[mid]) < 0)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        ki = lo - 1;
+
+        for (i = 0; i < ki; i++)
+            idx += in->counts[i];
+        if (path) {
+            assert(d < BMAXDEPTH);
+            path[d].n = in;
+            path[d].ki = ki;
+        }
+        d++;
+        n = in->kids[ki];
+    }
+
+    lo = 0;
+    hi = n->n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cmp(e, n->elems[mid]) > 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    *depth = d;
+    *base = idx;
+    *pos = lo;
+    return LEAF(n);
+}
+
+static void *add234_internal(tree234 *t, void *e, int index)
+{
+    struct bstep234 path[BMAXDEPTH];
+    bleaf234 *leaf;
+    int depth, pos;
+
+    if (!t->root) {
+        t->root = newnode234(true);
+        t->root->elems[0] = e;
+        t->root->n = 1;
+        t->count = 1;
+        return e;
+    }
+
+    if (index >= 0) {
+        if (index > t->count)
+            return NULL;               /* error: index out of range */
+        leaf = descendindex234(t, index, true, path, &depth, &pos);
+    } else {
+        int base;
+        leaf = descendkey234(t, e, t->cmp, path, &depth, &base, &pos);
+        if (pos < leaf->node.n && t->cmp(e, leaf->node.elems[pos]) == 0)
+            return leaf->node.elems[pos];  /* already exists */
+    }
+
+    leafinsert234(t, path, depth, leaf, pos, e);
+    return e;
+}
+
+void *add234(tree234 *t, void *e)
+{
+    if (!t->cmp)                       /* tree is unsorted */
+        return NULL;
+
+    return add234_internal(t, e, -1);
+}
+
+void *addpos234(tree234 *t, void *e, int index)
+{
+    if (index < 0 ||                   /* index out of range */
+        t->cmp)                        /* tree is sorted */
+        return NULL;                   /* return failure */
+
+    return add234_internal(t, e, index);  /* this checks the upper bound */
+}
+
+/*
+ * Find the leaf holding the element at a given index, which must be
+ * in range, and set *pos to that element's position in it.
+ */
+static bleaf234 *indexleaf234(tree234 *t, int index, int *pos)
+{
+    bnode234 *n = t->root;
+
+    while (!n->leaf) {
+        binternal234 *in = INTERNAL(n);
+        int ki = 0;
+
+        while (index >= in->counts[ki])
+            index -= in->counts[ki++];
+        n = in->kids[ki];
+    }
+
+    *pos = index;
+    return LEAF(n);
+}
+
+void *index234(tree234 *t, int index)
+{
+    bleaf234 *leaf;
+    int pos;
+
+    if (index < 0 || index >= t->count)
+        return NULL;                   /* out of range */
+
+    leaf = indexleaf234(t, index, &pos);
+    return leaf->node.elems[pos];
+}
+
+void *findrelpos234(tree234 *t, void *e, cmpfn234 cmp,
+                    int relation, int *index)
+{
+    bleaf234 *leaf;
+    void *ret;
+    int depth, base, pos, lt, idx;
+    bool eq;
+
+    if (t->root == NULL)
+        return NULL;
+
+    if (cmp == NULL)
+        cmp = t->cmp;
+
+    if (e == NULL) {
+        assert(relation == REL234_LT || relation == REL234_GT);
+        idx = (relation == REL234_LT ? t->count - 1 : 0);
+        ret = index234(t, idx);
+        if (index) *index = idx;
+        return ret;
+    }
+
+    /*
+     * Find how many elements of the tree are less than e, and
+     * whether the next one is equal to it. Then the element we want
+     * is at most one place either side of there, which means it's
+     * in this leaf or one of its neighbours.
+     */
+    leaf = descendkey234(t, e, cmp, NULL, &depth, &base, &pos);
+    eq = (pos < leaf->node.n && cmp(e, leaf->node.elems[pos]) == 0);
+    lt = base + pos;
+
+    switch (relation) {
+      case REL234_EQ:
+        if (!eq)
+            return NULL;
+        idx = lt;
+        break;
+      case REL234_LT:
+        idx = lt - 1;
+        break;
+      case REL234_LE:
+        idx = (eq ? lt : lt - 1);
+        break;
+      case REL234_GT:
+        idx = (eq ? lt + 1 : lt);
+        break;
+      default: /* REL234_GE */
+        idx = lt;
+        break;
+    }
+
+    if (idx < base) {
+        leaf = leaf->prev;
+        ret = leaf ? leaf->node.elems[leaf->node.n - 1] : NULL;
+    } else if (idx - base >= leaf->node.n) {
+        leaf = leaf->next;
+        ret = leaf ? leaf->node.elems[0] : NULL;
+    } else {
+        ret = leaf->node.elems[idx - base];
+    }
+
+    if (ret && index) *index = idx;
+    return ret;
+}
+
+void *find234(tree234 *t, void *e, cmpfn234 cmp)
+{
+    return findrelpos234(t, e, cmp, REL234_EQ, NULL);
+}
+
+void *findrel234(tree234 *t, void *e, cmpfn234 cmp, int relation)
+{
+    return findrelpos234(t, e, cmp, relation, NULL);
+}
+
+void *findpos234(tree234 *t, void *e, cmpfn234 cmp, int *index)
+{
+    return findrelpos234(t, e, cmp, REL234_EQ, index);
+}
+
+/*
+ * Child ki of internal node p has dropped below BMIN entries. Borrow
+ * an entry from a neighbour if one can spare it, or else merge with
+ * a neighbour. Returns the index in p of the node now containing
+ * child ki's entries.
+ */
+static int rebalance234(binternal234 *p, int ki)
+{
+    bnode234 *c = p->kids[ki], *sib;
+    int moved;
+
+    if (ki > 0 && (sib = p->kids[ki-1])->n > BMIN) {
+        /* Move the last entry of the left neighbour to the start
+         * of c. */
+        moveentries234(c, 1, c, 0, c->n);
+        moveentries234(c, 0, sib, sib->n - 1, 1);
+        c->n++;
+        sib->n--;
+        moved = (c->leaf ? 1 : INTERNAL(c)->counts[0]);
+        p->counts[ki-1] -= moved;
+        p->counts[ki] += moved;
+        p->node.elems[ki] = c->elems[0];
+        return ki;
+    }
+
+    if (ki+1 < p->node.n && (sib = p->kids[ki+1])->n > BMIN) {
+        /* Move the first entry of the right neighbour to the end
+         * of c. */
+        moveentries234(c, c->n, sib, 0, 1);
+        moveentries234(sib, 0, sib, 1, sib->n - 1);
+        sib->n--;
+        moved = (c->leaf ? 1 : INTERNAL(c)->counts[c->n]);
+        c->n++;
+        p->counts[ki] += moved;
+        p->counts[ki+1] -= moved;
+        p->node.elems[ki+1] = sib->elems[0];
+        return ki;
+    }
+
+    /*
+     * Neither neighbour has anything to spare, so merge c with one
+     * of them: the left one if it has one, moving the right one of
+     * the pair into the left.
+     */
+    if (ki > 0)
+        ki--;
+    c = p->kids[ki];
+    sib = p->kids[ki+1];
+    assert(c->n + sib->n <= BMAX);
+    moveentries234(c, c->n, sib, 0, sib->n);
+    c->n += sib->n;
+    if (c->leaf) {
+        LEAF(c)->next = LEAF(sib)->next;
+        if (LEAF(c)->next)
+            LEAF(c)->next->prev = LEAF(c);
+        sfree(LEAF(sib));
+    } else {
+        sfree(INTERNAL(sib));
+    }
+    p->counts[ki] += p->counts[ki+1];
+    moveentries234(&p->node, ki+1, &p->node, ki+2, p->node.n - (ki+2));
+    p->node.n--;
+    return ki;
+}
+
+static void *delpos234_internal(tree234 *t, int index)
+{
+    struct bstep234 path[BMAXDEPTH];
+    bleaf234 *leaf;
+    bnode234 *n;
+    void *ret;
+    int depth, pos, d;
+
+    leaf = descendindex234(t, index, false, path, &depth, &pos);
+    ret = leaf->node.elems[pos];
+    moveentries234(&leaf->node, pos, &leaf->node, pos+1,
+                   leaf->node.n - (pos+1));
+    leaf->node.n--;
+    t->count--;
+
+    n = &leaf->node;
+    for (d = depth; d-- > 0 ;) {
+        binternal234 *p = path[d].n;
+        int ki = path[d].ki;
+
+        p->counts[ki]--;
+        if (n->n < BMIN)
+            ki = rebalance234(p, ki);
+        p->node.elems[ki] = p->kids[ki]->elems[0];
+        n = &p->node;
+    }
+
+    /*
+     * If the root is down to one child, that child becomes the
+     * root. If it's an empty leaf, the tree is now empty.
+     */
+    n = t->root;
+    if (!n->leaf && n->n == 1) {
+        t->root = INTERNAL(n)->kids[0];
+        sfree(INTERNAL(n));
+    } else if (n->leaf && n->n == 0) {
+        sfree(LEAF(n));
+        t->root = NULL;
+    }
+
+    return ret;
+}
+
+void *delpos234(tree234 *t, int index)
+{
+    if (index < 0 || index >= t->count)
+        return NULL;
+    return delpos234_internal(t, index);
+}
+
+void *del234(tree234 *t, void *e)
+{
+    int index;
+    if (!findrelpos234(t, e, NULL, REL234_EQ, &index))
+        return NULL;                   /* it wasn't in there anyway */
+    return delpos234_internal(t, index); /* it's there; delete it. */
+}
+
+/*
+ * Build a tree from the n elements in 'elems', in that order, and
+ * put it in t, which must be empty. This makes every node as nearly
+ * equal in size as it can, and so takes O(n) time.
+ */
+static void build234(tree234 *t, void **elems, int n)
+{
+    bnode234 **level;
+    int *counts;
+    int nlevel, i, j;
+
+    if (n == 0)
+        return;
+
+    nlevel = (n + BMAX - 1) / BMAX;
+    level = snewn(nlevel, bnode234 *);
+    counts = snewn(nlevel, int);
+
+    for (i = 0; i < nlevel; i++) {
+        int start = (int)((long long)n * i / nlevel);
+        int end = (int)((long long)n * (i+1) / nlevel);
+        bnode234 *leaf = newnode234(true);
+
+        memcpy(leaf->elems, elems + start, (end - start) * sizeof(void *));
+        leaf->n = end - start;
+        if (i > 0) {
+            LEAF(leaf)->prev = LEAF(level[i-1]);
+            LEAF(level[i-1])->next = LEAF(leaf);
+        }
+        level[i] = leaf;
+        counts[i] = end - start;
+    }
+
+    /*
+     * Now group each level into parents in the same way, until
+     * there's only one node left. Each parent is written into the
+     * arrays at or before the position of its first child, so we
+     * can do this in place.
+     */
+    while (nlevel > 1) {
+        int nparents = (nlevel + BMAX - 1) / BMAX;
+
+        for (i = 0; i < nparents; i++) {
+            int start = nlevel * i / nparents;
+            int end = nlevel * (i+1) / nparents;
+            binternal234 *p = INTERNAL(newnode234(false));
+            int count = 0;
+
+            for (j = start; j < end; j++) {
+                p->kids[j - start] = level[j];
+                p->counts[j - start] = counts[j];
+                p->node.elems[j - start] = level[j]->elems[0];
+                count += counts[j];
+            }
+            p->node.n = end - start;
+            level[i] = &p->node;
+            counts[i] = count;
+        }
+        nlevel = nparents;
+    }
+
+    t->root = level[0];
+    t->count = n;
+    sfree(level);
+    sfree(counts);
+}
+
+tree234 *buildtree234(cmpfn234 cmp, void **elems, int n)
+{
+    tree234 *t = newtree234(cmp);
+    int i;
+
+    if (cmp)
+        for (i = 1; i < n; i++)
+            assert(cmp(elems[i-1], elems[i]) < 0);
+
+    build234(t, elems, n);
+    return t;
+}
+
+/*
+ * Return a newly allocated array of the elements of a tree, in
+ * order, and empty the tree if 'empty' is set.
+ */
+static void **flatten234(tree234 *t, bool empty)
+{
+    void **elems = snewn(t->count, void *);
+    bnode234 *n = t->root;
+    bleaf234 *leaf;
+    int i = 0;
+
+    if (n) {
+        while (!n->leaf)
+            n = INTERNAL(n)->kids[0];
+        for (leaf = LEAF(n); leaf; leaf = leaf->next) {
+            memcpy(elems + i, leaf->node.elems,
+                   leaf->node.n * sizeof(void *));
+            i += leaf->node.n;
+        }
+        assert(i == t->count);
+        if (empty) {
+            freenode234(t->root);
+            t->root = NULL;
+            t->count = 0;
+        }
+    }
+
+    return elems;
+}
+
+/*
+ * Splitting, joining and copying rebuild the trees involved from
+ * scratch, so they take time linear in the number of elements,
+ * rather than logarithmic as they do in tree234.c.
+ */
+tree234 *splitpos234(tree234 *t, int index, bool before)
+{
+    tree234 *ret;
+    void **elems;
+    int count = t->count;
+
+    if (index < 0 || index > count)
+        return NULL;                   /* error */
+    ret = newtree234(t->cmp);
+    elems = flatten234(t, true);
+    if (before) {
+        /* We want to return the ones before the index. */
+        build234(ret, elems, index);
+        build234(t, elems + index, count - index);
+    } else {
+        /*
+         * We want to keep the ones before the index and return the
+         * ones after.
+         */
+        build234(t, elems, index);
+        build234(ret, elems + index, count - index);
+    }
+    sfree(elems);
+    return ret;
+}
+
+tree234 *split234(tree234 *t, void *e, cmpfn234 cmp, int rel)
+{
+    bool before;
+    int index;
+
+    assert(rel != REL234_EQ);
+
+    if (rel == REL234_GT || rel == REL234_GE) {
+        before = true;
+        rel = (rel == REL234_GT ? REL234_LE : REL234_LT);
+    } else {
+        before = false;
+    }
+    if (!findrelpos234(t, e, cmp, rel, &index))
+        index = 0;
+
+    return splitpos234(t, index+1, before);
+}
+
+/*
+ * Move all the elements of t1 and t2, in that order, into dst,
+ * which is one of them.
+ */
+static void join234_internal(tree234 *t1, tree234 *t2, tree234 *dst)
+{
+    int n1 = t1->count, n2 = t2->count;
+    void **e1 = flatten234(t1, true), **e2 = flatten234(t2, true);
+    void **elems = snewn(n1 + n2, void *);
+
+    memcpy(elems, e1, n1 * sizeof(void *));
+    memcpy(elems + n1, e2, n2 * sizeof(void *));
+    build234(dst, elems, n1 + n2);
+    sfree(e1);
+    sfree(e2);
+    sfree(elems);
+}
+
+tree234 *join234(tree234 *t1, tree234 *t2)
+{
+    if (t2->count > 0) {
+        if (t1->cmp) {
+            void *element = index234(t2, 0);
+            element = findrelpos234(t1, element, NULL, REL234_GE, NULL);
+            if (element)
+                return NULL;
+        }
+        join234_internal(t1, t2, t1);
+    }
+    return t1;
+}
+
+tree234 *join234r(tree234 *t1, tree234 *t2)
+{
+    if (t1->count > 0) {
+        if (t2->cmp) {
+            void *element = index234(t1, t1->count - 1);
+            element = findrelpos234(t2, element, NULL, REL234_LE, NULL);
+            if (element)
+                return NULL;
+        }
+        join234_internal(t1, t2, t2);
+    }
+    return t2;
+}
+
+tree234 *copytree234(tree234 *t, copyfn234 copyfn, void *copyfnstate)
+{
+    tree234 *t2 = newtree234(t->cmp);
+    void **elems;
+    int count = t->count, i;
+
+    elems = flatten234(t, false);
+    if (copyfn)
+        for (i = 0; i < count; i++)
+            elems[i] = copyfn(copyfnstate, elems[i]);
+    build234(t2, elems, count);
+    sfree(elems);
+    return t2;
+}
+
+void *cursorindex234(tree234 *t, int index, cursor234 *c)
+{
+    bleaf234 *leaf;
+    int pos;
+
+    if (index < 0 || index >= t->count) {
+        c->node = NULL;
+        return NULL;
+    }
+
+    leaf = indexleaf234(t, index, &pos);
+    c->node = leaf;
+    c->pos = pos;
+    return leaf->node.elems[pos];
+}
+
+void *cursornext234(cursor234 *c)
+{
+    bleaf234 *leaf = (bleaf234 *)c->node;
+
+    if (!leaf)
+        return NULL;
+    if (++c->pos < leaf->node.n)
+        return leaf->node.elems[c->pos];
+    c->node = leaf = leaf->next;
+    c->pos = 0;
+    return leaf ? leaf->node.elems[0] : NULL;
+}
+
+void *cursorprev234(cursor234 *c)
+{
+    bleaf234 *leaf = (bleaf234 *)c->node;
+
+    if (!leaf)
+        return NULL;
+    if (--c->pos >= 0)
+        return leaf->node.elems[c->pos];
+    c->node = leaf = leaf->prev;
+    if (!leaf)
+        return NULL;
+    c->pos = leaf->node.n - 1;
+    return leaf->node.elems[c->pos];
+}
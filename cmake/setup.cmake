@@ -2,6 +2,15 @@ set(PUZZLES_ENABLE_UNFINISHED ""
   CACHE STRING "List of puzzles in the 'unfinished' subdirectory \
 to build as if official (separated by ';')")
 
+set(PUZZLES_BTREE234 OFF
+  CACHE BOOL "Implement tree234.h with the B+-tree in btree234.c, \
+instead of the 2-3-4 tree in tree234.c")
+if(PUZZLES_BTREE234)
+  set(tree234_source btree234.c)
+else()
+  set(tree234_source tree234.c)
+endif()
+
 set(build_individual_puzzles TRUE)
 set(build_cli_programs TRUE)
 set(build_gui_programs TRUE)
@@ -51,6 +60,22 @@ check_include_file(tgmath.h HAVE_TGMATH_H)
 if(NOT HAVE_TGMATH_H)
   add_compile_definitions(NO_TGMATH_H)
 endif()
+check_include_file(sys/mman.h HAVE_SYS_MMAN_H)
+if(NOT HAVE_SYS_MMAN_H)
+  add_compile_definitions(NO_MMAP)
+endif()
+# Puzzle generators can use several threads where POSIX threads are
+# available (but not in a web browser, where they need special
+# support from the page hosting them, nor under NestedVM).
+set(THREADS_PREFER_PTHREAD_FLAG ON)
+find_package(Threads)
+if(CMAKE_USE_PTHREADS_INIT AND
+    NOT CMAKE_C_COMPILER MATCHES "emcc" AND
+    NOT CMAKE_SYSTEM_NAME MATCHES "NestedVM")
+  list(APPEND platform_libs Threads::Threads)
+else()
+  add_compile_definitions(NO_THREADS)
+endif()
 
 # Try to normalise source file pathnames as seen in __FILE__ (e.g.
 # assertion failure messages). Partly to avoid bloating the binaries
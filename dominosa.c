@@ -351,15 +351,29 @@ struct solver_scratch {
     struct findloopstate *fls;
     bool squares_by_number_initialised;
     int *wh_scratch, *pc_scratch, *pc_scratch2, *dc_scratch;
+    arena *ar;                  /* all of the arrays above come from here */
+    bool own_arena;
 };
 
-static struct solver_scratch *solver_make_scratch(int n)
+/*
+ * If 'ar' is NULL, the scratch space gets an arena of its own, which
+ * solver_free_scratch frees. Otherwise it stays in 'ar' until the
+ * caller frees that.
+ */
+static struct solver_scratch *solver_make_scratch(int n, arena *ar)
 {
     int dc = DCOUNT(n), w = n+2, h = n+1, wh = w*h;
     int pc = (w-1)*h + w*(h-1);
-    struct solver_scratch *sc = snew(struct solver_scratch);
+    bool own_arena = (ar == NULL);
+    struct solver_scratch *sc;
     int hi, lo, di, x, y, pi, si;
 
+    if (own_arena)
+        ar = arena_new();
+    sc = anew(ar, struct solver_scratch);
+    sc->ar = ar;
+    sc->own_arena = own_arena;
+
     sc->n = n;
     sc->dc = dc;
     sc->pc = pc;
@@ -367,10 +381,10 @@ static struct solver_scratch *solver_make_scratch(int n)
     sc->h = h;
     sc->wh = wh;
 
-    sc->dominoes = snewn(dc, struct solver_domino);
-    sc->placements = snewn(pc, struct solver_placement);
-    sc->squares = snewn(wh, struct solver_square);
-    sc->domino_placement_lists = snewn(pc, struct solver_placement *);
+    sc->dominoes = anewn(ar, dc, struct solver_domino);
+    sc->placements = anewn(ar, pc, struct solver_placement);
+    sc->squares = anewn(ar, wh, struct solver_square);
+    sc->domino_placement_lists = anewn(ar, pc, struct solver_placement *);
     sc->fls = findloop_new_state(wh);
 
     for (di = hi = 0; hi <= n; hi++) {
@@ -499,17 +513,9 @@ static void solver_free_scratch(struct solver_scratch *sc)
             sfree(sc->squares[i].name);
     }
 #endif
-    sfree(sc->dominoes);
-    sfree(sc->placements);
-    sfree(sc->squares);
-    sfree(sc->domino_placement_lists);
-    sfree(sc->squares_by_number);
     findloop_free_state(sc->fls);
-    sfree(sc->wh_scratch);
-    sfree(sc->pc_scratch);
-    sfree(sc->pc_scratch2);
-    sfree(sc->dc_scratch);
-    sfree(sc);
+    if (sc->own_arena)
+        arena_free(sc->ar);
 }
 
 static void solver_setup_grid(struct solver_scratch *sc, const int *numbers)
@@ -1031,9 +1037,9 @@ static bool deduce_set(struct solver_scratch *sc, bool doubles)
     bool done_something = false;
 
     if (!sc->squares_by_number)
-        sc->squares_by_number = snewn(sc->wh, struct solver_square *);
+        sc->squares_by_number = anewn(sc->ar, sc->wh, struct solver_square *);
     if (!sc->wh_scratch)
-        sc->wh_scratch = snewn(sc->wh, int);
+        sc->wh_scratch = anewn(sc->ar, sc->wh, int);
 
     if (!sc->squares_by_number_initialised) {
         /*
@@ -1418,13 +1424,13 @@ static bool deduce_forcing_chain(struct solver_scratch *sc)
     bool done_something = false;
 
     if (!sc->wh_scratch)
-        sc->wh_scratch = snewn(sc->wh, int);
+        sc->wh_scratch = anewn(sc->ar, sc->wh, int);
     if (!sc->pc_scratch)
-        sc->pc_scratch = snewn(sc->pc, int);
+        sc->pc_scratch = anewn(sc->ar, sc->pc, int);
     if (!sc->pc_scratch2)
-        sc->pc_scratch2 = snewn(sc->pc, int);
+        sc->pc_scratch2 = anewn(sc->ar, sc->pc, int);
     if (!sc->dc_scratch)
-        sc->dc_scratch = snewn(sc->dc, int);
+        sc->dc_scratch = anewn(sc->ar, sc->dc, int);
 
     /*
      * Start by identifying chains of placements which must all occur
@@ -1862,9 +1868,9 @@ struct alloc_loc {
     int sq[2];
 };
 
-static struct alloc_scratch *alloc_make_scratch(int n)
+static struct alloc_scratch *alloc_make_scratch(int n, arena *ar)
 {
-    struct alloc_scratch *as = snew(struct alloc_scratch);
+    struct alloc_scratch *as = anew(ar, struct alloc_scratch);
     int lo, hi;
 
     as->n = n;
@@ -1873,12 +1879,12 @@ static struct alloc_scratch *alloc_make_scratch(int n)
     as->wh = as->w * as->h;
     as->dc = DCOUNT(n);
 
-    as->layout = snewn(as->wh, int);
-    as->numbers = snewn(as->wh, int);
-    as->vals = snewn(as->dc, struct alloc_val);
-    as->locs = snewn(as->dc, struct alloc_loc);
-    as->wh_scratch = snewn(as->wh, int);
-    as->wh2_scratch = snewn(as->wh * 2, int);
+    as->layout = anewn(ar, as->wh, int);
+    as->numbers = anewn(ar, as->wh, int);
+    as->vals = anewn(ar, as->dc, struct alloc_val);
+    as->locs = anewn(ar, as->dc, struct alloc_loc);
+    as->wh_scratch = anewn(ar, as->wh, int);
+    as->wh2_scratch = anewn(ar, as->wh * 2, int);
 
     for (hi = 0; hi <= n; hi++)
         for (lo = 0; lo <= hi; lo++) {
@@ -1890,17 +1896,6 @@ static struct alloc_scratch *alloc_make_scratch(int n)
     return as;
 }
 
-static void alloc_free_scratch(struct alloc_scratch *as)
-{
-    sfree(as->layout);
-    sfree(as->numbers);
-    sfree(as->vals);
-    sfree(as->locs);
-    sfree(as->wh_scratch);
-    sfree(as->wh2_scratch);
-    sfree(as);
-}
-
 static void alloc_make_layout(struct alloc_scratch *as, random_state *rs)
 {
     int i, pos;
@@ -2224,6 +2219,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     int n = params->n, w = n+2, h = n+1, wh = w*h, diff = params->diff;
     struct solver_scratch *sc;
     struct alloc_scratch *as;
+    arena *ar;
     int i, j, k, len;
     char *ret;
 
@@ -2246,8 +2242,9 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     /*
      * Allocate space in which to lay the grid out.
      */
-    sc = solver_make_scratch(n);
-    as = alloc_make_scratch(n);
+    ar = arena_new();
+    sc = solver_make_scratch(n, ar);
+    as = alloc_make_scratch(n, ar);
 
     /*
      * I haven't been able to think of any particularly clever
@@ -2413,7 +2410,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     }
 
     solver_free_scratch(sc);
-    alloc_free_scratch(as);
+    arena_free(ar);
 
     return ret;
 }
@@ -2614,8 +2611,13 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 		extra = sprintf(buf, ";D%d,%d", i, i+1);
 	    else if (aux[i] == 'T')
 		extra = sprintf(buf, ";D%d,%d", i, i+w);
-	    else
+	    else if (aux[i] && strchr("RB.", aux[i]))
 		continue;
+	    else {
+		*error = "invalid char in aux";
+		sfree(ret);
+		return NULL;
+	    }
 
 	    if (retlen + extra + 1 >= retsize) {
 		retsize = retlen + extra + 256;
@@ -2626,7 +2628,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	}
 
     } else {
-        struct solver_scratch *sc = solver_make_scratch(n);
+        struct solver_scratch *sc = solver_make_scratch(n, NULL);
         solver_setup_grid(sc, state->numbers->numbers);
         run_solver(sc, DIFFCOUNT);
         ret = solution_move_string(sc);
@@ -3453,6 +3455,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILESIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -3532,7 +3535,7 @@ int main(int argc, char **argv)
     s = new_game(NULL, p, desc);
 
     solver_diagnostics = diagnostics;
-    sc = solver_make_scratch(p->n);
+    sc = solver_make_scratch(p->n, NULL);
     solver_setup_grid(sc, s->numbers->numbers);
     retd = run_solver(sc, maxdiff);
     if (retd == 0) {
@@ -19,6 +19,15 @@ struct findloopstate {
     int index, minindex, maxindex;
     int minreachable, maxreachable;
     int bridge;
+
+    /*
+     * Depth of each vertex in the spanning forest, and number of
+     * vertices in the subtree below it (inclusive). Only the
+     * incremental update functions need these, but findloop_is_bridge
+     * uses 'size' too, since unlike minindex and maxindex it stays
+     * meaningful after an update.
+     */
+    int depth, size;
 };
 
 struct findloopstate *findloop_new_state(int nvertices)
@@ -66,8 +75,8 @@ static bool findloop_is_bridge_oneway(
         return false;
 
     r = pv[u].component_root;
-    total = pv[r].maxindex - pv[r].minindex + 1;
-    below = pv[u].maxindex - pv[u].minindex + 1;
+    total = pv[r].size;
+    below = pv[u].size;
 
     if (u_vertices)
         *u_vertices = below;
@@ -122,6 +131,7 @@ bool findloop_run(struct findloopstate *pv, int nvertices,
             pv[v].sibling = pv[root].child;
             pv[root].child = v;
             pv[v].component_root = v;
+            pv[v].depth = 0;
             debug(("%d is new child of root\n", v));
 
             u = v;
@@ -145,6 +155,7 @@ bool findloop_run(struct findloopstate *pv, int nvertices,
                             pv[w].sibling = pv[u].child;
                             pv[w].parent = u;
                             pv[w].component_root = pv[u].component_root;
+                            pv[w].depth = pv[u].depth + 1;
                             pv[u].child = w;
                         }
 
@@ -234,6 +245,7 @@ bool findloop_run(struct findloopstate *pv, int nvertices,
          * its maxindex field.
          */
         pv[u].maxindex = index-1;
+        pv[u].size = pv[u].maxindex - pv[u].minindex + 1;
         debug(("  vertex %d <- maxindex %d\n", u, pv[u].maxindex));
 
         if (pv[u].sibling >= 0) {
@@ -357,6 +369,189 @@ bool findloop_run(struct findloopstate *pv, int nvertices,
     return nbridges < nedges;
 }
 
+/*
+ * Incremental updates.
+ *
+ * After findloop_run, the parent/child/sibling links describe a
+ * spanning forest of the graph, and every bridge is one of its edges,
+ * recorded at the child end. Adding an edge within a component, or
+ * removing a bridge, changes the status of easily found edges only,
+ * and the forest can be patched to match. Removing an edge that was
+ * part of a loop can turn any number of other edges into bridges,
+ * and finding out which ones is no easier than starting again, so we
+ * don't try.
+ *
+ * The patched forest is no longer indexed in preorder, so the
+ * incremental functions use 'depth' and 'size' instead of the index
+ * ranges.
+ */
+
+/* Remove u from its parent's list of children. */
+static void findloop_unlink_child(struct findloopstate *pv, int u)
+{
+    int *link = &pv[pv[u].parent].child;
+
+    while (*link != u)
+        link = &pv[*link].sibling;
+    *link = pv[u].sibling;
+    pv[u].sibling = -1;
+}
+
+static void findloop_link_child(struct findloopstate *pv, int u, int parent)
+{
+    pv[u].parent = parent;
+    pv[u].sibling = pv[parent].child;
+    pv[parent].child = u;
+}
+
+/*
+ * Copy u's component root to everything below it, and recompute
+ * their depths from u's.
+ */
+static void findloop_relabel(struct findloopstate *pv, int u)
+{
+    int v = pv[u].child;
+
+    while (v >= 0) {
+        pv[v].component_root = pv[u].component_root;
+        pv[v].depth = pv[pv[v].parent].depth + 1;
+
+        if (pv[v].child >= 0) {
+            v = pv[v].child;
+            continue;
+        }
+        while (pv[v].sibling < 0) {
+            v = pv[v].parent;
+            if (v == u)
+                return;
+        }
+        v = pv[v].sibling;
+    }
+}
+
+/*
+ * Turn u's tree upside down so that u is its root, by reversing the
+ * parent links on the path from u up to the old root. The bridge
+ * markers and subtree sizes on that path are moved or recomputed to
+ * match; component roots and depths are left for the caller to fix.
+ */
+static void findloop_reroot(struct findloopstate *pv, int u)
+{
+    int r = pv[u].component_root, root = pv[r].parent;
+    int total = pv[r].size;
+    int x, p, bridge, size;
+
+    if (u == r)
+        return;
+
+    p = pv[u].parent;
+    bridge = pv[u].bridge;
+    size = pv[u].size;
+    findloop_unlink_child(pv, u);
+    pv[u].parent = root;
+    pv[u].bridge = -1;
+    pv[u].size = total;
+
+    x = u;
+    while (1) {
+        /*
+         * x used to be the child of p, and is now its parent.
+         * 'bridge' and 'size' are x's old values.
+         */
+        int pp = pv[p].parent, pbridge = pv[p].bridge, psize = pv[p].size;
+
+        if (p != r)
+            findloop_unlink_child(pv, p);
+        findloop_link_child(pv, p, x);
+        pv[p].bridge = (bridge == p ? x : -1);
+        pv[p].size = total - size;
+        if (p == r)
+            break;
+
+        bridge = pbridge;
+        size = psize;
+        x = p;
+        p = pp;
+    }
+}
+
+bool findloop_add_edge(struct findloopstate *pv, int u, int v,
+                       findloop_changed_fn_t changed, void *ctx)
+{
+    int ru = pv[u].component_root, rv = pv[v].component_root;
+    int a;
+
+    if (ru == rv) {
+        /*
+         * The new edge completes a loop with the path between u and
+         * v in the spanning tree, so every edge on that path is now
+         * a loop edge. Nothing else changes.
+         */
+        while (u != v) {
+            if (pv[u].depth < pv[v].depth) {
+                int tmp = u; u = v; v = tmp;
+            }
+            if (pv[u].bridge >= 0 && changed)
+                changed(u, pv[u].parent, ctx);
+            pv[u].bridge = -1;
+            u = pv[u].parent;
+        }
+        return true;
+    }
+
+    /*
+     * Otherwise the new edge is a bridge between two components,
+     * and again nothing else changes. Join the two trees by hanging
+     * the smaller one from the new edge.
+     */
+    if (pv[ru].size < pv[rv].size) {
+        int tmp = u; u = v; v = tmp;
+        ru = rv;
+    }
+    findloop_reroot(pv, v);
+    findloop_link_child(pv, v, u);
+    pv[v].bridge = u;
+    pv[v].component_root = ru;
+    pv[v].depth = pv[u].depth + 1;
+    findloop_relabel(pv, v);
+    for (a = u;; a = pv[a].parent) {
+        pv[a].size += pv[v].size;
+        if (a == ru)
+            break;
+    }
+    return true;
+}
+
+bool findloop_remove_edge(struct findloopstate *pv, int u, int v)
+{
+    int r, a;
+
+    if (pv[v].bridge == u) {
+        int tmp = u; u = v; v = tmp;
+    }
+    if (pv[u].bridge != v)
+        return false;              /* a loop edge: we must start again */
+
+    /*
+     * Removing a bridge cuts off the subtree below it as a
+     * component of its own, and no other edge changes status, since
+     * no loop went through the bridge.
+     */
+    r = pv[u].component_root;
+    for (a = v;; a = pv[a].parent) {
+        pv[a].size -= pv[u].size;
+        if (a == r)
+            break;
+    }
+    findloop_unlink_child(pv, u);
+    pv[u].parent = pv[r].parent;
+    pv[u].bridge = -1;
+    pv[u].component_root = u;
+    pv[u].depth = 0;
+    findloop_relabel(pv, u);
+    return true;
+}
+
 /*
  * Appendix: the long and painful history of loop detection in these puzzles
  * =========================================================================
@@ -317,12 +317,18 @@ static int sqcmp_osize(void *av, void *bv)
     SORT(x);
     return 0;
 }
+/*
+ * During random matrix generation, we keep count of the number of
+ * 1s in each column of the matrix (i.e. the coverage of each output
+ * square) and in each row (the omino size of each click square), to
+ * save counting them afresh every time we make a new sq.
+ */
 static void addsq(tree234 *t, int w, int h, int cx, int cy,
-                  int x, int y, unsigned char *matrix)
+                  int x, int y, unsigned char *matrix,
+                  const int *coverage, const int *ominosize)
 {
     int wh = w * h;
     struct sq *sq;
-    int i;
 
     if (x < 0 || x >= w || y < 0 || y >= h)
         return;
@@ -336,24 +342,47 @@ static void addsq(tree234 *t, int w, int h, int cx, int cy,
     sq->cy = cy;
     sq->x = x;
     sq->y = y;
-    sq->coverage = sq->ominosize = 0;
-    for (i = 0; i < wh; i++) {
-        if (matrix[i * wh + y*w+x])
-            sq->coverage++;
-        if (matrix[(cy*w+cx) * wh + i])
-            sq->ominosize++;
-    }
+    sq->coverage = coverage[y*w+x];
+    sq->ominosize = ominosize[cy*w+cx];
 
     if (add234(t, sq) != sq)
         sfree(sq);                     /* already there */
 }
 static void addneighbours(tree234 *t, int w, int h, int cx, int cy,
-                          int x, int y, unsigned char *matrix)
+                          int x, int y, unsigned char *matrix,
+                          const int *coverage, const int *ominosize)
+{
+    addsq(t, w, h, cx, cy, x-1, y, matrix, coverage, ominosize);
+    addsq(t, w, h, cx, cy, x+1, y, matrix, coverage, ominosize);
+    addsq(t, w, h, cx, cy, x, y-1, matrix, coverage, ominosize);
+    addsq(t, w, h, cx, cy, x, y+1, matrix, coverage, ominosize);
+}
+
+/*
+ * Check whether any two rows of a wh by wh matrix are identical, by
+ * sorting the rows and comparing neighbours.
+ */
+static int rowcmp(const void *av, const void *bv, void *ctx)
 {
-    addsq(t, w, h, cx, cy, x-1, y, matrix);
-    addsq(t, w, h, cx, cy, x+1, y, matrix);
-    addsq(t, w, h, cx, cy, x, y-1, matrix);
-    addsq(t, w, h, cx, cy, x, y+1, matrix);
+    const unsigned char *a = *(const unsigned char *const *)av;
+    const unsigned char *b = *(const unsigned char *const *)bv;
+    return memcmp(a, b, *(const int *)ctx);
+}
+static bool has_duplicate_rows(unsigned char *matrix, int wh)
+{
+    unsigned char **rows = snewn(wh, unsigned char *);
+    bool ret = false;
+    int i;
+
+    for (i = 0; i < wh; i++)
+        rows[i] = matrix + i * wh;
+    arraysort(rows, wh, rowcmp, &wh);
+    for (i = 0; i+1 < wh; i++)
+        if (!memcmp(rows[i], rows[i+1], wh))
+            ret = true;
+
+    sfree(rows);
+    return ret;
 }
 
 static char *new_game_desc(const game_params *params, random_state *rs,
@@ -362,10 +391,13 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     int w = params->w, h = params->h, wh = w * h;
     int i, j;
     unsigned char *matrix, *grid;
+    int *coverage, *ominosize;
     char *mbmp, *gbmp, *ret;
 
     matrix = snewn(wh * wh, unsigned char);
     grid = snewn(wh, unsigned char);
+    coverage = snewn(wh, int);
+    ominosize = snewn(wh, int);
 
     /*
      * First set up the matrix.
@@ -395,13 +427,17 @@ static char *new_game_desc(const game_params *params, random_state *rs,
             memset(matrix, 0, wh * wh);
             for (i = 0; i < wh; i++) {
                 matrix[i*wh+i] = 1;
+                coverage[i] = ominosize[i] = 1;
             }
 
             for (i = 0; i < wh; i++) {
                 int ix = i % w, iy = i / w;
-                addneighbours(pick, w, h, ix, iy, ix, iy, matrix);
-                addneighbours(cov, w, h, ix, iy, ix, iy, matrix);
-                addneighbours(osize, w, h, ix, iy, ix, iy, matrix);
+                addneighbours(pick, w, h, ix, iy, ix, iy, matrix,
+                              coverage, ominosize);
+                addneighbours(cov, w, h, ix, iy, ix, iy, matrix,
+                              coverage, ominosize);
+                addneighbours(osize, w, h, ix, iy, ix, iy, matrix,
+                              coverage, ominosize);
             }
 
             /*
@@ -444,6 +480,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
                  * Add this square to the matrix.
                  */
                 matrix[(sq->cy * w + sq->cx) * wh + (sq->y * w + sq->x)] = 1;
+                coverage[sq->y * w + sq->x]++;
+                ominosize[sq->cy * w + sq->cx]++;
 
                 /*
                  * Correct the matrix coverage field of any sq
@@ -488,9 +526,12 @@ static char *new_game_desc(const game_params *params, random_state *rs,
                  * finished with; but its neighbours now need to
                  * appear.
                  */
-                addneighbours(pick, w,h, sq->cx,sq->cy, sq->x,sq->y, matrix);
-                addneighbours(cov, w,h, sq->cx,sq->cy, sq->x,sq->y, matrix);
-                addneighbours(osize, w,h, sq->cx,sq->cy, sq->x,sq->y, matrix);
+                addneighbours(pick, w,h, sq->cx,sq->cy, sq->x,sq->y, matrix,
+                              coverage, ominosize);
+                addneighbours(cov, w,h, sq->cx,sq->cy, sq->x,sq->y, matrix,
+                              coverage, ominosize);
+                addneighbours(osize, w,h, sq->cx,sq->cy, sq->x,sq->y, matrix,
+                              coverage, ominosize);
                 sfree(sq);
             }
 
@@ -525,16 +566,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
              * massively worried yet. Anyone needs this done
              * better, they're welcome to submit a patch.
              */
-            for (i = 0; i < wh; i++) {
-                for (j = 0; j < wh; j++)
-                    if (i != j &&
-                        !memcmp(matrix + i * wh, matrix + j * wh, wh))
-                        break;
-                if (j < wh)
-                    break;
-            }
-            if (i == wh)
-                break;                 /* no matches found */
+            if (!has_duplicate_rows(matrix, wh))
+                break;
         }
         break;
     }
@@ -602,6 +635,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     sfree(gbmp);
     sfree(matrix);
     sfree(grid);
+    sfree(coverage);
+    sfree(ominosize);
     return ret;
 }
 
@@ -674,41 +709,152 @@ static void free_game(game_state *state)
     sfree(state);
 }
 
-static void rowxor(unsigned char *row1, unsigned char *row2, int len)
+/*
+ * The solver works on matrices over GF(2) packed 64 bits to a word,
+ * since on a large grid it has to handle thousands of equations in
+ * thousands of unknowns, and XORing one equation into another then
+ * takes a few dozen word operations rather than thousands of byte
+ * ones.
+ */
+#define BM_BITS 64
+#define BM_WORDS(n) (((n) + BM_BITS - 1) / BM_BITS)
+#define BM_GET(row, i) (((row)[(i) / BM_BITS] >> ((i) % BM_BITS)) & 1)
+#define BM_SET(row, i) ((row)[(i) / BM_BITS] |= (uint64_t)1 << ((i) % BM_BITS))
+
+static void rowxor(uint64_t *row1, const uint64_t *row2, int len)
 {
     int i;
     for (i = 0; i < len; i++)
 	row1[i] ^= row2[i];
 }
 
+static int parity(unsigned long v)
+{
+    v ^= v >> 16;
+    v ^= v >> 8;
+    v ^= v >> 4;
+    v ^= v >> 2;
+    v ^= v >> 1;
+    return v & 1;
+}
+
+/*
+ * Beyond this many undetermined variables, we don't search for the
+ * shortest solution at all, and just return the one with all the
+ * undetermined variables zero. (The search takes time proportional
+ * to 2^n; this limit allows for the 28 undetermined variables of the
+ * 64x64 Crosses puzzle, at a cost of a few seconds.)
+ */
+#define MAX_SEARCH_UND 28
+#define SEARCH_CHUNK 16
+
+/*
+ * Given the solutions of a system of equations in the form
+ *
+ *   x[c] = base[c] XOR parity(a & vec[c])    (0 <= c < n)
+ *
+ * where the bits of a are the nund undetermined variables, find the
+ * value of a which makes the fewest of the x[c] equal to 1; among
+ * equally short solutions, return the smallest a.
+ *
+ * Trying every a and counting the 1s would take time proportional to
+ * n * 2^nund. Instead, write s[c] = (-1)^base[c]; then the number of
+ * 1s in the solution for a is (n - F(a)) / 2, where
+ *
+ *   F(a) = sum over c of s[c] * (-1)^parity(a & vec[c])
+ *
+ * and F is exactly the Walsh-Hadamard transform of the function f
+ * which maps each v to the sum of s[c] over all c with vec[c] = v.
+ * So we want the a that maximises F, and a fast transform finds all
+ * of F in time proportional to nund * 2^nund.
+ *
+ * To keep the memory use down, we do the transform in chunks: for
+ * each value of the top (nund - SEARCH_CHUNK) bits of a, we fold
+ * those bits' contribution into f and then transform the remaining
+ * SEARCH_CHUNK bits.
+ */
+static unsigned long shortest_solution(int n, const unsigned char *base,
+                                       const unsigned long *vec, int nund)
+{
+    int lobits = (nund < SEARCH_CHUNK ? nund : SEARCH_CHUNK);
+    unsigned long losize = 1UL << lobits, lomask = losize - 1;
+    unsigned long hi, lo, len, i, k, besta = 0;
+    int *f = snewn(losize, int);
+    int c, best = INT_MIN;
+
+    for (hi = 0; hi < (1UL << (nund - lobits)); hi++) {
+        memset(f, 0, losize * sizeof(int));
+        for (c = 0; c < n; c++) {
+            int s = (base[c] ? -1 : +1);
+            if (parity(hi & (vec[c] >> lobits)))
+                s = -s;
+            f[vec[c] & lomask] += s;
+        }
+
+        for (len = 1; len < losize; len <<= 1)
+            for (i = 0; i < losize; i += 2*len)
+                for (k = i; k < i + len; k++) {
+                    int u = f[k], v = f[k+len];
+                    f[k] = u + v;
+                    f[k+len] = u - v;
+                }
+
+        for (lo = 0; lo < losize; lo++)
+            if (f[lo] > best) {
+                best = f[lo];
+                besta = (hi << lobits) | lo;
+            }
+    }
+
+    sfree(f);
+    return besta;
+}
+
 static char *solve_game(const game_state *state, const game_state *currstate,
                         const char *aux, const char **error)
 {
     int w = state->w, h = state->h, wh = w * h;
-    unsigned char *equations, *solution, *shortest;
-    int *und, nund;
+    int words = BM_WORDS(wh + 1);
+    uint64_t *equations, **rows;
+    unsigned char *base;
+    unsigned long *vec, a;
+    int *und, *pivot, nund;
     int rowsdone, colsdone;
-    int i, j, k, len, bestlen;
+    int i, j, k;
     char *ret;
 
     /*
-     * Set up a list of simultaneous equations. Each one is of
-     * length (wh+1) and has wh coefficients followed by a value.
+     * Set up a list of simultaneous equations. Each one has wh
+     * coefficients followed by a value, in bits 0,...,wh of a row of
+     * 'words' words. We work through an array of pointers to the
+     * rows, so that we can swap two rows without copying them.
      */
-    equations = snewn((wh + 1) * wh, unsigned char);
-    for (i = 0; i < wh; i++) {
-	for (j = 0; j < wh; j++)
-	    equations[i * (wh+1) + j] = currstate->matrix->matrix[j*wh+i];
-	equations[i * (wh+1) + wh] = currstate->grid[i] & 1;
-    }
+    equations = snewn(words * wh, uint64_t);
+    memset(equations, 0, words * wh * sizeof(uint64_t));
+    rows = snewn(wh, uint64_t *);
+    for (i = 0; i < wh; i++)
+        rows[i] = equations + i * words;
+    for (j = 0; j < wh; j++)
+	for (i = 0; i < wh; i++)
+	    if (currstate->matrix->matrix[j*wh+i])
+                BM_SET(rows[i], j);
+    for (i = 0; i < wh; i++)
+	if (currstate->grid[i] & 1)
+            BM_SET(rows[i], wh);
 
     /*
-     * Perform Gaussian elimination over GF(2).
+     * Perform Gauss-Jordan elimination over GF(2), leaving the
+     * equations in reduced row echelon form: the pivot column of
+     * each row (recorded in pivot[]) has a 1 in that row and 0 in
+     * every other.
      */
     rowsdone = colsdone = 0;
     nund = 0;
     und = snewn(wh, int);
+    pivot = snewn(wh, int);
     do {
+	uint64_t *tmp;
+
 	/*
 	 * Find the leftmost column which has a 1 in it somewhere
 	 * outside the first `rowsdone' rows.
@@ -716,7 +862,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	j = -1;
 	for (i = colsdone; i < wh; i++) {
 	    for (j = rowsdone; j < wh; j++)
-		if (equations[j * (wh+1) + i])
+		if (BM_GET(rows[j], i))
 		    break;
 	    if (j < wh)
 		break;		       /* found one */
@@ -736,10 +882,12 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	 */
 	if (i == wh) {
 	    for (j = rowsdone; j < wh; j++)
-		if (equations[j * (wh+1) + wh]) {
+		if (BM_GET(rows[j], wh)) {
 		    *error = "No solution exists for this position";
 		    sfree(equations);
+		    sfree(rows);
 		    sfree(und);
+		    sfree(pivot);
 		    return NULL;
 		}
 	    break;
@@ -747,25 +895,28 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 
 	/*
 	 * We've found a 1. It's in column i, and the topmost 1 in
-	 * that column is in row j. Do a row-XOR to move it up to
-	 * the topmost row if it isn't already there.
+	 * that column is in row j. Swap that row up to be the
+	 * topmost row if it isn't already there.
 	 */
 	assert(j != -1);
-	if (j > rowsdone)
-	    rowxor(equations + rowsdone*(wh+1), equations + j*(wh+1), wh+1);
+	tmp = rows[j];
+	rows[j] = rows[rowsdone];
+	rows[rowsdone] = tmp;
 
 	/*
-	 * Do row-XORs to eliminate that 1 from all rows below the
-	 * topmost row.
+	 * Do row-XORs to eliminate that 1 from every other row.
+	 * Both rows are zero to the left of column i, so we need
+	 * only start from the word containing it.
 	 */
-	for (j = rowsdone + 1; j < wh; j++)
-	    if (equations[j*(wh+1) + i])
-		rowxor(equations + j*(wh+1),
-		       equations + rowsdone*(wh+1), wh+1);
+	for (j = 0; j < wh; j++)
+	    if (j != rowsdone && BM_GET(rows[j], i))
+		rowxor(rows[j] + i / BM_BITS,
+		       rows[rowsdone] + i / BM_BITS, words - i / BM_BITS);
 
 	/*
 	 * Mark this row and column as done.
 	 */
+	pivot[rowsdone] = i;
 	rowsdone++;
 	colsdone = i+1;
 
@@ -775,90 +926,47 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     } while (rowsdone < wh);
 
     /*
-     * If we reach here, we have the ability to produce a solution.
-     * So we go through _all_ possible solutions (each
-     * corresponding to a set of arbitrary choices of those
-     * components not directly determined by an equation), and pick
-     * one requiring the smallest number of flips.
+     * If we reach here, we have the ability to produce a solution,
+     * and in fact one for every set of values of the undetermined
+     * variables: each other variable is the value of its row,
+     * XORed with whichever of the undetermined variables that row
+     * has a 1 in. Write those down in the form shortest_solution
+     * wants, and ask it for the solution requiring the smallest
+     * number of flips.
      */
-    solution = snewn(wh, unsigned char);
-    shortest = snewn(wh, unsigned char);
-    memset(solution, 0, wh);
-    bestlen = wh + 1;
-    while (1) {
-	/*
-	 * Find a solution based on the current values of the
-	 * undetermined variables.
-	 */
-	for (j = rowsdone; j-- ;) {
-	    int v;
-
-	    /*
-	     * Find the leftmost set bit in this equation.
-	     */
-	    for (i = 0; i < wh; i++)
-		if (equations[j * (wh+1) + i])
-		    break;
-	    assert(i < wh);		       /* there must have been one! */
-
-	    /*
-	     * Compute this variable using the rest.
-	     */
-	    v = equations[j * (wh+1) + wh];
-	    for (k = i+1; k < wh; k++)
-		if (equations[j * (wh+1) + k])
-		    v ^= solution[k];
-
-	    solution[i] = v;
-	}
-
-	/*
-	 * Compare this solution to the current best one, and
-	 * replace the best one if this one is shorter.
-	 */
-	len = 0;
-	for (i = 0; i < wh; i++)
-	    if (solution[i])
-		len++;
-	if (len < bestlen) {
-	    bestlen = len;
-	    memcpy(shortest, solution, wh);
-	}
-
-	/*
-	 * Now increment the binary number given by the
-	 * undetermined variables: turn all 1s into 0s until we see
-	 * a 0, at which point we turn it into a 1.
-	 */
-	for (i = 0; i < nund; i++) {
-	    solution[und[i]] = !solution[und[i]];
-	    if (solution[und[i]])
-		break;
-	}
-
-	/*
-	 * If we didn't find a 0 at any point, we have wrapped
-	 * round and are back at the start, i.e. we have enumerated
-	 * all solutions.
-	 */
-	if (i == nund)
-	    break;
+    base = snewn(wh, unsigned char);
+    vec = snewn(wh, unsigned long);
+    for (k = 0; k < nund; k++) {
+        base[und[k]] = 0;
+        vec[und[k]] = (k < MAX_SEARCH_UND ? 1UL << k : 0);
     }
+    for (j = 0; j < rowsdone; j++) {
+        base[pivot[j]] = BM_GET(rows[j], wh);
+        vec[pivot[j]] = 0;
+        for (k = 0; k < nund && k < MAX_SEARCH_UND; k++)
+            if (BM_GET(rows[j], und[k]))
+                vec[pivot[j]] |= 1UL << k;
+    }
+    if (nund <= MAX_SEARCH_UND)
+        a = shortest_solution(wh, base, vec, nund);
+    else
+        a = 0;
 
     /*
-     * We have a solution. Produce a move string encoding the
-     * solution.
+     * Produce a move string encoding the solution.
      */
     ret = snewn(wh + 2, char);
     ret[0] = 'S';
     for (i = 0; i < wh; i++)
-	ret[i+1] = shortest[i] ? '1' : '0';
+	ret[i+1] = (base[i] ^ parity(a & vec[i])) ? '1' : '0';
     ret[wh+1] = '\0';
 
-    sfree(shortest);
-    sfree(solution);
+    sfree(base);
+    sfree(vec);
     sfree(equations);
+    sfree(rows);
     sfree(und);
+    sfree(pivot);
 
     return ret;
 }
@@ -1355,6 +1463,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -2640,6 +2640,10 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 
     if (aux) {
         tosolve = execute_move(state, aux);
+        if (!tosolve) {
+            *error = "aux is not a valid move";
+            return NULL;
+        }
         goto solved;
     } else {
         tosolve = dup_game(currstate);
@@ -4148,6 +4152,7 @@ const struct game thegame = {
 #endif
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
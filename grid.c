@@ -18,6 +18,9 @@
 #else
 #  include <tgmath.h>
 #endif
+#ifndef NO_THREADS
+#include <pthread.h>
+#endif
 
 #include "puzzles.h"
 #include "tree234.h"
@@ -34,12 +37,41 @@
 /* ----------------------------------------------------------------------
  * Deallocate or dereference a grid
  */
+
+/*
+ * Grids handed out by grid_new can be shared between threads (puzzle
+ * generators run in parallel under --jobs, and the grid cache below
+ * is global), so the cache and every reference count are protected
+ * by this lock.
+ */
+#ifndef NO_THREADS
+static pthread_mutex_t grid_lock = PTHREAD_MUTEX_INITIALIZER;
+#define GRID_LOCK() pthread_mutex_lock(&grid_lock)
+#define GRID_UNLOCK() pthread_mutex_unlock(&grid_lock)
+#else
+#define GRID_LOCK() ((void)0)
+#define GRID_UNLOCK() ((void)0)
+#endif
+
+grid *grid_ref(grid *g)
+{
+    GRID_LOCK();
+    assert(g->refcount);
+    g->refcount++;
+    GRID_UNLOCK();
+    return g;
+}
+
 void grid_free(grid *g)
 {
+    int refcount;
+
+    GRID_LOCK();
     assert(g->refcount);
+    refcount = --g->refcount;
+    GRID_UNLOCK();
 
-    g->refcount--;
-    if (g->refcount == 0) {
+    if (refcount == 0) {
         int i;
         for (i = 0; i < g->num_faces; i++) {
             sfree(g->faces[i].dots);
@@ -52,6 +84,14 @@ void grid_free(grid *g)
         sfree(g->faces);
         sfree(g->edges);
         sfree(g->dots);
+        sfree(g->face_offsets);
+        sfree(g->face_edges);
+        sfree(g->face_dots);
+        sfree(g->dot_offsets);
+        sfree(g->dot_edges);
+        sfree(g->dot_faces);
+        sfree(g->edge_dots);
+        sfree(g->edge_faces);
         sfree(g);
     }
 }
@@ -65,6 +105,9 @@ static grid *grid_empty(void)
     g->edges = NULL;
     g->dots = NULL;
     g->num_faces = g->num_edges = g->num_dots = 0;
+    g->face_offsets = g->face_edges = g->face_dots = NULL;
+    g->dot_offsets = g->dot_edges = g->dot_faces = NULL;
+    g->edge_dots = g->edge_faces = NULL;
     g->refcount = 1;
     g->lowest_x = g->lowest_y = g->highest_x = g->highest_y = 0;
     return g;
@@ -361,56 +404,121 @@ static int grid_edge_bydots_cmpfn(void *v1, void *v2)
  * preconditions to grid_make_consistent() rather than the
  * postconditions. (So call it first.)
  */
+/* Whether some face has dots a and b consecutively, in that order. */
+static bool grid_trim_has_pair(const int *out_offsets, const int *out,
+                               int a, int b)
+{
+    int k;
+    for (k = out_offsets[a]; k < out_offsets[a+1]; k++)
+        if (out[k] == b)
+            return true;
+    return false;
+}
+
 static void grid_trim_vigorously(grid *g)
 {
-    int *dotpairs, *faces, *dots;
+    int *out_offsets, *out, *in_offsets, *in, *nbrs;
+    int *faces, *dots;
     int *dsf;
-    int i, j, k, size, newfaces, newdots;
+    int i, j, k, size, newfaces, newdots, npairs;
 
     /*
-     * First construct a matrix in which each ordered pair of dots is
-     * mapped to the index of the face in which those dots occur in
-     * that order.
+     * First list, for each dot, the dots that follow it and precede
+     * it around any face: each ordered pair of dots which occur
+     * consecutively (in that order) in some face appears once in each
+     * of 'out' and 'in'. These are indexed by dot, in the same way as
+     * the flat arrays of grid.h, so that out[out_offsets[i]] up to
+     * out[out_offsets[i+1]] are the successors of dot i.
      */
-    dotpairs = snewn(g->num_dots * g->num_dots, int);
-    for (i = 0; i < g->num_dots; i++)
-        for (j = 0; j < g->num_dots; j++)
-            dotpairs[i*g->num_dots+j] = -1;
+    out_offsets = snewn(g->num_dots + 1, int);
+    in_offsets = snewn(g->num_dots + 1, int);
+    for (i = 0; i <= g->num_dots; i++)
+        out_offsets[i] = in_offsets[i] = 0;
+    for (i = npairs = 0; i < g->num_faces; i++) {
+        grid_face *f = g->faces + i;
+        int dot0 = f->dots[f->order-1] - g->dots;
+        for (j = 0; j < f->order; j++) {
+            int dot1 = f->dots[j] - g->dots;
+            out_offsets[dot0+1]++;
+            in_offsets[dot1+1]++;
+            npairs++;
+            dot0 = dot1;
+        }
+    }
+    for (i = 0; i < g->num_dots; i++) {
+        out_offsets[i+1] += out_offsets[i];
+        in_offsets[i+1] += in_offsets[i];
+    }
+    out = snewn(npairs, int);
+    in = snewn(npairs, int);
+    nbrs = snewn(npairs, int);
     for (i = 0; i < g->num_faces; i++) {
         grid_face *f = g->faces + i;
         int dot0 = f->dots[f->order-1] - g->dots;
         for (j = 0; j < f->order; j++) {
             int dot1 = f->dots[j] - g->dots;
-            dotpairs[dot0 * g->num_dots + dot1] = i;
+            out[--out_offsets[dot0+1]] = dot1;
+            in[--in_offsets[dot1+1]] = dot0;
             dot0 = dot1;
         }
     }
+    /* The decrements above have left the start of dot i's lists in
+     * slot i+1 of the offset arrays, so shift them down into place. */
+    for (i = 0; i < g->num_dots; i++) {
+        out_offsets[i] = out_offsets[i+1];
+        in_offsets[i] = in_offsets[i+1];
+    }
+    out_offsets[g->num_dots] = in_offsets[g->num_dots] = npairs;
 
     /*
      * Now we can identify landlocked dots: they're the ones all of
-     * whose edges have a mirror-image counterpart in this matrix.
+     * whose edges have a mirror-image counterpart, i.e. for which
+     * every pair in 'out' or 'in' also occurs the other way round.
      */
     dots = snewn(g->num_dots, int);
     for (i = 0; i < g->num_dots; i++) {
         dots[i] = 1;
-        for (j = 0; j < g->num_dots; j++) {
-            if ((dotpairs[i*g->num_dots+j] >= 0) ^
-                (dotpairs[j*g->num_dots+i] >= 0))
+        for (k = out_offsets[i]; k < out_offsets[i+1]; k++)
+            if (!grid_trim_has_pair(out_offsets, out, out[k], i))
                 dots[i] = 0;    /* non-duplicated edge: coastal dot */
-        }
+        for (k = in_offsets[i]; k < in_offsets[i+1]; k++)
+            if (!grid_trim_has_pair(out_offsets, out, i, in[k]))
+                dots[i] = 0;
     }
 
     /*
      * Now identify connected pairs of landlocked dots, and form a dsf
-     * unifying them.
+     * unifying them. We merge each dot with its lower-numbered
+     * neighbours in increasing order, which keeps the choice of
+     * canonical elements (and hence the tie-breaking between equally
+     * large components below) independent of the order of the lists.
      */
     dsf = snew_dsf(g->num_dots);
-    for (i = 0; i < g->num_dots; i++)
-        for (j = 0; j < i; j++)
-            if (dots[i] && dots[j] &&
-                dotpairs[i*g->num_dots+j] >= 0 &&
-                dotpairs[j*g->num_dots+i] >= 0)
-                dsf_merge(dsf, i, j);
+    for (i = 0; i < g->num_dots; i++) {
+        int n = 0;
+
+        if (!dots[i])
+            continue;
+        for (k = out_offsets[i]; k < out_offsets[i+1]; k++) {
+            int m;
+            j = out[k];
+            if (j >= i || !dots[j] ||
+                !grid_trim_has_pair(out_offsets, out, j, i))
+                continue;
+            /* Insertion sort, discarding duplicates */
+            for (m = n; m > 0 && nbrs[m-1] > j; m--)
+                nbrs[m] = nbrs[m-1];
+            if (m > 0 && nbrs[m-1] == j) {
+                for (; m < n; m++)
+                    nbrs[m] = nbrs[m+1];
+                continue;
+            }
+            nbrs[m] = j;
+            n++;
+        }
+        for (k = 0; k < n; k++)
+            dsf_merge(dsf, i, nbrs[k]);
+    }
 
     /*
      * Now look for the largest component.
@@ -492,12 +600,73 @@ static void grid_trim_vigorously(grid *g)
     g->num_faces = newfaces;
     g->num_dots = newdots;
 
-    sfree(dotpairs);
+    sfree(out_offsets);
+    sfree(out);
+    sfree(in_offsets);
+    sfree(in);
+    sfree(nbrs);
     sfree(dsf);
     sfree(dots);
     sfree(faces);
 }
 
+/* Build the integer-indexed copies of the incidence lists (see the
+ * comment in grid.h), once the pointer-based lists are complete. */
+static void grid_make_flat(grid *g)
+{
+    int i, j, n;
+
+#define FACE_INDEX(f) ((f) ? (f) - g->faces : -1)
+
+    g->face_offsets = snewn(g->num_faces + 1, int);
+    for (i = n = 0; i < g->num_faces; i++) {
+        g->face_offsets[i] = n;
+        n += g->faces[i].order;
+    }
+    g->face_offsets[g->num_faces] = n;
+    g->face_edges = snewn(n, int);
+    g->face_dots = snewn(n, int);
+    for (i = 0; i < g->num_faces; i++) {
+        grid_face *f = g->faces + i;
+        int *fe = g->face_edges + g->face_offsets[i];
+        int *fd = g->face_dots + g->face_offsets[i];
+        for (j = 0; j < f->order; j++) {
+            fe[j] = f->edges[j] - g->edges;
+            fd[j] = f->dots[j] - g->dots;
+        }
+    }
+
+    g->dot_offsets = snewn(g->num_dots + 1, int);
+    for (i = n = 0; i < g->num_dots; i++) {
+        g->dot_offsets[i] = n;
+        n += g->dots[i].order;
+    }
+    g->dot_offsets[g->num_dots] = n;
+    g->dot_edges = snewn(n, int);
+    g->dot_faces = snewn(n, int);
+    for (i = 0; i < g->num_dots; i++) {
+        grid_dot *d = g->dots + i;
+        int *de = g->dot_edges + g->dot_offsets[i];
+        int *df = g->dot_faces + g->dot_offsets[i];
+        for (j = 0; j < d->order; j++) {
+            de[j] = d->edges[j] - g->edges;
+            df[j] = FACE_INDEX(d->faces[j]);
+        }
+    }
+
+    g->edge_dots = snewn(2 * g->num_edges, int);
+    g->edge_faces = snewn(2 * g->num_edges, int);
+    for (i = 0; i < g->num_edges; i++) {
+        grid_edge *e = g->edges + i;
+        g->edge_dots[2*i] = e->dot1 - g->dots;
+        g->edge_dots[2*i+1] = e->dot2 - g->dots;
+        g->edge_faces[2*i] = FACE_INDEX(e->face1);
+        g->edge_faces[2*i+1] = FACE_INDEX(e->face2);
+    }
+
+#undef FACE_INDEX
+}
+
 /* Input: grid has its dots and faces initialised:
  * - dots have (optionally) x and y coordinates, but no edges or faces
  * (pointers are NULL).
@@ -792,21 +961,87 @@ static void grid_make_consistent(grid *g)
         }
     }
 
+    /* ====== Stage 5 ======
+     * Flatten everything into the index arrays
+     */
+    grid_make_flat(g);
+
     grid_debug_derived(g);
 }
 
 /* Helpers for making grid-generation easier.  These functions are only
  * intended for use during grid generation. */
 
-/* Comparison function for the (tree234) sorted dot list */
-static int grid_point_cmp_fn(void *v1, void *v2)
+/*
+ * Hash table of the dots added so far, keyed on their coordinates, so
+ * that a face can find out whether each of its corners is a dot it
+ * shares with a previous face. Each slot holds an index into g->dots,
+ * or -1 if empty; the table is kept at most half full.
+ */
+typedef struct grid_dot_table {
+    int *slots;
+    int size, count;                   /* size is a power of 2 */
+} grid_dot_table;
+
+static unsigned grid_dot_hash(int x, int y)
 {
-    grid_dot *p1 = v1;
-    grid_dot *p2 = v2;
-    if (p1->y != p2->y)
-        return p2->y - p1->y;
-    else
-        return p2->x - p1->x;
+    unsigned h = (unsigned)x * 0x9E3779B1U ^ (unsigned)y * 0x85EBCA77U;
+    return h ^ (h >> 15);
+}
+
+static grid_dot_table *grid_dot_table_new(void)
+{
+    grid_dot_table *t = snew(grid_dot_table);
+    int i;
+
+    t->size = 256;
+    t->count = 0;
+    t->slots = snewn(t->size, int);
+    for (i = 0; i < t->size; i++)
+        t->slots[i] = -1;
+    return t;
+}
+
+static void grid_dot_table_free(grid_dot_table *t)
+{
+    sfree(t->slots);
+    sfree(t);
+}
+
+/* Find the slot holding a dot at (x,y), or the empty slot it would go in */
+static int grid_dot_table_slot(grid *g, grid_dot_table *t, int x, int y)
+{
+    unsigned mask = t->size - 1, i = grid_dot_hash(x, y) & mask;
+
+    while (t->slots[i] >= 0) {
+        grid_dot *d = g->dots + t->slots[i];
+        if (d->x == x && d->y == y)
+            break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void grid_dot_table_add(grid *g, grid_dot_table *t, grid_dot *d)
+{
+    if (2 * (t->count + 1) > t->size) {
+        int *oldslots = t->slots, oldsize = t->size, i;
+
+        t->size *= 2;
+        t->slots = snewn(t->size, int);
+        for (i = 0; i < t->size; i++)
+            t->slots[i] = -1;
+        for (i = 0; i < oldsize; i++)
+            if (oldslots[i] >= 0) {
+                grid_dot *od = g->dots + oldslots[i];
+                t->slots[grid_dot_table_slot(g, t, od->x, od->y)] =
+                    oldslots[i];
+            }
+        sfree(oldslots);
+    }
+
+    t->slots[grid_dot_table_slot(g, t, d->x, d->y)] = d - g->dots;
+    t->count++;
 }
 /* Add a new face to the grid, with its dot list allocated.
  * Assumes there's enough space allocated for the new face in grid->faces */
@@ -838,21 +1073,16 @@ static grid_dot *grid_dot_add_new(grid *g, int x, int y)
  * in the dot_list, or add a new dot to the grid (and the dot_list) and
  * return that.
  * Assumes g->dots has enough capacity allocated */
-static grid_dot *grid_get_dot(grid *g, tree234 *dot_list, int x, int y)
+static grid_dot *grid_get_dot(grid *g, grid_dot_table *dot_list, int x, int y)
 {
-    grid_dot test, *ret;
+    grid_dot *ret;
+    int slot = grid_dot_table_slot(g, dot_list, x, y);
 
-    test.order = 0;
-    test.edges = NULL;
-    test.faces = NULL;
-    test.x = x;
-    test.y = y;
-    ret = find234(dot_list, &test, NULL);
-    if (ret)
-        return ret;
+    if (dot_list->slots[slot] >= 0)
+        return g->dots + dot_list->slots[slot];
 
     ret = grid_dot_add_new(g, x, y);
-    add234(dot_list, ret);
+    grid_dot_table_add(g, dot_list, ret);
     return ret;
 }
 
@@ -1383,9 +1613,9 @@ void grid_find_incentre(grid_face *f)
  * a new face reuses an existing dot.  For example, two squares touching at an
  * edge would generate six unique dots: four dots from the first face, then
  * two additional dots for the second face, because we detect the other two
- * dots have already been taken up.  This list is stored in a tree234
- * called "points".  No extra memory-allocation needed here - we store the
- * actual grid_dot* pointers, which all point into the g->dots list.
+ * dots have already been taken up.  This list is stored in a hash table
+ * called "points" (see grid_get_dot), which refers to the dots by their
+ * indices in the g->dots list.
  * For this reason, we have to calculate coordinates in such a way as to
  * eliminate any rounding errors, so we can detect when a dot on one
  * face precisely lands on a dot of a different face.  No floating-point
@@ -1423,14 +1653,14 @@ static grid *grid_new_square(int width, int height, const char *desc)
     int max_faces = width * height;
     int max_dots = (width + 1) * (height + 1);
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = a;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     /* generate square faces */
     for (y = 0; y < height; y++) {
@@ -1452,7 +1682,7 @@ static grid *grid_new_square(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -1498,14 +1728,14 @@ static grid *grid_new_honeycomb(int width, int height, const char *desc)
     int max_faces = width * height;
     int max_dots = 2 * (width + 1) * (height + 1);
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = HONEY_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     /* generate hexagonal faces */
     for (y = 0; y < height; y++) {
@@ -1533,7 +1763,7 @@ static grid *grid_new_honeycomb(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -1688,7 +1918,7 @@ static grid *grid_new_triangular(int width, int height, const char *desc)
          *   5x5t1:0_21120b11a1a01a1a00c1a0b211021c1h1a2a1a0a
          *   5x6t1:0_a1212c22c2a02a2f22a0c12a110d0e1c0c0a101121a1
          */
-        tree234 *points = newtree234(grid_point_cmp_fn);
+        grid_dot_table *points = grid_dot_table_new();
         /* Upper bounds - don't have to be exact */
         int max_faces = height * (2*width+1);
         int max_dots = (height+1) * (width+1) * 4;
@@ -1741,7 +1971,7 @@ static grid *grid_new_triangular(int width, int height, const char *desc)
             }
         }
 
-        freetree234(points);
+        grid_dot_table_free(points);
         assert(g->num_faces <= max_faces);
         assert(g->num_dots <= max_dots);
     }
@@ -1789,14 +2019,14 @@ static grid *grid_new_snubsquare(int width, int height, const char *desc)
     int max_faces = 3 * width * height;
     int max_dots = 2 * (width + 1) * (height + 1);
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = SNUBSQUARE_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -1869,7 +2099,7 @@ static grid *grid_new_snubsquare(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -1914,14 +2144,14 @@ static grid *grid_new_cairo(int width, int height, const char *desc)
     int max_faces = 2 * width * height;
     int max_dots = 3 * (width + 1) * (height + 1);
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = CAIRO_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -1987,7 +2217,7 @@ static grid *grid_new_cairo(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2033,14 +2263,14 @@ static grid *grid_new_greathexagonal(int width, int height, const char *desc)
     int max_faces = 6 * (width + 1) * (height + 1);
     int max_dots = 6 * width * height;
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = GREATHEX_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2129,7 +2359,7 @@ static grid *grid_new_greathexagonal(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2175,14 +2405,14 @@ static grid *grid_new_kagome(int width, int height, const char *desc)
     int max_faces = 6 * (width + 1) * (height + 1);
     int max_dots = 6 * width * height;
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = KAGOME_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2237,7 +2467,7 @@ static grid *grid_new_kagome(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2283,14 +2513,14 @@ static grid *grid_new_octagonal(int width, int height, const char *desc)
     int max_faces = 2 * width * height;
     int max_dots = 4 * (width + 1) * (height + 1);
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = OCTAGONAL_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2332,7 +2562,7 @@ static grid *grid_new_octagonal(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2378,14 +2608,14 @@ static grid *grid_new_kites(int width, int height, const char *desc)
     int max_faces = 6 * width * height;
     int max_dots = 6 * (width + 1) * (height + 1);
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = KITE_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2464,7 +2694,7 @@ static grid *grid_new_kites(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2523,14 +2753,14 @@ static grid *grid_new_floret(int width, int height, const char *desc)
     int max_faces = 6 * width * height;
     int max_dots = 9 * (width + 1) * (height + 1);
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = FLORET_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     /* generate pentagonal faces */
     for (y = 0; y < height; y++) {
@@ -2588,7 +2818,7 @@ static grid *grid_new_floret(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2635,14 +2865,14 @@ static grid *grid_new_dodecagonal(int width, int height, const char *desc)
     int max_faces = 3 * width * height;
     int max_dots = 14 * width * height;
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = DODEC_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2686,7 +2916,7 @@ static grid *grid_new_dodecagonal(int width, int height, const char *desc)
 	}
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2728,14 +2958,14 @@ static grid *grid_new_greatdodecagonal(int width, int height, const char *desc)
     int max_faces = 30 * width * height;
     int max_dots = 200 * width * height;
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = DODEC_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2812,7 +3042,7 @@ static grid *grid_new_greatdodecagonal(int width, int height, const char *desc)
 	}
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2855,14 +3085,14 @@ static grid *grid_new_greatgreatdodecagonal(int width, int height, const char *d
     int max_faces = 50 * width * height;
     int max_dots = 300 * width * height;
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = DODEC_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2994,7 +3224,7 @@ static grid *grid_new_greatgreatdodecagonal(int width, int height, const char *d
         }
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -3037,14 +3267,14 @@ static grid *grid_new_compassdodecagonal(int width, int height, const char *desc
     int max_faces = 6 * width * height;
     int max_dots = 18 * width * height;
 
-    tree234 *points;
+    grid_dot_table *points;
 
     grid *g = grid_empty();
     g->tilesize = DODEC_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -3103,7 +3333,7 @@ static grid *grid_new_compassdodecagonal(int width, int height, const char *desc
         }
     }
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -3116,7 +3346,7 @@ typedef struct setface_ctx
     int xmin, xmax, ymin, ymax;
 
     grid *g;
-    tree234 *points;
+    grid_dot_table *points;
 } setface_ctx;
 
 static double round_int_nearest_away(double r)
@@ -3285,7 +3515,7 @@ static grid *grid_new_penrose(int width, int height, int which, const char *desc
     int xsz, ysz, xoff, yoff, aoff;
     double rradius;
 
-    tree234 *points;
+    grid_dot_table *points;
     grid *g;
 
     penrose_state ps;
@@ -3308,7 +3538,7 @@ static grid *grid_new_penrose(int width, int height, int which, const char *desc
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = grid_dot_table_new();
 
     memset(&sf_ctx, 0, sizeof(sf_ctx));
     sf_ctx.g = g;
@@ -3334,9 +3564,18 @@ static grid *grid_new_penrose(int width, int height, int which, const char *desc
     debug(("penrose: x range (%f --> %f), y range (%f --> %f)",
            sf_ctx.xmin, sf_ctx.xmax, sf_ctx.ymin, sf_ctx.ymax));
 
+    /* set_faces only wants tiles inside that rectangle, so there's no
+     * point in the tiling code generating the (vastly greater) rest
+     * of the patch. */
+    ps.clip = true;
+    ps.xmin = sf_ctx.xmin;
+    ps.xmax = sf_ctx.xmax;
+    ps.ymin = sf_ctx.ymin;
+    ps.ymax = sf_ctx.ymax;
+
     penrose(&ps, which, aoff);
 
-    freetree234(points);
+    grid_dot_table_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -3513,7 +3752,7 @@ static const char *grid_validate_desc_hats(
 
 struct hatcontext {
     grid *g;
-    tree234 *points;
+    grid_dot_table *points;
 };
 
 static void grid_hats_callback(void *vctx, size_t nvertices, int *coords)
@@ -3550,11 +3789,11 @@ static grid *grid_new_hats(int width, int height, const char *desc)
     ctx->g->faces = snewn(max_faces, grid_face);
     ctx->g->dots = snewn(max_dots, grid_dot);
 
-    ctx->points = newtree234(grid_point_cmp_fn);
+    ctx->points = grid_dot_table_new();
 
     hat_tiling_generate(&hp, width, height, grid_hats_callback, ctx);
 
-    freetree234(ctx->points);
+    grid_dot_table_free(ctx->points);
     sfree(hp.coords);
 
     grid_trim_vigorously(ctx->g);
@@ -3611,12 +3850,119 @@ const char *grid_validate_desc(grid_type type, int width, int height,
     }
 }
 
+/*
+ * Making a grid can be expensive (the aperiodic ones in particular
+ * are built by substitution and then trimmed), and the same grid is
+ * typically asked for several times in a row: once to validate a
+ * game description, again for each new_game, and so on. Since grids
+ * are immutable and reference-counted, we keep the last few we made
+ * and hand out another reference to one of those if we can.
+ *
+ * The cache holds a reference of its own to each grid in it, and is
+ * kept in most-recently-used order, so the entry that falls off the
+ * end when a new one is added is the least recently used.
+ */
+#define GRID_CACHE_SIZE 8
+
+struct grid_cache_entry {
+    grid_type type;
+    int width, height;
+    char *desc;                        /* may be NULL */
+    grid *g;
+};
+
+static struct grid_cache_entry grid_cache[GRID_CACHE_SIZE];
+static int grid_cache_len;
+static unsigned long grid_cache_hits, grid_cache_misses;
+
+static bool grid_cache_match(const struct grid_cache_entry *ent,
+                             grid_type type, int width, int height,
+                             const char *desc)
+{
+    if (ent->type != type || ent->width != width || ent->height != height)
+        return false;
+    if (!ent->desc || !desc)
+        return !ent->desc && !desc;
+    return !strcmp(ent->desc, desc);
+}
+
 grid *grid_new(grid_type type, int width, int height, const char *desc)
 {
-    const char *err = grid_validate_desc(type, width, height, desc);
+    struct grid_cache_entry ent, evicted;
+    const char *err;
+    int i;
+
+    GRID_LOCK();
+    for (i = 0; i < grid_cache_len; i++) {
+        if (grid_cache_match(&grid_cache[i], type, width, height, desc)) {
+            ent = grid_cache[i];
+            memmove(grid_cache + 1, grid_cache, i * sizeof(*grid_cache));
+            grid_cache[0] = ent;
+            grid_cache_hits++;
+            ent.g->refcount++;
+            GRID_UNLOCK();
+            return ent.g;
+        }
+    }
+    grid_cache_misses++;
+    GRID_UNLOCK();
+
+    /*
+     * Make the grid without holding the lock, so that other threads
+     * aren't held up behind a slow one. If two threads make the same
+     * grid at once, both copies go in the cache, which is harmless.
+     */
+    err = grid_validate_desc(type, width, height, desc);
     if (err) assert(!"Invalid grid description.");
 
-    return grid_news[type](width, height, desc);
+    ent.type = type;
+    ent.width = width;
+    ent.height = height;
+    ent.desc = desc ? dupstr(desc) : NULL;
+    ent.g = grid_news[type](width, height, desc);
+    ent.g->refcount++;                 /* one for the cache, one for us */
+
+    evicted.g = NULL;
+    GRID_LOCK();
+    if (grid_cache_len == GRID_CACHE_SIZE)
+        evicted = grid_cache[--grid_cache_len];
+    memmove(grid_cache + 1, grid_cache, grid_cache_len * sizeof(*grid_cache));
+    grid_cache[0] = ent;
+    grid_cache_len++;
+    GRID_UNLOCK();
+
+    if (evicted.g) {
+        grid_free(evicted.g);
+        sfree(evicted.desc);
+    }
+    return ent.g;
+}
+
+void grid_cache_clear(void)
+{
+    struct grid_cache_entry cleared[GRID_CACHE_SIZE];
+    int i, n;
+
+    GRID_LOCK();
+    n = grid_cache_len;
+    memcpy(cleared, grid_cache, n * sizeof(*grid_cache));
+    grid_cache_len = 0;
+    GRID_UNLOCK();
+
+    for (i = 0; i < n; i++) {
+        grid_free(cleared[i].g);
+        sfree(cleared[i].desc);
+    }
+}
+
+void grid_cache_stats(unsigned long *hits, unsigned long *misses)
+{
+    GRID_LOCK();
+    if (hits)
+        *hits = grid_cache_hits;
+    if (misses)
+        *misses = grid_cache_misses;
+    GRID_UNLOCK();
 }
 
 void grid_compute_size(grid_type type, int width, int height,
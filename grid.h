@@ -75,6 +75,22 @@ typedef struct grid {
   int num_edges; grid_edge *edges;
   int num_dots;  grid_dot *dots;
 
+  /* The same incidence relationships again, flattened into a few
+   * contiguous arrays of integer indices, for code which walks the
+   * grid in inner loops (solvers, loop generation) and would rather
+   * not chase pointers all over the heap.
+   *
+   * The edges of face i are face_edges[face_offsets[i]] up to (but not
+   * including) face_edges[face_offsets[i+1]], in the same order as
+   * faces[i].edges; face_dots is indexed the same way.  Likewise
+   * dot_offsets, dot_edges and dot_faces for the dots.  Edge i joins
+   * dots edge_dots[2*i] and edge_dots[2*i+1] (dot1 and dot2), and
+   * separates faces edge_faces[2*i] and edge_faces[2*i+1] (face1 and
+   * face2).  The infinite outside face is -1 throughout. */
+  int *face_offsets, *face_edges, *face_dots;
+  int *dot_offsets, *dot_edges, *dot_faces;
+  int *edge_dots, *edge_faces;
+
   /* Cache the bounding-box of the grid, so the drawing-code can quickly
    * figure out the proper scaling to draw onto a given area. */
   int lowest_x, lowest_y, highest_x, highest_y;
@@ -86,7 +102,9 @@ typedef struct grid {
   int tilesize;
 
   /* We really don't want to copy this monstrosity!
-   * A grid is immutable once generated.
+   * A grid is immutable once generated, and may be shared between
+   * any number of users (including the cache in grid_new), so it must
+   * only ever be shared with grid_ref and released with grid_free.
    */
   int refcount;
 } grid;
@@ -125,10 +143,24 @@ char *grid_new_desc(grid_type type, int width, int height, random_state *rs);
 const char *grid_validate_desc(grid_type type, int width, int height,
                                const char *desc);
 
+/* Returns a new reference to a grid, which may be shared with other
+ * callers asking for the same type, size and description: grid_new
+ * keeps the last few grids it made in a cache. */
 grid *grid_new(grid_type type, int width, int height, const char *desc);
 
+/* Take or release a reference to a grid. Use these rather than
+ * touching refcount directly, since grids can be shared between
+ * threads. */
+grid *grid_ref(grid *g);
 void grid_free(grid *g);
 
+/* Drop the cache's references to the grids in it (grids still in use
+ * elsewhere survive until their last grid_free). */
+void grid_cache_clear(void);
+/* Report how many grid_new calls were satisfied from the cache, and
+ * how many had to make a new grid, since the program started. */
+void grid_cache_stats(unsigned long *hits, unsigned long *misses);
+
 grid_edge *grid_nearest_edge(grid *g, int x, int y);
 
 void grid_compute_size(grid_type type, int width, int height,
@@ -3695,10 +3695,300 @@ static void list_presets_from_menu(struct preset_menu *menu)
     }
 }
 
+/*
+ * Construct the parameter string for the ith game produced by
+ * --generate. If the user supplied a random seed, every game after
+ * the first gets its own seed derived from it by appending "-i", so
+ * that the whole run is reproducible.
+ */
+static char *generate_pstr(const char *arg, int i)
+{
+    char *pstr;
+
+    if (!arg)
+        return NULL;
+
+    pstr = snewn(strlen(arg) + 40, char);
+    strcpy(pstr, arg);
+    if (i > 0 && strchr(arg, '#'))
+        sprintf(pstr + strlen(pstr), "-%d", i);
+    return pstr;
+}
+
+#ifdef RUSAGE_THREAD
+/* Per-thread CPU time, so that timings stay meaningful under --jobs */
+#define GENERATE_RUSAGE_WHO RUSAGE_THREAD
+#else
+#define GENERATE_RUSAGE_WHO RUSAGE_SELF
+#endif
+
+/*
+ * Generate a single game for the --generate loop, from pstr if it's
+ * non-NULL or from the midend's current parameters otherwise, and
+ * perform the optional --time-generation and --test-solve steps.
+ *
+ * Returns NULL on success, or a dynamically allocated error message
+ * (including trailing newline) on failure. If time_generation is set,
+ * *report is filled in with a dynamically allocated timing line.
+ */
+static char *generate_one_game(midend *me, const char *pname,
+                               const char *pstr, bool time_generation,
+                               bool test_solve, char **report)
+{
+    const char *err;
+    char *seed, *msg;
+    struct rusage before, after;
+
+    if (pstr) {
+        err = midend_game_id(me, pstr);
+        if (err) {
+            msg = snewn(strlen(pname) + strlen(pstr) + strlen(err) + 40,
+                        char);
+            sprintf(msg, "%s: error parsing '%s': %s\n", pname, pstr, err);
+            return msg;
+        }
+    }
+
+    if (time_generation)
+        getrusage(GENERATE_RUSAGE_WHO, &before);
+
+    midend_new_game(me);
+
+    seed = midend_get_random_seed(me);
+
+    if (time_generation) {
+        double elapsed;
+
+        getrusage(GENERATE_RUSAGE_WHO, &after);
+
+        elapsed = (after.ru_utime.tv_sec -
+                   before.ru_utime.tv_sec);
+        elapsed += (after.ru_utime.tv_usec -
+                    before.ru_utime.tv_usec) / 1000000.0;
+
+        *report = snewn(strlen(thegame.name) + strlen(seed) + 40, char);
+        sprintf(*report, "%s %s: %.6f", thegame.name, seed, elapsed);
+    }
+
+    if (test_solve && thegame.can_solve) {
+        /*
+         * Now destroy the aux_info in the midend, by means of
+         * re-entering the same game id, and then try to solve
+         * it.
+         */
+        char *game_id;
+
+        game_id = midend_get_game_id(me);
+        err = midend_game_id(me, game_id);
+        if (err) {
+            msg = snewn(strlen(thegame.name) + strlen(seed) +
+                        strlen(err) + 40, char);
+            sprintf(msg, "%s %s: game id re-entry error: %s\n",
+                    thegame.name, seed, err);
+            sfree(game_id);
+            sfree(seed);
+            return msg;
+        }
+        midend_new_game(me);
+        sfree(game_id);
+
+        err = midend_solve(me);
+        /*
+         * If the solve operation returned the error "Solution
+         * not known for this puzzle", that's OK, because that
+         * just means it's a puzzle for which we don't have an
+         * algorithmic solver and hence can't solve it without
+         * the aux_info, e.g. Netslide. Any other error is a
+         * problem, though.
+         */
+        if (err && strcmp(err, "Solution not known for this puzzle")) {
+            msg = snewn(strlen(thegame.name) + strlen(seed) +
+                        strlen(err) + 40, char);
+            sprintf(msg, "%s %s: solve error: %s\n",
+                    thegame.name, seed, err);
+            sfree(seed);
+            return msg;
+        }
+    }
+
+    sfree(seed);
+    return NULL;
+}
+
+/*
+ * Support for '--generate --jobs N', which runs N midends in worker
+ * threads to make use of more than one core.
+ *
+ * Games are numbered in the order the single-threaded loop would
+ * generate them. Each worker repeatedly claims the lowest unclaimed
+ * number, and the main thread prints results strictly in number
+ * order, so the output for a given seed is identical however many
+ * threads are used. To bound memory use, no worker is allowed to get
+ * more than 'window' games ahead of the output.
+ *
+ * Without a '#seed', the workers' midends can't be left to seed
+ * themselves, because get_random_seed() gives the same answer to
+ * threads that start at the same moment. Instead the main thread
+ * draws a seed for each game from one master random state, in game
+ * number order, and the worker reseeds its midend with it. So an
+ * unseeded run, too, doesn't depend on the number of threads.
+ */
+struct generate_result {
+    bool done;
+    char *out, *err;
+    unsigned char seed[16];      /* for the midend, set by the main thread */
+};
+
+struct generate_jobs {
+    const char *pname, *arg;
+    int n;
+    bool time_generation, test_solve;
+
+    GMutex mutex;
+    GCond cond;                  /* signalled whenever anything changes */
+    int next_job, next_output;
+    bool aborted;
+    struct generate_result *results;   /* indexed by game number % window */
+    int window;
+    random_state *master;        /* main thread only */
+};
+
+/* Called with the mutex held, before game i can be claimed. */
+static void generate_set_seed(struct generate_jobs *ctx, int i)
+{
+    struct generate_result *res = &ctx->results[i % ctx->window];
+    int j;
+
+    for (j = 0; j < lenof(res->seed); j++)
+        res->seed[j] = random_bits(ctx->master, 8);
+}
+
+static gpointer generate_worker(gpointer vctx)
+{
+    struct generate_jobs *ctx = (struct generate_jobs *)vctx;
+    midend *me = midend_new(NULL, &thegame, NULL, NULL);
+
+    g_mutex_lock(&ctx->mutex);
+    while (!ctx->aborted && ctx->next_job < ctx->n) {
+        int i = ctx->next_job;
+        struct generate_result *res;
+        char *pstr, *out = NULL, *err;
+        unsigned char seed[lenof(res->seed)];
+
+        if (i >= ctx->next_output + ctx->window) {
+            g_cond_wait(&ctx->cond, &ctx->mutex);
+            continue;
+        }
+        ctx->next_job++;
+        memcpy(seed, ctx->results[i % ctx->window].seed, sizeof(seed));
+        g_mutex_unlock(&ctx->mutex);
+
+        midend_reseed(me, seed, sizeof(seed));
+        pstr = generate_pstr(ctx->arg, i);
+        err = generate_one_game(me, ctx->pname, pstr, ctx->time_generation,
+                                ctx->test_solve, &out);
+        if (!err && !ctx->time_generation)
+            out = midend_get_game_id(me);
+        sfree(pstr);
+
+        g_mutex_lock(&ctx->mutex);
+        res = &ctx->results[i % ctx->window];
+        res->out = out;
+        res->err = err;
+        res->done = true;
+        g_cond_broadcast(&ctx->cond);
+    }
+    g_mutex_unlock(&ctx->mutex);
+
+    midend_free(me);
+    return NULL;
+}
+
+static int generate_with_jobs(const char *pname, const char *arg, int n,
+                              int njobs, bool time_generation,
+                              bool test_solve)
+{
+    struct generate_jobs ctx;
+    GThread **threads;
+    void *randseed;
+    int randseedsize;
+    int i, ret = 0;
+
+    ctx.pname = pname;
+    ctx.arg = arg;
+    ctx.n = n;
+    ctx.time_generation = time_generation;
+    ctx.test_solve = test_solve;
+    ctx.next_job = ctx.next_output = 0;
+    ctx.aborted = false;
+    ctx.window = njobs * 16;
+    ctx.results = snewn(ctx.window, struct generate_result);
+    get_random_seed(&randseed, &randseedsize);
+    ctx.master = random_new(randseed, randseedsize);
+    sfree(randseed);
+    for (i = 0; i < ctx.window; i++) {
+        ctx.results[i].done = false;
+        ctx.results[i].out = ctx.results[i].err = NULL;
+        generate_set_seed(&ctx, i);
+    }
+    g_mutex_init(&ctx.mutex);
+    g_cond_init(&ctx.cond);
+
+    threads = snewn(njobs, GThread *);
+    for (i = 0; i < njobs; i++)
+        threads[i] = g_thread_new("generate", generate_worker, &ctx);
+
+    for (i = 0; i < n; i++) {
+        struct generate_result *res = &ctx.results[i % ctx.window];
+        char *out, *err;
+
+        g_mutex_lock(&ctx.mutex);
+        while (!res->done)
+            g_cond_wait(&ctx.cond, &ctx.mutex);
+        out = res->out;
+        err = res->err;
+        res->done = false;
+        res->out = res->err = NULL;
+        generate_set_seed(&ctx, i + ctx.window);
+        ctx.next_output++;
+        if (err)
+            ctx.aborted = true;
+        g_cond_broadcast(&ctx.cond);
+        g_mutex_unlock(&ctx.mutex);
+
+        if (out) {
+            puts(out);
+            sfree(out);
+        }
+        if (err) {
+            fputs(err, stderr);
+            sfree(err);
+            ret = 1;
+            break;
+        }
+    }
+
+    for (i = 0; i < njobs; i++)
+        g_thread_join(threads[i]);
+    sfree(threads);
+
+    /* Discard anything generated after an error made us stop early. */
+    for (i = 0; i < ctx.window; i++) {
+        sfree(ctx.results[i].out);
+        sfree(ctx.results[i].err);
+    }
+    sfree(ctx.results);
+    random_free(ctx.master);
+    g_cond_clear(&ctx.cond);
+    g_mutex_clear(&ctx.mutex);
+
+    return ret;
+}
+
 int main(int argc, char **argv)
 {
     char *pname = argv[0];
-    int ngenerate = 0, px = 1, py = 1;
+    int ngenerate = 0, njobs = 1, px = 1, py = 1;
     bool print = false;
     bool time_generation = false, test_solve = false, list_presets = false;
     bool soln = false, colour = false;
@@ -3753,6 +4043,18 @@ int main(int argc, char **argv)
 		}
 	    } else
 		ngenerate = 1;
+	} else if (doing_opts && !strcmp(p, "--jobs")) {
+	    if (--ac > 0) {
+		njobs = atoi(*++av);
+		if (njobs < 1) {
+		    fprintf(stderr, "%s: '--jobs' expected a positive number\n",
+			    pname);
+		    return 1;
+		}
+	    } else {
+		fprintf(stderr, "%s: '--jobs' expected a number\n", pname);
+		return 1;
+	    }
 	} else if (doing_opts && !strcmp(p, "--time-generation")) {
             time_generation = true;
 	} else if (doing_opts && !strcmp(p, "--test-solve")) {
@@ -3900,6 +4202,11 @@ int main(int argc, char **argv)
      * If you specify <params>, you must also specify <n> (although
      * you may specify it to be 1). Sorry; that was the
      * simplest-to-parse command-line syntax I came up with.
+     *
+     * '--jobs <j>' spreads the work of --generate across <j> threads,
+     * each with its own midend. The IDs are still output in the same
+     * order, so a run starting from a fixed random seed produces the
+     * same list however many threads it uses.
      */
     if (ngenerate > 0 || print || savefile || savesuffix) {
 	int i, n = 1;
@@ -3919,6 +4226,22 @@ int main(int argc, char **argv)
 
 	n = ngenerate;
 
+        if (njobs > 1) {
+            /*
+             * Multi-threaded generation only knows how to write game
+             * IDs (or timings) to standard output, in the same order
+             * as the single-threaded loop below would.
+             */
+            if (ngenerate == 0 || print || savefile || savesuffix) {
+                fprintf(stderr, "%s: '--jobs' can only be used with "
+                        "'--generate', and not with '--print' or "
+                        "'--save'\n", pname);
+                return 1;
+            }
+            return generate_with_jobs(pname, arg, n, njobs,
+                                      time_generation, test_solve);
+        }
+
 	me = midend_new(NULL, &thegame, NULL, NULL);
 	i = 0;
 
@@ -3947,9 +4270,8 @@ int main(int argc, char **argv)
 	 * generated descriptive game IDs.)
 	 */
 	while (ngenerate == 0 || i < n) {
-	    char *pstr, *seed;
+	    char *pstr, *report = NULL, *msg;
             const char *err;
-            struct rusage before, after;
 
 	    if (ngenerate == 0) {
 		pstr = fgetline(stdin);
@@ -3957,81 +4279,21 @@ int main(int argc, char **argv)
 		    break;
 		pstr[strcspn(pstr, "\r\n")] = '\0';
 	    } else {
-		if (arg) {
-		    pstr = snewn(strlen(arg) + 40, char);
-
-		    strcpy(pstr, arg);
-		    if (i > 0 && strchr(arg, '#'))
-			sprintf(pstr + strlen(pstr), "-%d", i);
-		} else
-		    pstr = NULL;
-	    }
-
-	    if (pstr) {
-		err = midend_game_id(me, pstr);
-		if (err) {
-		    fprintf(stderr, "%s: error parsing '%s': %s\n",
-			    pname, pstr, err);
-		    return 1;
-		}
+		pstr = generate_pstr(arg, i);
 	    }
 
-            if (time_generation)
-                getrusage(RUSAGE_SELF, &before);
-
-            midend_new_game(me);
-
-            seed = midend_get_random_seed(me);
-
-            if (time_generation) {
-                double elapsed;
-
-                getrusage(RUSAGE_SELF, &after);
-
-                elapsed = (after.ru_utime.tv_sec -
-                           before.ru_utime.tv_sec);
-                elapsed += (after.ru_utime.tv_usec -
-                            before.ru_utime.tv_usec) / 1000000.0;
-
-                printf("%s %s: %.6f\n", thegame.name, seed, elapsed);
+            msg = generate_one_game(me, pname, pstr, time_generation,
+                                    test_solve, &report);
+            if (report) {
+                puts(report);
+                sfree(report);
             }
-
-            if (test_solve && thegame.can_solve) {
-                /*
-                 * Now destroy the aux_info in the midend, by means of
-                 * re-entering the same game id, and then try to solve
-                 * it.
-                 */
-                char *game_id;
-
-                game_id = midend_get_game_id(me);
-                err = midend_game_id(me, game_id);
-                if (err) {
-                    fprintf(stderr, "%s %s: game id re-entry error: %s\n",
-                            thegame.name, seed, err);
-                    return 1;
-                }
-                midend_new_game(me);
-                sfree(game_id);
-
-                err = midend_solve(me);
-                /*
-                 * If the solve operation returned the error "Solution
-                 * not known for this puzzle", that's OK, because that
-                 * just means it's a puzzle for which we don't have an
-                 * algorithmic solver and hence can't solve it without
-                 * the aux_info, e.g. Netslide. Any other error is a
-                 * problem, though.
-                 */
-                if (err && strcmp(err, "Solution not known for this puzzle")) {
-                    fprintf(stderr, "%s %s: solve error: %s\n",
-                            thegame.name, seed, err);
-                    return 1;
-                }
+            if (msg) {
+                fputs(msg, stderr);
+                return 1;
             }
 
 	    sfree(pstr);
-            sfree(seed);
 
 	    if (doc) {
 		err = midend_print_puzzle(me, doc, soln);
@@ -1525,6 +1525,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PEG_PREFER_SZ, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
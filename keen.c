@@ -376,15 +376,15 @@ static int solver_common(struct latin_solver *solver, void *vctx, int diff)
 
 		/* (i,j) is a valid digit pair. Try it both ways round. */
 
-		if (solver->cube[sq[0]*w+i-1] &&
-		    solver->cube[sq[1]*w+j-1]) {
+		if (cubebit(sq[0], i) &&
+		    cubebit(sq[1], j)) {
 		    ctx->dscratch[0] = i;
 		    ctx->dscratch[1] = j;
 		    solver_clue_candidate(ctx, diff, box);
 		}
 
-		if (solver->cube[sq[0]*w+j-1] &&
-		    solver->cube[sq[1]*w+i-1]) {
+		if (cubebit(sq[0], j) &&
+		    cubebit(sq[1], i)) {
 		    ctx->dscratch[0] = j;
 		    ctx->dscratch[1] = i;
 		    solver_clue_candidate(ctx, diff, box);
@@ -415,7 +415,7 @@ static int solver_common(struct latin_solver *solver, void *vctx, int diff)
 		    for (j = ctx->dscratch[i] + 1; j <= w; j++) {
 			if (op == C_ADD ? (total < j) : (total % j != 0))
 			    continue;  /* this one won't fit */
-			if (!solver->cube[sq[i]*w+j-1])
+			if (!cubebit(sq[i], j))
 			    continue;  /* this one is ruled out already */
 			for (k = 0; k < i; k++)
 			    if (ctx->dscratch[k] == j &&
@@ -482,7 +482,7 @@ static int solver_common(struct latin_solver *solver, void *vctx, int diff)
 
 	    for (i = 0; i < n; i++)
 		for (j = 1; j <= w; j++) {
-		    if (solver->cube[sq[i]*w+j-1] &&
+		    if (cubebit(sq[i], j) &&
 			!(ctx->iscratch[i] & (1 << j))) {
 #ifdef STANDALONE_SOLVER
 			if (solver_show_working) {
@@ -492,7 +492,7 @@ static int solver_common(struct latin_solver *solver, void *vctx, int diff)
 			    prefix[0] = '\0';
 			}
 #endif
-			solver->cube[sq[i]*w+j-1] = 0;
+			latin_solver_rule_out(solver, sq[i]/w, sq[i]%w, j);
 			ret = 1;
 		    }
 		}
@@ -526,7 +526,7 @@ static int solver_common(struct latin_solver *solver, void *vctx, int diff)
 		    for (k = 0; k < w; k++) {
 			int pos = start + k*step;
 			if (ctx->whichbox[pos] != box &&
-			    solver->cube[pos*w+j-1]) {
+			    cubebit(pos, j)) {
 #ifdef STANDALONE_SOLVER
 			    if (solver_show_working) {
 				printf("%s%s%*s   ruling out %d at (%d,%d)\n",
@@ -536,7 +536,7 @@ static int solver_common(struct latin_solver *solver, void *vctx, int diff)
 				prefix[0] = prefix2[0] = '\0';
 			    }
 #endif
-			    solver->cube[pos*w+j-1] = 0;
+			    latin_solver_rule_out(solver, pos/w, pos%w, j);
 			    ret = 1;
 			}
 		    }
@@ -681,12 +681,19 @@ static bool keen_valid(struct latin_solver *solver, void *vctx)
     return true;
 }
 
-static int solver(int w, int *dsf, long *clues, digit *soln, int maxdiff)
+/*
+ * 'ar' may be NULL, in which case the solver uses a private arena
+ * for all its scratch space.
+ */
+static int solver(int w, int *dsf, long *clues, digit *soln, int maxdiff,
+                  arena *ar)
 {
     int a = w*w;
     struct solver_ctx ctx;
     int ret;
     int i, j, n, m;
+    bool own_arena = (ar == NULL);
+    arena_mark mark;
     
     ctx.w = w;
     ctx.soln = soln;
@@ -703,10 +710,13 @@ static int solver(int w, int *dsf, long *clues, digit *soln, int maxdiff)
     for (ctx.nboxes = i = 0; i < a; i++)
 	if (dsf_canonify(dsf, i) == i)
 	    ctx.nboxes++;
-    ctx.boxlist = snewn(a, int);
-    ctx.boxes = snewn(ctx.nboxes+1, int);
-    ctx.clues = snewn(ctx.nboxes, long);
-    ctx.whichbox = snewn(a, int);
+    if (own_arena)
+        ar = arena_new();
+    mark = arena_save(ar);
+    ctx.boxlist = anewn(ar, a, int);
+    ctx.boxes = anewn(ar, ctx.nboxes+1, int);
+    ctx.clues = anewn(ar, ctx.nboxes, long);
+    ctx.whichbox = anewn(ar, a, int);
     for (n = m = i = 0; i < a; i++)
 	if (dsf_canonify(dsf, i) == i) {
 	    ctx.clues[n] = clues[i];
@@ -722,20 +732,18 @@ static int solver(int w, int *dsf, long *clues, digit *soln, int maxdiff)
     assert(m == a);
     ctx.boxes[n] = m;
 
-    ctx.dscratch = snewn(a+1, digit);
-    ctx.iscratch = snewn(max(a+1, 4*w), int);
+    ctx.dscratch = anewn(ar, a+1, digit);
+    ctx.iscratch = anewn(ar, max(a+1, 4*w), int);
 
     ret = latin_solver(soln, w, maxdiff,
 		       DIFF_EASY, DIFF_HARD, DIFF_EXTREME,
 		       DIFF_EXTREME, DIFF_UNREASONABLE,
-		       keen_solvers, keen_valid, &ctx, NULL, NULL);
+		       keen_solvers, keen_valid, &ctx, NULL, NULL, ar);
 
-    sfree(ctx.dscratch);
-    sfree(ctx.iscratch);
-    sfree(ctx.whichbox);
-    sfree(ctx.boxlist);
-    sfree(ctx.boxes);
-    sfree(ctx.clues);
+    if (own_arena)
+        arena_free(ar);
+    else
+        arena_restore(ar, mark);
 
     return ret;
 }
@@ -899,6 +907,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     int i, j, k, n, x, y, ret;
     int diff = params->diff;
     char *desc, *p;
+    arena *ar;
 
     /*
      * Difficulty exceptions: 3x3 puzzles at difficulty Hard or
@@ -928,13 +937,18 @@ done
 
     grid = NULL;
 
-    order = snewn(a, int);
-    revorder = snewn(a, int);
-    singletons = snewn(a, int);
+    /*
+     * The solver's scratch space for every attempt comes from here,
+     * along with our own working arrays.
+     */
+    ar = arena_new();
+    order = anewn(ar, a, int);
+    revorder = anewn(ar, a, int);
+    singletons = anewn(ar, a, int);
     dsf = snew_dsf(a);
-    clues = snewn(a, long);
-    cluevals = snewn(a, long);
-    soln = snewn(a, digit);
+    clues = anewn(ar, a, long);
+    cluevals = anewn(ar, a, long);
+    soln = anewn(ar, a, digit);
 
     while (1) {
 	/*
@@ -1222,12 +1236,12 @@ done
 	 */
 	if (diff > 0) {
 	    memset(soln, 0, a);
-	    ret = solver(w, dsf, clues, soln, diff-1);
+	    ret = solver(w, dsf, clues, soln, diff-1, ar);
 	    if (ret <= diff-1)
 		continue;
 	}
 	memset(soln, 0, a);
-	ret = solver(w, dsf, clues, soln, diff);
+	ret = solver(w, dsf, clues, soln, diff, ar);
 	if (ret != diff)
 	    continue;		       /* go round again */
 
@@ -1281,13 +1295,8 @@ done
     (*aux)[a+1] = '\0';
 
     sfree(grid);
-    sfree(order);
-    sfree(revorder);
-    sfree(singletons);
     sfree(dsf);
-    sfree(clues);
-    sfree(cluevals);
-    sfree(soln);
+    arena_free(ar);
 
     return desc;
 }
@@ -1481,7 +1490,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     memset(soln, 0, a);
 
     ret = solver(w, state->clues->dsf, state->clues->clues,
-		 soln, DIFFCOUNT-1);
+		 soln, DIFFCOUNT-1, NULL);
 
     if (ret == diff_impossible) {
 	*error = "No solution exists for this puzzle";
@@ -2495,6 +2504,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILESIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -2569,7 +2579,7 @@ int main(int argc, char **argv)
     for (diff = 0; diff < DIFFCOUNT; diff++) {
 	memset(s->grid, 0, p->w * p->w);
 	ret = solver(p->w, s->clues->dsf, s->clues->clues,
-		     s->grid, diff);
+		     s->grid, diff, NULL);
 	if (ret <= diff)
 	    break;
     }
@@ -2589,7 +2599,7 @@ int main(int argc, char **argv)
 	    solver_show_working = really_show_working ? 1 : 0;
 	    memset(s->grid, 0, p->w * p->w);
 	    ret = solver(p->w, s->clues->dsf, s->clues->clues,
-			 s->grid, diff);
+			 s->grid, diff, NULL);
 	    if (ret != diff)
 		printf("Puzzle is inconsistent\n");
 	    else {
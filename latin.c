@@ -26,6 +26,45 @@ static int latin_solver_top(struct latin_solver *solver, int maxdiff,
 int solver_show_working, solver_recurse_depth;
 #endif
 
+#define DIGITBIT(n) ((latin_mask)1 << ((n)-1))
+
+static int bitcount32(latin_mask word)
+{
+    word = ((word & 0xAAAAAAAAUL) >> 1) + (word & 0x55555555UL);
+    word = ((word & 0xCCCCCCCCUL) >> 2) + (word & 0x33333333UL);
+    word = ((word & 0xF0F0F0F0UL) >> 4) + (word & 0x0F0F0F0FUL);
+    word = ((word & 0xFF00FF00UL) >> 8) + (word & 0x00FF00FFUL);
+    word = ((word & 0xFFFF0000UL) >> 16) + (word & 0x0000FFFFUL);
+
+    return (int)word;
+}
+
+/* Index of the lowest set bit in a nonzero mask. */
+static int lowbit(latin_mask word)
+{
+    int i = 0;
+
+    assert(word);
+    while (!(word & 1)) {
+        word >>= 1;
+        i++;
+    }
+    return i;
+}
+
+/*
+ * Rule out a number at a particular position, keeping the per-square
+ * masks and the transposed row and column masks in step.
+ */
+void latin_solver_rule_out(struct latin_solver *solver, int x, int y, int n)
+{
+    int o = solver->o;
+
+    solver->cube[cubecell(x,y)] &= ~DIGITBIT(n);
+    solver->rowpos[y*o+n-1] &= ~DIGITBIT(x+1);
+    solver->colpos[x*o+n-1] &= ~DIGITBIT(y+1);
+}
+
 /*
  * Function called when we are certain that a particular square has
  * a particular number in it. The y-coordinate passed in here is
@@ -33,7 +72,8 @@ int solver_show_working, solver_recurse_depth;
  */
 void latin_solver_place(struct latin_solver *solver, int x, int y, int n)
 {
-    int i, o = solver->o;
+    int o = solver->o;
+    latin_mask m;
 
     assert(n <= o);
     assert(cube(x,y,n));
@@ -41,23 +81,20 @@ void latin_solver_place(struct latin_solver *solver, int x, int y, int n)
     /*
      * Rule out all other numbers in this square.
      */
-    for (i = 1; i <= o; i++)
-	if (i != n)
-            cube(x,y,i) = false;
+    for (m = solver->cube[cubecell(x,y)] & ~DIGITBIT(n); m; m &= m-1)
+        latin_solver_rule_out(solver, x, y, lowbit(m)+1);
 
     /*
      * Rule out this number in all other positions in the row.
      */
-    for (i = 0; i < o; i++)
-	if (i != y)
-            cube(x,i,n) = false;
+    for (m = solver->colpos[x*o+n-1] & ~DIGITBIT(y+1); m; m &= m-1)
+        latin_solver_rule_out(solver, x, lowbit(m), n);
 
     /*
      * Rule out this number in all other positions in the column.
      */
-    for (i = 0; i < o; i++)
-	if (i != x)
-            cube(i,y,n) = false;
+    for (m = solver->rowpos[y*o+n-1] & ~DIGITBIT(x+1); m; m &= m-1)
+        latin_solver_rule_out(solver, lowbit(m), y, n);
 
     /*
      * Enter the number in the result grid.
@@ -68,7 +105,36 @@ void latin_solver_place(struct latin_solver *solver, int x, int y, int n)
      * Cross out this number from the list of numbers left to place
      * in its row, its column and its block.
      */
-    solver->row[y*o+n-1] = solver->col[x*o+n-1] = true;
+    solver->row[y] |= DIGITBIT(n);
+    solver->col[x] |= DIGITBIT(n);
+}
+
+/*
+ * Return the o booleans at cube positions start, start+step, ...,
+ * as a mask with bit i corresponding to start+i*step. The step must
+ * run along one of the three axes of the cube, starting from zero in
+ * that coordinate, so that the answer is one of our stored masks.
+ */
+static latin_mask latin_solver_line(struct latin_solver *solver,
+                                    int start, int step)
+{
+    int o = solver->o, x, y, n;
+
+    n = 1 + start % o;
+    y = start / o;
+    x = y / o;
+    y %= o;
+
+    if (step == 1) {
+        assert(n == 1);
+        return solver->cube[cubecell(x,y)];
+    } else if (step == o) {
+        assert(y == 0);
+        return solver->colpos[x*o+n-1];
+    } else {
+        assert(step == o*o && x == 0);
+        return solver->rowpos[y*o+n-1];
+    }
 }
 
 int latin_solver_elim(struct latin_solver *solver, int start, int step
@@ -81,24 +147,19 @@ int latin_solver_elim(struct latin_solver *solver, int start, int step
 #ifdef STANDALONE_SOLVER
     char **names = solver->names;
 #endif
-    int fpos, m, i;
+    latin_mask line = latin_solver_line(solver, start, step);
+    int m;
 
     /*
      * Count the number of set bits within this section of the
      * cube.
      */
-    m = 0;
-    fpos = -1;
-    for (i = 0; i < o; i++)
-	if (solver->cube[start+i*step]) {
-	    fpos = start+i*step;
-	    m++;
-	}
+    m = bitcount32(line);
 
     if (m == 1) {
-	int x, y, n;
-	assert(fpos >= 0);
+	int x, y, n, fpos;
 
+        fpos = start + lowbit(line) * step;
 	n = 1 + fpos % o;
 	y = fpos / o;
 	x = y / o;
@@ -139,7 +200,8 @@ int latin_solver_elim(struct latin_solver *solver, int start, int step
 }
 
 struct latin_solver_scratch {
-    unsigned char *grid, *rowidx, *colidx, *set;
+    unsigned char *grid, *rowidx, *colidx;
+    latin_mask *rows;
     int *neighbours, *bfsqueue;
 #ifdef STANDALONE_SOLVER
     int *bfsprev;
@@ -159,10 +221,10 @@ int latin_solver_set(struct latin_solver *solver,
     char **names = solver->names;
 #endif
     int i, j, n, count;
-    unsigned char *grid = scratch->grid;
     unsigned char *rowidx = scratch->rowidx;
     unsigned char *colidx = scratch->colidx;
-    unsigned char *set = scratch->set;
+    latin_mask *rows = scratch->rows;
+    latin_mask set, full;
 
     /*
      * We are passed a o-by-o matrix of booleans. Our first job
@@ -173,14 +235,11 @@ int latin_solver_set(struct latin_solver *solver,
     memset(rowidx, true, o);
     memset(colidx, true, o);
     for (i = 0; i < o; i++) {
-        int count = 0, first = -1;
-        for (j = 0; j < o; j++)
-            if (solver->cube[start+i*step1+j*step2])
-                first = j, count++;
-
-	if (count == 0) return -1;
-        if (count == 1)
-            rowidx[i] = colidx[first] = false;
+        rows[i] = latin_solver_line(solver, start+i*step1, step2);
+
+	if (!rows[i]) return -1;
+        if (bitcount32(rows[i]) == 1)
+            rowidx[i] = colidx[lowbit(rows[i])] = false;
     }
 
     /*
@@ -197,11 +256,18 @@ int latin_solver_set(struct latin_solver *solver,
     assert(n == j);
 
     /*
-     * And create the smaller matrix.
+     * And create the smaller matrix, as one mask per row. Column j
+     * of the smaller matrix goes in bit n-1-j, so that counting
+     * upwards through candidate sets of columns visits them in the
+     * same order as a binary counter whose last digit is column n-1.
      */
-    for (i = 0; i < n; i++)
+    for (i = 0; i < n; i++) {
+        latin_mask row = rows[rowidx[i]];
+        rows[i] = 0;
         for (j = 0; j < n; j++)
-            grid[i*o+j] = solver->cube[start+rowidx[i]*step1+colidx[j]*step2];
+            if (row & DIGITBIT(colidx[j]+1))
+                rows[i] |= DIGITBIT(n-j);
+    }
 
     /*
      * Having done that, we now have a matrix in which every row
@@ -211,9 +277,10 @@ int latin_solver_set(struct latin_solver *solver,
      * columns) whose width and height add up to n.
      */
 
-    memset(set, 0, n);
-    count = 0;
-    while (1) {
+    full = n ? (DIGITBIT(n) << 1) - 1 : 0;
+    for (set = 0;; set++) {
+        count = bitcount32(set);
+
         /*
          * We have a candidate set. If its size is <=1 or >=n-1
          * then we move on immediately.
@@ -224,17 +291,10 @@ int latin_solver_set(struct latin_solver *solver,
              * find that many rows which each have a zero in all
              * the positions listed in `set'.
              */
-            int rows = 0;
-            for (i = 0; i < n; i++) {
-                bool ok = true;
-                for (j = 0; j < n; j++)
-                    if (set[j] && grid[i*o+j]) {
-                        ok = false;
-                        break;
-                    }
-                if (ok)
-                    rows++;
-            }
+            int rows_ok = 0;
+            for (i = 0; i < n; i++)
+                if (!(rows[i] & set))
+                    rows_ok++;
 
             /*
              * We expect never to be able to get _more_ than
@@ -244,7 +304,7 @@ int latin_solver_set(struct latin_solver *solver,
              * indicates a faulty deduction before this point or
              * even a bogus clue.
              */
-            if (rows > n - count) {
+            if (rows_ok > n - count) {
 #ifdef STANDALONE_SOLVER
 		if (solver_show_working) {
 		    va_list ap;
@@ -260,7 +320,7 @@ int latin_solver_set(struct latin_solver *solver,
 		return -1;
 	    }
 
-            if (rows >= n - count) {
+            if (rows_ok >= n - count) {
                 bool progress = false;
 
                 /*
@@ -275,44 +335,40 @@ int latin_solver_set(struct latin_solver *solver,
                  * positions in the cube to meddle with.
                  */
                 for (i = 0; i < n; i++) {
-                    bool ok = true;
-                    for (j = 0; j < n; j++)
-                        if (set[j] && grid[i*o+j]) {
-                            ok = false;
-                            break;
-                        }
-                    if (!ok) {
-                        for (j = 0; j < n; j++)
-                            if (!set[j] && grid[i*o+j]) {
-                                int fpos = (start+rowidx[i]*step1+
-                                            colidx[j]*step2);
-#ifdef STANDALONE_SOLVER
-                                if (solver_show_working) {
-                                    int px, py, pn;
-
-                                    if (!progress) {
-                                        va_list ap;
-					printf("%*s", solver_recurse_depth*4,
-					       "");
-                                        va_start(ap, fmt);
-                                        vprintf(fmt, ap);
-                                        va_end(ap);
-                                        printf(":\n");
-                                    }
+                    if (!(rows[i] & set))
+                        continue;
+                    for (j = 0; j < n; j++) {
+                        int fpos, px, py, pn;
 
-                                    pn = 1 + fpos % o;
-                                    py = fpos / o;
-                                    px = py / o;
-                                    py %= o;
+                        if (!(rows[i] & ~set & DIGITBIT(n-j)))
+                            continue;
 
-                                    printf("%*s  ruling out %s at (%d,%d)\n",
-					   solver_recurse_depth*4, "",
-                                           names[pn-1], px+1, py+1);
-                                }
-#endif
-                                progress = true;
-                                solver->cube[fpos] = false;
+                        fpos = (start+rowidx[i]*step1+
+                                colidx[j]*step2);
+                        pn = 1 + fpos % o;
+                        py = fpos / o;
+                        px = py / o;
+                        py %= o;
+
+#ifdef STANDALONE_SOLVER
+                        if (solver_show_working) {
+                            if (!progress) {
+                                va_list ap;
+                                printf("%*s", solver_recurse_depth*4,
+                                       "");
+                                va_start(ap, fmt);
+                                vprintf(fmt, ap);
+                                va_end(ap);
+                                printf(":\n");
                             }
+
+                            printf("%*s  ruling out %s at (%d,%d)\n",
+                                   solver_recurse_depth*4, "",
+                                   names[pn-1], px+1, py+1);
+                        }
+#endif
+                        progress = true;
+                        latin_solver_rule_out(solver, px, py, pn);
                     }
                 }
 
@@ -322,16 +378,7 @@ int latin_solver_set(struct latin_solver *solver,
             }
         }
 
-        /*
-         * Binary increment: change the rightmost 0 to a 1, and
-         * change all 1s to the right of it to 0s.
-         */
-        i = n;
-        while (i > 0 && set[i-1])
-            set[--i] = 0, count--;
-        if (i > 0)
-            set[--i] = 1, count++;
-        else
+        if (set == full)
             break;                     /* done */
     }
 
@@ -391,28 +438,21 @@ int latin_solver_forcing(struct latin_solver *solver,
 
     for (y = 0; y < o; y++)
         for (x = 0; x < o; x++) {
-            int count, t, n;
+            latin_mask cands = solver->cube[cubecell(x,y)];
+            int n;
 
             /*
              * If this square doesn't have exactly two candidate
              * numbers, don't try it.
-             *
-             * In this loop we also sum the candidate numbers,
-             * which is a nasty hack to allow us to quickly find
-             * `the other one' (since we will shortly know there
-             * are exactly two).
              */
-            for (count = t = 0, n = 1; n <= o; n++)
-                if (cube(x, y, n))
-                    count++, t += n;
-            if (count != 2)
+            if (bitcount32(cands) != 2)
                 continue;
 
             /*
              * Now attempt a bfs for each candidate.
              */
             for (n = 1; n <= o; n++)
-                if (cube(x, y, n)) {
+                if (cands & DIGITBIT(n)) {
                     int orign, currn, head, tail;
 
                     /*
@@ -426,7 +466,7 @@ int latin_solver_forcing(struct latin_solver *solver,
 #ifdef STANDALONE_SOLVER
                     bfsprev[y*o+x] = -1;
 #endif
-                    number[y*o+x] = t - n;
+                    number[y*o+x] = 1 + lowbit(cands & ~DIGITBIT(n));
 
                     while (head < tail) {
                         int xx, yy, nneighbours, xt, yt, i;
@@ -450,7 +490,7 @@ int latin_solver_forcing(struct latin_solver *solver,
                          * Try visiting each of those neighbours.
                          */
                         for (i = 0; i < nneighbours; i++) {
-                            int cc, tt, nn;
+                            latin_mask tcands;
 
                             xt = neighbours[i] % o;
                             yt = neighbours[i] / o;
@@ -477,15 +517,14 @@ int latin_solver_forcing(struct latin_solver *solver,
                              * this square to have exactly two
                              * possible numbers.
                              */
-                            for (cc = tt = 0, nn = 1; nn <= o; nn++)
-                                if (cube(xt, yt, nn))
-                                    cc++, tt += nn;
-                            if (cc == 2) {
+                            tcands = solver->cube[cubecell(xt,yt)];
+                            if (bitcount32(tcands) == 2) {
                                 bfsqueue[tail++] = yt*o+xt;
 #ifdef STANDALONE_SOLVER
                                 bfsprev[yt*o+xt] = yy*o+xx;
 #endif
-                                number[yt*o+xt] = tt - currn;
+                                number[yt*o+xt] =
+                                    1 + lowbit(tcands & ~DIGITBIT(currn));
                             }
 
                             /*
@@ -522,7 +561,7 @@ int latin_solver_forcing(struct latin_solver *solver,
 					   xt+1, yt+1);
                                 }
 #endif
-                                cube(xt, yt, orign) = false;
+                                latin_solver_rule_out(solver, xt, yt, orign);
                                 return 1;
                             }
                         }
@@ -535,47 +574,46 @@ int latin_solver_forcing(struct latin_solver *solver,
 
 struct latin_solver_scratch *latin_solver_new_scratch(struct latin_solver *solver)
 {
-    struct latin_solver_scratch *scratch = snew(struct latin_solver_scratch);
+    arena *ar = solver->ar;
+    struct latin_solver_scratch *scratch = anew(ar, struct latin_solver_scratch);
     int o = solver->o;
-    scratch->grid = snewn(o*o, unsigned char);
-    scratch->rowidx = snewn(o, unsigned char);
-    scratch->colidx = snewn(o, unsigned char);
-    scratch->set = snewn(o, unsigned char);
-    scratch->neighbours = snewn(3*o, int);
-    scratch->bfsqueue = snewn(o*o, int);
+    scratch->grid = anewn(ar, o*o, unsigned char);
+    scratch->rowidx = anewn(ar, o, unsigned char);
+    scratch->colidx = anewn(ar, o, unsigned char);
+    scratch->rows = anewn(ar, o, latin_mask);
+    scratch->neighbours = anewn(ar, 3*o, int);
+    scratch->bfsqueue = anewn(ar, o*o, int);
 #ifdef STANDALONE_SOLVER
-    scratch->bfsprev = snewn(o*o, int);
+    scratch->bfsprev = anewn(ar, o*o, int);
 #endif
     return scratch;
 }
 
-void latin_solver_free_scratch(struct latin_solver_scratch *scratch)
-{
-#ifdef STANDALONE_SOLVER
-    sfree(scratch->bfsprev);
-#endif
-    sfree(scratch->bfsqueue);
-    sfree(scratch->neighbours);
-    sfree(scratch->set);
-    sfree(scratch->colidx);
-    sfree(scratch->rowidx);
-    sfree(scratch->grid);
-    sfree(scratch);
-}
-
-bool latin_solver_alloc(struct latin_solver *solver, digit *grid, int o)
+bool latin_solver_alloc(struct latin_solver *solver, digit *grid, int o,
+                        arena *ar)
 {
     int x, y;
 
+    assert(o <= LATIN_MAX_ORDER);
+
+    solver->own_arena = (ar == NULL);
+    solver->ar = ar ? ar : arena_new();
+    solver->mark = arena_save(solver->ar);
+    ar = solver->ar;
+
     solver->o = o;
-    solver->cube = snewn(o*o*o, unsigned char);
+    solver->cube = anewn(ar, o*o, latin_mask);
+    solver->rowpos = anewn(ar, o*o, latin_mask);
+    solver->colpos = anewn(ar, o*o, latin_mask);
     solver->grid = grid;		/* write straight back to the input */
-    memset(solver->cube, 1, o*o*o);
+    for (x = 0; x < o*o; x++)
+        solver->cube[x] = solver->rowpos[x] = solver->colpos[x] =
+            (DIGITBIT(o) << 1) - 1;
 
-    solver->row = snewn(o*o, unsigned char);
-    solver->col = snewn(o*o, unsigned char);
-    memset(solver->row, 0, o*o);
-    memset(solver->col, 0, o*o);
+    solver->row = anewn(ar, o, latin_mask);
+    solver->col = anewn(ar, o, latin_mask);
+    memset(solver->row, 0, o * sizeof(latin_mask));
+    memset(solver->col, 0, o * sizeof(latin_mask));
 
 #ifdef STANDALONE_SOLVER
     solver->names = NULL;
@@ -598,9 +636,10 @@ bool latin_solver_alloc(struct latin_solver *solver, digit *grid, int o)
 
 void latin_solver_free(struct latin_solver *solver)
 {
-    sfree(solver->cube);
-    sfree(solver->row);
-    sfree(solver->col);
+    if (solver->own_arena)
+        arena_free(solver->ar);
+    else
+        arena_restore(solver->ar, solver->mark);
 }
 
 int latin_solver_diff_simple(struct latin_solver *solver)
@@ -615,7 +654,7 @@ int latin_solver_diff_simple(struct latin_solver *solver)
      */
     for (y = 0; y < o; y++)
         for (n = 1; n <= o; n++)
-            if (!solver->row[y*o+n-1]) {
+            if (!(solver->row[y] & DIGITBIT(n))) {
                 ret = latin_solver_elim(solver, cubepos(0,y,n), o*o
 #ifdef STANDALONE_SOLVER
 					, "positional elimination,"
@@ -630,7 +669,7 @@ int latin_solver_diff_simple(struct latin_solver *solver)
      */
     for (x = 0; x < o; x++)
         for (n = 1; n <= o; n++)
-            if (!solver->col[x*o+n-1]) {
+            if (!(solver->col[x] & DIGITBIT(n))) {
                 ret = latin_solver_elim(solver, cubepos(x,0,n), o
 #ifdef STANDALONE_SOLVER
 					, "positional elimination,"
@@ -741,10 +780,7 @@ static int latin_solver_recurse
                  * An unfilled square. Count the number of
                  * possible digits in it.
                  */
-                count = 0;
-                for (n = 1; n <= o; n++)
-                    if (cube(x,y,n))
-                        count++;
+                count = bitcount32(solver->cube[cubecell(x,y)]);
 
                 /*
                  * We should have found any impossibilities
@@ -772,9 +808,9 @@ static int latin_solver_recurse
         y = best / o;
         x = best % o;
 
-        list = snewn(o, digit);
-        ingrid = snewn(o*o, digit);
-        outgrid = snewn(o*o, digit);
+        list = anewn(solver->ar, o, digit);
+        ingrid = anewn(solver->ar, o*o, digit);
+        outgrid = anewn(solver->ar, o*o, digit);
         memcpy(ingrid, solver->grid, o*o);
 
         /* Make a list of the possible digits. */
@@ -822,7 +858,7 @@ static int latin_solver_recurse
 #ifdef STANDALONE_SOLVER
 	    subsolver.names = solver->names;
 #endif
-	    if (latin_solver_alloc(&subsolver, outgrid, o))
+	    if (latin_solver_alloc(&subsolver, outgrid, o, solver->ar))
                 ret = latin_solver_top(&subsolver, diff_recursive,
                                        diff_simple, diff_set_0, diff_set_1,
                                        diff_forcing, diff_recursive,
@@ -873,10 +909,6 @@ static int latin_solver_recurse
                 break;
         }
 
-        sfree(outgrid);
-        sfree(ingrid);
-        sfree(list);
-
         if (diff == diff_impossible)
             return -1;
         else if (diff == diff_ambiguous)
@@ -910,7 +942,15 @@ static int latin_solver_top(struct latin_solver *solver, int maxdiff,
 
 	cont:
 
-        latin_solver_debug(solver->cube, solver->o);
+#ifdef STANDALONE_SOLVER
+        if (solver_show_working > 1) {
+            int o = solver->o;
+            unsigned char *dbgcube = snewn(o*o*o, unsigned char);
+            latin_solver_copy_cube(solver, dbgcube);
+            latin_solver_debug(dbgcube, o);
+            sfree(dbgcube);
+        }
+#endif
 
 	for (i = 0; i <= maxdiff; i++) {
 	    if (usersolvers[i])
@@ -1014,8 +1054,6 @@ static int latin_solver_top(struct latin_solver *solver, int maxdiff,
         diff = diff_impossible;
     }
 
-    latin_solver_free_scratch(scratch);
-
     return diff;
 }
 
@@ -1065,12 +1103,12 @@ int latin_solver(digit *grid, int o, int maxdiff,
 		 int diff_simple, int diff_set_0, int diff_set_1,
 		 int diff_forcing, int diff_recursive,
 		 usersolver_t const *usersolvers, validator_t valid,
-                 void *ctx, ctxnew_t ctxnew, ctxfree_t ctxfree)
+                 void *ctx, ctxnew_t ctxnew, ctxfree_t ctxfree, arena *ar)
 {
     struct latin_solver solver;
     int diff;
 
-    if (latin_solver_alloc(&solver, grid, o))
+    if (latin_solver_alloc(&solver, grid, o, ar))
         diff = latin_solver_main(&solver, maxdiff,
                                  diff_simple, diff_set_0, diff_set_1,
                                  diff_forcing, diff_recursive,
@@ -1081,21 +1119,28 @@ int latin_solver(digit *grid, int o, int maxdiff,
     return diff;
 }
 
+void latin_solver_copy_cube(struct latin_solver *solver, unsigned char *out)
+{
+    int o = solver->o, x, y, n;
+
+    for (x = 0; x < o; x++)
+        for (y = 0; y < o; y++)
+            for (n = 1; n <= o; n++)
+                out[cubepos(x,y,n)] = cube(x,y,n);
+}
+
 void latin_solver_debug(unsigned char *cube, int o)
 {
 #ifdef STANDALONE_SOLVER
     if (solver_show_working > 1) {
-        struct latin_solver ls, *solver = &ls;
         char *dbg;
         int x, y, i, c = 0;
 
-        ls.cube = cube; ls.o = o; /* for cube() to work */
-
         dbg = snewn(3*o*o*o, char);
         for (y = 0; y < o; y++) {
             for (x = 0; x < o; x++) {
                 for (i = 1; i <= o; i++) {
-                    if (cube(x,y,i))
+                    if (cube[(x*o+y)*o+i-1])
                         dbg[c++] = i + '0';
                     else
                         dbg[c++] = '.';
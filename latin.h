@@ -11,21 +11,44 @@ typedef unsigned char digit;
 extern int solver_show_working, solver_recurse_depth;
 #endif
 
+/*
+ * Candidate digits are held as bitmasks, so the order of the square
+ * must be at most LATIN_MAX_ORDER. Bit n-1 of a mask corresponds to
+ * digit n (in the digit-indexed masks) or to coordinate n-1 (in the
+ * position-indexed ones).
+ */
+typedef unsigned long latin_mask;
+#define LATIN_MAX_ORDER 32
+
 struct latin_solver {
   int o;                /* order of latin square */
-  unsigned char *cube;  /* o^3, indexed by x, y, and digit:
-                           true in that position indicates a possibility */
+  latin_mask *cube;     /* o^2, indexed by cubecell(x,y): bit n-1 set
+                           if n is still possible in that square */
+  latin_mask *rowpos;   /* o^2: bit x of rowpos[y*o+n-1] set if
+                           cube(x,y,n) (the same facts, transposed) */
+  latin_mask *colpos;   /* o^2: bit y of colpos[x*o+n-1] set if
+                           cube(x,y,n) */
   digit *grid;          /* o^2, indexed by x and y: for final deductions */
 
-  unsigned char *row;   /* o^2: row[y*cr+n-1] true if n is in row y */
-  unsigned char *col;   /* o^2: col[x*cr+n-1] true if n is in col x */
+  latin_mask *row;      /* o: bit n-1 of row[y] set if n is in row y */
+  latin_mask *col;      /* o: bit n-1 of col[x] set if n is in col x */
+
+  arena *ar;            /* everything above, and all scratch space */
+  arena_mark mark;      /* state of ar before latin_solver_alloc */
+  bool own_arena;       /* ar was created by latin_solver_alloc */
 
 #ifdef STANDALONE_SOLVER
   char **names;         /* o: names[n-1] gives name of 'digit' n */
 #endif
 };
-#define cubepos(x,y,n) (((x)*solver->o+(y))*solver->o+(n)-1)
-#define cube(x,y,n) (solver->cube[cubepos(x,y,n)])
+#define cubecell(x,y) ((x)*solver->o+(y))
+#define cubebit(c,n) ((int)((solver->cube[c] >> ((n)-1)) & 1))
+#define cube(x,y,n) cubebit(cubecell(x,y),n)
+/*
+ * Position of (x,y,n) in a notional o^3 array of booleans, as passed
+ * to latin_solver_elim and latin_solver_set.
+ */
+#define cubepos(x,y,n) (cubecell(x,y)*solver->o+(n)-1)
 
 #define gridpos(x,y) ((y)*solver->o+(x))
 #define grid(x,y) (solver->grid[gridpos(x,y)])
@@ -36,6 +59,9 @@ struct latin_solver {
 /* Place a value at a specific location. */
 void latin_solver_place(struct latin_solver *solver, int x, int y, int n);
 
+/* Rule out a value at a specific location. */
+void latin_solver_rule_out(struct latin_solver *solver, int x, int y, int n);
+
 /* Positional elimination. */
 int latin_solver_elim(struct latin_solver *solver, int start, int step
 #ifdef STANDALONE_SOLVER
@@ -65,15 +91,22 @@ int latin_solver_forcing(struct latin_solver *solver,
  * (allowing 'struct latin_solver' to be the first element in a larger
  * struct, for example).
  *
+ * The members, and everything else the solver needs, are allocated
+ * from 'ar', and given back to it by latin_solver_free. A generator
+ * can pass the same arena to every solver run so that retries don't
+ * go back to malloc; if ar is NULL, the solver uses an arena of its
+ * own.
+ *
  * latin_solver_alloc returns false if the digits already in the grid
  * could not be legally placed. */
-bool latin_solver_alloc(struct latin_solver *solver, digit *grid, int o);
+bool latin_solver_alloc(struct latin_solver *solver, digit *grid, int o,
+                        arena *ar);
 void latin_solver_free(struct latin_solver *solver);
 
-/* Allocates scratch space (for _set and _forcing) */
+/* Allocates scratch space (for _set and _forcing) from the solver's
+ * arena. It lasts until latin_solver_free. */
 struct latin_solver_scratch *
   latin_solver_new_scratch(struct latin_solver *solver);
-void latin_solver_free_scratch(struct latin_solver_scratch *scratch);
 
 
 /* --- Solver guts --- */
@@ -96,12 +129,13 @@ typedef void (*ctxfree_t)(void *ctx);
  * own difficulty levels, ensuring they don't clash with these. */
 enum { diff_impossible = 10, diff_ambiguous, diff_unfinished };
 
-/* Externally callable function that allocates and frees a latin_solver */
+/* Externally callable function that allocates and frees a latin_solver
+ * (in 'ar', as for latin_solver_alloc) */
 int latin_solver(digit *grid, int o, int maxdiff,
 		 int diff_simple, int diff_set_0, int diff_set_1,
 		 int diff_forcing, int diff_recursive,
 		 usersolver_t const *usersolvers, validator_t valid,
-                 void *ctx, ctxnew_t ctxnew, ctxfree_t ctxfree);
+                 void *ctx, ctxnew_t ctxnew, ctxfree_t ctxfree, arena *ar);
 
 /* Version you can call if you want to alloc and free latin_solver yourself */
 int latin_solver_main(struct latin_solver *solver, int maxdiff,
@@ -110,6 +144,9 @@ int latin_solver_main(struct latin_solver *solver, int maxdiff,
 		      usersolver_t const *usersolvers, validator_t valid,
                       void *ctx, ctxnew_t ctxnew, ctxfree_t ctxfree);
 
+/* Writes the candidates out as o^3 booleans, indexed by cubepos(). */
+void latin_solver_copy_cube(struct latin_solver *solver, unsigned char *out);
+
 void latin_solver_debug(unsigned char *cube, int o);
 
 /* --- Generation and checking --- */
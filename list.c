@@ -1,11 +1,16 @@
 /*
  * list.c: List of pointers to puzzle structures, for monolithic
- * platforms.
+ * platforms, and a couple of helpers for the command-line tools
+ * (benchpuzz and poolfill) which work through it.
  *
  * This file depends on the header "generated-games.h", which is
  * constructed by CMakeLists.txt.
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "puzzles.h"
 
 #define GAME(x) &x,
@@ -15,3 +20,32 @@ const game *gamelist[] = {
 #undef GAME
 
 const int gamecount = lenof(gamelist);
+
+/*
+ * Find a puzzle by the first len characters of name, which may be
+ * either its name or its help topic (e.g. "Same Game" or "samegame").
+ */
+const game *find_game(const char *name, size_t len)
+{
+    int i;
+
+    for (i = 0; i < gamecount; i++)
+        if ((strlen(gamelist[i]->name) == len &&
+             !memcmp(gamelist[i]->name, name, len)) ||
+            (strlen(gamelist[i]->htmlhelp_topic) == len &&
+             !memcmp(gamelist[i]->htmlhelp_topic, name, len)))
+            return gamelist[i];
+    return NULL;
+}
+
+/*
+ * Report a command-line error (if msg is non-NULL) and the usage
+ * summary 'usage' of the program pname, and exit.
+ */
+void usage_exit(const char *pname, const char *msg, const char *usage)
+{
+    if (msg)
+        fprintf(stderr, "%s: %s\n", pname, msg);
+    fprintf(stderr, "usage: %s %s\n", pname, usage);
+    exit(1);
+}
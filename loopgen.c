@@ -76,6 +76,16 @@ static int black_sort_cmpfn(void *v1, void *v2)
     return generic_sort_cmpfn(v1, v2, offsetof(struct face_score,black_score));
 }
 
+/* Everything below walks the grid through its flat index arrays (see
+ * grid.h) rather than the pointer lists, so faces are identified by
+ * index, with -1 for the infinite face. */
+#define FACE_INDEX_COLOUR(fi) ( (fi) < 0 ? FACE_BLACK : board[fi] )
+
+/* The face on the other side of edge 'e' from face 'fi'. */
+#define OTHER_FACE(g, e, fi) \
+    ( (g)->edge_faces[2*(e)] == (fi) ? \
+      (g)->edge_faces[2*(e)+1] : (g)->edge_faces[2*(e)] )
+
 /* 'board' is an array of enum face_colour, indicating which faces are
  * currently black/white/grey.  'colour' is FACE_WHITE or FACE_BLACK.
  * Returns whether it's legal to colour the given face with this colour. */
@@ -83,9 +93,13 @@ static bool can_colour_face(grid *g, char* board, int face_index,
                             enum face_colour colour)
 {
     int i, j;
-    grid_face *test_face = g->faces + face_index;
-    grid_face *starting_face, *current_face;
-    grid_dot *starting_dot;
+    const int *fe = g->face_edges + g->face_offsets[face_index];
+    const int *fd = g->face_dots + g->face_offsets[face_index];
+    int order = g->face_offsets[face_index + 1] - g->face_offsets[face_index];
+    const int *df; /* faces around the dot fd[i] */
+    int dorder;    /* and how many of them there are */
+    int starting_face, current_face;
+    int starting_dot;
     int transitions;
     bool current_state, s; /* equal or not-equal to 'colour' */
     bool found_same_coloured_neighbour = false;
@@ -93,10 +107,9 @@ static bool can_colour_face(grid *g, char* board, int face_index,
 
     /* Can only consider a face for colouring if it's adjacent to a face
      * with the same colour. */
-    for (i = 0; i < test_face->order; i++) {
-        grid_edge *e = test_face->edges[i];
-        grid_face *f = (e->face1 == test_face) ? e->face2 : e->face1;
-        if (FACE_COLOUR(f) == colour) {
+    for (i = 0; i < order; i++) {
+        int f = OTHER_FACE(g, fe[i], face_index);
+        if (FACE_INDEX_COLOUR(f) == colour) {
             found_same_coloured_neighbour = true;
             break;
         }
@@ -128,6 +141,8 @@ static bool can_colour_face(grid *g, char* board, int face_index,
      * j points to a face around the i^th dot.
      * The current face will always be:
      *     test_face->dots[i]->faces[j]
+     * or in terms of the flat arrays, df[j] where df is the face list
+     * of dot fd[i].
      * We assume dots go clockwise around the test face,
      * and faces go clockwise around dots. */
 
@@ -153,48 +168,52 @@ static bool can_colour_face(grid *g, char* board, int face_index,
      */
 
     i = j = 0;
-    current_face = test_face->dots[0]->faces[0];
-    if (current_face == test_face) {
+    df = g->dot_faces + g->dot_offsets[fd[0]];
+    dorder = g->dot_offsets[fd[0] + 1] - g->dot_offsets[fd[0]];
+    current_face = df[0];
+    if (current_face == face_index) {
         j = 1;
-        current_face = test_face->dots[0]->faces[1];
+        current_face = df[1];
     }
     transitions = 0;
-    current_state = (FACE_COLOUR(current_face) == colour);
-    starting_dot = NULL;
-    starting_face = NULL;
+    current_state = (FACE_INDEX_COLOUR(current_face) == colour);
+    starting_dot = -1;
+    starting_face = -1;
     while (true) {
         /* Advance to next face.
          * Need to loop here because it might take several goes to
          * find it. */
         while (true) {
             j++;
-            if (j == test_face->dots[i]->order)
+            if (j == dorder)
                 j = 0;
 
-            if (test_face->dots[i]->faces[j] == test_face) {
+            if (df[j] == face_index) {
                 /* Advance to next dot round test_face, then
                  * find current_face around new dot
                  * and advance to the next face clockwise */
                 i++;
-                if (i == test_face->order)
+                if (i == order)
                     i = 0;
-                for (j = 0; j < test_face->dots[i]->order; j++) {
-                    if (test_face->dots[i]->faces[j] == current_face)
+                df = g->dot_faces + g->dot_offsets[fd[i]];
+                dorder = g->dot_offsets[fd[i] + 1] - g->dot_offsets[fd[i]];
+                for (j = 0; j < dorder; j++) {
+                    if (df[j] == current_face)
                         break;
                 }
                 /* Must actually find current_face around new dot,
                  * or else something's wrong with the grid. */
-                assert(j != test_face->dots[i]->order);
+                assert(j != dorder);
                 /* Found, so advance to next face and try again */
             } else {
                 break;
             }
         }
         /* (i,j) are now advanced to next face */
-        current_face = test_face->dots[i]->faces[j];
-        s = (FACE_COLOUR(current_face) == colour);
-	if (!starting_dot) {
-	    starting_dot = test_face->dots[i];
+        current_face = df[j];
+        s = (FACE_INDEX_COLOUR(current_face) == colour);
+	if (starting_dot < 0) {
+	    starting_dot = fd[i];
 	    starting_face = current_face;
 	    current_state = s;
 	} else {
@@ -204,7 +223,7 @@ static bool can_colour_face(grid *g, char* board, int face_index,
 		if (transitions > 2)
 		    break;
 	    }
-	    if (test_face->dots[i] == starting_dot &&
+	    if (fd[i] == starting_dot &&
 		current_face == starting_face)
 		break;
         }
@@ -214,17 +233,14 @@ static bool can_colour_face(grid *g, char* board, int face_index,
 }
 
 /* Count the number of neighbours of 'face', having colour 'colour' */
-static int face_num_neighbours(grid *g, char *board, grid_face *face,
+static int face_num_neighbours(grid *g, char *board, int face,
                                enum face_colour colour)
 {
     int colour_count = 0;
     int i;
-    grid_face *f;
-    grid_edge *e;
-    for (i = 0; i < face->order; i++) {
-        e = face->edges[i];
-        f = (e->face1 == face) ? e->face2 : e->face1;
-        if (FACE_COLOUR(f) == colour)
+    for (i = g->face_offsets[face]; i < g->face_offsets[face + 1]; i++) {
+        int f = OTHER_FACE(g, g->face_edges[i], face);
+        if (FACE_INDEX_COLOUR(f) == colour)
             ++colour_count;
     }
     return colour_count;
@@ -235,7 +251,7 @@ static int face_num_neighbours(grid *g, char *board, grid_face *face,
  * into grey areas and increasing loopiness, so we give scores according to
  * how many of the face's neighbours are currently coloured the same as the
  * proposed colour. */
-static int face_score(grid *g, char *board, grid_face *face,
+static int face_score(grid *g, char *board, int face,
                       enum face_colour colour)
 {
     /* Simple formula: score = 0 - num. same-coloured neighbours,
@@ -306,7 +322,7 @@ void generate_loop(grid *g, char *board, random_state *rs,
     int num_faces = g->num_faces;
     struct face_score *face_scores; /* Array of face_score objects */
     struct face_score *fs; /* Points somewhere in the above list */
-    struct grid_face *cur_face;
+    int cur_face;
     tree234 *lightable_faces_sorted;
     tree234 *darkable_faces_sorted;
     int *face_list;
@@ -348,18 +364,17 @@ void generate_loop(grid *g, char *board, random_state *rs,
      * to check every face of the board (the grid structure does not keep a
      * list of the infinite face's neighbours). */
     for (i = 0; i < num_faces; i++) {
-        grid_face *f = g->faces + i;
         struct face_score *fs = face_scores + i;
         if (board[i] != FACE_GREY) continue;
         /* We need the full colourability check here, it's not enough simply
          * to check neighbourhood.  On some grids, a neighbour of the infinite
          * face is not necessarily darkable. */
         if (can_colour_face(g, board, i, FACE_BLACK)) {
-            fs->black_score = face_score(g, board, f, FACE_BLACK);
+            fs->black_score = face_score(g, board, i, FACE_BLACK);
             add234(darkable_faces_sorted, fs);
         }
         if (can_colour_face(g, board, i, FACE_WHITE)) {
-            fs->white_score = face_score(g, board, f, FACE_WHITE);
+            fs->white_score = face_score(g, board, i, FACE_WHITE);
             add234(lightable_faces_sorted, fs);
         }
     }
@@ -430,7 +445,7 @@ void generate_loop(grid *g, char *board, random_state *rs,
         del234(darkable_faces_sorted, fs);
 
         /* Remember which face we've just coloured */
-        cur_face = g->faces + i;
+        cur_face = i;
 
         /* The face we've just coloured potentially affects the colourability
          * and the scores of any neighbouring faces (touching at a corner or
@@ -439,24 +454,23 @@ void generate_loop(grid *g, char *board, random_state *rs,
          * over each corner's faces.  For each such face, we remove it from
          * the lists, recalculate any scores, then add it back to the lists
          * (depending on whether it is lightable, darkable or both). */
-        for (i = 0; i < cur_face->order; i++) {
-            grid_dot *d = cur_face->dots[i];
-            for (j = 0; j < d->order; j++) {
-                grid_face *f = d->faces[j];
-                int fi; /* face index of f */
+        for (i = g->face_offsets[cur_face];
+             i < g->face_offsets[cur_face + 1]; i++) {
+            int d = g->face_dots[i];
+            for (j = g->dot_offsets[d]; j < g->dot_offsets[d + 1]; j++) {
+                int fi = g->dot_faces[j];
 
-                if (f == NULL)
+                if (fi < 0)
                     continue;
-                if (f == cur_face)
+                if (fi == cur_face)
                     continue;
                 
                 /* If the face is already coloured, it won't be on our
                  * lightable/darkable lists anyway, so we can skip it without 
                  * bothering with the removal step. */
-                if (FACE_COLOUR(f) != FACE_GREY) continue; 
+                if (board[fi] != FACE_GREY) continue; 
 
-                /* Find the face index and face_score* corresponding to f */
-                fi = f - g->faces;                
+                /* Find the face_score* corresponding to fi */
                 fs = face_scores + fi;
 
                 /* Remove from lightable list if it's in there.  We do this,
@@ -465,13 +479,13 @@ void generate_loop(grid *g, char *board, random_state *rs,
                  * correct sort order. */
                 del234(lightable_faces_sorted, fs);
                 if (can_colour_face(g, board, fi, FACE_WHITE)) {
-                    fs->white_score = face_score(g, board, f, FACE_WHITE);
+                    fs->white_score = face_score(g, board, fi, FACE_WHITE);
                     add234(lightable_faces_sorted, fs);
                 }
                 /* Do the same for darkable list. */
                 del234(darkable_faces_sorted, fs);
                 if (can_colour_face(g, board, fi, FACE_BLACK)) {
-                    fs->black_score = face_score(g, board, f, FACE_BLACK);
+                    fs->black_score = face_score(g, board, fi, FACE_BLACK);
                     add234(darkable_faces_sorted, fs);
                 }
             }
@@ -517,14 +531,13 @@ void generate_loop(grid *g, char *board, random_state *rs,
             enum face_colour opp =
                 (board[j] == FACE_WHITE) ? FACE_BLACK : FACE_WHITE;
             if (can_colour_face(g, board, j, opp)) {
-                grid_face *face = g->faces +j;
                 if (do_random_pass) {
                     /* final random pass */
                     if (!random_upto(rs, 10))
                         board[j] = opp;
                 } else {
                     /* normal pass - flip when neighbour count is 1 */
-                    if (face_num_neighbours(g, board, face, opp) == 1) {
+                    if (face_num_neighbours(g, board, j, opp) == 1) {
                         board[j] = opp;
                         flipped = true;
                     }
@@ -165,8 +165,27 @@ typedef struct solver_state {
      * (bit 1) at most one is YES */
     char *dlines;
 
+    /* Bitsets (see pending_add) of the faces and dots which
+     * trivial_deductions and dline_deductions haven't looked at since
+     * the lines (or dlines) they depend on last changed. Nothing new can
+     * be deduced about a face or dot that hasn't changed, so those
+     * solvers only visit the members of these sets. */
+    unsigned long *trivial_faces, *trivial_dots;
+    unsigned long *dline_faces, *dline_dots;
+
     /* Hard level information */
     int *linedsf;
+
+    /* All the arrays above (but not the game state) are carved out of
+     * this one block of memory, so that dup_solver_state can copy them
+     * in a single memcpy. See layout_solver_state. */
+    void *cache;
+    size_t cache_size;
+
+    /* Everything above, including the copy of the game state, lives in
+     * here. Solver states are never freed individually: whoever made
+     * the first one restores or frees the arena. */
+    arena *ar;
 } solver_state;
 
 /*
@@ -342,8 +361,7 @@ static game_state *dup_game(const game_state *state)
 {
     game_state *ret = snew(game_state);
 
-    ret->game_grid = state->game_grid;
-    ret->game_grid->refcount++;
+    ret->game_grid = grid_ref(state->game_grid);
 
     ret->solved = state->solved;
     ret->cheated = state->cheated;
@@ -374,124 +392,160 @@ static void free_game(game_state *state)
     }
 }
 
-static solver_state *new_solver_state(const game_state *state, int diff) {
+/*
+ * Copy of a game_state for the solver's private use, allocated in an
+ * arena. It shares the grid with the original without taking a
+ * reference, so it must not outlive it, and is never passed to
+ * free_game.
+ */
+static game_state *dup_game_in_arena(const game_state *state, arena *ar)
+{
+    game_state *ret = anew(ar, game_state);
+    int num_faces = state->game_grid->num_faces;
+    int num_edges = state->game_grid->num_edges;
+
+    *ret = *state;
+    ret->clues = anewn(ar, num_faces, signed char);
+    memcpy(ret->clues, state->clues, num_faces);
+    ret->lines = anewn(ar, num_edges, char);
+    memcpy(ret->lines, state->lines, num_edges);
+    ret->line_errors = anewn(ar, num_edges, bool);
+    memcpy(ret->line_errors, state->line_errors, num_edges * sizeof(bool));
+    return ret;
+}
+
+/*
+ * Allocate the block of memory holding a solver state's arrays, and
+ * point each array at its part of it. The arrays are laid out in order
+ * of decreasing element size, so that everything is suitably aligned. The
+ * arrays only needed at higher difficulty levels are left out (and
+ * their pointers set to NULL) if the state's difficulty doesn't reach
+ * them.
+ */
+static void layout_solver_state(solver_state *sstate)
+{
+    grid *g = sstate->state->game_grid;
+    int num_dots = g->num_dots;
+    int num_faces = g->num_faces;
+    int num_dlines = (sstate->diff < DIFF_NORMAL ? 0 : 2*g->num_edges);
+    int num_linedsf = (sstate->diff < DIFF_HARD ? 0 : g->num_edges);
+    unsigned long *lp;
+    int *ip;
+    bool *bp;
+    char *cp;
+
+    sstate->cache_size =
+        2 * (PENDING_WORDS(num_faces) + PENDING_WORDS(num_dots)) *
+        sizeof(unsigned long) +
+        (2*num_dots + num_linedsf) * sizeof(int) +
+        (num_dots + num_faces) * sizeof(bool) +
+        (2*num_dots + 2*num_faces + num_dlines);
+    sstate->cache = arena_alloc(sstate->ar, sstate->cache_size);
+
+    lp = sstate->cache;
+    sstate->trivial_faces = lp;
+    lp += PENDING_WORDS(num_faces);
+    sstate->dline_faces = lp;
+    lp += PENDING_WORDS(num_faces);
+    sstate->trivial_dots = lp;
+    lp += PENDING_WORDS(num_dots);
+    sstate->dline_dots = lp;
+    lp += PENDING_WORDS(num_dots);
+
+    ip = (int *)lp;
+    sstate->dotdsf = ip;
+    ip += num_dots;
+    sstate->looplen = ip;
+    ip += num_dots;
+    sstate->linedsf = (num_linedsf ? ip : NULL);
+    ip += num_linedsf;
+
+    bp = (bool *)ip;
+    sstate->dot_solved = bp;
+    bp += num_dots;
+    sstate->face_solved = bp;
+    bp += num_faces;
+
+    cp = (char *)bp;
+    sstate->dot_yes_count = cp;
+    cp += num_dots;
+    sstate->dot_no_count = cp;
+    cp += num_dots;
+    sstate->face_yes_count = cp;
+    cp += num_faces;
+    sstate->face_no_count = cp;
+    cp += num_faces;
+    sstate->dlines = (num_dlines ? cp : NULL);
+}
+
+static solver_state *new_solver_state(const game_state *state, int diff,
+                                      arena *ar) {
     int i;
     int num_dots = state->game_grid->num_dots;
     int num_faces = state->game_grid->num_faces;
     int num_edges = state->game_grid->num_edges;
-    solver_state *ret = snew(solver_state);
+    solver_state *ret = anew(ar, solver_state);
 
-    ret->state = dup_game(state);
+    ret->ar = ar;
+    ret->state = dup_game_in_arena(state, ar);
 
     ret->solver_status = SOLVER_INCOMPLETE;
     ret->diff = diff;
 
-    ret->dotdsf = snew_dsf(num_dots);
-    ret->looplen = snewn(num_dots, int);
+    layout_solver_state(ret);
 
+    dsf_init(ret->dotdsf, num_dots);
     for (i = 0; i < num_dots; i++) {
         ret->looplen[i] = 1;
     }
 
-    ret->dot_solved = snewn(num_dots, bool);
-    ret->face_solved = snewn(num_faces, bool);
     memset(ret->dot_solved, 0, num_dots * sizeof(bool));
     memset(ret->face_solved, 0, num_faces * sizeof(bool));
 
-    ret->dot_yes_count = snewn(num_dots, char);
     memset(ret->dot_yes_count, 0, num_dots);
-    ret->dot_no_count = snewn(num_dots, char);
     memset(ret->dot_no_count, 0, num_dots);
-    ret->face_yes_count = snewn(num_faces, char);
     memset(ret->face_yes_count, 0, num_faces);
-    ret->face_no_count = snewn(num_faces, char);
     memset(ret->face_no_count, 0, num_faces);
 
-    if (diff < DIFF_NORMAL) {
-        ret->dlines = NULL;
-    } else {
-        ret->dlines = snewn(2*num_edges, char);
-        memset(ret->dlines, 0, 2*num_edges);
+    /* Every solver has to look at everything at least once */
+    memset(ret->trivial_faces, 0,
+           PENDING_WORDS(num_faces) * sizeof(unsigned long));
+    memset(ret->dline_faces, 0,
+           PENDING_WORDS(num_faces) * sizeof(unsigned long));
+    memset(ret->trivial_dots, 0,
+           PENDING_WORDS(num_dots) * sizeof(unsigned long));
+    memset(ret->dline_dots, 0,
+           PENDING_WORDS(num_dots) * sizeof(unsigned long));
+    for (i = 0; i < num_faces; i++) {
+        pending_add(ret->trivial_faces, i);
+        pending_add(ret->dline_faces, i);
     }
-
-    if (diff < DIFF_HARD) {
-        ret->linedsf = NULL;
-    } else {
-        ret->linedsf = snew_dsf(state->game_grid->num_edges);
+    for (i = 0; i < num_dots; i++) {
+        pending_add(ret->trivial_dots, i);
+        pending_add(ret->dline_dots, i);
     }
 
-    return ret;
-}
-
-static void free_solver_state(solver_state *sstate) {
-    if (sstate) {
-        free_game(sstate->state);
-        sfree(sstate->dotdsf);
-        sfree(sstate->looplen);
-        sfree(sstate->dot_solved);
-        sfree(sstate->face_solved);
-        sfree(sstate->dot_yes_count);
-        sfree(sstate->dot_no_count);
-        sfree(sstate->face_yes_count);
-        sfree(sstate->face_no_count);
+    if (ret->dlines)
+        memset(ret->dlines, 0, 2*num_edges);
 
-        /* OK, because sfree(NULL) is a no-op */
-        sfree(sstate->dlines);
-        sfree(sstate->linedsf);
+    if (ret->linedsf)
+        dsf_init(ret->linedsf, num_edges);
 
-        sfree(sstate);
-    }
+    return ret;
 }
 
 static solver_state *dup_solver_state(const solver_state *sstate) {
-    game_state *state = sstate->state;
-    int num_dots = state->game_grid->num_dots;
-    int num_faces = state->game_grid->num_faces;
-    int num_edges = state->game_grid->num_edges;
-    solver_state *ret = snew(solver_state);
+    arena *ar = sstate->ar;
+    solver_state *ret = anew(ar, solver_state);
 
-    ret->state = state = dup_game(sstate->state);
+    ret->ar = ar;
+    ret->state = dup_game_in_arena(sstate->state, ar);
 
     ret->solver_status = sstate->solver_status;
     ret->diff = sstate->diff;
 
-    ret->dotdsf = snewn(num_dots, int);
-    ret->looplen = snewn(num_dots, int);
-    memcpy(ret->dotdsf, sstate->dotdsf,
-           num_dots * sizeof(int));
-    memcpy(ret->looplen, sstate->looplen,
-           num_dots * sizeof(int));
-
-    ret->dot_solved = snewn(num_dots, bool);
-    ret->face_solved = snewn(num_faces, bool);
-    memcpy(ret->dot_solved, sstate->dot_solved, num_dots * sizeof(bool));
-    memcpy(ret->face_solved, sstate->face_solved, num_faces * sizeof(bool));
-
-    ret->dot_yes_count = snewn(num_dots, char);
-    memcpy(ret->dot_yes_count, sstate->dot_yes_count, num_dots);
-    ret->dot_no_count = snewn(num_dots, char);
-    memcpy(ret->dot_no_count, sstate->dot_no_count, num_dots);
-
-    ret->face_yes_count = snewn(num_faces, char);
-    memcpy(ret->face_yes_count, sstate->face_yes_count, num_faces);
-    ret->face_no_count = snewn(num_faces, char);
-    memcpy(ret->face_no_count, sstate->face_no_count, num_faces);
-
-    if (sstate->dlines) {
-        ret->dlines = snewn(2*num_edges, char);
-        memcpy(ret->dlines, sstate->dlines,
-               2*num_edges);
-    } else {
-        ret->dlines = NULL;
-    }
-
-    if (sstate->linedsf) {
-        ret->linedsf = snewn(num_edges, int);
-        memcpy(ret->linedsf, sstate->linedsf,
-               num_edges * sizeof(int));
-    } else {
-        ret->linedsf = NULL;
-    }
+    layout_solver_state(ret);
+    memcpy(ret->cache, sstate->cache, sstate->cache_size);
 
     return ret;
 }
@@ -1118,6 +1172,11 @@ static void check_caches(const solver_state* sstate)
 
 /* ----------------------------------------------------------------------
  * Solver utility functions
+ *
+ * The solver walks the grid through its flat index arrays
+ * (g->face_edges, g->dot_edges etc, see grid.h) rather than the
+ * grid_face and grid_dot pointer lists, since it does so over and over
+ * again and large grids don't fit in cache.
  */
 
 /* Sets the line (with index i) to the new state 'line_new', and updates
@@ -1132,7 +1191,8 @@ static bool solver_set_line(solver_state *sstate, int i,
 {
     game_state *state = sstate->state;
     grid *g;
-    grid_edge *e;
+    const int *ed, *ef;
+    int j;
 
     assert(line_new != LINE_UNKNOWN);
 
@@ -1150,26 +1210,39 @@ static bool solver_set_line(solver_state *sstate, int i,
 #endif
 
     g = state->game_grid;
-    e = g->edges + i;
+    ed = g->edge_dots + 2*i;
+    ef = g->edge_faces + 2*i;
 
     /* Update the cache for both dots and both faces affected by this. */
+    for (j = 0; j < 2; j++) {
+        int k;
+        pending_add(sstate->trivial_dots, ed[j]);
+        pending_add(sstate->dline_dots, ed[j]);
+        if (ef[j] >= 0)
+            pending_add(sstate->dline_faces, ef[j]);
+        /* trivial_deductions looks at the lines around each corner of
+         * a face, not just the face's own lines */
+        for (k = g->dot_offsets[ed[j]]; k < g->dot_offsets[ed[j]+1]; k++)
+            if (g->dot_faces[k] >= 0)
+                pending_add(sstate->trivial_faces, g->dot_faces[k]);
+    }
     if (line_new == LINE_YES) {
-        sstate->dot_yes_count[e->dot1 - g->dots]++;
-        sstate->dot_yes_count[e->dot2 - g->dots]++;
-        if (e->face1) {
-            sstate->face_yes_count[e->face1 - g->faces]++;
+        sstate->dot_yes_count[ed[0]]++;
+        sstate->dot_yes_count[ed[1]]++;
+        if (ef[0] >= 0) {
+            sstate->face_yes_count[ef[0]]++;
         }
-        if (e->face2) {
-            sstate->face_yes_count[e->face2 - g->faces]++;
+        if (ef[1] >= 0) {
+            sstate->face_yes_count[ef[1]]++;
         }
     } else {
-        sstate->dot_no_count[e->dot1 - g->dots]++;
-        sstate->dot_no_count[e->dot2 - g->dots]++;
-        if (e->face1) {
-            sstate->face_no_count[e->face1 - g->faces]++;
+        sstate->dot_no_count[ed[0]]++;
+        sstate->dot_no_count[ed[1]]++;
+        if (ef[0] >= 0) {
+            sstate->face_no_count[ef[0]]++;
         }
-        if (e->face2) {
-            sstate->face_no_count[e->face2 - g->faces]++;
+        if (ef[1] >= 0) {
+            sstate->face_no_count[ef[1]]++;
         }
     }
 
@@ -1193,10 +1266,9 @@ static bool merge_dots(solver_state *sstate, int edge_index)
 {
     int i, j, len;
     grid *g = sstate->state->game_grid;
-    grid_edge *e = g->edges + edge_index;
 
-    i = e->dot1 - g->dots;
-    j = e->dot2 - g->dots;
+    i = g->edge_dots[2*edge_index];
+    j = g->edge_dots[2*edge_index+1];
 
     i = dsf_canonify(sstate->dotdsf, i);
     j = dsf_canonify(sstate->dotdsf, j);
@@ -1254,12 +1326,10 @@ static int dot_order(const game_state* state, int dot, char line_type)
 {
     int n = 0;
     grid *g = state->game_grid;
-    grid_dot *d = g->dots + dot;
     int i;
 
-    for (i = 0; i < d->order; i++) {
-        grid_edge *e = d->edges[i];
-        if (state->lines[e - g->edges] == line_type)
+    for (i = g->dot_offsets[dot]; i < g->dot_offsets[dot+1]; i++) {
+        if (state->lines[g->dot_edges[i]] == line_type)
             ++n;
     }
     return n;
@@ -1271,12 +1341,10 @@ static int face_order(const game_state* state, int face, char line_type)
 {
     int n = 0;
     grid *g = state->game_grid;
-    grid_face *f = g->faces + face;
     int i;
 
-    for (i = 0; i < f->order; i++) {
-        grid_edge *e = f->edges[i];
-        if (state->lines[e - g->edges] == line_type)
+    for (i = g->face_offsets[face]; i < g->face_offsets[face+1]; i++) {
+        if (state->lines[g->face_edges[i]] == line_type)
             ++n;
     }
     return n;
@@ -1290,17 +1358,15 @@ static bool dot_setall(solver_state *sstate, int dot,
     bool retval = false, r;
     game_state *state = sstate->state;
     grid *g;
-    grid_dot *d;
     int i;
 
     if (old_type == new_type)
         return false;
 
     g = state->game_grid;
-    d = g->dots + dot;
 
-    for (i = 0; i < d->order; i++) {
-        int line_index = d->edges[i] - g->edges;
+    for (i = g->dot_offsets[dot]; i < g->dot_offsets[dot+1]; i++) {
+        int line_index = g->dot_edges[i];
         if (state->lines[line_index] == old_type) {
             r = solver_set_line(sstate, line_index, new_type);
             assert(r);
@@ -1317,17 +1383,15 @@ static bool face_setall(solver_state *sstate, int face,
     bool retval = false, r;
     game_state *state = sstate->state;
     grid *g;
-    grid_face *f;
     int i;
 
     if (old_type == new_type)
         return false;
 
     g = state->game_grid;
-    f = g->faces + face;
 
-    for (i = 0; i < f->order; i++) {
-        int line_index = f->edges[i] - g->edges;
+    for (i = g->face_offsets[face]; i < g->face_offsets[face+1]; i++) {
+        int line_index = g->face_edges[i];
         if (state->lines[line_index] == old_type) {
             r = solver_set_line(sstate, line_index, new_type);
             assert(r);
@@ -1356,35 +1420,35 @@ static void add_full_clues(game_state *state, random_state *rs)
      * algorithm does work, and there aren't any GREY faces still there. */
     memset(clues, 0, g->num_faces);
     for (i = 0; i < g->num_edges; i++) {
-        grid_edge *e = g->edges + i;
-        grid_face *f1 = e->face1;
-        grid_face *f2 = e->face2;
-        enum face_colour c1 = FACE_COLOUR(f1);
-        enum face_colour c2 = FACE_COLOUR(f2);
+        int f1 = g->edge_faces[2*i];
+        int f2 = g->edge_faces[2*i+1];
+        enum face_colour c1 = f1 < 0 ? FACE_BLACK : board[f1];
+        enum face_colour c2 = f2 < 0 ? FACE_BLACK : board[f2];
         assert(c1 != FACE_GREY);
         assert(c2 != FACE_GREY);
         if (c1 != c2) {
-            if (f1) clues[f1 - g->faces]++;
-            if (f2) clues[f2 - g->faces]++;
+            if (f1 >= 0) clues[f1]++;
+            if (f2 >= 0) clues[f2]++;
         }
     }
     sfree(board);
 }
 
 
-static bool game_has_unique_soln(const game_state *state, int diff)
+static bool game_has_unique_soln(const game_state *state, int diff,
+                                 arena *ar)
 {
     bool ret;
+    arena_mark mark = arena_save(ar);
     solver_state *sstate_new;
-    solver_state *sstate = new_solver_state(state, diff);
+    solver_state *sstate = new_solver_state(state, diff, ar);
 
     sstate_new = solve_game_rec(sstate);
 
     assert(sstate_new->solver_status != SOLVER_MISTAKE);
     ret = (sstate_new->solver_status == SOLVER_SOLVED);
 
-    free_solver_state(sstate_new);
-    free_solver_state(sstate);
+    arena_restore(ar, mark);
 
     return ret;
 }
@@ -1392,11 +1456,11 @@ static bool game_has_unique_soln(const game_state *state, int diff)
 
 /* Remove clues one at a time at random. */
 static game_state *remove_clues(game_state *state, random_state *rs,
-                                int diff)
+                                int diff, arena *ar)
 {
     int *face_list;
     int num_faces = state->game_grid->num_faces;
-    game_state *ret = dup_game(state), *saved_ret;
+    game_state *ret = dup_game(state);
     int n;
 
     /* We need to remove some clues.  We'll do this by forming a list of all
@@ -1411,15 +1475,11 @@ static game_state *remove_clues(game_state *state, random_state *rs,
     shuffle(face_list, num_faces, sizeof(int), rs);
 
     for (n = 0; n < num_faces; ++n) {
-        saved_ret = dup_game(ret);
+        signed char saved_clue = ret->clues[face_list[n]];
         ret->clues[face_list[n]] = -1;
 
-        if (game_has_unique_soln(ret, diff)) {
-            free_game(saved_ret);
-        } else {
-            free_game(ret);
-            ret = saved_ret;
-        }
+        if (!game_has_unique_soln(ret, diff, ar))
+            ret->clues[face_list[n]] = saved_clue;
     }
     sfree(face_list);
 
@@ -1435,6 +1495,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     grid *g;
     game_state *state = snew(game_state);
     game_state *state_new;
+    arena *ar = arena_new();
 
     grid_desc = grid_new_desc(grid_types[params->type], params->w, params->h, rs);
     state->game_grid = g = loopy_generate_grid(params, grid_desc);
@@ -1459,14 +1520,14 @@ static char *new_game_desc(const game_params *params, random_state *rs,
      * preventing games smaller than 4x4 seems to stop this happening */
     do {
         add_full_clues(state, rs);
-    } while (!game_has_unique_soln(state, params->diff));
+    } while (!game_has_unique_soln(state, params->diff, ar));
 
-    state_new = remove_clues(state, rs, params->diff);
+    state_new = remove_clues(state, rs, params->diff, ar);
     free_game(state);
     state = state_new;
 
 
-    if (params->diff > 0 && game_has_unique_soln(state, params->diff-1)) {
+    if (params->diff > 0 && game_has_unique_soln(state, params->diff-1, ar)) {
 #ifdef SHOW_WORKING
         fprintf(stderr, "Rejecting board, it is too easy\n");
 #endif
@@ -1476,6 +1537,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     game_desc = state_to_text(state);
 
     free_game(state);
+    arena_free(ar);
 
     if (grid_desc) {
         retval = snewn(strlen(grid_desc) + 1 + strlen(game_desc) + 1, char);
@@ -1827,21 +1889,20 @@ static bool check_completion(game_state *state)
 
 /* i points to the first edge of the dline pair, reading clockwise around
  * the dot. */
-static int dline_index_from_dot(grid *g, grid_dot *d, int i)
+static int dline_index_from_dot(grid *g, int d, int i)
 {
-    grid_edge *e = d->edges[i];
+    int e = g->dot_edges[g->dot_offsets[d] + i];
     int ret;
 #ifdef DEBUG_DLINES
-    grid_edge *e2;
+    int e2;
     int i2 = i+1;
-    if (i2 == d->order) i2 = 0;
-    e2 = d->edges[i2];
+    if (i2 == g->dot_offsets[d+1] - g->dot_offsets[d]) i2 = 0;
+    e2 = g->dot_edges[g->dot_offsets[d] + i2];
 #endif
-    ret = 2 * (e - g->edges) + ((e->dot1 == d) ? 1 : 0);
+    ret = 2 * e + ((g->edge_dots[2*e] == d) ? 1 : 0);
 #ifdef DEBUG_DLINES
     printf("dline_index_from_dot: d=%d,i=%d, edges [%d,%d] - %d\n",
-           (int)(d - g->dots), i, (int)(e - g->edges),
-           (int)(e2 - g->edges), ret);
+           d, i, e, e2, ret);
 #endif
     return ret;
 }
@@ -1849,22 +1910,21 @@ static int dline_index_from_dot(grid *g, grid_dot *d, int i)
  * the face.  That is, the edges of the dline, starting at edge{i}, read
  * anti-clockwise around the face.  By layout conventions, the common dot
  * of the dline will be f->dots[i] */
-static int dline_index_from_face(grid *g, grid_face *f, int i)
+static int dline_index_from_face(grid *g, int f, int i)
 {
-    grid_edge *e = f->edges[i];
-    grid_dot *d = f->dots[i];
+    int e = g->face_edges[g->face_offsets[f] + i];
+    int d = g->face_dots[g->face_offsets[f] + i];
     int ret;
 #ifdef DEBUG_DLINES
-    grid_edge *e2;
+    int e2;
     int i2 = i - 1;
-    if (i2 < 0) i2 += f->order;
-    e2 = f->edges[i2];
+    if (i2 < 0) i2 += g->face_offsets[f+1] - g->face_offsets[f];
+    e2 = g->face_edges[g->face_offsets[f] + i2];
 #endif
-    ret = 2 * (e - g->edges) + ((e->dot1 == d) ? 1 : 0);
+    ret = 2 * e + ((g->edge_dots[2*e] == d) ? 1 : 0);
 #ifdef DEBUG_DLINES
     printf("dline_index_from_face: f=%d,i=%d, edges [%d,%d] - %d\n",
-           (int)(f - g->faces), i, (int)(e - g->edges),
-           (int)(e2 - g->edges), ret);
+           f, i, e, e2, ret);
 #endif
     return ret;
 }
@@ -1872,17 +1932,37 @@ static bool is_atleastone(const char *dline_array, int index)
 {
     return BIT_SET(dline_array[index], 0);
 }
-static bool set_atleastone(char *dline_array, int index)
+/* Mark the dot and face a dline belongs to as needing another look
+ * from dline_deductions. By the numbering in dline_index_from_dot, the
+ * dot is edge_dots[index^1]. The face is one of the two either side of
+ * the dline's first edge; rather than work out which, we mark both. */
+static void dline_changed(solver_state *sstate, int index)
 {
-    return SET_BIT(dline_array[index], 0);
+    grid *g = sstate->state->game_grid;
+    const int *ef = g->edge_faces + 2*(index/2);
+    pending_add(sstate->dline_dots, g->edge_dots[index ^ 1]);
+    if (ef[0] >= 0)
+        pending_add(sstate->dline_faces, ef[0]);
+    if (ef[1] >= 0)
+        pending_add(sstate->dline_faces, ef[1]);
+}
+static bool set_atleastone(solver_state *sstate, int index)
+{
+    if (!SET_BIT(sstate->dlines[index], 0))
+        return false;
+    dline_changed(sstate, index);
+    return true;
 }
 static bool is_atmostone(const char *dline_array, int index)
 {
     return BIT_SET(dline_array[index], 1);
 }
-static bool set_atmostone(char *dline_array, int index)
+static bool set_atmostone(solver_state *sstate, int index)
 {
-    return SET_BIT(dline_array[index], 1);
+    if (!SET_BIT(sstate->dlines[index], 1))
+        return false;
+    dline_changed(sstate, index);
+    return true;
 }
 
 static void array_setall(char *array, char from, char to, int len)
@@ -1905,11 +1985,12 @@ static void array_setall(char *array, char from, char to, int len)
  * and set their corresponding dline to atleastone.  (Setting atmostone
  * already happens in earlier dline deductions) */
 static bool dline_set_opp_atleastone(solver_state *sstate,
-                                     grid_dot *d, int edge)
+                                     int d, int edge)
 {
     game_state *state = sstate->state;
     grid *g = state->game_grid;
-    int N = d->order;
+    const int *de = g->dot_edges + g->dot_offsets[d];
+    int N = g->dot_offsets[d+1] - g->dot_offsets[d];
     int opp, opp2;
     for (opp = 0; opp < N; opp++) {
         int opp_dline_index;
@@ -1922,13 +2003,13 @@ static bool dline_set_opp_atleastone(solver_state *sstate,
         opp2 = opp + 1;
         if (opp2 == N) opp2 = 0;
         /* Check if opp, opp2 point to LINE_UNKNOWNs */
-        if (state->lines[d->edges[opp] - g->edges] != LINE_UNKNOWN)
+        if (state->lines[de[opp]] != LINE_UNKNOWN)
             continue;
-        if (state->lines[d->edges[opp2] - g->edges] != LINE_UNKNOWN)
+        if (state->lines[de[opp2]] != LINE_UNKNOWN)
             continue;
         /* Found opposite UNKNOWNS and they're next to each other */
         opp_dline_index = dline_index_from_dot(g, d, opp);
-        return set_atleastone(sstate->dlines, opp_dline_index);
+        return set_atleastone(sstate, opp_dline_index);
     }
     return false;
 }
@@ -1946,18 +2027,18 @@ static bool face_setall_identical(solver_state *sstate, int face_index,
     bool retval = false;
     game_state *state = sstate->state;
     grid *g = state->game_grid;
-    grid_face *f = g->faces + face_index;
-    int N = f->order;
+    const int *fe = g->face_edges + g->face_offsets[face_index];
+    int N = g->face_offsets[face_index+1] - g->face_offsets[face_index];
     int i, j;
     int can1, can2;
     bool inv1, inv2;
 
     for (i = 0; i < N; i++) {
-        int line1_index = f->edges[i] - g->edges;
+        int line1_index = fe[i];
         if (state->lines[line1_index] != LINE_UNKNOWN)
             continue;
         for (j = i + 1; j < N; j++) {
-            int line2_index = f->edges[j] - g->edges;
+            int line2_index = fe[j];
             if (state->lines[line2_index] != LINE_UNKNOWN)
                 continue;
 
@@ -1976,14 +2057,13 @@ static bool face_setall_identical(solver_state *sstate, int face_index,
 /* Given a dot or face, and a count of LINE_UNKNOWNs, find them and
  * return the edge indices into e. */
 static void find_unknowns(game_state *state,
-    grid_edge **edge_list, /* Edge list to search (from a face or a dot) */
+    const int *edge_list, /* Edge list to search (from a face or a dot) */
     int expected_count, /* Number of UNKNOWNs (comes from solver's cache) */
     int *e /* Returned edge indices */)
 {
     int c = 0;
-    grid *g = state->game_grid;
     while (c < expected_count) {
-        int line_index = *edge_list - g->edges;
+        int line_index = *edge_list;
         if (state->lines[line_index] == LINE_UNKNOWN) {
             e[c] = line_index;
             c++;
@@ -1998,7 +2078,7 @@ static void find_unknowns(game_state *state,
  * Returns the difficulty level of the next solver that should be used,
  * or DIFF_MAX if no progress was made. */
 static int parity_deductions(solver_state *sstate,
-    grid_edge **edge_list, /* Edge list (from a face or a dot) */
+    const int *edge_list, /* Edge list (from a face or a dot) */
     int total_parity, /* Expected number of YESs modulo 2 (either 0 or 1) */
     int unknown_count)
 {
@@ -2111,8 +2191,11 @@ static int trivial_deductions(solver_state *sstate)
     int diff = DIFF_MAX;
 
     /* Per-face deductions */
-    for (i = 0; i < g->num_faces; i++) {
-        grid_face *f = g->faces + i;
+    for (i = pending_next(sstate->trivial_faces, 0, g->num_faces);
+         i < g->num_faces;
+         i = pending_next(sstate->trivial_faces, i+1, g->num_faces)) {
+        const int *fe = g->face_edges + g->face_offsets[i];
+        int order = g->face_offsets[i+1] - g->face_offsets[i];
 
         if (sstate->face_solved[i])
             continue;
@@ -2120,7 +2203,7 @@ static int trivial_deductions(solver_state *sstate)
         current_yes = sstate->face_yes_count[i];
         current_no  = sstate->face_no_count[i];
 
-        if (current_yes + current_no == f->order)  {
+        if (current_yes + current_no == order)  {
             sstate->face_solved[i] = true;
             continue;
         }
@@ -2146,19 +2229,19 @@ static int trivial_deductions(solver_state *sstate)
             continue;
         }
 
-        if (f->order - state->clues[i] < current_no) {
+        if (order - state->clues[i] < current_no) {
             sstate->solver_status = SOLVER_MISTAKE;
             return DIFF_EASY;
         }
-        if (f->order - state->clues[i] == current_no) {
+        if (order - state->clues[i] == current_no) {
             if (face_setall(sstate, i, LINE_UNKNOWN, LINE_YES))
                 diff = min(diff, DIFF_EASY);
             sstate->face_solved[i] = true;
             continue;
         }
 
-        if (f->order - state->clues[i] == current_no + 1 &&
-            f->order - current_yes - current_no > 2) {
+        if (order - state->clues[i] == current_no + 1 &&
+            order - current_yes - current_no > 2) {
             /*
              * One small refinement to the above: we also look for any
              * adjacent pair of LINE_UNKNOWNs around the face with
@@ -2169,23 +2252,25 @@ static int trivial_deductions(solver_state *sstate)
              */
             int j, k, e1, e2, e, d;
 
-            for (j = 0; j < f->order; j++) {
-                e1 = f->edges[j] - g->edges;
-                e2 = f->edges[j+1 < f->order ? j+1 : 0] - g->edges;
+            for (j = 0; j < order; j++) {
+                const int *ed1, *ed2;
 
-                if (g->edges[e1].dot1 == g->edges[e2].dot1 ||
-                    g->edges[e1].dot1 == g->edges[e2].dot2) {
-                    d = g->edges[e1].dot1 - g->dots;
+                e1 = fe[j];
+                e2 = fe[j+1 < order ? j+1 : 0];
+                ed1 = g->edge_dots + 2*e1;
+                ed2 = g->edge_dots + 2*e2;
+
+                if (ed1[0] == ed2[0] || ed1[0] == ed2[1]) {
+                    d = ed1[0];
                 } else {
-                    assert(g->edges[e1].dot2 == g->edges[e2].dot1 ||
-                           g->edges[e1].dot2 == g->edges[e2].dot2);
-                    d = g->edges[e1].dot2 - g->dots;
+                    assert(ed1[1] == ed2[0] || ed1[1] == ed2[1]);
+                    d = ed1[1];
                 }
 
                 if (state->lines[e1] == LINE_UNKNOWN &&
                     state->lines[e2] == LINE_UNKNOWN) {
-                    for (k = 0; k < g->dots[d].order; k++) {
-                        int e = g->dots[d].edges[k] - g->edges;
+                    for (k = g->dot_offsets[d]; k < g->dot_offsets[d+1]; k++) {
+                        int e = g->dot_edges[k];
                         if (state->lines[e] == LINE_YES)
                             goto found;    /* multi-level break */
                     }
@@ -2198,8 +2283,8 @@ static int trivial_deductions(solver_state *sstate)
              * If we get here, we've found such a pair of edges, and
              * they're e1 and e2.
              */
-            for (j = 0; j < f->order; j++) {
-                e = f->edges[j] - g->edges;
+            for (j = 0; j < order; j++) {
+                e = fe[j];
                 if (state->lines[e] == LINE_UNKNOWN && e != e1 && e != e2) {
                     bool r = solver_set_line(sstate, e, LINE_YES);
                     assert(r);
@@ -2212,8 +2297,9 @@ static int trivial_deductions(solver_state *sstate)
     check_caches(sstate);
 
     /* Per-dot deductions */
-    for (i = 0; i < g->num_dots; i++) {
-        grid_dot *d = g->dots + i;
+    for (i = pending_next(sstate->trivial_dots, 0, g->num_dots);
+         i < g->num_dots;
+         i = pending_next(sstate->trivial_dots, i+1, g->num_dots)) {
         int yes, no, unknown;
 
         if (sstate->dot_solved[i])
@@ -2221,7 +2307,7 @@ static int trivial_deductions(solver_state *sstate)
 
         yes = sstate->dot_yes_count[i];
         no = sstate->dot_no_count[i];
-        unknown = d->order - yes - no;
+        unknown = g->dot_offsets[i+1] - g->dot_offsets[i] - yes - no;
 
         if (yes == 0) {
             if (unknown == 0) {
@@ -2307,11 +2393,15 @@ static int dline_deductions(solver_state *sstate)
      * could get quite expensive if there are many large faces. */
 #define MAX_FACE_SIZE 14
 
-    for (i = 0; i < g->num_faces; i++) {
+    /* (Anything we deduce about a face's own lines and dlines puts it
+     * back in dline_faces, which is what we want.) */
+    for (i = pending_next(sstate->dline_faces, 0, g->num_faces);
+         i < g->num_faces;
+         i = pending_next(sstate->dline_faces, i+1, g->num_faces)) {
         int maxs[MAX_FACE_SIZE][MAX_FACE_SIZE];
         int mins[MAX_FACE_SIZE][MAX_FACE_SIZE];
-        grid_face *f = g->faces + i;
-        int N = f->order;
+        const int *fe = g->face_edges + g->face_offsets[i];
+        int N = g->face_offsets[i+1] - g->face_offsets[i];
         int j,m;
         int clue = state->clues[i];
         assert(N <= MAX_FACE_SIZE);
@@ -2321,7 +2411,7 @@ static int dline_deductions(solver_state *sstate)
 
         /* Calculate the (j,j+1) entries */
         for (j = 0; j < N; j++) {
-            int edge_index = f->edges[j] - g->edges;
+            int edge_index = fe[j];
             int dline_index;
             enum line_state line1 = state->lines[edge_index];
             enum line_state line2;
@@ -2331,8 +2421,8 @@ static int dline_deductions(solver_state *sstate)
             maxs[j][k] = (line1 == LINE_NO) ? 0 : 1;
             mins[j][k] = (line1 == LINE_YES) ? 1 : 0;
             /* Calculate the (j,j+2) entries */
-            dline_index = dline_index_from_face(g, f, k);
-            edge_index = f->edges[k] - g->edges;
+            dline_index = dline_index_from_face(g, i, k);
+            edge_index = fe[k];
             line2 = state->lines[edge_index];
             k++;
             if (k >= N) k = 0;
@@ -2376,8 +2466,7 @@ static int dline_deductions(solver_state *sstate)
         /* See if we can make any deductions */
         for (j = 0; j < N; j++) {
             int k;
-            grid_edge *e = f->edges[j];
-            int line_index = e - g->edges;
+            int line_index = fe[j];
             int dline_index;
 
             if (state->lines[line_index] != LINE_UNKNOWN)
@@ -2411,27 +2500,26 @@ static int dline_deductions(solver_state *sstate)
              * in square grids. */
             if (sstate->diff >= DIFF_TRICKY) {
                 /* Now see if we can make dline deduction for edges{j,j+1} */
-                e = f->edges[k];
-                if (state->lines[e - g->edges] != LINE_UNKNOWN)
+                if (state->lines[fe[k]] != LINE_UNKNOWN)
                     /* Only worth doing this for an UNKNOWN,UNKNOWN pair.
                      * Dlines where one of the edges is known, are handled in the
                      * dot-deductions */
                     continue;
     
-                dline_index = dline_index_from_face(g, f, k);
+                dline_index = dline_index_from_face(g, i, k);
                 k++;
                 if (k >= N) k = 0;
     
                 /* minimum YESs in the complement of this dline */
                 if (mins[k][j] > clue - 2) {
                     /* Adding 2 YESs would break the clue */
-                    if (set_atmostone(dlines, dline_index))
+                    if (set_atmostone(sstate, dline_index))
                         diff = min(diff, DIFF_NORMAL);
                 }
                 /* maximum YESs in the complement of this dline */
                 if (maxs[k][j] < clue) {
                     /* Adding 2 NOs would mean not enough YESs */
-                    if (set_atleastone(dlines, dline_index))
+                    if (set_atleastone(sstate, dline_index))
                         diff = min(diff, DIFF_NORMAL);
                 }
             }
@@ -2443,9 +2531,11 @@ static int dline_deductions(solver_state *sstate)
 
     /* ------ Dot deductions ------ */
 
-    for (i = 0; i < g->num_dots; i++) {
-        grid_dot *d = g->dots + i;
-        int N = d->order;
+    for (i = pending_next(sstate->dline_dots, 0, g->num_dots);
+         i < g->num_dots;
+         i = pending_next(sstate->dline_dots, i+1, g->num_dots)) {
+        const int *de = g->dot_edges + g->dot_offsets[i];
+        int N = g->dot_offsets[i+1] - g->dot_offsets[i];
         int yes, no, unknown;
         int j;
         if (sstate->dot_solved[i])
@@ -2461,19 +2551,19 @@ static int dline_deductions(solver_state *sstate)
             enum line_state line1, line2;
             k = j + 1;
             if (k >= N) k = 0;
-            dline_index = dline_index_from_dot(g, d, j);
-            line1_index = d->edges[j] - g->edges;
-            line2_index = d->edges[k] - g->edges;
+            dline_index = dline_index_from_dot(g, i, j);
+            line1_index = de[j];
+            line2_index = de[k];
             line1 = state->lines[line1_index];
             line2 = state->lines[line2_index];
 
             /* Infer dline state from line state */
             if (line1 == LINE_NO || line2 == LINE_NO) {
-                if (set_atmostone(dlines, dline_index))
+                if (set_atmostone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
             }
             if (line1 == LINE_YES || line2 == LINE_YES) {
-                if (set_atleastone(dlines, dline_index))
+                if (set_atleastone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
             }
             /* Infer line state from dline state */
@@ -2519,10 +2609,10 @@ static int dline_deductions(solver_state *sstate)
                 }
             }
             if (yes == 1) {
-                if (set_atmostone(dlines, dline_index))
+                if (set_atmostone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
                 if (unknown == 2) {
-                    if (set_atleastone(dlines, dline_index))
+                    if (set_atleastone(sstate, dline_index))
                         diff = min(diff, DIFF_NORMAL);
                 }
             }
@@ -2547,8 +2637,8 @@ static int dline_deductions(solver_state *sstate)
                             continue;
                         if (j == N-1 && opp == 0)
                             continue;
-                        opp_dline_index = dline_index_from_dot(g, d, opp);
-                        if (set_atmostone(dlines, opp_dline_index))
+                        opp_dline_index = dline_index_from_dot(g, i, opp);
+                        if (set_atmostone(sstate, opp_dline_index))
                             diff = min(diff, DIFF_NORMAL);
                     }
                     if (yes == 0 && is_atmostone(dlines, dline_index)) {
@@ -2560,7 +2650,7 @@ static int dline_deductions(solver_state *sstate)
                                 int opp_index;
                                 if (opp == j || opp == k)
                                     continue;
-                                opp_index = d->edges[opp] - g->edges;
+                                opp_index = de[opp];
                                 if (state->lines[opp_index] == LINE_UNKNOWN) {
                                     solver_set_line(sstate, opp_index,
                                                     LINE_YES);
@@ -2572,7 +2662,7 @@ static int dline_deductions(solver_state *sstate)
                              * already set atmostone, so set atleastone as
                              * well.
                              */
-                            if (dline_set_opp_atleastone(sstate, d, j))
+                            if (dline_set_opp_atleastone(sstate, i, j))
                                 diff = min(diff, DIFF_NORMAL);
                         }
                     }
@@ -2611,7 +2701,7 @@ static int linedsf_deductions(solver_state *sstate)
         if (clue < 0)
             continue;
 
-        N = g->faces[i].order;
+        N = g->face_offsets[i+1] - g->face_offsets[i];
         yes = sstate->face_yes_count[i];
         if (yes + 1 == clue) {
             if (face_setall_identical(sstate, i, LINE_NO))
@@ -2629,32 +2719,33 @@ static int linedsf_deductions(solver_state *sstate)
 
         /* Deductions with small number of LINE_UNKNOWNs, based on overall
          * parity of lines. */
-        diff_tmp = parity_deductions(sstate, g->faces[i].edges,
+        diff_tmp = parity_deductions(sstate,
+                                     g->face_edges + g->face_offsets[i],
                                      (clue - yes) % 2, unknown);
         diff = min(diff, diff_tmp);
     }
 
     /* ------ Dot deductions ------ */
     for (i = 0; i < g->num_dots; i++) {
-        grid_dot *d = g->dots + i;
-        int N = d->order;
+        const int *de = g->dot_edges + g->dot_offsets[i];
+        int N = g->dot_offsets[i+1] - g->dot_offsets[i];
         int j;
         int yes, no, unknown;
         /* Go through dlines, and do any dline<->linedsf deductions wherever
          * we find two UNKNOWNS. */
         for (j = 0; j < N; j++) {
-            int dline_index = dline_index_from_dot(g, d, j);
+            int dline_index = dline_index_from_dot(g, i, j);
             int line1_index;
             int line2_index;
             int can1, can2;
             bool inv1, inv2;
             int j2;
-            line1_index = d->edges[j] - g->edges;
+            line1_index = de[j];
             if (state->lines[line1_index] != LINE_UNKNOWN)
                 continue;
             j2 = j + 1;
             if (j2 == N) j2 = 0;
-            line2_index = d->edges[j2] - g->edges;
+            line2_index = de[j2];
             if (state->lines[line2_index] != LINE_UNKNOWN)
                 continue;
             /* Infer dline flags from linedsf */
@@ -2662,9 +2753,9 @@ static int linedsf_deductions(solver_state *sstate)
             can2 = edsf_canonify(sstate->linedsf, line2_index, &inv2);
             if (can1 == can2 && inv1 != inv2) {
                 /* These are opposites, so set dline atmostone/atleastone */
-                if (set_atmostone(dlines, dline_index))
+                if (set_atmostone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
-                if (set_atleastone(dlines, dline_index))
+                if (set_atleastone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
                 continue;
             }
@@ -2681,7 +2772,7 @@ static int linedsf_deductions(solver_state *sstate)
         yes = sstate->dot_yes_count[i];
         no = sstate->dot_no_count[i];
         unknown = N - yes - no;
-        diff_tmp = parity_deductions(sstate, d->edges,
+        diff_tmp = parity_deductions(sstate, de,
                                      yes % 2, unknown);
         diff = min(diff, diff_tmp);
     }
@@ -2721,7 +2812,7 @@ static int loop_deductions(solver_state *sstate)
     int shortest_chainlen = g->num_dots;
     int dots_connected;
     bool progress = false;
-    int i;
+    int i, j;
 
     /*
      * Go through the grid and update for all the new edges.
@@ -2776,9 +2867,8 @@ static int loop_deductions(solver_state *sstate)
      * loop it would create is a solution.
      */
     for (i = 0; i < g->num_edges; i++) {
-        grid_edge *e = g->edges + i;
-        int d1 = e->dot1 - g->dots;
-        int d2 = e->dot2 - g->dots;
+        int d1 = g->edge_dots[2*i];
+        int d2 = g->edge_dots[2*i+1];
         int eqclass, val;
         if (state->lines[i] != LINE_UNKNOWN)
             continue;
@@ -2814,15 +2904,12 @@ static int loop_deductions(solver_state *sstate)
              * side of this edge.
              */
             sm1_nearby = 0;
-            if (e->face1) {
-                int f = e->face1 - g->faces;
-                int c = state->clues[f];
-                if (c >= 0 && sstate->face_yes_count[f] == c - 1)
-                    sm1_nearby++;
-            }
-            if (e->face2) {
-                int f = e->face2 - g->faces;
-                int c = state->clues[f];
+            for (j = 0; j < 2; j++) {
+                int f = g->edge_faces[2*i+j];
+                int c;
+                if (f < 0)
+                    continue;
+                c = state->clues[f];
                 if (c >= 0 && sstate->face_yes_count[f] == c - 1)
                     sm1_nearby++;
             }
@@ -2936,8 +3023,9 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 {
     char *soln = NULL;
     solver_state *sstate, *new_sstate;
+    arena *ar = arena_new();
 
-    sstate = new_solver_state(state, DIFF_MAX);
+    sstate = new_solver_state(state, DIFF_MAX, ar);
     new_sstate = solve_game_rec(sstate);
 
     if (new_sstate->solver_status == SOLVER_SOLVED) {
@@ -2950,8 +3038,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
         /**error = "Solver failed"; */
     }
 
-    free_solver_state(new_sstate);
-    free_solver_state(sstate);
+    arena_free(ar);
 
     return soln;
 }
@@ -3152,6 +3239,68 @@ static game_state *execute_move(const game_state *state, const char *move)
     return NULL;
 }
 
+/*
+ * For midend checkpoints, a state is encoded as 'S' if the solver
+ * has been used, 'C' if the game has been completed, then a colon,
+ * then one of 'y', 'n' or 'u' for each line.
+ */
+static char *encode_state(const game_state *state)
+{
+    strbuf *sb = strbuf_new();
+    int i;
+
+    if (state->cheated)
+        strbuf_addc(sb, 'S');
+    if (state->solved)
+        strbuf_addc(sb, 'C');
+    strbuf_addc(sb, ':');
+    for (i = 0; i < state->game_grid->num_edges; i++)
+        strbuf_addc(sb, (state->lines[i] == LINE_YES ? 'y' :
+                         state->lines[i] == LINE_NO ? 'n' : 'u'));
+    return strbuf_to_str(sb);
+}
+
+static game_state *decode_state(const game_state *initial,
+                                const char *encoding)
+{
+    game_state *ret = dup_game(initial);
+    const char *p = encoding;
+    bool solved = false;
+    int i;
+
+    if (*p == 'S') {
+        ret->cheated = true;
+        p++;
+    }
+    if (*p == 'C') {
+        solved = true;
+        p++;
+    }
+    if (*p++ != ':')
+        goto fail;
+
+    for (i = 0; i < ret->game_grid->num_edges; i++) {
+        switch (*p++) {
+          case 'y': ret->lines[i] = LINE_YES; break;
+          case 'n': ret->lines[i] = LINE_NO; break;
+          case 'u': ret->lines[i] = LINE_UNKNOWN; break;
+          default: goto fail;
+        }
+    }
+    if (*p)
+        goto fail;
+
+    /* This also fills in the error highlights. */
+    if (check_completion(ret) || solved)
+        ret->solved = true;
+
+    return ret;
+
+    fail:
+    free_game(ret);
+    return NULL;
+}
+
 /* ----------------------------------------------------------------------
  * Drawing routines.
  */
@@ -3688,6 +3837,8 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    encode_state,
+    decode_state,
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -3723,6 +3874,7 @@ int main(int argc, char **argv)
     const char *err;
     bool grade = false;
     int ret, diff;
+    arena *ar = arena_new();
 #if 0 /* verbose solver not supported here (yet) */
     bool really_verbose = false;
 #endif
@@ -3773,7 +3925,7 @@ int main(int argc, char **argv)
     ret = -1;			       /* placate optimiser */
     for (diff = 0; diff < DIFF_MAX; diff++) {
 	solver_state *sstate_new;
-	solver_state *sstate = new_solver_state((game_state *)s, diff);
+	solver_state *sstate = new_solver_state((game_state *)s, diff, ar);
 
 	sstate_new = solve_game_rec(sstate);
 
@@ -3784,8 +3936,7 @@ int main(int argc, char **argv)
 	else
 	    ret = 2;
 
-	free_solver_state(sstate_new);
-	free_solver_state(sstate);
+	arena_reset(ar);
 
 	if (ret < 2)
 	    break;
@@ -3804,7 +3955,7 @@ int main(int argc, char **argv)
 		printf("Difficulty rating: %s\n", diffnames[diff]);
 	} else {
 	    solver_state *sstate_new;
-	    solver_state *sstate = new_solver_state((game_state *)s, diff);
+	    solver_state *sstate = new_solver_state((game_state *)s, diff, ar);
 
 	    /* If we supported a verbose solver, we'd set verbosity here */
 
@@ -3820,12 +3971,10 @@ int main(int argc, char **argv)
 		    printf("Unable to output non-square grids\n");
 		}
 	    }
-
-	    free_solver_state(sstate_new);
-	    free_solver_state(sstate);
 	}
     }
 
+    arena_free(ar);
     return 0;
 }
 
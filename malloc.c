@@ -62,3 +62,115 @@ char *dupstr(const char *s) {
     strcpy(r,s);
     return r;
 }
+
+/*
+ * The arena allocator hands out memory from a chain of large blocks
+ * by simply advancing a pointer. Restoring a mark moves the pointer
+ * back but keeps every block, so a generator that allocates the
+ * same scratch space on each of its retries only calls malloc on
+ * the first one.
+ */
+#define ARENA_BLOCKSIZE 16384
+
+union arena_align {
+    void *p;
+    double d;
+    long l;
+    void (*f)(void);
+};
+#define ARENA_ALIGN sizeof(union arena_align)
+#define ARENA_ROUNDUP(n) (((n) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN)
+
+struct arena_block {
+    struct arena_block *next;
+    size_t size;                       /* bytes usable after the header */
+};
+#define ARENA_HEADER ARENA_ROUNDUP(sizeof(struct arena_block))
+#define ARENA_DATA(b) ((char *)(b) + ARENA_HEADER)
+
+struct arena {
+    struct arena_block *first;
+    struct arena_block *cur;           /* NULL means before 'first' */
+    size_t used;                       /* bytes of cur already handed out */
+};
+
+arena *arena_new(void)
+{
+    arena *a = snew(arena);
+    a->first = a->cur = NULL;
+    a->used = 0;
+    return a;
+}
+
+void *arena_alloc(arena *a, size_t size)
+{
+    struct arena_block *b, **link;
+    size_t bsize;
+
+    if (size == 0)
+        size = 1;
+#ifdef PTRDIFF_MAX
+    if (size > PTRDIFF_MAX - ARENA_ALIGN - ARENA_HEADER)
+	fatal("allocation too large");
+#endif
+    size = ARENA_ROUNDUP(size);
+
+    if (a->cur && a->cur->size - a->used >= size) {
+        void *p = ARENA_DATA(a->cur) + a->used;
+        a->used += size;
+        return p;
+    }
+
+    /*
+     * Move on to the next block left over from a previous pass, if
+     * there is one big enough; otherwise insert a fresh block here.
+     */
+    link = a->cur ? &a->cur->next : &a->first;
+    while ((b = *link) != NULL && b->size < size)
+        link = &b->next;
+    if (!b) {
+        link = a->cur ? &a->cur->next : &a->first;
+        bsize = size > ARENA_BLOCKSIZE ? size : ARENA_BLOCKSIZE;
+        b = smalloc(ARENA_HEADER + bsize);
+        b->size = bsize;
+        b->next = *link;
+        *link = b;
+    }
+
+    a->cur = b;
+    a->used = size;
+    return ARENA_DATA(b);
+}
+
+arena_mark arena_save(arena *a)
+{
+    arena_mark mark;
+    mark.block = a->cur;
+    mark.used = a->used;
+    return mark;
+}
+
+void arena_restore(arena *a, arena_mark mark)
+{
+    a->cur = mark.block;
+    a->used = mark.used;
+}
+
+void arena_reset(arena *a)
+{
+    a->cur = NULL;
+    a->used = 0;
+}
+
+void arena_free(arena *a)
+{
+    struct arena_block *b, *next;
+
+    if (!a)
+        return;
+    for (b = a->first; b; b = next) {
+        next = b->next;
+        sfree(b);
+    }
+    sfree(a);
+}
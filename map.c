@@ -509,14 +509,16 @@ static int extend_options(int w, int h, int n, int *map,
     return total;
 }
 
-static void genmap(int w, int h, int n, int *map, random_state *rs)
+static void genmap(int w, int h, int n, int *map, random_state *rs,
+                   arena *ar)
 {
     int wh = w*h;
     int x, y, i, k;
     int *tmp;
+    arena_mark mark = arena_save(ar);
 
     assert(n <= wh);
-    tmp = snewn(wh, int);
+    tmp = anewn(ar, wh, int);
 
     /*
      * Clear the map, and set up `tmp' as a list of grid indices.
@@ -597,7 +599,7 @@ static void genmap(int w, int h, int n, int *map, random_state *rs)
         map[i] = tmp[map[i]];
     }
 
-    sfree(tmp);
+    arena_restore(ar, mark);
 }
 
 /* ----------------------------------------------------------------------
@@ -661,24 +663,21 @@ static int graph_edge_index(int *graph, int n, int ngraph, int i, int j)
     return -1;
 }
 
-#define graph_adjacent(graph, n, ngraph, i, j) \
-    (graph_edge_index((graph), (n), (ngraph), (i), (j)) >= 0)
-
-static int graph_vertex_start(int *graph, int n, int ngraph, int i)
+/*
+ * Index a graph list by vertex: on return, the neighbours of vertex
+ * i are graph[j] - i*n for start[i] <= j < start[i+1]. 'start' must
+ * have room for n+1 entries.
+ */
+static void graph_vertex_starts(const int *graph, int n, int ngraph,
+                                int *start)
 {
-    int v = i*n;
-    int top, bot, mid;
+    int i, j;
 
-    bot = -1;
-    top = ngraph;
-    while (top - bot > 1) {
-	mid = (top + bot) / 2;
-	if (graph[mid] < v)
-	    bot = mid;
-	else
-	    top = mid;
+    for (i = j = 0; i <= n; i++) {
+        while (j < ngraph && graph[j] < i*n)
+            j++;
+        start[i] = j;
     }
-    return top;
 }
 
 /* ----------------------------------------------------------------------
@@ -689,44 +688,75 @@ static int graph_vertex_start(int *graph, int n, int ngraph, int i)
  * the sake of the Palm port and its limited stack.
  */
 
-static bool fourcolour_recurse(int *graph, int n, int ngraph,
-                               int *colouring, int *scratch, random_state *rs)
+/*
+ * The search usually finds a colouring almost without backtracking,
+ * but on a large map an early unlucky choice can leave it exploring
+ * a hopeless subtree for minutes. So each attempt is allowed this
+ * many calls to fourcolour_recurse per vertex, after which we start
+ * again from scratch with a doubled allowance. Almost every search
+ * needs barely more than one call per vertex, so the limit only
+ * comes into play for the unlucky ones.
+ */
+#define FOURCOLOUR_BUDGET 100
+
+struct colouring_scratch {
+    int *graph, *start, n;
+    int *colouring;
+
+    /*
+     * For each vertex and each colour, we store the number of
+     * neighbours that have that colour. Also, we store the number
+     * of free colours for the vertex.
+     */
+    int *counts;
+
+    /*
+     * nwithfree[f] is the number of uncoloured vertices with f free
+     * colours.
+     */
+    int nwithfree[FIVE];
+
+    long budget;                       /* calls left in this attempt */
+    random_state *rs;
+};
+
+static bool fourcolour_recurse(struct colouring_scratch *cs)
 {
-    int nfree, nvert, start, i, j, k, c, ci;
-    int cs[FOUR];
+    int *graph = cs->graph, *scratch = cs->counts, *colouring = cs->colouring;
+    int n = cs->n;
+    int nfree, nvert, start, end, i, j, k, c, ci, f;
+    int cols[FOUR];
+
+    if (cs->budget <= 0)
+        return false;                  /* give up and start again */
+    cs->budget--;
 
     /*
      * Find the smallest number of free colours in any uncoloured
      * vertex, and count the number of such vertices.
      */
-
-    nfree = FIVE;		       /* start off bigger than FOUR! */
-    nvert = 0;
-    for (i = 0; i < n; i++)
-	if (colouring[i] < 0 && scratch[i*FIVE+FOUR] <= nfree) {
-	    if (nfree > scratch[i*FIVE+FOUR]) {
-		nfree = scratch[i*FIVE+FOUR];
-		nvert = 0;
-	    }
-	    nvert++;
-	}
+    for (nfree = 0; nfree < FIVE; nfree++)
+        if (cs->nwithfree[nfree] > 0)
+            break;
 
     /*
      * If there aren't any uncoloured vertices at all, we're done.
      */
-    if (nvert == 0)
+    if (nfree == FIVE)
 	return true;		       /* we've got a colouring! */
+    nvert = cs->nwithfree[nfree];
 
     /*
      * Pick a random vertex in that set.
      */
-    j = random_upto(rs, nvert);
+    j = random_upto(cs->rs, nvert);
     for (i = 0; i < n; i++)
 	if (colouring[i] < 0 && scratch[i*FIVE+FOUR] == nfree)
 	    if (j-- == 0)
 		break;
     assert(i < n);
-    start = graph_vertex_start(graph, n, ngraph, i);
+    start = cs->start[i];
+    end = cs->start[i+1];
 
     /*
      * Loop over the possible colours for i, and recurse for each
@@ -735,45 +765,64 @@ static bool fourcolour_recurse(int *graph, int n, int ngraph,
     ci = 0;
     for (c = 0; c < FOUR; c++)
 	if (scratch[i*FIVE+c] == 0)
-	    cs[ci++] = c;
-    shuffle(cs, ci, sizeof(*cs), rs);
+	    cols[ci++] = c;
+    shuffle(cols, ci, sizeof(*cols), cs->rs);
 
     while (ci-- > 0) {
-	c = cs[ci];
+	c = cols[ci];
 
 	/*
 	 * Fill in this colour.
 	 */
 	colouring[i] = c;
+        cs->nwithfree[nfree]--;
 
 	/*
 	 * Update the scratch space to reflect a new neighbour
 	 * of this colour for each neighbour of vertex i.
 	 */
-	for (j = start; j < ngraph && graph[j] < n*(i+1); j++) {
+	for (j = start; j < end; j++) {
 	    k = graph[j] - i*n;
-	    if (scratch[k*FIVE+c] == 0)
-		scratch[k*FIVE+FOUR]--;
+	    if (scratch[k*FIVE+c] == 0) {
+                f = scratch[k*FIVE+FOUR]--;
+                if (colouring[k] < 0) {
+                    cs->nwithfree[f]--;
+                    cs->nwithfree[f-1]++;
+                }
+            }
 	    scratch[k*FIVE+c]++;
 	}
 
 	/*
 	 * Recurse.
 	 */
-	if (fourcolour_recurse(graph, n, ngraph, colouring, scratch, rs))
+	if (fourcolour_recurse(cs))
 	    return true;	       /* got one! */
 
+        /*
+         * If we ran out of time, there's no point in tidying up:
+         * fourcolour() will reset everything before trying again.
+         */
+        if (cs->budget <= 0)
+            return false;
+
 	/*
 	 * If that didn't work, clean up and try again with a
 	 * different colour.
 	 */
-	for (j = start; j < ngraph && graph[j] < n*(i+1); j++) {
+	for (j = start; j < end; j++) {
 	    k = graph[j] - i*n;
 	    scratch[k*FIVE+c]--;
-	    if (scratch[k*FIVE+c] == 0)
-		scratch[k*FIVE+FOUR]++;
+	    if (scratch[k*FIVE+c] == 0) {
+                f = scratch[k*FIVE+FOUR]++;
+                if (colouring[k] < 0) {
+                    cs->nwithfree[f]--;
+                    cs->nwithfree[f+1]++;
+                }
+            }
 	}
 	colouring[i] = -1;
+        cs->nwithfree[nfree]++;
     }
 
     /*
@@ -788,31 +837,44 @@ static bool fourcolour_recurse(int *graph, int n, int ngraph,
 }
 
 static void fourcolour(int *graph, int n, int ngraph, int *colouring,
-		       random_state *rs)
+		       random_state *rs, arena *ar)
 {
-    int *scratch;
+    struct colouring_scratch cs;
+    long budget = (long)FOURCOLOUR_BUDGET * n;
     int i;
-    bool retd;
+    arena_mark mark = arena_save(ar);
 
-    /*
-     * For each vertex and each colour, we store the number of
-     * neighbours that have that colour. Also, we store the number
-     * of free colours for the vertex.
-     */
-    scratch = snewn(n * FIVE, int);
-    for (i = 0; i < n * FIVE; i++)
-	scratch[i] = (i % FIVE == FOUR ? FOUR : 0);
+    cs.graph = graph;
+    cs.n = n;
+    cs.colouring = colouring;
+    cs.rs = rs;
+    cs.start = anewn(ar, n+1, int);
+    graph_vertex_starts(graph, n, ngraph, cs.start);
+    cs.counts = anewn(ar, n * FIVE, int);
 
-    /*
-     * Clear the colouring to start with.
-     */
-    for (i = 0; i < n; i++)
-	colouring[i] = -1;
+    while (1) {
+        for (i = 0; i < n * FIVE; i++)
+            cs.counts[i] = (i % FIVE == FOUR ? FOUR : 0);
+        for (i = 0; i < FIVE; i++)
+            cs.nwithfree[i] = (i == FOUR ? n : 0);
 
-    retd = fourcolour_recurse(graph, n, ngraph, colouring, scratch, rs);
-    assert(retd);                 /* by the Four Colour Theorem :-) */
+        /*
+         * Clear the colouring to start with.
+         */
+        for (i = 0; i < n; i++)
+            colouring[i] = -1;
+
+        cs.budget = budget;
+        if (fourcolour_recurse(&cs))
+            break;
 
-    sfree(scratch);
+        /* Only running out of time can stop us, by the Four Colour
+         * Theorem :-) */
+        assert(cs.budget <= 0);
+        budget *= 2;
+    }
+
+    arena_restore(ar, mark);
 }
 
 /* ----------------------------------------------------------------------
@@ -825,6 +887,23 @@ struct solver_scratch {
     int *graph;
     int n;
     int ngraph;
+    int *start;                        /* see graph_vertex_starts */
+
+    /*
+     * Regions whose entry in 'possible' has changed since the easy
+     * deductions last looked at them (easy_pending), and since the
+     * start of the last pass of the normal deductions
+     * (normal_pending). A pass of the normal deductions works from a
+     * copy of normal_pending in normal_current, which also collects
+     * the changes made by the pass itself. See region_changed().
+     */
+    unsigned long *easy_pending, *normal_pending, *normal_current;
+
+    /*
+     * The forcing chain search sets adjmark[k] = i for each
+     * neighbour k of its starting region i.
+     */
+    int *adjmark;
 
     int *bfsqueue;
     int *bfscolour;
@@ -833,22 +912,53 @@ struct solver_scratch {
 #endif
 
     int depth;
+
+    /* The scratch space and everything in it lives in this arena,
+     * and free_scratch winds it back to 'mark'. */
+    arena *ar;
+    arena_mark mark;
+    bool own_arena;
 };
 
-static struct solver_scratch *new_scratch(int *graph, int n, int ngraph)
+/*
+ * If 'ar' is NULL, the scratch space uses an arena of its own.
+ */
+static struct solver_scratch *new_scratch(int *graph, int n, int ngraph,
+                                          arena *ar)
 {
     struct solver_scratch *sc;
+    bool own_arena = (ar == NULL);
+    arena_mark mark;
+    int i;
+
+    if (own_arena)
+        ar = arena_new();
+    mark = arena_save(ar);
 
-    sc = snew(struct solver_scratch);
+    sc = anew(ar, struct solver_scratch);
+    sc->ar = ar;
+    sc->mark = mark;
+    sc->own_arena = own_arena;
     sc->graph = graph;
     sc->n = n;
     sc->ngraph = ngraph;
-    sc->possible = snewn(n, unsigned char);
+    sc->start = anewn(ar, n+1, int);
+    graph_vertex_starts(graph, n, ngraph, sc->start);
+    sc->possible = anewn(ar, n, unsigned char);
+    sc->easy_pending = anewn(ar, PENDING_WORDS(n), unsigned long);
+    sc->normal_pending = anewn(ar, PENDING_WORDS(n), unsigned long);
+    sc->normal_current = anewn(ar, PENDING_WORDS(n), unsigned long);
+    memset(sc->easy_pending, 0, PENDING_WORDS(n) * sizeof(unsigned long));
+    memset(sc->normal_pending, 0, PENDING_WORDS(n) * sizeof(unsigned long));
+    memset(sc->normal_current, 0, PENDING_WORDS(n) * sizeof(unsigned long));
+    sc->adjmark = anewn(ar, n, int);
+    for (i = 0; i < n; i++)
+        sc->adjmark[i] = -1;
     sc->depth = 0;
-    sc->bfsqueue = snewn(n, int);
-    sc->bfscolour = snewn(n, int);
+    sc->bfsqueue = anewn(ar, n, int);
+    sc->bfscolour = anewn(ar, n, int);
 #ifdef SOLVER_DIAGNOSTICS
-    sc->bfsprev = snewn(n, int);
+    sc->bfsprev = anewn(ar, n, int);
 #endif
 
     return sc;
@@ -856,13 +966,10 @@ static struct solver_scratch *new_scratch(int *graph, int n, int ngraph)
 
 static void free_scratch(struct solver_scratch *sc)
 {
-    sfree(sc->possible);
-    sfree(sc->bfsqueue);
-    sfree(sc->bfscolour);
-#ifdef SOLVER_DIAGNOSTICS
-    sfree(sc->bfsprev);
-#endif
-    sfree(sc);
+    if (sc->own_arena)
+        arena_free(sc->ar);
+    else
+        arena_restore(sc->ar, sc->mark);
 }
 
 /*
@@ -880,6 +987,17 @@ static int bitcount(int word)
 static const char colnames[FOUR] = { 'R', 'Y', 'G', 'B' };
 #endif
 
+/*
+ * Record that the possible colours of region k have changed, so that
+ * the deductions which depend on them will look at it again.
+ */
+static void region_changed(struct solver_scratch *sc, int k)
+{
+    pending_add(sc->easy_pending, k);
+    pending_add(sc->normal_pending, k);
+    pending_add(sc->normal_current, k);
+}
+
 static bool place_colour(struct solver_scratch *sc,
                          int *colouring, int index, int colour
 #ifdef SOLVER_DIAGNOSTICS
@@ -887,7 +1005,7 @@ static bool place_colour(struct solver_scratch *sc,
 #endif
                          )
 {
-    int *graph = sc->graph, n = sc->n, ngraph = sc->ngraph;
+    int *graph = sc->graph, n = sc->n;
     int j, k;
 
     if (!(sc->possible[index] & (1 << colour))) {
@@ -901,6 +1019,7 @@ static bool place_colour(struct solver_scratch *sc,
 
     sc->possible[index] = 1 << colour;
     colouring[index] = colour;
+    region_changed(sc, index);
 
 #ifdef SOLVER_DIAGNOSTICS
     if (verbose)
@@ -911,15 +1030,17 @@ static bool place_colour(struct solver_scratch *sc,
     /*
      * Rule out this colour from all the region's neighbours.
      */
-    for (j = graph_vertex_start(graph, n, ngraph, index);
-	 j < ngraph && graph[j] < n*(index+1); j++) {
+    for (j = sc->start[index]; j < sc->start[index+1]; j++) {
 	k = graph[j] - index*n;
+        if (sc->possible[k] & (1 << colour)) {
 #ifdef SOLVER_DIAGNOSTICS
-        if (verbose && (sc->possible[k] & (1 << colour)))
-            printf("%*s  ruling out %c in region %d\n", 2*sc->depth, "",
-                   colnames[colour], k);
+            if (verbose)
+                printf("%*s  ruling out %c in region %d\n", 2*sc->depth, "",
+                       colnames[colour], k);
 #endif
-	sc->possible[k] &= ~(1 << colour);
+            sc->possible[k] &= ~(1 << colour);
+            region_changed(sc, k);
+        }
     }
 
     return true;
@@ -980,6 +1101,13 @@ static int map_solver(struct solver_scratch *sc,
             }
     }
 
+    /*
+     * Every region is worth a first look, whether we're starting
+     * afresh or were given a copy of a parent's state.
+     */
+    pending_fill(sc->easy_pending, n);
+    pending_fill(sc->normal_pending, n);
+
     /*
      * Now repeatedly loop until we find nothing further to do.
      */
@@ -991,11 +1119,15 @@ static int map_solver(struct solver_scratch *sc,
 
 	/*
 	 * Simplest possible deduction: find a region with only one
-	 * possible colour.
+	 * possible colour. Only regions which have changed since we
+	 * last looked can have become one.
 	 */
-	for (i = 0; i < n; i++) if (colouring[i] < 0) {
+	for (i = 0; (i = pending_next(sc->easy_pending, i, n)) < n; i++) {
 	    int p = sc->possible[i];
 
+	    if (colouring[i] >= 0)
+		continue;
+
 	    if (p == 0) {
 #ifdef SOLVER_DIAGNOSTICS
                 if (verbose)
@@ -1046,10 +1178,19 @@ static int map_solver(struct solver_scratch *sc,
          * Simplest way to do this is by going through the graph
          * edge by edge, so that we start with property (b) and
          * then look for (a) and finally (c) and (d).
+         *
+         * Since possibilities are only ever ruled out, an edge can
+         * only yield something new if one of its ends has changed
+         * since we last considered it, which was at the latest
+         * during the previous pass.
          */
+        memcpy(sc->normal_current, sc->normal_pending,
+               PENDING_WORDS(n) * sizeof(unsigned long));
+        memset(sc->normal_pending, 0,
+               PENDING_WORDS(n) * sizeof(unsigned long));
         for (i = 0; i < ngraph; i++) {
             int j1 = graph[i] / n, j2 = graph[i] % n;
-            int j, k, v, v2;
+            int j, k, v, v2, gj, gend;
 #ifdef SOLVER_DIAGNOSTICS
             bool started = false;
 #endif
@@ -1057,6 +1198,10 @@ static int map_solver(struct solver_scratch *sc,
             if (j1 > j2)
                 continue;              /* done it already, other way round */
 
+            if (!pending_has(sc->normal_current, j1) &&
+                !pending_has(sc->normal_current, j2))
+                continue;              /* nothing new here */
+
             if (colouring[j1] >= 0 || colouring[j2] >= 0)
                 continue;              /* they're not undecided */
 
@@ -1081,12 +1226,16 @@ static int map_solver(struct solver_scratch *sc,
              * region then that region cannot be either colour.
              * 
              * Go through the neighbours of j1 and see if any are
-             * shared with j2.
+             * shared with j2. Both lists are sorted, so we can walk
+             * along j2's in step.
              */
-            for (j = graph_vertex_start(graph, n, ngraph, j1);
-                 j < ngraph && graph[j] < n*(j1+1); j++) {
+            gj = sc->start[j2];
+            gend = sc->start[j2+1];
+            for (j = sc->start[j1]; j < sc->start[j1+1]; j++) {
                 k = graph[j] - j1*n;
-                if (graph_adjacent(graph, n, ngraph, k, j2) &&
+                while (gj < gend && graph[gj] - j2*n < k)
+                    gj++;
+                if (gj < gend && graph[gj] - j2*n == k &&
                     (sc->possible[k] & v)) {
 #ifdef SOLVER_DIAGNOSTICS
                     if (verbose) {
@@ -1101,6 +1250,7 @@ static int map_solver(struct solver_scratch *sc,
                     }
 #endif
                     sc->possible[k] &= ~v;
+                    region_changed(sc, k);
                     done_something = true;
                 }
             }
@@ -1151,14 +1301,17 @@ static int map_solver(struct solver_scratch *sc,
          * two possible colours.
          */
         for (i = 0; i < n; i++) {
-            int c;
+            int c, gi;
 
             if (colouring[i] >= 0 || bitcount(sc->possible[i]) != 2)
                 continue;
 
+            for (gi = sc->start[i]; gi < sc->start[i+1]; gi++)
+                sc->adjmark[graph[gi] - i*n] = i;
+
             for (c = 0; c < FOUR; c++)
                 if (sc->possible[i] & (1 << c)) {
-                    int j, k, gi, origc, currc, head, tail;
+                    int j, k, origc, currc, head, tail;
                     /*
                      * Try a bfs from this vertex, ruling out
                      * colour c.
@@ -1188,8 +1341,7 @@ static int map_solver(struct solver_scratch *sc,
                         /*
                          * Try neighbours of j.
                          */
-                        for (gi = graph_vertex_start(graph, n, ngraph, j);
-                             gi < ngraph && graph[gi] < n*(j+1); gi++) {
+                        for (gi = sc->start[j]; gi < sc->start[j+1]; gi++) {
                             k = graph[gi] - j*n;
 
                             /*
@@ -1221,7 +1373,7 @@ static int map_solver(struct solver_scratch *sc,
                              * the original colour we ruled out.
                              */
                             if (currc == origc &&
-                                graph_adjacent(graph, n, ngraph, k, i) &&
+                                sc->adjmark[k] == i &&
                                 (sc->possible[k] & currc)) {
 #ifdef SOLVER_DIAGNOSTICS
                                 if (verbose) {
@@ -1242,6 +1394,7 @@ static int map_solver(struct solver_scratch *sc,
                                 }
 #endif
                                 sc->possible[k] &= ~origc;
+                                region_changed(sc, k);
                                 done_something = true;
                             }
                         }
@@ -1321,11 +1474,11 @@ static int map_solver(struct solver_scratch *sc,
         /*
          * Now iterate over the possible colours for this region.
          */
-        rsc = new_scratch(graph, n, ngraph);
+        rsc = new_scratch(graph, n, ngraph, sc->ar);
         rsc->depth = sc->depth + 1;
-        origcolouring = snewn(n, int);
+        origcolouring = anewn(sc->ar, n, int);
         memcpy(origcolouring, colouring, n * sizeof(int));
-        subcolouring = snewn(n, int);
+        subcolouring = anewn(sc->ar, n, int);
         we_already_got_one = false;
         ret = 0;
 
@@ -1380,9 +1533,7 @@ static int map_solver(struct solver_scratch *sc,
              */
         }
 
-        sfree(origcolouring);
-        sfree(subcolouring);
-        free_scratch(rsc);
+        free_scratch(rsc);             /* and origcolouring, subcolouring */
 
 #ifdef SOLVER_DIAGNOSTICS
         if (verbose && sc->depth == 0) {
@@ -1413,6 +1564,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 #endif
     char *ret, buf[80];
     int retlen, retsize;
+    arena *ar;
 
     w = params->w;
     h = params->h;
@@ -1421,11 +1573,12 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 
     *aux = NULL;
 
-    map = snewn(wh, int);
-    graph = snewn(n*n, int);
-    colouring = snewn(n, int);
-    colouring2 = snewn(n, int);
-    regions = snewn(n, int);
+    ar = arena_new();
+    map = anewn(ar, wh, int);
+    graph = anewn(ar, n*n, int);
+    colouring = anewn(ar, n, int);
+    colouring2 = anewn(ar, n, int);
+    regions = anewn(ar, n, int);
 
     /*
      * This is the minimum difficulty below which we'll completely
@@ -1444,7 +1597,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
         /*
          * Create the map.
          */
-        genmap(w, h, n, map, rs);
+        genmap(w, h, n, map, rs, ar);
 
 #ifdef GENERATION_DIAGNOSTICS
         for (y = 0; y < h; y++) {
@@ -1476,7 +1629,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
         /*
          * Colour the map.
          */
-        fourcolour(graph, n, ngraph, colouring, rs);
+        fourcolour(graph, n, ngraph, colouring, rs, ar);
 
 #ifdef GENERATION_DIAGNOSTICS
         for (i = 0; i < n; i++)
@@ -1538,7 +1691,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
         shuffle(regions, n, sizeof(*regions), rs);
 
         if (sc) free_scratch(sc);
-        sc = new_scratch(graph, n, ngraph);
+        sc = new_scratch(graph, n, ngraph, ar);
 
         for (i = 0; i < n; i++) {
             j = regions[i];
@@ -1708,11 +1861,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     }
 
     free_scratch(sc);
-    sfree(regions);
-    sfree(colouring2);
-    sfree(colouring);
-    sfree(graph);
-    sfree(map);
+    arena_free(ar);
 
     return ret;
 }
@@ -2222,7 +2371,8 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	colouring = snewn(state->map->n, int);
 	memcpy(colouring, state->colouring, state->map->n * sizeof(int));
 
-	sc = new_scratch(state->map->graph, state->map->n, state->map->ngraph);
+	sc = new_scratch(state->map->graph, state->map->n, state->map->ngraph,
+                         NULL);
 	sret = map_solver(sc, state->map->graph, state->map->n,
 			 state->map->ngraph, colouring, DIFFCOUNT-1);
 	free_scratch(sc);
@@ -3274,6 +3424,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     20, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -3338,7 +3489,7 @@ int main(int argc, char **argv)
     }
     s = new_game(NULL, p, desc);
 
-    sc = new_scratch(s->map->graph, s->map->n, s->map->ngraph);
+    sc = new_scratch(s->map->graph, s->map->n, s->map->ngraph, NULL);
 
     /*
      * When solving an Easy puzzle, we don't want to bother the
@@ -64,10 +64,33 @@ struct midend {
     char *desc, *privdesc, *seedstr;
     char *aux_info;
     enum { GOT_SEED, GOT_DESC, GOT_NOTHING } genmode;
+    bool fast_random_seeds;  /* invent seeds using RANDOM_FAST_SEED_PREFIX */
 
     int nstates, statesize, statepos;
     struct midend_state_entry *states;
 
+    /*
+     * If undo_checkpoint is positive, we don't keep every game_state
+     * in the undo chain. Only every undo_checkpoint'th state (and
+     * any state that can't be reconstructed from its predecessor
+     * by execute_move, i.e. NEWGAME and RESTART entries) is kept
+     * permanently, along with the current state and its immediate
+     * neighbours. The rest have their state field set to NULL, and
+     * midend_state() rebuilds them on demand by replaying the move
+     * strings from the nearest earlier state we still have.
+     */
+    int undo_checkpoint;
+
+    /*
+     * If lazy_replay is set, loading a saved game only keeps the
+     * current position and the states midend_state() can't rebuild.
+     * The rest of the undo chain is left for midend_state() to
+     * rebuild when it's needed. An untrusted load still replays (and
+     * so checks) every move on the way; a trusted one only executes
+     * the moves it needs to reach the current position.
+     */
+    bool lazy_replay;
+
     struct midend_serialise_buf newgame_undo, newgame_redo;
     bool newgame_can_store_undo;
 
@@ -112,7 +135,7 @@ struct midend {
  */
 struct deserialise_data {
     char *seed, *parstr, *desc, *privdesc;
-    char *auxinfo, *uistr, *cparstr;
+    char *auxinfo, *uistr, *cparstr, *checkpoint;
     float elapsed;
     game_params *params, *cparams;
     game_ui *ui;
@@ -126,7 +149,7 @@ struct deserialise_data {
 static const char *midend_deserialise_internal(
     midend *me, bool (*read)(void *ctx, void *buf, int len), void *rctx,
     const char *(*check)(void *ctx, midend *, const struct deserialise_data *),
-    void *cctx);
+    void *cctx, bool trusted);
 
 void midend_reset_tilesize(midend *me)
 {
@@ -200,6 +223,16 @@ midend *midend_new(frontend *fe, const game *ourgame,
     me->seedstr = NULL;
     me->aux_info = NULL;
     me->genmode = GOT_NOTHING;
+    me->fast_random_seeds = getenv_bool("PUZZLES_FAST_RANDOM", false);
+    {
+        char *e = getenv("PUZZLES_UNDO_CHECKPOINT");
+        int n;
+
+        me->undo_checkpoint = 0;
+        if (e && sscanf(e, "%d", &n) == 1 && n > 0)
+            me->undo_checkpoint = n;
+    }
+    me->lazy_replay = getenv_bool("PUZZLES_LAZY_REPLAY", false);
     me->drawstate = NULL;
     me->first_draw = true;
     me->oldstate = NULL;
@@ -230,10 +263,111 @@ const game *midend_which_game(midend *me)
     return me->ourgame;
 }
 
+/*
+ * Return the game_state at position i in the undo chain,
+ * reconstructing it if it was discarded by midend_trim_states or
+ * never built by a lazy load. Any states built on the way which
+ * midend_trim_states would have kept are kept, so that walking back
+ * through a lazily loaded undo chain doesn't replay it from the
+ * start at every step.
+ *
+ * Returns NULL if one of the moves on the way won't execute. That
+ * can only happen to a state skipped by a trusted load of data which
+ * wasn't what it claimed to be, but it's no reason to crash.
+ */
+static game_state *midend_state(midend *me, int i)
+{
+    game_state *s;
+    int j;
+
+    assert(i >= 0 && i < me->nstates);
+    if (me->states[i].state)
+        return me->states[i].state;
+
+    for (j = i; !me->states[j].state; j--) {
+        assert(j > 0);
+        assert(me->states[j].movetype == MOVE ||
+               me->states[j].movetype == SOLVE);
+    }
+
+    s = me->states[j].state;
+    while (j < i) {
+        game_state *next;
+
+        j++;
+        next = me->ourgame->execute_move(s, me->states[j].movestr);
+        if (s != me->states[j-1].state)
+            me->ourgame->free_game(s);
+        if (!next || next == s)
+            return NULL;
+        if (me->undo_checkpoint <= 0 || j % me->undo_checkpoint == 0)
+            me->states[j].state = next;
+        s = next;
+    }
+
+    me->states[i].state = s;
+    return s;
+}
+
+/*
+ * Discard every game_state in the undo chain that midend_state can
+ * rebuild and that isn't a checkpoint or adjacent to the current
+ * position.
+ */
+static void midend_trim_states(midend *me)
+{
+    int i;
+
+    if (me->undo_checkpoint <= 0)
+        return;
+
+    for (i = 1; i < me->nstates; i++) {
+        if (!me->states[i].state)
+            continue;
+        if (me->states[i].movetype != MOVE &&
+            me->states[i].movetype != SOLVE)
+            continue;
+        if (i % me->undo_checkpoint == 0)
+            continue;
+        if (i >= me->statepos - 2 && i <= me->statepos)
+            continue;
+        me->ourgame->free_game(me->states[i].state);
+        me->states[i].state = NULL;
+    }
+}
+
+void midend_reseed(midend *me, const void *seed, int len)
+{
+    random_free(me->random);
+    me->random = random_new(seed, len);
+}
+
+void midend_set_undo_checkpoint(midend *me, int interval)
+{
+    int i;
+
+    me->undo_checkpoint = interval > 0 ? interval : 0;
+
+    if (me->undo_checkpoint == 0) {
+        /* Put back every state we'd previously thrown away. */
+        for (i = 0; i < me->nstates; i++)
+            midend_state(me, i);
+    } else {
+        midend_trim_states(me);
+    }
+}
+
+void midend_set_lazy_replay(midend *me, bool lazy)
+{
+    me->lazy_replay = lazy;
+}
+
 static void midend_purge_states(midend *me)
 {
     while (me->nstates > me->statepos) {
-        me->ourgame->free_game(me->states[--me->nstates].state);
+        me->nstates--;
+        if (me->states[me->nstates].state)
+            me->ourgame->free_game(me->states[me->nstates].state);
         if (me->states[me->nstates].movestr)
             sfree(me->states[me->nstates].movestr);
     }
@@ -244,7 +378,8 @@ static void midend_free_game(midend *me)
 {
     while (me->nstates > 0) {
         me->nstates--;
-	me->ourgame->free_game(me->states[me->nstates].state);
+        if (me->states[me->nstates].state)
+            me->ourgame->free_game(me->states[me->nstates].state);
 	sfree(me->states[me->nstates].movestr);
     }
 
@@ -365,7 +500,7 @@ void midend_size(midend *me, int *x, int *y, bool user_size,
     if (me->drawstate && me->tilesize > 0) {
         me->ourgame->free_drawstate(me->drawing, me->drawstate);
         me->drawstate = me->ourgame->new_drawstate(me->drawing,
-                                                   me->states[0].state);
+                                                   midend_state(me, 0));
         me->first_draw = true;
     }
 
@@ -458,7 +593,7 @@ static void assert_printable_ascii(char const *s)
 static void midend_set_timer(midend *me)
 {
     me->timing = (me->ourgame->is_timed &&
-		  me->ourgame->timing_state(me->states[me->statepos-1].state,
+		  me->ourgame->timing_state(midend_state(me, me->statepos-1),
 					    me->ui));
     if (me->timing || me->flash_time || me->anim_time)
 	activate_timer(me->frontend);
@@ -471,7 +606,7 @@ void midend_force_redraw(midend *me)
     if (me->drawstate)
         me->ourgame->free_drawstate(me->drawing, me->drawstate);
     me->drawstate = me->ourgame->new_drawstate(me->drawing,
-					       me->states[0].state);
+					       midend_state(me, 0));
     me->first_draw = true;
     midend_size_new_drawstate(me);
     midend_redraw(me);
@@ -492,7 +627,12 @@ static void newgame_serialise_write(void *ctx, const void *buf, int len)
     ser->len = new_len;
 }
 
-void midend_new_game(midend *me)
+/*
+ * Start a new game. If pooldesc is non-NULL, it's a game description
+ * (with optional aux_info) taken from a puzzle pool for the current
+ * parameters, and we take ownership of both strings.
+ */
+static void midend_new_game_int(midend *me, char *pooldesc, char *poolaux)
 {
     me->newgame_undo.len = 0;
     if (me->newgame_can_store_undo) {
@@ -511,7 +651,8 @@ void midend_new_game(midend *me)
          * worse, valid but wrong.
          */
         midend_purge_states(me);
-        midend_serialise(me, newgame_serialise_write, &me->newgame_undo);
+        midend_serialise_binary(me, newgame_serialise_write,
+                                &me->newgame_undo);
     }
 
     midend_stop_anim(me);
@@ -521,6 +662,19 @@ void midend_new_game(midend *me)
 
     if (me->genmode == GOT_DESC) {
 	me->genmode = GOT_NOTHING;
+    } else if (pooldesc) {
+	if (me->curparams)
+	    me->ourgame->free_params(me->curparams);
+	me->curparams = me->ourgame->dup_params(me->params);
+
+	sfree(me->desc);
+	sfree(me->privdesc);
+	sfree(me->seedstr);
+        sfree(me->aux_info);
+	me->desc = pooldesc;
+	me->privdesc = NULL;
+	me->seedstr = NULL;
+	me->aux_info = poolaux;
     } else {
         random_state *rs;
 
@@ -534,13 +688,20 @@ void midend_new_game(midend *me)
              * I'll avoid putting a leading zero on the number,
              * just in case it confuses anybody who thinks it's
              * processed as an integer rather than a string.
+             *
+             * If we've been asked to, prefix the number so that it
+             * selects the faster random number generator.
              */
-            char newseed[16];
-            int i;
-            newseed[15] = '\0';
-            newseed[0] = '1' + (char)random_upto(me->random, 9);
+            char newseed[16 + sizeof(RANDOM_FAST_SEED_PREFIX)];
+            int i, off = 0;
+            if (me->fast_random_seeds) {
+                strcpy(newseed, RANDOM_FAST_SEED_PREFIX);
+                off = strlen(newseed);
+            }
+            newseed[off + 15] = '\0';
+            newseed[off] = '1' + (char)random_upto(me->random, 9);
             for (i = 1; i < 15; i++)
-                newseed[i] = '0' + (char)random_upto(me->random, 10);
+                newseed[off + i] = '0' + (char)random_upto(me->random, 10);
             sfree(me->seedstr);
             me->seedstr = dupstr(newseed);
 
@@ -554,7 +715,7 @@ void midend_new_game(midend *me)
         sfree(me->aux_info);
 	me->aux_info = NULL;
 
-        rs = random_new(me->seedstr, strlen(me->seedstr));
+        rs = random_new_from_seed(me->seedstr);
 	/*
 	 * If this midend has been instantiated without providing a
 	 * drawing API, it is non-interactive. This means that it's
@@ -612,7 +773,7 @@ void midend_new_game(midend *me)
     me->nstates++;
     me->statepos = 1;
     me->drawstate = me->ourgame->new_drawstate(me->drawing,
-					       me->states[0].state);
+					       midend_state(me, 0));
     me->first_draw = true;
     midend_size_new_drawstate(me);
     me->elapsed = 0.0F;
@@ -620,7 +781,7 @@ void midend_new_game(midend *me)
     me->anim_pos = me->anim_time = 0.0F;
     if (me->ui)
         me->ourgame->free_ui(me->ui);
-    me->ui = me->ourgame->new_ui(me->states[0].state);
+    me->ui = me->ourgame->new_ui(midend_state(me, 0));
     midend_set_timer(me);
     me->pressed_mouse_button = 0;
 
@@ -630,6 +791,75 @@ void midend_new_game(midend *me)
     me->newgame_can_store_undo = true;
 }
 
+void midend_new_game(midend *me)
+{
+    midend_new_game_int(me, NULL, NULL);
+}
+
+/*
+ * Check that an aux_info string from a pool file really does solve
+ * its game, since midend_new_game_int() asserts that it does.
+ */
+static bool pool_aux_works(midend *me, const char *desc, const char *aux)
+{
+    game_state *state, *s;
+    const char *msg = NULL;
+    char *movestr;
+
+    if (!me->ourgame->can_solve)
+        return true;                   /* it'll never be used */
+
+    state = me->ourgame->new_game(me, me->params, desc);
+    movestr = me->ourgame->solve(state, state, aux, &msg);
+    s = NULL;
+    if (movestr && !msg)
+        s = me->ourgame->execute_move(state, movestr);
+    if (s)
+        me->ourgame->free_game(s);
+    sfree(movestr);
+    me->ourgame->free_game(state);
+    return s != NULL;
+}
+
+bool midend_new_game_from_pool(midend *me, puzzle_pool *pool)
+{
+    char *key, *desc = NULL, *aux = NULL;
+    bool got;
+
+    /*
+     * A game id or seed given by the user takes precedence.
+     */
+    if (me->genmode != GOT_NOTHING) {
+        midend_new_game(me);
+        return false;
+    }
+
+    /*
+     * The pool file may be older than this build of the puzzle, so
+     * don't trust it: discard anything that doesn't validate. An
+     * aux_info that doesn't solve the game is dropped, leaving the
+     * game to be solved the hard way if the player asks.
+     */
+    key = pool_key(me->ourgame, me->params);
+    while (pool_take(pool, key, &desc, &aux)) {
+        if (!me->ourgame->validate_desc(me->params, desc)) {
+            if (aux && !pool_aux_works(me, desc, aux)) {
+                sfree(aux);
+                aux = NULL;
+            }
+            break;
+        }
+        sfree(desc);
+        sfree(aux);
+        desc = aux = NULL;
+    }
+    sfree(key);
+
+    got = (desc != NULL);
+    midend_new_game_int(me, desc, aux);
+    return got;
+}
+
 bool midend_can_undo(midend *me)
 {
     return (me->statepos > 1 || me->newgame_undo.len);
@@ -718,12 +948,19 @@ static bool midend_undo(midend *me)
     const char *deserialise_error;
 
     if (me->statepos > 1) {
+        /*
+         * If the previous position can't be rebuilt, there's nowhere
+         * to undo to.
+         */
+        if (!midend_state(me, me->statepos-2))
+            return false;
         if (me->ui)
             me->ourgame->changed_state(me->ui,
-                                       me->states[me->statepos-1].state,
-                                       me->states[me->statepos-2].state);
+                                       midend_state(me, me->statepos-1),
+                                       midend_state(me, me->statepos-2));
 	me->statepos--;
         me->dir = -1;
+        midend_trim_states(me);
         return true;
     } else if (me->newgame_undo.len) {
 	struct newgame_undo_deserialise_read_ctx rctx;
@@ -737,7 +974,7 @@ static bool midend_undo(midend *me)
          */
         serbuf.buf = NULL;
         serbuf.len = serbuf.size = 0;
-        midend_serialise(me, newgame_serialise_write, &serbuf);
+        midend_serialise_binary(me, newgame_serialise_write, &serbuf);
 
 	rctx.ser = &me->newgame_undo;
 	rctx.len = me->newgame_undo.len; /* copy for reentrancy safety */
@@ -745,7 +982,7 @@ static bool midend_undo(midend *me)
         cctx.refused = false;
         deserialise_error = midend_deserialise_internal(
             me, newgame_undo_deserialise_read, &rctx,
-            newgame_undo_deserialise_check, &cctx);
+            newgame_undo_deserialise_check, &cctx, true);
         if (cctx.refused) {
             /*
              * Our post-deserialisation check shows that we can't use
@@ -791,12 +1028,21 @@ static bool midend_redo(midend *me)
     const char *deserialise_error;
 
     if (me->statepos < me->nstates) {
+        /*
+         * If the next position can't be rebuilt, none of the redo
+         * chain after it can be reached either, so throw it away.
+         */
+        if (!midend_state(me, me->statepos)) {
+            midend_purge_states(me);
+            return false;
+        }
         if (me->ui)
             me->ourgame->changed_state(me->ui,
-                                       me->states[me->statepos-1].state,
-                                       me->states[me->statepos].state);
+                                       midend_state(me, me->statepos-1),
+                                       midend_state(me, me->statepos));
 	me->statepos++;
         me->dir = +1;
+        midend_trim_states(me);
         return true;
     } else if (me->newgame_redo.len) {
 	struct newgame_undo_deserialise_read_ctx rctx;
@@ -810,7 +1056,7 @@ static bool midend_redo(midend *me)
          */
         serbuf.buf = NULL;
         serbuf.len = serbuf.size = 0;
-        midend_serialise(me, newgame_serialise_write, &serbuf);
+        midend_serialise_binary(me, newgame_serialise_write, &serbuf);
 
 	rctx.ser = &me->newgame_redo;
 	rctx.len = me->newgame_redo.len; /* copy for reentrancy safety */
@@ -818,7 +1064,7 @@ static bool midend_redo(midend *me)
         cctx.refused = false;
         deserialise_error = midend_deserialise_internal(
             me, newgame_undo_deserialise_read, &rctx,
-            newgame_undo_deserialise_check, &cctx);
+            newgame_undo_deserialise_check, &cctx, true);
         if (cctx.refused) {
             /*
              * Our post-deserialisation check shows that we can't use
@@ -873,8 +1119,8 @@ static void midend_finish_move(midend *me)
          (me->dir < 0 && me->statepos < me->nstates &&
           !special(me->states[me->statepos].movetype)))) {
 	flashtime = me->ourgame->flash_length(me->oldstate ? me->oldstate :
-					      me->states[me->statepos-2].state,
-					      me->states[me->statepos-1].state,
+					      midend_state(me, me->statepos-2),
+					      midend_state(me, me->statepos-1),
 					      me->oldstate ? me->dir : +1,
 					      me->ui);
 	if (flashtime > 0) {
@@ -929,8 +1175,9 @@ void midend_restart_game(midend *me)
     me->statepos = ++me->nstates;
     if (me->ui)
         me->ourgame->changed_state(me->ui,
-                                   me->states[me->statepos-2].state,
-                                   me->states[me->statepos-1].state);
+                                   midend_state(me, me->statepos-2),
+                                   midend_state(me, me->statepos-1));
+    midend_trim_states(me);
     me->flash_pos = me->flash_time = 0.0F;
     midend_finish_move(me);
     midend_redraw(me);
@@ -941,7 +1188,7 @@ static bool midend_really_process_key(midend *me, int x, int y, int button,
                                       bool *handled)
 {
     game_state *oldstate =
-        me->ourgame->dup_game(me->states[me->statepos - 1].state);
+        me->ourgame->dup_game(midend_state(me, me->statepos - 1));
     int type = MOVE;
     bool gottype = false, ret = true;
     float anim_time;
@@ -950,7 +1197,7 @@ static bool midend_really_process_key(midend *me, int x, int y, int button,
 
     if (!IS_UI_FAKE_KEY(button)) {
         movestr = me->ourgame->interpret_move(
-            me->states[me->statepos-1].state,
+            midend_state(me, me->statepos-1),
             me->ui, me->drawstate, x, y, button);
     }
 
@@ -992,15 +1239,15 @@ static bool midend_really_process_key(midend *me, int x, int y, int button,
     } else {
         *handled = true;
 	if (movestr == UI_UPDATE)
-	    s = me->states[me->statepos-1].state;
+	    s = midend_state(me, me->statepos-1);
 	else {
 	    assert_printable_ascii(movestr);
-	    s = me->ourgame->execute_move(me->states[me->statepos-1].state,
+	    s = me->ourgame->execute_move(midend_state(me, me->statepos-1),
 					  movestr);
 	    assert(s != NULL);
 	}
 
-        if (s == me->states[me->statepos-1].state) {
+        if (s == midend_state(me, me->statepos-1)) {
             /*
              * make_move() is allowed to return its input state to
              * indicate that although no move has been made, the UI
@@ -1021,8 +1268,9 @@ static bool midend_really_process_key(midend *me, int x, int y, int button,
             me->dir = +1;
 	    if (me->ui)
 		me->ourgame->changed_state(me->ui,
-					   me->states[me->statepos-2].state,
-					   me->states[me->statepos-1].state);
+					   midend_state(me, me->statepos-2),
+					   midend_state(me, me->statepos-1));
+            midend_trim_states(me);
         } else {
             goto done;
         }
@@ -1039,7 +1287,7 @@ static bool midend_really_process_key(midend *me, int x, int y, int button,
         anim_time = 0;
     } else {
         anim_time = me->ourgame->anim_length(oldstate,
-                                             me->states[me->statepos-1].state,
+                                             midend_state(me, me->statepos-1),
                                              me->dir, me->ui);
     }
 
@@ -1245,7 +1493,7 @@ const char *midend_current_key_label(midend *me, int button)
     assert(IS_CURSOR_SELECT(button));
     if (!me->ourgame->current_key_label) return "";
     return me->ourgame->current_key_label(
-        me->ui, me->states[me->statepos-1].state, button);
+        me->ui, midend_state(me, me->statepos-1), button);
 }
 
 void midend_redraw(midend *me)
@@ -1275,11 +1523,11 @@ void midend_redraw(midend *me)
             me->anim_pos < me->anim_time) {
             assert(me->dir != 0);
             me->ourgame->redraw(me->drawing, me->drawstate, me->oldstate,
-				me->states[me->statepos-1].state, me->dir,
+				midend_state(me, me->statepos-1), me->dir,
 				me->ui, me->anim_pos, me->flash_pos);
         } else {
             me->ourgame->redraw(me->drawing, me->drawstate, NULL,
-				me->states[me->statepos-1].state, +1 /*shrug*/,
+				midend_state(me, me->statepos-1), +1 /*shrug*/,
 				me->ui, 0.0, me->flash_pos);
         }
 
@@ -1618,7 +1866,7 @@ bool midend_get_cursor_location(midend *me,
     if(me->ourgame->get_cursor_location)
         me->ourgame->get_cursor_location(me->ui,
                                          me->drawstate,
-                                         me->states[me->statepos-1].state,
+                                         midend_state(me, me->statepos-1),
                                          me->params,
                                          &x, &y, &w, &h);
 
@@ -1974,7 +2222,7 @@ char *midend_text_format(midend *me)
 {
     if (me->ourgame->can_format_as_text_ever && me->statepos > 0 &&
 	me->ourgame->can_format_as_text_now(me->params))
-	return me->ourgame->text_format(me->states[me->statepos-1].state);
+	return me->ourgame->text_format(midend_state(me, me->statepos-1));
     else
 	return NULL;
 }
@@ -1992,8 +2240,8 @@ const char *midend_solve(midend *me)
 	return "No game set up to solve";   /* _shouldn't_ happen! */
 
     msg = NULL;
-    movestr = me->ourgame->solve(me->states[0].state,
-				 me->states[me->statepos-1].state,
+    movestr = me->ourgame->solve(midend_state(me, 0),
+				 midend_state(me, me->statepos-1),
 				 me->aux_info, &msg);
     assert(movestr != UI_UPDATE);
     if (!movestr) {
@@ -2002,7 +2250,7 @@ const char *midend_solve(midend *me)
 	return msg;
     }
     assert_printable_ascii(movestr);
-    s = me->ourgame->execute_move(me->states[me->statepos-1].state, movestr);
+    s = me->ourgame->execute_move(midend_state(me, me->statepos-1), movestr);
     assert(s);
 
     /*
@@ -2017,14 +2265,15 @@ const char *midend_solve(midend *me)
     me->statepos = ++me->nstates;
     if (me->ui)
         me->ourgame->changed_state(me->ui,
-                                   me->states[me->statepos-2].state,
-                                   me->states[me->statepos-1].state);
+                                   midend_state(me, me->statepos-2),
+                                   midend_state(me, me->statepos-1));
+    midend_trim_states(me);
     me->dir = +1;
     if (me->ourgame->flags & SOLVE_ANIMATES) {
-	me->oldstate = me->ourgame->dup_game(me->states[me->statepos-2].state);
+	me->oldstate = me->ourgame->dup_game(midend_state(me, me->statepos-2));
         me->anim_time =
-	    me->ourgame->anim_length(me->states[me->statepos-2].state,
-				     me->states[me->statepos-1].state,
+	    me->ourgame->anim_length(midend_state(me, me->statepos-2),
+				     midend_state(me, me->statepos-1),
 				     +1, me->ui);
         me->anim_pos = 0.0;
     } else {
@@ -2051,7 +2300,7 @@ int midend_status(midend *me)
     if (me->statepos == 0)
         return +1;
 
-    return me->ourgame->status(me->states[me->statepos-1].state);
+    return me->ourgame->status(midend_state(me, me->statepos-1));
 }
 
 char *midend_rewrite_statusbar(midend *me, const char *text)
@@ -2087,47 +2336,110 @@ char *midend_rewrite_statusbar(midend *me, const char *text)
 #define SERIALISE_MAGIC "Simon Tatham's Portable Puzzle Collection"
 #define SERIALISE_VERSION "1"
 
-void midend_serialise(midend *me,
-                      void (*write)(void *ctx, const void *buf, int len),
-                      void *wctx)
+/*
+ * The binary save format starts with this magic number instead of a
+ * SAVEFILE line. Its first byte has the top bit set and can never
+ * begin a text save file, and the CR, LF and ^Z after it detect the
+ * usual ways of mangling a binary file in transit.
+ */
+#define SERIALISE_BINARY_MAGIC "\211PUZ\r\n\032\n"
+#define SERIALISE_BINARY_MAGIC_LEN 8
+
+/*
+ * The keys which may appear in a save file. In the text format each
+ * line is labelled with the key's name; in the binary format, with
+ * its index in this list. So new keys must only ever be added at the
+ * end.
+ */
+#define SERIALISE_KEYS(X) \
+    X(SAVEFILE) X(VERSION) X(GAME) X(PARAMS) X(CPARAMS) X(HEXSEED) \
+    X(SEED) X(DESC) X(PRIVDESC) X(AUXINFO) X(UI) X(TIME) X(NSTATES) \
+    X(STATEPOS) X(MOVE) X(SOLVE) X(RESTART) X(CHECKPNT)
+#define SERIALISE_KEY_ENUM(k) SER_##k,
+#define SERIALISE_KEY_NAME(k) #k,
+enum { SERIALISE_KEYS(SERIALISE_KEY_ENUM) SER_NKEYS };
+static const char *const serialise_keys[] = {
+    SERIALISE_KEYS(SERIALISE_KEY_NAME)
+};
+
+struct serialise_writer {
+    void (*write)(void *ctx, const void *buf, int len);
+    void *wctx;
+    bool binary;
+};
+
+static void serialise_varint(struct serialise_writer *w, unsigned val)
+{
+    unsigned char buf[5];
+    int len = 0;
+
+    while (val >= 0x80) {
+        buf[len++] = (val & 0x7F) | 0x80;
+        val >>= 7;
+    }
+    buf[len++] = val;
+    w->write(w->wctx, buf, len);
+}
+
+static void serialise_record(struct serialise_writer *w, int key,
+                             const char *str)
+{
+    int len = strlen(str);
+
+    if (w->binary) {
+        /*
+         * A record in the binary format is the key's index and the
+         * length of its value, each as a little-endian base-128
+         * varint, followed by the value.
+         */
+        serialise_varint(w, key);
+        serialise_varint(w, len);
+        w->write(w->wctx, str, len);
+    } else {
+        /*
+         * Each line of the text save file contains three components.
+         * First exactly 8 characters of header word indicating what
+         * type of data is contained on the line; then a colon
+         * followed by a decimal integer giving the length of the main
+         * string on the line; then a colon followed by the string
+         * itself (exactly as many bytes as previously specified, no
+         * matter what they contain). Then a newline (of reasonably
+         * flexible form).
+         */
+        char hbuf[80];
+        char lbuf[9];
+        copy_left_justified(lbuf, sizeof(lbuf), serialise_keys[key]);
+        sprintf(hbuf, "%s:%d:", lbuf, len);
+        assert_printable_ascii(hbuf);
+        w->write(w->wctx, hbuf, strlen(hbuf));
+        assert_printable_ascii(str);
+        w->write(w->wctx, str, len);
+        w->write(w->wctx, "\n", 1);
+    }
+}
+
+static void midend_serialise_internal(midend *me, struct serialise_writer *w)
 {
     int i;
 
-    /*
-     * Each line of the save file contains three components. First
-     * exactly 8 characters of header word indicating what type of
-     * data is contained on the line; then a colon followed by a
-     * decimal integer giving the length of the main string on the
-     * line; then a colon followed by the string itself (exactly as
-     * many bytes as previously specified, no matter what they
-     * contain). Then a newline (of reasonably flexible form).
-     */
-#define wr(h,s) do { \
-    char hbuf[80]; \
-    const char *str = (s); \
-    char lbuf[9];                               \
-    copy_left_justified(lbuf, sizeof(lbuf), h); \
-    sprintf(hbuf, "%s:%d:", lbuf, (int)strlen(str)); \
-    assert_printable_ascii(hbuf); \
-    write(wctx, hbuf, strlen(hbuf)); \
-    assert_printable_ascii(str); \
-    write(wctx, str, strlen(str)); \
-    write(wctx, "\n", 1); \
-} while (0)
+#define wr(h,s) serialise_record(w, SER_##h, (s))
 
     /*
      * Magic string identifying the file, and version number of the
      * file format.
      */
-    wr("SAVEFILE", SERIALISE_MAGIC);
-    wr("VERSION", SERIALISE_VERSION);
+    if (w->binary)
+        w->write(w->wctx, SERIALISE_BINARY_MAGIC, SERIALISE_BINARY_MAGIC_LEN);
+    else
+        wr(SAVEFILE, SERIALISE_MAGIC);
+    wr(VERSION, SERIALISE_VERSION);
 
     /*
      * The game name. (Copied locally to avoid const annoyance.)
      */
     {
         char *s = dupstr(me->ourgame->name);
-        wr("GAME", s);
+        wr(GAME, s);
         sfree(s);
     }
 
@@ -2136,7 +2448,7 @@ void midend_serialise(midend *me,
      */
     if (me->params) {
         char *s = encode_params(me, me->params, true);
-        wr("PARAMS", s);
+        wr(PARAMS, s);
         sfree(s);
     }
 
@@ -2145,7 +2457,7 @@ void midend_serialise(midend *me,
      */
     if (me->curparams) {
         char *s = encode_params(me, me->curparams, true);
-        wr("CPARAMS", s);
+        wr(CPARAMS, s);
         sfree(s);
     }
 
@@ -2157,26 +2469,26 @@ void midend_serialise(midend *me,
          * Random seeds are not necessarily printable ASCII.
          * Hex-encode the seed if necessary.  Printable ASCII seeds
          * are emitted unencoded for compatibility with older
-         * versions.
+         * versions. The binary format can hold any seed as it is.
          */
         int i;
 
         for (i = 0; me->seedstr[i]; i++)
             if (me->seedstr[i] < 32 || me->seedstr[i] >= 127)
                 break;
-        if (me->seedstr[i]) {
+        if (me->seedstr[i] && !w->binary) {
             char *hexseed = bin2hex((unsigned char *)me->seedstr,
                                     strlen(me->seedstr));
 
-            wr("HEXSEED", hexseed);
+            wr(HEXSEED, hexseed);
             sfree(hexseed);
         } else
-            wr("SEED", me->seedstr);
+            wr(SEED, me->seedstr);
     }
     if (me->desc)
-        wr("DESC", me->desc);
+        wr(DESC, me->desc);
     if (me->privdesc)
-        wr("PRIVDESC", me->privdesc);
+        wr(PRIVDESC, me->privdesc);
 
     /*
      * The game's aux_info. We obfuscate this to prevent spoilers
@@ -2195,7 +2507,7 @@ void midend_serialise(midend *me,
         obfuscate_bitmap(s1, len*8, false);
         s2 = bin2hex(s1, len);
 
-        wr("AUXINFO", s2);
+        wr(AUXINFO, s2);
 
         sfree(s2);
         sfree(s1);
@@ -2207,7 +2519,7 @@ void midend_serialise(midend *me,
     if (me->ui) {
         char *s = me->ourgame->encode_ui(me->ui);
         if (s) {
-            wr("UI", s);
+            wr(UI, s);
             sfree(s);
         }
     }
@@ -2218,7 +2530,7 @@ void midend_serialise(midend *me,
     if (me->ourgame->is_timed) {
         char buf[80];
         sprintf(buf, "%g", me->elapsed);
-        wr("TIME", buf);
+        wr(TIME, buf);
     }
 
     /*
@@ -2227,10 +2539,25 @@ void midend_serialise(midend *me,
     {
         char buf[80];
         sprintf(buf, "%d", me->nstates);
-        wr("NSTATES", buf);
+        wr(NSTATES, buf);
         assert(me->statepos >= 1 && me->statepos <= me->nstates);
         sprintf(buf, "%d", me->statepos);
-        wr("STATEPOS", buf);
+        wr(STATEPOS, buf);
+    }
+
+    /*
+     * In the binary format, if the back end can encode a game state,
+     * include a copy of the current one, so that loading the file
+     * needn't replay every move to reconstruct it. This must come
+     * before the moves, since the loader stops reading once it has
+     * all of those.
+     */
+    if (w->binary && me->ourgame->encode_state &&
+        (me->states[me->statepos-1].movetype == MOVE ||
+         me->states[me->statepos-1].movetype == SOLVE)) {
+        char *s = me->ourgame->encode_state(midend_state(me, me->statepos-1));
+        wr(CHECKPNT, s);
+        sfree(s);
     }
 
     /*
@@ -2243,13 +2570,13 @@ void midend_serialise(midend *me,
         assert(me->states[i].movetype != NEWGAME);   /* only state 0 */
         switch (me->states[i].movetype) {
           case MOVE:
-            wr("MOVE", me->states[i].movestr);
+            wr(MOVE, me->states[i].movestr);
             break;
           case SOLVE:
-            wr("SOLVE", me->states[i].movestr);
+            wr(SOLVE, me->states[i].movestr);
             break;
           case RESTART:
-            wr("RESTART", me->states[i].movestr);
+            wr(RESTART, me->states[i].movestr);
             break;
         }
     }
@@ -2257,22 +2584,172 @@ void midend_serialise(midend *me,
 #undef wr
 }
 
+void midend_serialise(midend *me,
+                      void (*write)(void *ctx, const void *buf, int len),
+                      void *wctx)
+{
+    struct serialise_writer w;
+
+    w.write = write;
+    w.wctx = wctx;
+    w.binary = false;
+    midend_serialise_internal(me, &w);
+}
+
+void midend_serialise_binary(midend *me,
+                             void (*write)(void *ctx, const void *buf,
+                                           int len),
+                             void *wctx)
+{
+    struct serialise_writer w;
+
+    w.write = write;
+    w.wctx = wctx;
+    w.binary = true;
+    midend_serialise_internal(me, &w);
+}
+
+/*
+ * Read one key/value pair from a serialised game, in either format.
+ * The key is written into 'key' as a string (an unrecognised key in
+ * a binary file comes out as the empty string), and the value into a
+ * newly allocated string in '*val'.
+ *
+ * The format is detected from the first few bytes, and the binary
+ * magic number is returned as if it had been the SAVEFILE line of a
+ * text file, so that callers need only handle the latter.
+ */
+struct deserialise_reader {
+    bool (*read)(void *ctx, void *buf, int len);
+    void *rctx;
+    bool first, binary;
+};
+
+enum { READ_OK, READ_EOF, READ_BAD };
+
+static bool deserialise_varint(struct deserialise_reader *r, int *val)
+{
+    unsigned char c;
+    unsigned v = 0;
+    int shift = 0;
+
+    do {
+        if (!r->read(r->rctx, &c, 1))
+            return false;
+        if (shift > 28 || (shift == 28 && (c & 0x78)))
+            return false;              /* too big for an int */
+        v |= (unsigned)(c & 0x7F) << shift;
+        shift += 7;
+    } while (c & 0x80);
+
+    *val = v;
+    return true;
+}
+
+static int deserialise_record(struct deserialise_reader *r, char key[9],
+                              char **val)
+{
+    int len;
+
+    *val = NULL;
+
+    if (r->binary) {
+        int k;
+
+        if (!deserialise_varint(r, &k))
+            return READ_EOF;
+        if (!deserialise_varint(r, &len) || len == INT_MAX)
+            return READ_BAD;
+        if (k >= 0 && k < SER_NKEYS && k != SER_SAVEFILE)
+            strcpy(key, serialise_keys[k]);
+        else
+            key[0] = '\0';
+    } else {
+        char c;
+
+        do {
+            if (!r->read(r->rctx, key, 1)) {
+                /* unexpected EOF */
+                return READ_EOF;
+            }
+        } while (key[0] == '\r' || key[0] == '\n');
+
+        if (r->first && key[0] == SERIALISE_BINARY_MAGIC[0]) {
+            char magic[SERIALISE_BINARY_MAGIC_LEN];
+
+            r->first = false;
+            if (!r->read(r->rctx, magic + 1, SERIALISE_BINARY_MAGIC_LEN - 1))
+                return READ_EOF;
+            magic[0] = key[0];
+            if (memcmp(magic, SERIALISE_BINARY_MAGIC,
+                       SERIALISE_BINARY_MAGIC_LEN))
+                return READ_BAD;
+            r->binary = true;
+            strcpy(key, serialise_keys[SER_SAVEFILE]);
+            *val = dupstr(SERIALISE_MAGIC);
+            return READ_OK;
+        }
+        r->first = false;
+
+        if (!r->read(r->rctx, key+1, 8)) {
+            /* unexpected EOF */
+            return READ_EOF;
+        }
+
+        if (key[8] != ':')
+            return READ_BAD;
+        len = strcspn(key, ": ");
+        assert(len <= 8);
+        key[len] = '\0';
+
+        len = 0;
+        while (1) {
+            if (!r->read(r->rctx, &c, 1)) {
+                /* unexpected EOF */
+                return READ_EOF;
+            }
+
+            if (c == ':') {
+                break;
+            } else if (c >= '0' && c <= '9' && len < (INT_MAX - 10) / 10) {
+                len = (len * 10) + (c - '0');
+            } else {
+                return READ_BAD;
+            }
+        }
+    }
+
+    *val = snewn(len+1, char);
+    if (!r->read(r->rctx, *val, len)) {
+        /* unexpected EOF */
+        return READ_EOF;
+    }
+    (*val)[len] = '\0';
+    return READ_OK;
+}
+
 /*
  * Internal version of midend_deserialise, taking an extra check
  * function to be called just before beginning to install things in
  * the midend.
  *
+ * 'trusted' is set when the data was written by this mid-end itself
+ * (the New Game undo and redo buffers), or by a caller of
+ * midend_deserialise_trusted() that vouches for it, and allows a
+ * state checkpoint in it to be used instead of replaying the moves.
+ *
  * Like midend_deserialise proper, this function returns NULL on
  * success, or an error message.
  */
 static const char *midend_deserialise_internal(
     midend *me, bool (*read)(void *ctx, void *buf, int len), void *rctx,
     const char *(*check)(void *ctx, midend *, const struct deserialise_data *),
-    void *cctx)
+    void *cctx, bool trusted)
 {
     struct deserialise_data data;
-    int gotstates = 0;
-    bool started = false;
+    struct deserialise_reader reader;
+    int gotstates = 0, replay_from, replay_to;
+    bool started = false, checkpointed = false;
     int i;
 
     char *val = NULL;
@@ -2287,6 +2764,12 @@ static const char *midend_deserialise_internal(
     data.states = NULL;
     data.nstates = 0;
     data.statepos = -1;
+    data.checkpoint = NULL;
+
+    reader.read = read;
+    reader.rctx = rctx;
+    reader.first = true;
+    reader.binary = false;
 
     /*
      * Loop round and round reading one key/value pair at a time
@@ -2295,55 +2778,18 @@ static const char *midend_deserialise_internal(
      */
     while (data.nstates <= 0 || data.statepos < 0 ||
            gotstates < data.nstates-1) {
-        char key[9], c;
-        int len;
+        char key[9];
 
-        do {
-            if (!read(rctx, key, 1)) {
-                /* unexpected EOF */
-                goto cleanup;
-            }
-        } while (key[0] == '\r' || key[0] == '\n');
-
-        if (!read(rctx, key+1, 8)) {
+        switch (deserialise_record(&reader, key, &val)) {
+          case READ_EOF:
             /* unexpected EOF */
             goto cleanup;
-        }
-
-        if (key[8] != ':') {
+          case READ_BAD:
             if (started)
                 ret = "Data was incorrectly formatted for a saved game file";
-	    goto cleanup;
-        }
-        len = strcspn(key, ": ");
-        assert(len <= 8);
-        key[len] = '\0';
-
-        len = 0;
-        while (1) {
-            if (!read(rctx, &c, 1)) {
-                /* unexpected EOF */
-                goto cleanup;
-            }
-
-            if (c == ':') {
-                break;
-            } else if (c >= '0' && c <= '9' && len < (INT_MAX - 10) / 10) {
-                len = (len * 10) + (c - '0');
-            } else {
-                if (started)
-                    ret = "Data was incorrectly formatted for a"
-                    " saved game file";
-                goto cleanup;
-            }
-        }
-
-        val = snewn(len+1, char);
-        if (!read(rctx, val, len)) {
-            /* unexpected EOF */
             goto cleanup;
         }
-        val[len] = '\0';
+
         /* Validate that all values (apart from SEED) are printable ASCII. */
         if (strcmp(key, "SEED"))
             for (i = 0; val[i]; i++)
@@ -2436,6 +2882,10 @@ static const char *midend_deserialise_internal(
                 }
             } else if (!strcmp(key, "STATEPOS")) {
                 data.statepos = atoi(val);
+            } else if (!strcmp(key, "CHECKPNT")) {
+                sfree(data.checkpoint);
+                data.checkpoint = val;
+                val = NULL;
             } else if (!strcmp(key, "MOVE") ||
                        !strcmp(key, "SOLVE") ||
                        !strcmp(key, "RESTART")) {
@@ -2516,17 +2966,72 @@ static const char *midend_deserialise_internal(
     data.states[0].state = me->ourgame->new_game(
         me, data.cparams, data.privdesc ? data.privdesc : data.desc);
 
+    /*
+     * If the data has a checkpoint of the current state and we can
+     * decode it, we don't replay the moves at all. The states
+     * between the checkpoint and the nearest earlier state we do
+     * have are left empty, for midend_state() to fill in if undo
+     * ever gets that far back.
+     *
+     * We only do this for trusted data. In a save file from
+     * outside, the checkpoint and the move list could disagree, or a
+     * move the checkpoint lets us skip could be invalid, and then
+     * midend_state() would fail later on instead of the load failing
+     * now. So for those we ignore the checkpoint, and replay the
+     * moves as if it weren't there. If a trusted checkpoint won't
+     * decode, we fall back to replaying in the same way.
+     */
+    if (trusted && data.checkpoint && me->ourgame->decode_state &&
+        (data.states[data.statepos-1].movetype == MOVE ||
+         data.states[data.statepos-1].movetype == SOLVE)) {
+        data.states[data.statepos-1].state = me->ourgame->decode_state(
+            data.states[0].state, data.checkpoint);
+        checkpointed = (data.states[data.statepos-1].state != NULL);
+    }
+
+    /*
+     * Otherwise we replay every move, including the redo chain after
+     * the current position, so that an invalid one makes the load
+     * fail. In lazy mode we then throw away each position that
+     * midend_state() can rebuild from the one before it, apart from
+     * the current position, once we've made the next one.
+     *
+     * A trusted load in lazy mode doesn't need to check the moves,
+     * so it only executes the ones after the last restart (or the
+     * start of the game) before the current position, which are
+     * needed to reach it. The rest are left for midend_state().
+     */
+    if (checkpointed) {
+        replay_from = replay_to = data.nstates;
+    } else if (trusted && me->lazy_replay) {
+        replay_to = data.statepos - 1;
+        for (replay_from = replay_to; replay_from > 0; replay_from--)
+            if (data.states[replay_from].movetype != MOVE &&
+                data.states[replay_from].movetype != SOLVE)
+                break;
+    } else {
+        replay_from = 0;
+        replay_to = data.nstates - 1;
+    }
     for (i = 1; i < data.nstates; i++) {
         assert(data.states[i].movetype != NEWGAME);
         switch (data.states[i].movetype) {
           case MOVE:
           case SOLVE:
+            if (i <= replay_from || i > replay_to)
+                break;
             data.states[i].state = me->ourgame->execute_move(
                 data.states[i-1].state, data.states[i].movestr);
             if (data.states[i].state == NULL) {
                 ret = "Save file contained an invalid move";
                 goto cleanup;
             }
+            if (me->lazy_replay && i-1 != data.statepos-1 &&
+                (data.states[i-1].movetype == MOVE ||
+                 data.states[i-1].movetype == SOLVE)) {
+                me->ourgame->free_game(data.states[i-1].state);
+                data.states[i-1].state = NULL;
+            }
             break;
           case RESTART:
             if (me->ourgame->validate_desc(
@@ -2539,6 +3044,13 @@ static const char *midend_deserialise_internal(
             break;
         }
     }
+    i = data.nstates - 1;
+    if (me->lazy_replay && i != data.statepos-1 && data.states[i].state &&
+        (data.states[i].movetype == MOVE ||
+         data.states[i].movetype == SOLVE)) {
+        me->ourgame->free_game(data.states[i].state);
+        data.states[i].state = NULL;
+    }
 
     data.ui = me->ourgame->new_ui(data.states[0].state);
     if (data.uistr)
@@ -2590,6 +3102,7 @@ static const char *midend_deserialise_internal(
         data.states = tmp;
     }
     me->statepos = data.statepos;
+    midend_trim_states(me);
 
     /*
      * Don't save the "new game undo/redo" state.  So "new game" twice or
@@ -2634,7 +3147,7 @@ static const char *midend_deserialise_internal(
         me->ourgame->free_drawstate(me->drawing, me->drawstate);
     me->drawstate =
         me->ourgame->new_drawstate(me->drawing,
-				   me->states[me->statepos-1].state);
+				   midend_state(me, me->statepos-1));
     me->first_draw = true;
     midend_size_new_drawstate(me);
     if (me->game_id_change_notify_function)
@@ -2651,6 +3164,7 @@ static const char *midend_deserialise_internal(
     sfree(data.privdesc);
     sfree(data.auxinfo);
     sfree(data.uistr);
+    sfree(data.checkpoint);
     if (data.params)
         me->ourgame->free_params(data.params);
     if (data.cparams)
@@ -2674,7 +3188,13 @@ static const char *midend_deserialise_internal(
 const char *midend_deserialise(
     midend *me, bool (*read)(void *ctx, void *buf, int len), void *rctx)
 {
-    return midend_deserialise_internal(me, read, rctx, NULL, NULL);
+    return midend_deserialise_internal(me, read, rctx, NULL, NULL, false);
+}
+
+const char *midend_deserialise_trusted(
+    midend *me, bool (*read)(void *ctx, void *buf, int len), void *rctx)
+{
+    return midend_deserialise_internal(me, read, rctx, NULL, NULL, true);
 }
 
 /*
@@ -2688,6 +3208,7 @@ const char *identify_game(char **name,
                           bool (*read)(void *ctx, void *buf, int len),
                           void *rctx)
 {
+    struct deserialise_reader reader;
     int nstates = 0, statepos = -1, gotstates = 0;
     bool started = false;
 
@@ -2697,60 +3218,27 @@ const char *identify_game(char **name,
 
     *name = NULL;
 
+    reader.read = read;
+    reader.rctx = rctx;
+    reader.first = true;
+    reader.binary = false;
+
     /*
      * Loop round and round reading one key/value pair at a time from
      * the serialised stream, until we've found the game name.
      */
     while (nstates <= 0 || statepos < 0 || gotstates < nstates-1) {
-        char key[9], c;
-        int len;
-
-        do {
-            if (!read(rctx, key, 1)) {
-                /* unexpected EOF */
-                goto cleanup;
-            }
-        } while (key[0] == '\r' || key[0] == '\n');
+        char key[9];
 
-        if (!read(rctx, key+1, 8)) {
+        switch (deserialise_record(&reader, key, &val)) {
+          case READ_EOF:
             /* unexpected EOF */
             goto cleanup;
-        }
-
-        if (key[8] != ':') {
+          case READ_BAD:
             if (started)
                 ret = "Data was incorrectly formatted for a saved game file";
-	    goto cleanup;
-        }
-        len = strcspn(key, ": ");
-        assert(len <= 8);
-        key[len] = '\0';
-
-        len = 0;
-        while (1) {
-            if (!read(rctx, &c, 1)) {
-                /* unexpected EOF */
-                goto cleanup;
-            }
-
-            if (c == ':') {
-                break;
-            } else if (c >= '0' && c <= '9' && len < (INT_MAX - 10) / 10) {
-                len = (len * 10) + (c - '0');
-            } else {
-                if (started)
-                    ret = "Data was incorrectly formatted for a"
-                    " saved game file";
-                goto cleanup;
-            }
-        }
-
-        val = snewn(len+1, char);
-        if (!read(rctx, val, len)) {
-            /* unexpected EOF */
             goto cleanup;
         }
-        val[len] = '\0';
 
         if (!started) {
             if (strcmp(key, "SAVEFILE") || strcmp(val, SERIALISE_MAGIC)) {
@@ -2798,12 +3286,12 @@ const char *midend_print_puzzle(midend *me, document *doc, bool with_soln)
 	    return "This game does not support the Solve operation";
 
 	msg = "Solve operation failed";/* game _should_ overwrite on error */
-	movestr = me->ourgame->solve(me->states[0].state,
-				     me->states[me->statepos-1].state,
+	movestr = me->ourgame->solve(midend_state(me, 0),
+				     midend_state(me, me->statepos-1),
 				     me->aux_info, &msg);
 	if (!movestr)
 	    return msg;
-	soln = me->ourgame->execute_move(me->states[me->statepos-1].state,
+	soln = me->ourgame->execute_move(midend_state(me, me->statepos-1),
 					 movestr);
 	assert(soln);
 
@@ -2819,7 +3307,7 @@ const char *midend_print_puzzle(midend *me, document *doc, bool with_soln)
      */
     document_add_puzzle(doc, me->ourgame,
 			me->ourgame->dup_params(me->curparams),
-			me->ourgame->dup_game(me->states[0].state), soln);
+			me->ourgame->dup_game(midend_state(me, 0)), soln);
 
     return NULL;
 }
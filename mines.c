@@ -7,6 +7,10 @@
  *    that is, we've thought about configurability in general!
  */
 
+#if !defined NO_THREADS && !defined _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* for sysconf under -std=c99 */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,8 +22,11 @@
 #else
 #  include <tgmath.h>
 #endif
+#ifndef NO_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
-#include "tree234.h"
 #include "puzzles.h"
 
 enum {
@@ -313,50 +320,79 @@ static int bitcount16(int inword)
 }
 
 /*
- * We use a tree234 to store a large number of small localised
- * sets, each with a mine count. We also keep some of those sets
- * linked together into a to-do list.
+ * We store a large number of small localised sets, each with a mine
+ * count. Each set lives in a bucket for the grid square at the top
+ * left of its bounding rectangle, so the sets which might overlap a
+ * given one can be found by looking in just a few buckets. Within a
+ * bucket, sets are kept in order of mask, so that walking the
+ * buckets in order visits the sets sorted by y, x and then mask.
+ *
+ * Some of the sets are also on a to-do queue. Sets leaving the
+ * queue early (by being removed from the store) aren't taken out of
+ * it there and then: the queue entry just stops matching the set.
  */
 struct set {
     short x, y, mask, mines;
     bool todo;
-    struct set *prev, *next;
+    unsigned stamp;		       /* identifies its to-do queue entry */
+    struct set *bnext;		       /* in bucket, or on free list */
 };
 
-static int setcmp(void *av, void *bv)
-{
-    struct set *a = (struct set *)av;
-    struct set *b = (struct set *)bv;
+struct todoentry {
+    struct set *s;
+    unsigned stamp;
+};
 
-    if (a->y < b->y)
-	return -1;
-    else if (a->y > b->y)
-	return +1;
-    else if (a->x < b->x)
-	return -1;
-    else if (a->x > b->x)
-	return +1;
-    else if (a->mask < b->mask)
-	return -1;
-    else if (a->mask > b->mask)
-	return +1;
-    else
-	return 0;
-}
+#define SET_CHUNK 256
 
 struct setstore {
-    tree234 *sets;
-    struct set *todo_head, *todo_tail;
+    int w, h;
+    struct set **buckets;	       /* w*h of them */
+    int nsets;
+
+    /* Sets are allocated from chunks, and recycled via a free list. */
+    struct set **chunks;
+    int nchunks, chunksize, chunkused;
+    struct set *freelist;
+
+    struct todoentry *todo;
+    int todo_head, todo_tail, todo_size;
+    unsigned stamp;
 };
 
-static struct setstore *ss_new(void)
+static struct setstore *ss_new(int w, int h)
 {
     struct setstore *ss = snew(struct setstore);
-    ss->sets = newtree234(setcmp);
-    ss->todo_head = ss->todo_tail = NULL;
+    int i;
+
+    ss->w = w;
+    ss->h = h;
+    ss->buckets = snewn(w*h, struct set *);
+    for (i = 0; i < w*h; i++)
+	ss->buckets[i] = NULL;
+    ss->nsets = 0;
+    ss->chunks = NULL;
+    ss->nchunks = ss->chunksize = 0;
+    ss->chunkused = SET_CHUNK;
+    ss->freelist = NULL;
+    ss->todo = NULL;
+    ss->todo_head = ss->todo_tail = ss->todo_size = 0;
+    ss->stamp = 0;
     return ss;
 }
 
+static void ss_free(struct setstore *ss)
+{
+    int i;
+
+    for (i = 0; i < ss->nchunks; i++)
+	sfree(ss->chunks[i]);
+    sfree(ss->chunks);
+    sfree(ss->buckets);
+    sfree(ss->todo);
+    sfree(ss);
+}
+
 /*
  * Take two input sets, in the form (x,y,mask). Munge the first by
  * taking either its intersection with the second or its difference
@@ -417,19 +453,29 @@ static void ss_add_todo(struct setstore *ss, struct set *s)
 	   s->x, s->y, s->mask, s->mines);
 #endif
 
-    s->prev = ss->todo_tail;
-    if (s->prev)
-	s->prev->next = s;
-    else
-	ss->todo_head = s;
-    ss->todo_tail = s;
-    s->next = NULL;
+    if (ss->todo_tail >= ss->todo_size) {
+	if (ss->todo_head > ss->todo_size / 2) {
+	    /* Reclaim the space at the front of the queue. */
+	    memmove(ss->todo, ss->todo + ss->todo_head,
+		    (ss->todo_tail - ss->todo_head) * sizeof(*ss->todo));
+	    ss->todo_tail -= ss->todo_head;
+	    ss->todo_head = 0;
+	} else {
+	    ss->todo_size = ss->todo_size * 2 + 64;
+	    ss->todo = sresize(ss->todo, ss->todo_size, struct todoentry);
+	}
+    }
+
     s->todo = true;
+    s->stamp = ++ss->stamp;
+    ss->todo[ss->todo_tail].s = s;
+    ss->todo[ss->todo_tail].stamp = s->stamp;
+    ss->todo_tail++;
 }
 
 static void ss_add(struct setstore *ss, int x, int y, int mask, int mines)
 {
-    struct set *s;
+    struct set *s, **prevp;
 
     assert(mask != 0);
 
@@ -441,65 +487,96 @@ static void ss_add(struct setstore *ss, int x, int y, int mask, int mines)
 	mask >>= 1, x++;
     while (!(mask & (1|2|4)))
 	mask >>= 3, y++;
+    assert(0 <= x && x < ss->w && 0 <= y && y < ss->h);
+
+    /*
+     * Find where the set belongs in its bucket. If it's already
+     * there, we have nothing to do.
+     */
+    for (prevp = &ss->buckets[y * ss->w + x];
+	 *prevp && (*prevp)->mask < mask; prevp = &(*prevp)->bnext);
+    if (*prevp && (*prevp)->mask == mask)
+	return;
 
     /*
-     * Create a set structure and add it to the tree.
+     * Make a set structure and link it in.
      */
-    s = snew(struct set);
-    assert(SHRT_MIN <= x && x <= SHRT_MAX);
+    if (ss->freelist) {
+	s = ss->freelist;
+	ss->freelist = s->bnext;
+    } else {
+	if (ss->chunkused == SET_CHUNK) {
+	    if (ss->nchunks >= ss->chunksize) {
+		ss->chunksize = ss->nchunks * 2 + 16;
+		ss->chunks = sresize(ss->chunks, ss->chunksize,
+				     struct set *);
+	    }
+	    ss->chunks[ss->nchunks++] = snewn(SET_CHUNK, struct set);
+	    ss->chunkused = 0;
+	}
+	s = &ss->chunks[ss->nchunks - 1][ss->chunkused++];
+    }
     s->x = x;
-    assert(SHRT_MIN <= y && y <= SHRT_MAX);
     s->y = y;
     s->mask = mask;
     s->mines = mines;
     s->todo = false;
-    if (add234(ss->sets, s) != s) {
-	/*
-	 * This set already existed! Free it and return.
-	 */
-	sfree(s);
-	return;
-    }
+    s->bnext = *prevp;
+    *prevp = s;
+    ss->nsets++;
 
     /*
-     * We've added a new set to the tree, so put it on the todo
-     * list.
+     * We've added a new set, so put it on the todo list.
      */
     ss_add_todo(ss, s);
 }
 
 static void ss_remove(struct setstore *ss, struct set *s)
 {
-    struct set *next = s->next, *prev = s->prev;
+    struct set **prevp;
 
 #ifdef SOLVER_DIAGNOSTICS
     printf("removing set %d,%d %03x\n", s->x, s->y, s->mask);
 #endif
     /*
-     * Remove s from the todo list.
+     * Taking s off the todo list just means making its queue entry
+     * (if any) stale.
      */
-    if (prev)
-	prev->next = next;
-    else if (s == ss->todo_head)
-	ss->todo_head = next;
-
-    if (next)
-	next->prev = prev;
-    else if (s == ss->todo_tail)
-	ss->todo_tail = prev;
-
     s->todo = false;
 
     /*
-     * Remove s from the tree.
+     * Unlink s from its bucket, and recycle it.
      */
-    del234(ss->sets, s);
+    for (prevp = &ss->buckets[s->y * ss->w + s->x];
+	 *prevp != s; prevp = &(*prevp)->bnext)
+	assert(*prevp);
+    *prevp = s->bnext;
+    s->bnext = ss->freelist;
+    ss->freelist = s;
+    ss->nsets--;
+}
 
-    /*
-     * Destroy the actual set structure.
-     */
-    sfree(s);
+/*
+ * Iterate over all the sets, in order of y, x and mask.
+ */
+static struct set *ss_next(struct setstore *ss, struct set *s)
+{
+    int i;
+
+    if (s) {
+	if (s->bnext)
+	    return s->bnext;
+	i = s->y * ss->w + s->x + 1;
+    } else {
+	i = 0;
+    }
+
+    for (; i < ss->w * ss->h; i++)
+	if (ss->buckets[i])
+	    return ss->buckets[i];
+    return NULL;
 }
+#define ss_first(ss) ss_next(ss, NULL)
 
 /*
  * Return a dynamically allocated list of all the sets which
@@ -511,41 +588,32 @@ static struct set **ss_overlap(struct setstore *ss, int x, int y, int mask)
     int nret = 0, retsize = 0;
     int xx, yy;
 
-    for (xx = x-3; xx < x+3; xx++)
-	for (yy = y-3; yy < y+3; yy++) {
-	    struct set stmp, *s;
-	    int pos;
+    /*
+     * A set's bounding rectangle is at most 3x3, so only sets with
+     * their top left within two squares up or left of the input set
+     * can overlap it. We visit them in the same order as we always
+     * have (x outermost), so that the solver's behaviour on a given
+     * grid doesn't depend on how the sets are stored.
+     */
+    for (xx = max(x-2, 0); xx < min(x+3, ss->w); xx++)
+	for (yy = max(y-2, 0); yy < min(y+3, ss->h); yy++) {
+	    struct set *s;
 
-	    /*
-	     * Find the first set with these top left coordinates.
-	     */
-            assert(SHRT_MIN <= xx && xx <= SHRT_MAX);
-	    stmp.x = xx;
-            assert(SHRT_MIN <= yy && yy <= SHRT_MAX);
-	    stmp.y = yy;
-	    stmp.mask = 0;
-
-	    if (findrelpos234(ss->sets, &stmp, NULL, REL234_GE, &pos)) {
-		while ((s = index234(ss->sets, pos)) != NULL &&
-		       s->x == xx && s->y == yy) {
+	    for (s = ss->buckets[yy * ss->w + xx]; s; s = s->bnext) {
+		/*
+		 * This set potentially overlaps the input one.
+		 * Compute the intersection to see if they really
+		 * overlap, and add it to the list if so.
+		 */
+		if (setmunge(x, y, mask, s->x, s->y, s->mask, false)) {
 		    /*
-		     * This set potentially overlaps the input one.
-		     * Compute the intersection to see if they
-		     * really overlap, and add it to the list if
-		     * so.
+		     * There's an overlap.
 		     */
-		    if (setmunge(x, y, mask, s->x, s->y, s->mask, false)) {
-			/*
-			 * There's an overlap.
-			 */
-			if (nret >= retsize) {
-			    retsize = nret + 32;
-			    ret = sresize(ret, retsize, struct set *);
-			}
-			ret[nret++] = s;
+		    if (nret >= retsize) {
+			retsize = nret + 32;
+			ret = sresize(ret, retsize, struct set *);
 		    }
-
-		    pos++;
+		    ret[nret++] = s;
 		}
 	    }
 	}
@@ -561,19 +629,15 @@ static struct set **ss_overlap(struct setstore *ss, int x, int y, int mask)
  */
 static struct set *ss_todo(struct setstore *ss)
 {
-    if (ss->todo_head) {
-	struct set *ret = ss->todo_head;
-	ss->todo_head = ret->next;
-	if (ss->todo_head)
-	    ss->todo_head->prev = NULL;
-	else
-	    ss->todo_tail = NULL;
-	ret->next = ret->prev = NULL;
-	ret->todo = false;
-	return ret;
-    } else {
-	return NULL;
+    while (ss->todo_head < ss->todo_tail) {
+	struct todoentry *e = &ss->todo[ss->todo_head++];
+	if (e->s->todo && e->s->stamp == e->stamp) {
+	    e->s->todo = false;
+	    return e->s;
+	}
     }
+    ss->todo_head = ss->todo_tail = 0;
+    return NULL;
 }
 
 struct squaretodo {
@@ -669,7 +733,7 @@ static int minesolve(int w, int h, int n, signed char *grid,
                      perturb_cb perturb,
 		     void *ctx, random_state *rs)
 {
-    struct setstore *ss = ss_new();
+    struct setstore *ss = ss_new(w, h);
     struct set **list;
     struct squaretodo astd, *std = &astd;
     int x, y, i, j;
@@ -990,7 +1054,7 @@ static int minesolve(int w, int h, int n, signed char *grid,
 	     * a bit slow for large n, so I artificially cap this
 	     * recursion at n=10 to avoid too much pain.
 	     */
-	    nsets = count234(ss->sets);
+	    nsets = ss->nsets;
 	    if (nsets <= lenof(setused)) {
 		/*
 		 * Doing this with actual recursive function calls
@@ -1034,8 +1098,8 @@ static int minesolve(int w, int h, int n, signed char *grid,
 		 *    give up.
 		 */
 		struct set *sets[lenof(setused)];
-		for (i = 0; i < nsets; i++)
-		    sets[i] = index234(ss->sets, i);
+		for (i = 0, s = ss_first(ss); i < nsets; i++, s = ss_next(ss, s))
+		    sets[i] = s;
 
 		cursor = 0;
 		while (1) {
@@ -1174,7 +1238,7 @@ static int minesolve(int w, int h, int n, signed char *grid,
 	{
 	    struct set *s;
 
-	    for (i = 0; (s = index234(ss->sets, i)) != NULL; i++)
+	    for (s = ss_first(ss); s; s = ss_next(ss, s))
 		printf("remaining set: %d,%d %03x %d\n", s->x, s->y, s->mask, s->mines);
 	}
 #endif
@@ -1198,13 +1262,14 @@ static int minesolve(int w, int h, int n, signed char *grid,
 	     * 
 	     * If we have no sets at all, we must give up.
 	     */
-	    if (count234(ss->sets) == 0) {
+	    if (ss->nsets == 0) {
 #ifdef SOLVER_DIAGNOSTICS
 		printf("perturbing on entire unknown set\n");
 #endif
 		ret = perturb(ctx, grid, 0, 0, 0);
 	    } else {
-		s = index234(ss->sets, random_upto(rs, count234(ss->sets)));
+		i = random_upto(rs, ss->nsets);
+		for (s = ss_first(ss); i-- > 0; s = ss_next(ss, s));
 #ifdef SOLVER_DIAGNOSTICS
 		printf("perturbing on set %d,%d %03x\n", s->x, s->y, s->mask);
 #endif
@@ -1275,7 +1340,7 @@ static int minesolve(int w, int h, int n, signed char *grid,
 		{
 		    struct set *s;
 
-		    for (i = 0; (s = index234(ss->sets, i)) != NULL; i++)
+		    for (s = ss_first(ss); s; s = ss_next(ss, s))
 			printf("remaining set: %d,%d %03x %d\n", s->x, s->y, s->mask, s->mines);
 		}
 #endif
@@ -1308,14 +1373,8 @@ static int minesolve(int w, int h, int n, signed char *grid,
     /*
      * Free the set list and square-todo list.
      */
-    {
-	struct set *s;
-	while ((s = delpos234(ss->sets, 0)) != NULL)
-	    sfree(s);
-	freetree234(ss->sets);
-	sfree(ss);
-	sfree(std->next);
-    }
+    ss_free(ss);
+    sfree(std->next);
 
     return nperturbs;
 }
@@ -1746,116 +1805,296 @@ static struct perturbations *mineperturb(void *vctx, signed char *grid,
     return ret;
 }
 
-static bool *minegen(int w, int h, int n, int x, int y, bool unique,
-		     random_state *rs)
+/*
+ * Everything a minegen worker thread needs to know, and the result
+ * of the search so far.
+ */
+struct minegen_ctx {
+    int w, h, n, x, y;
+    random_state *rs;		       /* forked once per attempt */
+    int next;			       /* next attempt to be started */
+    int best;			       /* first attempt known to succeed */
+    bool *result;		       /* ... and its grid */
+#ifndef NO_THREADS
+    pthread_mutex_t lock;
+#endif
+};
+
+static void minegen_lock(struct minegen_ctx *gctx)
 {
-    bool *ret = snewn(w*h, bool);
-    bool success;
-    int ntries = 0;
+#ifndef NO_THREADS
+    pthread_mutex_lock(&gctx->lock);
+#endif
+}
 
-    do {
-	success = false;
-	ntries++;
+static void minegen_unlock(struct minegen_ctx *gctx)
+{
+#ifndef NO_THREADS
+    pthread_mutex_unlock(&gctx->lock);
+#endif
+}
 
-	memset(ret, 0, w*h);
+/*
+ * Check whether an earlier attempt than this one has already
+ * succeeded, in which case this one is wasted effort.
+ */
+static bool minegen_superseded(struct minegen_ctx *gctx, int attempt)
+{
+    bool ret;
 
-	/*
-	 * Start by placing n mines, none of which is at x,y or within
-	 * one square of it.
-	 */
-	{
-	    int *tmp = snewn(w*h, int);
-	    int i, j, k, nn;
+    minegen_lock(gctx);
+    ret = (gctx->best < attempt);
+    minegen_unlock(gctx);
+    return ret;
+}
 
-	    /*
-	     * Write down the list of possible mine locations.
-	     */
-	    k = 0;
-	    for (i = 0; i < h; i++)
-		for (j = 0; j < w; j++)
-		    if (abs(i - y) > 1 || abs(j - x) > 1)
-			tmp[k++] = i*w+j;
+/*
+ * Place n mines at random, none of which is at x,y or within one
+ * square of it.
+ */
+static void minegen_place(bool *ret, int w, int h, int n, int x, int y,
+			  random_state *rs)
+{
+    int *tmp = snewn(w*h, int);
+    int i, j, k;
 
-	    /*
-	     * Now pick n off the list at random.
-	     */
-	    nn = n;
-	    while (nn-- > 0) {
-		i = random_upto(rs, k);
-		ret[tmp[i]] = true;
-		tmp[i] = tmp[--k];
-	    }
+    memset(ret, 0, w*h);
 
-	    sfree(tmp);
-	}
+    /*
+     * Write down the list of possible mine locations.
+     */
+    k = 0;
+    for (i = 0; i < h; i++)
+	for (j = 0; j < w; j++)
+	    if (abs(i - y) > 1 || abs(j - x) > 1)
+		tmp[k++] = i*w+j;
+
+    /*
+     * Now pick n off the list at random.
+     */
+    while (n-- > 0) {
+	i = random_upto(rs, k);
+	ret[tmp[i]] = true;
+	tmp[i] = tmp[--k];
+    }
+
+    sfree(tmp);
+}
+
+/*
+ * Make one attempt at generating a grid, numbered from zero, using
+ * its own random state. Returns true if it produced a usable grid.
+ */
+static bool minegen_attempt(struct minegen_ctx *gctx, bool *ret,
+			    int attempt, random_state *rs)
+{
+    int w = gctx->w, h = gctx->h, n = gctx->n, x = gctx->x, y = gctx->y;
+    bool success;
+
+    minegen_place(ret, w, h, n, x, y, rs);
 
 #ifdef GENERATION_DIAGNOSTICS
-	{
-	    int yy, xx;
-	    printf("grid after initial generation:\n");
-	    for (yy = 0; yy < h; yy++) {
-		for (xx = 0; xx < w; xx++) {
-		    int v = ret[yy*w+xx];
-		    if (yy == y && xx == x) {
-			assert(!v);
-			putchar('S');
-		    } else if (v) {
-			putchar('*');
-		    } else {
-			putchar('-');
-		    }
+    {
+	int yy, xx;
+	printf("grid after initial generation:\n");
+	for (yy = 0; yy < h; yy++) {
+	    for (xx = 0; xx < w; xx++) {
+		int v = ret[yy*w+xx];
+		if (yy == y && xx == x) {
+		    assert(!v);
+		    putchar('S');
+		} else if (v) {
+		    putchar('*');
+		} else {
+		    putchar('-');
 		}
-		putchar('\n');
 	    }
-	    printf("\n");
+	    putchar('\n');
 	}
+	printf("\n");
+    }
 #endif
 
-	/*
-	 * Now set up a results grid to run the solver in, and a
-	 * context for the solver to open squares. Then run the solver
-	 * repeatedly; if the number of perturb steps ever goes up or
-	 * it ever returns -1, give up completely.
-	 *
-	 * We bypass this bit if we're not after a unique grid.
-         */
-	if (unique) {
-	    signed char *solvegrid = snewn(w*h, signed char);
-	    struct minectx actx, *ctx = &actx;
-	    int solveret, prevret = -2;
-
-	    ctx->grid = ret;
-	    ctx->w = w;
-	    ctx->h = h;
-	    ctx->sx = x;
-	    ctx->sy = y;
-	    ctx->rs = rs;
-	    ctx->allow_big_perturbs = (ntries > 100);
-
-	    while (1) {
-		memset(solvegrid, -2, w*h);
-		solvegrid[y*w+x] = mineopen(ctx, x, y);
-		assert(solvegrid[y*w+x] == 0); /* by deliberate arrangement */
-
-		solveret =
-		    minesolve(w, h, n, solvegrid, mineopen, mineperturb, ctx, rs);
-		if (solveret < 0 || (prevret >= 0 && solveret >= prevret)) {
-		    success = false;
-		    break;
-		} else if (solveret == 0) {
-		    success = true;
-		    break;
-		}
+    /*
+     * Now set up a results grid to run the solver in, and a context
+     * for the solver to open squares. Then run the solver
+     * repeatedly; if the number of perturb steps ever goes up or it
+     * ever returns -1, give up completely. Also give up if another
+     * thread has beaten us to it.
+     */
+    {
+	signed char *solvegrid = snewn(w*h, signed char);
+	struct minectx actx, *ctx = &actx;
+	int solveret, prevret = -2;
+
+	ctx->grid = ret;
+	ctx->w = w;
+	ctx->h = h;
+	ctx->sx = x;
+	ctx->sy = y;
+	ctx->rs = rs;
+	ctx->allow_big_perturbs = (attempt >= 100);
+
+	while (1) {
+	    memset(solvegrid, -2, w*h);
+	    solvegrid[y*w+x] = mineopen(ctx, x, y);
+	    assert(solvegrid[y*w+x] == 0); /* by deliberate arrangement */
+
+	    solveret =
+		minesolve(w, h, n, solvegrid, mineopen, mineperturb, ctx, rs);
+	    if (solveret < 0 || (prevret >= 0 && solveret >= prevret) ||
+		minegen_superseded(gctx, attempt)) {
+		success = false;
+		break;
+	    } else if (solveret == 0) {
+		success = true;
+		break;
 	    }
+	}
 
-	    sfree(solvegrid);
-	} else {
-	    success = true;
+	sfree(solvegrid);
+    }
+
+    return success;
+}
+
+/*
+ * Make attempts in turn until one of them succeeds, or until an
+ * attempt earlier than the one we'd try next has succeeded
+ * elsewhere. Each thread taking part in generating a grid runs one
+ * of these.
+ */
+static void *minegen_worker(void *vctx)
+{
+    struct minegen_ctx *gctx = (struct minegen_ctx *)vctx;
+    bool *grid = snewn(gctx->w * gctx->h, bool);
+
+    while (1) {
+	random_state *rs;
+	int attempt;
+	bool success;
+
+	minegen_lock(gctx);
+	attempt = gctx->next++;
+	if (attempt > gctx->best) {
+	    minegen_unlock(gctx);
+	    break;
 	}
+	rs = random_fork(gctx->rs, attempt);
+	minegen_unlock(gctx);
+
+	success = minegen_attempt(gctx, grid, attempt, rs);
+	random_free(rs);
+
+	if (success) {
+	    minegen_lock(gctx);
+	    if (attempt < gctx->best) {
+		bool *tmp = gctx->result;
+		gctx->result = grid;
+		grid = tmp;
+		gctx->best = attempt;
+	    }
+	    minegen_unlock(gctx);
+	    if (!grid)
+		grid = snewn(gctx->w * gctx->h, bool);
+	}
+    }
 
-    } while (!success);
+    sfree(grid);
+    return NULL;
+}
 
-    return ret;
+#ifndef NO_THREADS
+/*
+ * Decide how many threads to generate a grid with. The environment
+ * variable MINES_GENERATOR_THREADS can override the default of one
+ * per processor, up to a limit.
+ */
+#define MINEGEN_MAX_THREADS 16
+static int minegen_nthreads;
+static pthread_once_t minegen_nthreads_once = PTHREAD_ONCE_INIT;
+
+static void minegen_count_threads(void)
+{
+    char *env = getenv("MINES_GENERATOR_THREADS");
+    int nthreads;
+
+    if (env)
+	nthreads = atoi(env);
+    else
+	nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = max(nthreads, 1);
+    minegen_nthreads = min(nthreads, MINEGEN_MAX_THREADS);
+}
+
+/* Several games may be generated at once (e.g. under --jobs). */
+static int minegen_threads(void)
+{
+    pthread_once(&minegen_nthreads_once, minegen_count_threads);
+    return minegen_nthreads;
+}
+#endif
+
+/*
+ * Generate a grid. To make a grid which can be solved without
+ * guessing, we need to make a series of attempts, each of which
+ * starts from a fresh random layout and may or may not succeed.
+ * Each attempt gets its own random state, forked from rs by attempt
+ * number, and the grid we return is always the one from the first
+ * attempt to succeed.
+ *
+ * That means several threads can make attempts speculatively at
+ * once, each taking the next attempt number when it finishes one,
+ * and the result still depends only on rs: not on how many threads
+ * there were, or which of them finished first. (Any attempt
+ * numbered after one that is known to have succeeded is abandoned.)
+ */
+static bool *minegen(int w, int h, int n, int x, int y, bool unique,
+		     random_state *rs)
+{
+    struct minegen_ctx actx, *gctx = &actx;
+#ifndef NO_THREADS
+    pthread_t threads[MINEGEN_MAX_THREADS];
+    int nthreads = minegen_threads(), nstarted, i;
+#endif
+
+    gctx->w = w;
+    gctx->h = h;
+    gctx->n = n;
+    gctx->x = x;
+    gctx->y = y;
+
+    if (!unique) {
+	/*
+	 * If we're not after a unique grid, there's no need for any
+	 * of that: just place the mines at random.
+	 */
+	bool *ret = snewn(w*h, bool);
+	minegen_place(ret, w, h, n, x, y, rs);
+	return ret;
+    }
+
+    gctx->rs = rs;
+    gctx->next = 0;
+    gctx->best = INT_MAX;
+    gctx->result = NULL;
+
+#ifndef NO_THREADS
+    pthread_mutex_init(&gctx->lock, NULL);
+    for (nstarted = 0; nstarted < nthreads - 1; nstarted++)
+	if (pthread_create(&threads[nstarted], NULL,
+			   minegen_worker, gctx) != 0)
+	    break;
+#endif
+    minegen_worker(gctx);	       /* this thread takes part too */
+#ifndef NO_THREADS
+    for (i = 0; i < nstarted; i++)
+	pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&gctx->lock);
+#endif
+
+    assert(gctx->result);
+    return gctx->result;
 }
 
 static char *describe_layout(bool *grid, int area, int x, int y,
@@ -3266,6 +3505,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
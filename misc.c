@@ -8,6 +8,8 @@
 #else
 #  include <tgmath.h>
 #endif
+#include <limits.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -202,6 +204,141 @@ char *fgetline(FILE *fp)
     return ret;
 }
 
+struct strbuf {
+    char *s;
+    int len, size;
+};
+
+strbuf *strbuf_new(void)
+{
+    strbuf *sb = snew(strbuf);
+    sb->size = 64;
+    sb->s = snewn(sb->size, char);
+    sb->len = 0;
+    sb->s[0] = '\0';
+    return sb;
+}
+
+void strbuf_free(strbuf *sb)
+{
+    sfree(sb->s);
+    sfree(sb);
+}
+
+char *strbuf_to_str(strbuf *sb)
+{
+    char *ret = sresize(sb->s, sb->len + 1, char);
+    sfree(sb);
+    return ret;
+}
+
+int strbuf_len(const strbuf *sb)
+{
+    return sb->len;
+}
+
+/*
+ * Make room for at least 'extra' more characters plus the trailing
+ * NUL. The buffer grows geometrically, so that building a string a
+ * few characters at a time costs linear time in its final length
+ * rather than quadratic.
+ */
+static char *strbuf_grow(strbuf *sb, int extra)
+{
+    if (sb->len + extra >= sb->size) {
+        sb->size = (sb->len + extra) * 5 / 4 + 64;
+        sb->s = sresize(sb->s, sb->size, char);
+    }
+    return sb->s + sb->len;
+}
+
+void strbuf_addc(strbuf *sb, char c)
+{
+    char *p = strbuf_grow(sb, 1);
+    p[0] = c;
+    p[1] = '\0';
+    sb->len++;
+}
+
+void strbuf_adds(strbuf *sb, const char *str)
+{
+    int len = strlen(str);
+    memcpy(strbuf_grow(sb, len), str, len + 1);
+    sb->len += len;
+}
+
+void strbuf_addf(strbuf *sb, const char *fmt, ...)
+{
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(sb->s + sb->len, sb->size - sb->len, fmt, ap);
+    va_end(ap);
+    assert(len >= 0);
+
+    if (sb->len + len >= sb->size) {
+        strbuf_grow(sb, len);
+        va_start(ap, fmt);
+        vsnprintf(sb->s + sb->len, sb->size - sb->len, fmt, ap);
+        va_end(ap);
+    }
+    sb->len += len;
+}
+
+void strbuf_addint(strbuf *sb, int n)
+{
+    char buf[MAX_DIGITS(int) + 2], *p = buf + sizeof(buf);
+    unsigned u = n < 0 ? -(unsigned)n : (unsigned)n;
+    int len;
+
+    *--p = '\0';
+    do {
+        *--p = '0' + u % 10;
+        u /= 10;
+    } while (u);
+    if (n < 0)
+        *--p = '-';
+
+    len = buf + sizeof(buf) - 1 - p;
+    memcpy(strbuf_grow(sb, len), p, len + 1);
+    sb->len += len;
+}
+
+void strbuf_addrun(strbuf *sb, int run)
+{
+    while (run > 0) {
+        int n = min(run, 26);
+        strbuf_addc(sb, 'a' - 1 + n);
+        run -= n;
+    }
+}
+
+int read_number(const char **pp)
+{
+    const char *p = *pp;
+    int n = 0;
+
+    if (*p < '0' || *p > '9')
+        return -1;
+    while (*p >= '0' && *p <= '9') {
+        int d = *p++ - '0';
+        n = (n > (INT_MAX - d) / 10) ? INT_MAX : n * 10 + d;
+    }
+    *pp = p;
+    return n;
+}
+
+int read_run(const char **pp)
+{
+    const char *p = *pp;
+
+    if (*p < 'a' || *p > 'z')
+        return 0;
+    *pp = p + 1;
+    return *p - 'a' + 1;
+}
+
 bool getenv_bool(const char *name, bool dflt)
 {
     char *env = getenv(name);
@@ -210,6 +347,35 @@ bool getenv_bool(const char *name, bool dflt)
     return false;
 }
 
+void pending_fill(unsigned long *set, int n)
+{
+    int i;
+
+    memset(set, 0, PENDING_WORDS(n) * sizeof(unsigned long));
+    for (i = 0; i < n; i++)
+        pending_add(set, i);
+}
+
+int pending_next(unsigned long *set, int i, int n)
+{
+    int w = i / PENDING_BITS, b;
+    unsigned long word;
+
+    if (i >= n)
+        return n;
+    word = set[w] & (0xFFFFFFFFUL << (i % PENDING_BITS));
+    while (!word) {
+        if (++w >= PENDING_WORDS(n))
+            return n;
+        word = set[w];
+    }
+    b = 0;
+    while (!(word & (1UL << b)))
+        b++;
+    set[w] &= ~(1UL << b);
+    return w * PENDING_BITS + b;
+}
+
 /* Utility functions for colour manipulation. */
 
 static float colour_distance(const float a[3], const float b[3])
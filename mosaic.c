@@ -1627,6 +1627,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     DEFAULT_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -1785,6 +1785,20 @@ static char *solve_game(const game_state *state, const game_state *currstate,
                 tiles[i] = c - 'a' + 10;
             else if (c >= 'A' && c <= 'F')
                 tiles[i] = c - 'A' + 10;
+            else {
+                *error = "invalid char in aux";
+                sfree(tiles);
+                return NULL;
+            }
+
+            /* The solution must be made of the puzzle's own tiles. */
+            c = state->tiles[i] & (R|L|U|D);
+            if (tiles[i] != c && tiles[i] != A(c) && tiles[i] != C(c) &&
+                tiles[i] != F(c)) {
+                *error = "aux does not match puzzle";
+                sfree(tiles);
+                return NULL;
+            }
 
 	    tiles[i] |= LOCKED;
         }
@@ -1913,6 +1927,20 @@ static unsigned char *compute_active(const game_state *state, int cx, int cy)
     return active;
 }
 
+/*
+ * Whether tile v is connected to tile v1, its neighbour in direction
+ * dir.
+ */
+static bool net_linked(const unsigned char *tiles,
+                       const unsigned char *barriers, int v, int v1, int dir)
+{
+    int tile = tiles[v];
+
+    if (barriers)
+        tile &= ~barriers[v];
+    return (tile & dir) && (tiles[v1] & F(dir));
+}
+
 struct net_neighbour_ctx {
     int w, h;
     const unsigned char *tiles, *barriers;
@@ -1924,20 +1952,14 @@ static int net_neighbour(int vertex, void *vctx)
 
     if (vertex >= 0) {
         int x = vertex % ctx->w, y = vertex / ctx->w;
-        int tile, dir, x1, y1, v1;
+        int dir, x1, y1, v1;
 
         ctx->i = ctx->n = 0;
 
-        tile = ctx->tiles[vertex];
-        if (ctx->barriers)
-            tile &= ~ctx->barriers[vertex];
-
         for (dir = 1; dir < 0x10; dir <<= 1) {
-            if (!(tile & dir))
-                continue;
             OFFSETWH(x1, y1, x, y, dir, ctx->w, ctx->h);
             v1 = y1 * ctx->w + x1;
-            if (ctx->tiles[v1] & F(dir))
+            if (net_linked(ctx->tiles, ctx->barriers, vertex, v1, dir))
                 ctx->neighbours[ctx->n++] = v1;
         }
     }
@@ -1948,50 +1970,66 @@ static int net_neighbour(int vertex, void *vctx)
         return -1;
 }
 
-static int *compute_loops_inner(int w, int h, bool wrapping,
-                                const unsigned char *tiles,
-                                const unsigned char *barriers)
+static void find_loops(struct findloopstate *fls, int w, int h,
+                       const unsigned char *tiles,
+                       const unsigned char *barriers)
 {
     struct net_neighbour_ctx ctx;
-    struct findloopstate *fls;
-    int *loops;
-    int x, y;
 
-    fls = findloop_new_state(w*h);
     ctx.w = w;
     ctx.h = h;
     ctx.tiles = tiles;
     ctx.barriers = barriers;
     findloop_run(fls, w*h, net_neighbour, &ctx);
+}
 
-    loops = snewn(w*h, int);
-
-    for (y = 0; y < h; y++) {
-        for (x = 0; x < w; x++) {
-            int x1, y1, dir;
-            int flags = 0;
-
-            for (dir = 1; dir < 0x10; dir <<= 1) {
-                if ((tiles[y*w+x] & dir) &&
-                    !(barriers && (barriers[y*w+x] & dir))) {
-                    OFFSETWH(x1, y1, x, y, dir, w, h);
-                    if ((tiles[y1*w+x1] & F(dir)) &&
-                        findloop_is_loop_edge(fls, y*w+x, y1*w+x1))
-                        flags |= ERR(dir);
-                }
-            }
-            loops[y*w+x] = flags;
-        }
+/*
+ * Return the ERR flags for tile i, given the output of findloop for
+ * the tiles.
+ */
+static int tile_loop_flags(struct findloopstate *fls, int w, int h,
+                           const unsigned char *tiles,
+                           const unsigned char *barriers, int i)
+{
+    int x = i % w, y = i / w, x1, y1, dir;
+    int flags = 0;
+
+    for (dir = 1; dir < 0x10; dir <<= 1) {
+        OFFSETWH(x1, y1, x, y, dir, w, h);
+        if (net_linked(tiles, barriers, i, y1*w+x1, dir) &&
+            findloop_is_loop_edge(fls, i, y1*w+x1))
+            flags |= ERR(dir);
     }
+    return flags;
+}
 
-    findloop_free_state(fls);
-    return loops;
+/*
+ * Fill in 'loops' with the ERR flags for each tile, given the output
+ * of findloop for those tiles.
+ */
+static void loop_flags(struct findloopstate *fls, int w, int h,
+                       const unsigned char *tiles,
+                       const unsigned char *barriers, int *loops)
+{
+    int i;
+
+    for (i = 0; i < w*h; i++)
+        loops[i] = tile_loop_flags(fls, w, h, tiles, barriers, i);
 }
 
-static int *compute_loops(const game_state *state)
+static int *compute_loops_inner(int w, int h, bool wrapping,
+                                const unsigned char *tiles,
+                                const unsigned char *barriers)
 {
-    return compute_loops_inner(state->width, state->height, state->wrapping,
-                               state->tiles, state->imm->barriers);
+    struct findloopstate *fls;
+    int *loops;
+
+    fls = findloop_new_state(w*h);
+    find_loops(fls, w, h, tiles, barriers);
+    loops = snewn(w*h, int);
+    loop_flags(fls, w, h, tiles, barriers, loops);
+    findloop_free_state(fls);
+    return loops;
 }
 
 struct game_ui {
@@ -2066,6 +2104,19 @@ struct game_drawstate {
     int width, height;
     int tilesize;
     unsigned long *visible, *to_draw;
+
+    /*
+     * The loop highlighting for the tiles in loop_tiles, if
+     * loops_valid is set, and the findloop state it came from. See
+     * update_loops. loop_dirty and loop_dirty_list are scratch space
+     * for it, recording which tiles' flags need recomputing.
+     */
+    struct findloopstate *fls;
+    unsigned char *loop_tiles;
+    int *loops;
+    bool loops_valid;
+    bool *loop_dirty;
+    int *loop_dirty_list, nloop_dirty;
 };
 
 /* ----------------------------------------------------------------------
@@ -2345,6 +2396,40 @@ static char *interpret_move(const game_state *state, game_ui *ui,
     }
 }
 
+/*
+ * Check whether the game has been completed.
+ *
+ * For this purpose it doesn't matter where the source square is,
+ * because we can start from anywhere (or, at least, any square
+ * that's non-empty!), and correctly determine whether the game is
+ * completed.
+ */
+static bool is_complete(const game_state *state)
+{
+    unsigned char *active;
+    int pos;
+    bool complete = true;
+
+    for (pos = 0; pos < state->width * state->height; pos++)
+        if (state->tiles[pos] & 0xF)
+            break;
+
+    if (pos < state->width * state->height) {
+        active = compute_active(state, pos % state->width,
+                                pos / state->width);
+
+        for (pos = 0; pos < state->width * state->height; pos++)
+            if ((state->tiles[pos] & 0xF) && !active[pos]) {
+                complete = false;
+                break;
+            }
+
+        sfree(active);
+    }
+
+    return complete;
+}
+
 static game_state *execute_move(const game_state *from, const char *move)
 {
     game_state *ret;
@@ -2403,42 +2488,97 @@ static game_state *execute_move(const game_state *from, const char *move)
 	ret->last_rotate_y = ty;
     }
 
+    if (is_complete(ret))
+        ret->completed = true;
+
+    return ret;
+}
+
+
+/*
+ * For midend checkpoints, a state is encoded as 'S' if the solver
+ * has been used, 'C' if the game has been completed, then a colon,
+ * then a hex digit per tile giving its current orientation, followed
+ * by 'L' if the tile is locked.
+ */
+static char *encode_state(const game_state *state)
+{
+    strbuf *sb = strbuf_new();
+    int i;
+
+    if (state->used_solve)
+        strbuf_addc(sb, 'S');
+    if (state->completed)
+        strbuf_addc(sb, 'C');
+    strbuf_addc(sb, ':');
+    for (i = 0; i < state->width * state->height; i++) {
+        strbuf_addc(sb, "0123456789abcdef"[state->tiles[i] & 0xF]);
+        if (state->tiles[i] & LOCKED)
+            strbuf_addc(sb, 'L');
+    }
+    return strbuf_to_str(sb);
+}
+
+static game_state *decode_state(const game_state *initial,
+                                const char *encoding)
+{
+    game_state *ret = dup_game(initial);
+    const char *p = encoding;
+    int i;
+
+    ret->last_rotate_dir = 0;
+    ret->last_rotate_x = ret->last_rotate_y = 0;
+
     /*
-     * Check whether the game has been completed.
-     * 
-     * For this purpose it doesn't matter where the source square is,
-     * because we can start from anywhere (or, at least, any square
-     * that's non-empty!), and correctly determine whether the game is
-     * completed.
+     * The flags record history which the tiles alone can't show: the
+     * solver may have been used, and the game may have been completed
+     * and then broken up again. So all we can check is that they're
+     * in the order encode_state writes them.
      */
-    {
-	unsigned char *active;
-	int pos;
-        bool complete = true;
-
-	for (pos = 0; pos < ret->width * ret->height; pos++)
-            if (ret->tiles[pos] & 0xF)
-                break;
+    if (*p == 'S') {
+        ret->used_solve = true;
+        p++;
+    }
+    if (*p == 'C') {
+        ret->completed = true;
+        p++;
+    }
+    if (*p++ != ':')
+        goto fail;
 
-        if (pos < ret->width * ret->height) {
-            active = compute_active(ret, pos % ret->width, pos / ret->width);
+    for (i = 0; i < ret->width * ret->height; i++) {
+        int orig = initial->tiles[i] & 0xF, t;
 
-            for (pos = 0; pos < ret->width * ret->height; pos++)
-                if ((ret->tiles[pos] & 0xF) && !active[pos]) {
-		    complete = false;
-                    break;
-                }
+        if (*p >= '0' && *p <= '9')
+            t = *p - '0';
+        else if (*p >= 'a' && *p <= 'f')
+            t = *p - 'a' + 10;
+        else
+            goto fail;
+        p++;
 
-            sfree(active);
+        /* A tile can be turned round, but never rewired. */
+        if (t != orig && t != A(orig) && t != F(orig) && t != C(orig))
+            goto fail;
+        ret->tiles[i] = t;
+        if (*p == 'L') {
+            ret->tiles[i] |= LOCKED;
+            p++;
         }
-
-	if (complete)
-	    ret->completed = true;
     }
+    if (*p)
+        goto fail;
+
+    /* But a game whose tiles are complete is certainly completed. */
+    if (is_complete(ret))
+        ret->completed = true;
 
     return ret;
-}
 
+    fail:
+    free_game(ret);
+    return NULL;
+}
 
 /* ----------------------------------------------------------------------
  * Routines for drawing the game position on the screen.
@@ -2457,6 +2597,14 @@ static game_drawstate *game_new_drawstate(drawing *dr, const game_state *state)
     ds->tilesize = 0;                  /* undecided yet */
     for (i = 0; i < ncells; i++)
         ds->visible[i] = -1;
+    ds->fls = findloop_new_state(state->width * state->height);
+    ds->loop_tiles = snewn(state->width * state->height, unsigned char);
+    ds->loops = snewn(state->width * state->height, int);
+    ds->loops_valid = false;
+    ds->loop_dirty = snewn(state->width * state->height, bool);
+    for (i = 0; i < state->width * state->height; i++)
+        ds->loop_dirty[i] = false;
+    ds->loop_dirty_list = snewn(state->width * state->height, int);
 
     return ds;
 }
@@ -2467,6 +2615,11 @@ static game_drawstate *game_new_drawstate(drawing *dr, const game_state *state)
 
 static void game_free_drawstate(drawing *dr, game_drawstate *ds)
 {
+    findloop_free_state(ds->fls);
+    sfree(ds->loop_tiles);
+    sfree(ds->loops);
+    sfree(ds->loop_dirty);
+    sfree(ds->loop_dirty_list);
     sfree(ds->visible);
     sfree(ds->to_draw);
     sfree(ds);
@@ -2836,6 +2989,95 @@ static void draw_tile(drawing *dr, game_drawstate *ds, int x, int y,
     draw_update(dr, clipx, clipy, clipw, cliph);
 }
 
+static void mark_loop_dirty(game_drawstate *ds, int i)
+{
+    if (!ds->loop_dirty[i]) {
+        ds->loop_dirty[i] = true;
+        ds->loop_dirty_list[ds->nloop_dirty++] = i;
+    }
+}
+
+static void loop_edge_changed(int u, int v, void *ctx)
+{
+    game_drawstate *ds = (game_drawstate *)ctx;
+
+    mark_loop_dirty(ds, u);
+    mark_loop_dirty(ds, v);
+}
+
+/*
+ * Bring the drawstate's loop highlighting up to date for the tiles in
+ * 'state'. Most redraws are animation frames, for which nothing has
+ * changed; and a move usually changes only the few links around the
+ * tile it rotated, so we can tell findloop about them one at a time
+ * rather than running it on the whole grid again. Then we only need
+ * new ERR flags for the tiles at either end of a changed link, and
+ * of any link which findloop reports has joined a loop as a result.
+ */
+static const int *update_loops(game_drawstate *ds, const game_state *state)
+{
+    int w = state->width, h = state->height;
+    const unsigned char *barriers = state->imm->barriers;
+    bool ok = ds->loops_valid;
+    int i;
+
+    if (ok && !memcmp(ds->loop_tiles, state->tiles, w*h))
+        return ds->loops;
+
+    /*
+     * On a wrapping grid less than three tiles across, two tiles can
+     * be linked in both directions, or a tile to itself, and
+     * findloop_add_edge can't cope with that.
+     */
+    if (state->wrapping && (w < 3 || h < 3))
+        ok = false;
+
+    ds->nloop_dirty = 0;
+    for (i = 0; ok && i < w*h; i++) {
+        int x = i % w, y = i / w, x1, y1, i1, dir;
+        bool was, is;
+
+        if (state->tiles[i] == ds->loop_tiles[i])
+            continue;
+
+        for (dir = 1; ok && dir < 0x10; dir <<= 1) {
+            OFFSETWH(x1, y1, x, y, dir, w, h);
+            i1 = y1*w+x1;
+            if (i1 < i && state->tiles[i1] != ds->loop_tiles[i1])
+                continue;              /* already done from the other end */
+
+            was = net_linked(ds->loop_tiles, barriers, i, i1, dir);
+            is = net_linked(state->tiles, barriers, i, i1, dir);
+            if (was == is)
+                continue;
+            mark_loop_dirty(ds, i);
+            mark_loop_dirty(ds, i1);
+            if (was)
+                ok = findloop_remove_edge(ds->fls, i, i1);
+            else
+                ok = findloop_add_edge(ds->fls, i, i1,
+                                       loop_edge_changed, ds);
+        }
+    }
+
+    if (!ok) {
+        find_loops(ds->fls, w, h, state->tiles, barriers);
+        loop_flags(ds->fls, w, h, state->tiles, barriers, ds->loops);
+    }
+    for (i = 0; i < ds->nloop_dirty; i++) {
+        int t = ds->loop_dirty_list[i];
+
+        if (ok)
+            ds->loops[t] = tile_loop_flags(ds->fls, w, h, state->tiles,
+                                           barriers, t);
+        ds->loop_dirty[t] = false;
+    }
+    memcpy(ds->loop_tiles, state->tiles, w*h);
+    ds->loops_valid = true;
+
+    return ds->loops;
+}
+
 static void game_redraw(drawing *dr, game_drawstate *ds,
                         const game_state *oldstate, const game_state *state,
                         int dir, const game_ui *ui,
@@ -2843,7 +3085,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
 {
     int tx, ty, dx, dy, d, dsh, last_rotate_dir, frame;
     unsigned char *active;
-    int *loops;
+    const int *loops;
     float angle = 0.0;
 
     tx = ty = -1;
@@ -2876,7 +3118,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
      * of barriers.
      */
     active = compute_active(state, ui->cx, ui->cy);
-    loops = compute_loops(state);
+    loops = update_loops(ds, state);
 
     for (dy = -1; dy < ds->height+1; dy++) {
         for (dx = -1; dx < ds->width+1; dx++) {
@@ -3039,7 +3281,6 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
     }
 
     sfree(active);
-    sfree(loops);
 }
 
 static float game_anim_length(const game_state *oldstate,
@@ -3262,6 +3503,8 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    encode_state,
+    decode_state,
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
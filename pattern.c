@@ -365,6 +365,7 @@ static int compute_rowdata(int *ret, unsigned char *start, int len, int step)
 #define BLOCK 1
 #define DOT 2
 #define STILL_UNKNOWN 3
+#define DP_START 4                     /* scratch flag used by do_dp */
 
 #ifdef STANDALONE_SOLVER
 static bool verbose = false;
@@ -434,18 +435,271 @@ static bool do_recurse(unsigned char *known, unsigned char *deduced,
 }
 
 
+/*
+ * Alternative line solver, by dynamic programming rather than
+ * enumerating every placement of the blocks.
+ *
+ * fwd[k*(len+1) + i] says whether the first k blocks can be fitted
+ * into the first i squares of the line, consistently with the known
+ * squares, with every square in that range not covered by a block
+ * being a dot. bwd[k*(len+1) + i] similarly says whether blocks k
+ * onwards fit into the squares from i to the end. Then a square can
+ * be a dot if, for some k, the first k blocks fit to its left and
+ * the rest to its right; and it can be a block if some block k has a
+ * consistent position covering it with the first k blocks fitting to
+ * its left (with a dot between) and the rest to its right (ditto).
+ * This gives exactly the same deductions as do_recurse, in
+ * O(len * nblocks) time however awkward the line is.
+ *
+ * Only the part of each table where the blocks on both sides of the
+ * boundary have room to fit is ever filled in: everything else is
+ * false, so it is zeroed up front. The narrower the gaps in the line,
+ * the less work that leaves.
+ */
+static bool do_dp(const unsigned char *known, unsigned char *deduced,
+                  unsigned char *fwd, unsigned char *bwd,
+                  const int *data, int nblocks, int len)
+{
+    int i, k, run, pre, suf, total;
+#define FWD(k, i) fwd[(k)*(len+1) + (i)]
+#define BWD(k, i) bwd[(k)*(len+1) + (i)]
+
+    /*
+     * pre is the room the first k blocks need, and suf the room
+     * needed by blocks k onwards, so the boundary between them can
+     * only be somewhere in [pre, len-suf].
+     */
+    for (k = 0, total = -1; k < nblocks; k++)
+        total += data[k] + 1;
+    memset(deduced, 0, len);
+    if (total > len)
+        return false;
+
+    memset(fwd, 0, (nblocks+1) * (len+1));
+    memset(bwd, 0, (nblocks+1) * (len+1));
+
+    FWD(0, 0) = true;
+    for (k = 0, pre = 0; k <= nblocks; k++) {
+        int c = (k > 0 ? data[k-1] : 0);
+        suf = (k == nblocks ? 0 : total - pre - (k > 0));
+        for (i = max(pre - c, 0), run = 0; i < len - suf; i++) {
+            bool ok = (known[i] != BLOCK && FWD(k, i));
+            run = (known[i] == DOT ? 0 : run + 1);
+            if (!ok && k > 0 && run >= c) {
+                int start = i + 1 - c;  /* block k-1 ends at i */
+                ok = (start == 0 ? k == 1 :
+                      known[start-1] != BLOCK && FWD(k-1, start-1));
+            }
+            FWD(k, i+1) = ok;
+        }
+        if (k < nblocks)
+            pre += data[k] + (k > 0);
+    }
+
+    BWD(nblocks, len) = true;
+    for (k = nblocks; k >= 0; k--) {
+        int c = (k < nblocks ? data[k] : 0);
+        suf = (k == nblocks ? 0 : suf + c + (k < nblocks-1));
+        pre = (k == 0 ? 0 : total - suf - (k < nblocks));
+        for (i = min(len - suf + c, len) - 1, run = 0; i >= pre; i--) {
+            bool ok = (known[i] != BLOCK && BWD(k, i+1));
+            run = (known[i] == DOT ? 0 : run + 1);
+            if (!ok && k < nblocks && run >= c) {
+                int end = i + c;          /* block k starts at i */
+                ok = (end == len ? k == nblocks-1 :
+                      known[end] != BLOCK && BWD(k+1, end+1));
+            }
+            BWD(k, i) = ok;
+        }
+    }
+
+    if (!FWD(nblocks, len))
+        return false;
+
+    for (k = 0, pre = 0; k <= nblocks; k++) {
+        suf = (k == nblocks ? 0 : total - pre - (k > 0));
+        for (i = pre; i < len - suf; i++)
+            if (known[i] != BLOCK && FWD(k, i) && BWD(k, i+1))
+                deduced[i] |= DOT;
+        if (k < nblocks)
+            pre += data[k] + (k > 0);
+    }
+
+    /*
+     * For each block, first scan leftwards (so that we can count the
+     * non-dot squares from each position onwards) marking the
+     * positions where the block can start, using a spare bit of
+     * deduced[]. Then scan rightwards remembering the last possible
+     * start: a square is covered by the block in some valid
+     * placement iff it is within reach of that start.
+     */
+    for (k = 0, pre = 0; k < nblocks; k++) {
+        int c = data[k], start = -1, lo = (k > 0 ? pre + 1 : 0);
+        suf = total - pre - (k > 0);
+        for (i = len - suf + c - 1, run = 0; i >= lo; i--) {
+            run = (known[i] == DOT ? 0 : run + 1);
+            if (run >= c && i <= len - suf &&
+                (i == 0 ? k == 0 : known[i-1] != BLOCK && FWD(k, i-1)) &&
+                (i + c == len ? k == nblocks-1 :
+                 known[i+c] != BLOCK && BWD(k+1, i+c+1)))
+                deduced[i] |= DP_START;
+        }
+        for (i = lo; i < len - suf + c; i++) {
+            if (deduced[i] & DP_START) {
+                start = i;
+                deduced[i] &= ~DP_START;
+            }
+            if (start >= 0 && i < start + c)
+                deduced[i] |= BLOCK;
+        }
+        pre += c + (k > 0);
+    }
+
+#undef FWD
+#undef BWD
+    return true;
+}
+
+/*
+ * A memo of line solver results. The picture generator solves the
+ * same grid over and over with one clue square fewer each time, so
+ * the same clue meets the same pattern of known squares again and
+ * again. (Random grids from generate_soluble, on the other hand,
+ * almost never repeat a line, so it doesn't bother with a memo: only
+ * the standalone programs create one.)
+ *
+ * The memo is a fixed-size direct-mapped table: each key (the clue
+ * numbers plus the packed known squares of the line) hashes to a
+ * single slot, and a new result simply evicts whatever was there.
+ */
+#define LINE_CACHE_SLOTS 4096
+
+struct line_cache {
+    int max, keysize;
+    unsigned char *key;                /* scratch space to build a key */
+    int keylen;
+    unsigned char *keys;               /* LINE_CACHE_SLOTS * keysize */
+    int *keylens;                      /* 0 for an empty slot */
+    unsigned char *results;            /* LINE_CACHE_SLOTS * max */
+    unsigned long lookups, hits;
+};
+
+#if defined STANDALONE_SOLVER || defined STANDALONE_PICTURE_GENERATOR
+static struct line_cache *line_cache_new(int max)
+{
+    struct line_cache *cache = snew(struct line_cache);
+    int i;
+
+    /*
+     * A key is the line length and then the clue numbers as base-128
+     * varints (at most 5 bytes each, and at most (max+1)/2 clue
+     * numbers), a terminating zero byte, and the known squares
+     * packed four to a byte.
+     */
+    cache->max = max;
+    cache->keysize = 5 * (1 + (max+1)/2) + 1 + (max+3)/4;
+    cache->key = snewn(cache->keysize, unsigned char);
+    cache->keys = snewn(LINE_CACHE_SLOTS * cache->keysize, unsigned char);
+    cache->keylens = snewn(LINE_CACHE_SLOTS, int);
+    cache->results = snewn(LINE_CACHE_SLOTS * max, unsigned char);
+    for (i = 0; i < LINE_CACHE_SLOTS; i++)
+        cache->keylens[i] = 0;
+    cache->lookups = cache->hits = 0;
+    return cache;
+}
+
+static void line_cache_free(struct line_cache *cache)
+{
+    sfree(cache->key);
+    sfree(cache->keys);
+    sfree(cache->keylens);
+    sfree(cache->results);
+    sfree(cache);
+}
+#endif
+
+static int put_varint(unsigned char *p, unsigned int n)
+{
+    int len = 0;
+    while (n >= 0x80) {
+        p[len++] = 0x80 | (n & 0x7F);
+        n >>= 7;
+    }
+    p[len++] = n;
+    return len;
+}
+
+/*
+ * Look up a line in the cache. Returns true, with the line's
+ * deductions copied into 'deduced', on a hit. On a miss, returns
+ * false and sets *slot to the slot which line_cache_store should
+ * fill in once the line has been solved.
+ */
+static bool line_cache_lookup(struct line_cache *cache, const int *data,
+                              const unsigned char *known, int len,
+                              unsigned char *deduced, int *slot)
+{
+    unsigned char *key = cache->key;
+    unsigned long hash = 0;
+    int i, j, keylen;
+
+    keylen = put_varint(key, len);
+    for (i = 0; data[i]; i++)
+        keylen += put_varint(key + keylen, data[i]);
+    key[keylen++] = 0;
+    for (i = 0; i < len; i += 4) {
+        unsigned char byte = 0;
+        for (j = i; j < i+4 && j < len; j++)
+            byte |= known[j] << (2 * (j-i));
+        key[keylen++] = byte;
+    }
+    assert(keylen <= cache->keysize);
+    cache->keylen = keylen;
+
+    for (i = 0; i < keylen; i++)
+        hash = ((hash ^ key[i]) * 0x01000193UL) & 0xFFFFFFFFUL;
+    *slot = (int)((hash ^ (hash >> 16)) % LINE_CACHE_SLOTS);
+
+    cache->lookups++;
+    if (cache->keylens[*slot] != keylen ||
+        memcmp(cache->keys + *slot * cache->keysize, key, keylen))
+        return false;
+    cache->hits++;
+    memcpy(deduced, cache->results + *slot * cache->max, len);
+    return true;
+}
+
+/* Fill in the slot for the line most recently looked up. */
+static void line_cache_store(struct line_cache *cache, int slot,
+                             const unsigned char *deduced, int len)
+{
+    memcpy(cache->keys + slot * cache->keysize, cache->key, cache->keylen);
+    cache->keylens[slot] = cache->keylen;
+    memcpy(cache->results + slot * cache->max, deduced, len);
+}
+
+/*
+ * do_recurse and do_dp make the same deductions. On short lines
+ * do_recurse is quicker, because it has few placements to try and
+ * do_dp has to clear and fill in its tables whatever the line looks
+ * like; on long lines do_recurse's bad cases take over. So do_row
+ * uses do_dp for lines at least this long.
+ */
+#define DP_MIN_LEN 36
+
 static bool do_row(unsigned char *known, unsigned char *deduced,
                    unsigned char *row,
                    unsigned char *minpos_done, unsigned char *maxpos_done,
                    unsigned char *minpos_ok, unsigned char *maxpos_ok,
+                   unsigned char *dpspace,
                    unsigned char *start, int len, int step, int *data,
-                   unsigned int *changed
+                   unsigned int *changed, struct line_cache *cache
 #ifdef STANDALONE_SOLVER
                    , const char *rowcol, int index, int cluewid
 #endif
                    )
 {
-    int rowlen, i, freespace;
+    int rowlen, i, freespace, slot = 0;
     bool done_any;
 
     assert(len >= 0);   /* avoid compile warnings about the memsets below */
@@ -468,9 +722,16 @@ static bool do_row(unsigned char *known, unsigned char *deduced,
         memset(deduced, DOT, len);
     } else if (rowlen == 1 && data[0] == len) {
         memset(deduced, BLOCK, len);
-    } else {
-        do_recurse(known, deduced, row, minpos_done, maxpos_done, minpos_ok,
-                   maxpos_ok, data, len, freespace, 0, 0);
+    } else if (!cache || !line_cache_lookup(cache, data, known, len,
+                                            deduced, &slot)) {
+        if (len < DP_MIN_LEN)
+            do_recurse(known, deduced, row, minpos_done, maxpos_done,
+                       minpos_ok, maxpos_ok, data, len, freespace, 0, 0);
+        else
+            do_dp(known, deduced, dpspace, dpspace + (rowlen+1) * (len+1),
+                  data, rowlen, len);
+        if (cache)
+            line_cache_store(cache, slot, deduced, len);
     }
 
     done_any = false;
@@ -504,11 +765,19 @@ static bool do_row(unsigned char *known, unsigned char *deduced,
     return done_any;
 }
 
+/*
+ * Size of the workspace passed to solve_puzzle: seven arrays of max
+ * bytes for do_row and do_recurse, followed by do_dp's two tables,
+ * each of (nblocks+1) * (len+1) flags for a line with at most
+ * (max+1)/2 blocks.
+ */
+#define WORKSPACE_SIZE(max) (7 * (max) + 2 * (((max)+3)/2) * ((max)+1))
+
 static bool solve_puzzle(const game_state *state, unsigned char *grid,
                          int w, int h,
                          unsigned char *matrix, unsigned char *workspace,
                          unsigned int *changed_h, unsigned int *changed_w,
-                         int *rowdata
+                         int *rowdata, struct line_cache *cache
 #ifdef STANDALONE_SOLVER
                          , int cluewid
 #else
@@ -611,7 +880,7 @@ static bool solve_puzzle(const game_state *state, unsigned char *grid,
 		    do_row(workspace, workspace+max, workspace+2*max,
 			   workspace+3*max, workspace+4*max,
 			   workspace+5*max, workspace+6*max,
-			   matrix+i*w, w, 1, rowdata, changed_w
+			   workspace+7*max, matrix+i*w, w, 1, rowdata, changed_w, cache
 #ifdef STANDALONE_SOLVER
 			   , "row", i+1, cluewid
 #endif
@@ -635,7 +904,7 @@ static bool solve_puzzle(const game_state *state, unsigned char *grid,
 		    do_row(workspace, workspace+max, workspace+2*max,
 			   workspace+3*max, workspace+4*max,
 			   workspace+5*max, workspace+6*max,
-			   matrix+i, h, w, rowdata, changed_h
+			   workspace+7*max, matrix+i, h, w, rowdata, changed_h, cache
 #ifdef STANDALONE_SOLVER
 			   , "col", i+1, cluewid
 #endif
@@ -674,7 +943,7 @@ static unsigned char *generate_soluble(random_state *rs, int w, int h)
     grid = snewn(w*h, unsigned char);
     /* Allocate this here, to avoid having to reallocate it again for every geneerated grid */
     matrix = snewn(w*h, unsigned char);
-    workspace = snewn(max*7, unsigned char);
+    workspace = snewn(WORKSPACE_SIZE(max), unsigned char);
     changed_h = snewn(max+1, unsigned int);
     changed_w = snewn(max+1, unsigned int);
     rowdata = snewn(max+1, int);
@@ -715,7 +984,7 @@ static unsigned char *generate_soluble(random_state *rs, int w, int h)
             continue;
 
 	ok = solve_puzzle(NULL, grid, w, h, matrix, workspace,
-			  changed_h, changed_w, rowdata, 0);
+			  changed_h, changed_w, rowdata, NULL, 0);
     } while (!ok);
 
     sfree(matrix);
@@ -770,17 +1039,19 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 
     {
         unsigned char *matrix = snewn(params->w*params->h, unsigned char);
-        unsigned char *workspace = snewn(max*7, unsigned char);
+        unsigned char *workspace = snewn(WORKSPACE_SIZE(max), unsigned char);
         unsigned int *changed_h = snewn(max+1, unsigned int);
         unsigned int *changed_w = snewn(max+1, unsigned int);
         int *rowdata = snewn(max+1, int);
+        struct line_cache *cache = line_cache_new(max);
         for (i = 0; i < params->w * params->h; i++) {
             state->common->immutable[index[i]] = false;
             if (!solve_puzzle(state, grid, params->w, params->h,
                               matrix, workspace, changed_h, changed_w,
-                              rowdata, 0))
+                              rowdata, cache, 0))
                 state->common->immutable[index[i]] = true;
         }
+        line_cache_free(cache);
         sfree(workspace);
         sfree(changed_h);
         sfree(changed_w);
@@ -1097,13 +1368,13 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 
     max = max(w, h);
     matrix = snewn(w*h, unsigned char);
-    workspace = snewn(max*7, unsigned char);
+    workspace = snewn(WORKSPACE_SIZE(max), unsigned char);
     changed_h = snewn(max+1, unsigned int);
     changed_w = snewn(max+1, unsigned int);
     rowdata = snewn(max+1, int);
 
     ok = solve_puzzle(state, NULL, w, h, matrix, workspace,
-		      changed_h, changed_w, rowdata, 0);
+		      changed_h, changed_w, rowdata, NULL, 0);
 
     sfree(workspace);
     sfree(changed_h);
@@ -2094,6 +2365,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -2158,13 +2430,15 @@ int main(int argc, char **argv)
 	unsigned char *matrix, *workspace;
 	unsigned int *changed_h, *changed_w;
 	int *rowdata;
+	struct line_cache *cache;
 
 	matrix = snewn(w*h, unsigned char);
 	max = max(w, h);
-	workspace = snewn(max*7, unsigned char);
+	workspace = snewn(WORKSPACE_SIZE(max), unsigned char);
 	changed_h = snewn(max+1, unsigned int);
 	changed_w = snewn(max+1, unsigned int);
 	rowdata = snewn(max+1, int);
+	cache = line_cache_new(max);
 
 	if (verbose) {
 	    int thiswid;
@@ -2185,7 +2459,7 @@ int main(int argc, char **argv)
 	}
 
 	solve_puzzle(s, NULL, w, h, matrix, workspace,
-		     changed_h, changed_w, rowdata, cluewid);
+		     changed_h, changed_w, rowdata, cache, cluewid);
 
 	for (i = 0; i < h; i++) {
 	    for (j = 0; j < w; j++) {
@@ -2197,6 +2471,11 @@ int main(int argc, char **argv)
 	    }
 	    printf("\n");
 	}
+
+	printf("line cache: %lu lookups, %lu hits (%.1f%%)\n",
+	       cache->lookups, cache->hits,
+	       cache->lookups ? 100.0 * cache->hits / cache->lookups : 0.0);
+	line_cache_free(cache);
     }
 
     return 0;
@@ -239,6 +239,38 @@ static vector xform_coord(vector vo, int shrink, vector vtrans, int ang)
 
 #define XFORM(n,o,s,a) vs[(n)] = xform_coord(v_edge, (s), vs[(o)], (a))
 
+/*
+ * Each call below is responsible for one half-tile triangle, and
+ * everything it recurses into lies inside that triangle. So if the
+ * caller has given us a clipping rectangle, and the triangle is well
+ * clear of it, we can skip the whole subtree. (The tile we'd report
+ * for the triangle sticks out of it by a mirror-image half-tile, so
+ * rather than worrying about exactly how far, we allow a margin of
+ * the triangle's own size, which is more than enough.)
+ */
+static bool clipped(penrose_state *state, vector *vs)
+{
+    double x0, x1, y0, y1, margin;
+    int i;
+
+    if (!state->clip)
+        return false;
+
+    x0 = x1 = v_x(vs, 0);
+    y0 = y1 = v_y(vs, 0);
+    for (i = 1; i < 3; i++) {
+        double x = v_x(vs, i), y = v_y(vs, i);
+        if (x0 > x) x0 = x;
+        if (x1 < x) x1 = x;
+        if (y0 > y) y0 = y;
+        if (y1 < y) y1 = y;
+    }
+    margin = (x1 - x0 > y1 - y0) ? x1 - x0 : y1 - y0;
+
+    return (x1 + margin < state->xmin || x0 - margin > state->xmax ||
+            y1 + margin < state->ymin || y0 - margin > state->ymax);
+}
+
 static int penrose_p2_small(penrose_state *state, int depth, int flip,
                             vector v_orig, vector v_edge);
 
@@ -247,16 +279,17 @@ static int penrose_p2_large(penrose_state *state, int depth, int flip,
 {
     vector vv_orig, vv_edge;
 
-#ifdef DEBUG_PENROSE
     {
         vector vs[3];
         vs[0] = v_orig;
         XFORM(1, 0, 0, 0);
         XFORM(2, 0, 0, -36*flip);
 
+        if (clipped(state, vs)) return 0;
+#ifdef DEBUG_PENROSE
         state->new_tile(state, vs, 3, depth);
-    }
 #endif
+    }
 
     if (flip > 0) {
         vector vs[4];
@@ -289,16 +322,17 @@ static int penrose_p2_small(penrose_state *state, int depth, int flip,
 {
     vector vv_orig;
 
-#ifdef DEBUG_PENROSE
     {
         vector vs[3];
         vs[0] = v_orig;
         XFORM(1, 0, 0, 0);
         XFORM(2, 0, -1, -36*flip);
 
+        if (clipped(state, vs)) return 0;
+#ifdef DEBUG_PENROSE
         state->new_tile(state, vs, 3, depth);
-    }
 #endif
+    }
 
     if (flip > 0) {
         vector vs[4];
@@ -332,16 +366,17 @@ static int penrose_p3_large(penrose_state *state, int depth, int flip,
 {
     vector vv_orig;
 
-#ifdef DEBUG_PENROSE
     {
         vector vs[3];
         vs[0] = v_orig;
         XFORM(1, 0, 1, 0);
         XFORM(2, 0, 0, -36*flip);
 
+        if (clipped(state, vs)) return 0;
+#ifdef DEBUG_PENROSE
         state->new_tile(state, vs, 3, depth);
-    }
 #endif
+    }
 
     if (flip > 0) {
         vector vs[4];
@@ -377,16 +412,17 @@ static int penrose_p3_small(penrose_state *state, int depth, int flip,
 {
     vector vv_orig;
 
-#ifdef DEBUG_PENROSE
     {
         vector vs[3];
         vs[0] = v_orig;
         XFORM(1, 0, 0, 0);
         XFORM(2, 0, 0, -36*flip);
 
+        if (clipped(state, vs)) return 0;
+#ifdef DEBUG_PENROSE
         state->new_tile(state, vs, 3, depth);
-    }
 #endif
+    }
 
     if (flip > 0) {
         vector vs[4];
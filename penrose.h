@@ -38,6 +38,14 @@ struct penrose_state {
 
     tile_callback new_tile;
     void *ctx;          /* for callback */
+
+    /* If 'clip' is true, don't bother recursing into (or reporting)
+     * any part of the tiling which is nowhere near the rectangle
+     * xmin <= x <= xmax, ymin <= y <= ymax. Every tile lying wholly
+     * inside that rectangle is still reported, in the same order as
+     * without clipping. */
+    bool clip;
+    double xmin, xmax, ymin, ymax;
 };
 
 enum { PENROSE_P2, PENROSE_P3 };
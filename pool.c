@@ -0,0 +1,626 @@
+/*
+ * pool.c: a persistent stock of pre-generated game descriptions,
+ * kept on disk so that a front end can hand out a new game of a
+ * slow-to-generate preset instantly instead of waiting for the
+ * generator.
+ */
+
+#if !defined NO_MMAP && !defined _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* for mmap and friends under -std=c99 */
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef NO_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "puzzles.h"
+#include "tree234.h"
+
+/*
+ * File format. The file starts with the 8-byte magic number below,
+ * followed by nothing but records. Each record is
+ *
+ *  - a 4-byte little-endian payload length
+ *  - a 1-byte record type
+ *  - the payload.
+ *
+ * A game record (type 'G') adds a game to the pool. Its payload is
+ * three NUL-terminated strings: the pool key, the game description
+ * and the aux_info (empty if there is none).
+ *
+ * A take record (type 'T') removes a game from the pool again. Its
+ * payload is the 8-byte little-endian file offset of the game record
+ * being taken.
+ *
+ * The file is only ever appended to (except by pool_compact, which
+ * rewrites it from scratch), and every record is written with a
+ * single write call in append mode, so several processes can add
+ * games to the same pool at once. Taking a game is done while
+ * holding an advisory lock on the whole file, so that two processes
+ * can't both take the same one. Nothing is ever read from the file
+ * except by scanning it from start to end, so on platforms that
+ * support it we simply map the whole file into memory and point our
+ * index straight into the mapping.
+ *
+ * If a writer dies halfway through a record, the scan stops at the
+ * truncated record. Anything after it is ignored until pool_compact
+ * rewrites the file.
+ */
+
+#define POOL_MAGIC "SGTPOOL1"
+#define POOL_MAGIC_LEN 8
+#define POOL_HEADER_LEN 5
+#define POOL_OFFSET_LEN 8
+
+/*
+ * One of these for each distinct key in the pool, holding the
+ * offsets of its untaken game records, oldest first, in a circular
+ * buffer.
+ */
+struct pool_stock {
+    char *key;
+    size_t *offsets;
+    int start, count, size;
+};
+
+struct puzzle_pool {
+    char *filename;
+#ifndef NO_MMAP
+    int fd;
+#else
+    FILE *fp;
+#endif
+    unsigned char *data;               /* contents of the whole file */
+    size_t datalen;
+    size_t scanned;                    /* end of the last whole record */
+    tree234 *stocks;                   /* struct pool_stock, by key */
+
+    int lowwater;
+    void (*refill)(void *ctx, const char *key, int count);
+    void *refillctx;
+};
+
+static int stockcmp(void *av, void *bv)
+{
+    const struct pool_stock *a = (const struct pool_stock *)av;
+    const struct pool_stock *b = (const struct pool_stock *)bv;
+    return strcmp(a->key, b->key);
+}
+
+static int stockfind(void *av, void *bv)
+{
+    const char *a = (const char *)av;
+    const struct pool_stock *b = (const struct pool_stock *)bv;
+    return strcmp(a, b->key);
+}
+
+static struct pool_stock *find_stock(puzzle_pool *pool, const char *key,
+                                     bool create)
+{
+    struct pool_stock *stock = find234(pool->stocks, (void *)key, stockfind);
+
+    if (!stock && create) {
+        stock = snew(struct pool_stock);
+        stock->key = dupstr(key);
+        stock->offsets = NULL;
+        stock->start = stock->count = stock->size = 0;
+        add234(pool->stocks, stock);
+    }
+    return stock;
+}
+
+static void stock_push(struct pool_stock *stock, size_t offset)
+{
+    if (stock->count == stock->size) {
+        int newsize = stock->size * 3 / 2 + 16, i;
+        size_t *newoffsets = snewn(newsize, size_t);
+        for (i = 0; i < stock->count; i++)
+            newoffsets[i] = stock->offsets[(stock->start + i) % stock->size];
+        sfree(stock->offsets);
+        stock->offsets = newoffsets;
+        stock->start = 0;
+        stock->size = newsize;
+    }
+    stock->offsets[(stock->start + stock->count++) % stock->size] = offset;
+}
+
+static size_t stock_pop(struct pool_stock *stock)
+{
+    size_t offset;
+
+    assert(stock->count > 0);
+    offset = stock->offsets[stock->start];
+    stock->start = (stock->start + 1) % stock->size;
+    stock->count--;
+    return offset;
+}
+
+/*
+ * Remove an arbitrary offset from a stock. It's almost always at the
+ * front, since games are taken in the order they were added, so
+ * there's no point in anything cleverer than a linear search.
+ */
+static void stock_remove(struct pool_stock *stock, size_t offset)
+{
+    int i, j;
+
+    for (i = 0; i < stock->count; i++)
+        if (stock->offsets[(stock->start + i) % stock->size] == offset)
+            break;
+    if (i == stock->count)
+        return;                        /* already taken by us */
+    if (i == 0) {
+        stock_pop(stock);
+        return;
+    }
+    for (j = i; j+1 < stock->count; j++)
+        stock->offsets[(stock->start + j) % stock->size] =
+            stock->offsets[(stock->start + j + 1) % stock->size];
+    stock->count--;
+}
+
+static unsigned long get_le32(const unsigned char *p)
+{
+    return ((unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+            ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24));
+}
+
+static void put_le32(unsigned char *p, unsigned long val)
+{
+    int i;
+    for (i = 0; i < 4; i++, val >>= 8)
+        p[i] = (unsigned char)val;
+}
+
+static size_t get_offset(const unsigned char *p)
+{
+    size_t val = 0;
+    int i;
+    for (i = POOL_OFFSET_LEN; i-- > 0 ;)
+        val = (val << 4 << 4) | p[i];  /* two shifts: size_t may be 32 bits */
+    return val;
+}
+
+static void put_offset(unsigned char *p, size_t val)
+{
+    int i;
+    for (i = 0; i < POOL_OFFSET_LEN; i++, val = val >> 4 >> 4)
+        p[i] = (unsigned char)val;
+}
+
+/*
+ * Find the strings in the game record at a given offset. Returns
+ * false if there isn't a well-formed game record there.
+ */
+static bool game_record(puzzle_pool *pool, size_t offset, const char **key,
+                        const char **desc, const char **aux)
+{
+    const unsigned char *p = pool->data + offset, *end;
+    const char *strs[3];
+    int i;
+
+    if (offset < POOL_MAGIC_LEN || offset > pool->scanned - POOL_HEADER_LEN ||
+        p[4] != 'G' ||
+        get_le32(p) > pool->scanned - offset - POOL_HEADER_LEN)
+        return false;
+    end = p + POOL_HEADER_LEN + get_le32(p);
+    p += POOL_HEADER_LEN;
+    for (i = 0; i < 3; i++) {
+        const unsigned char *nul = memchr(p, '\0', end - p);
+        if (!nul)
+            return false;
+        strs[i] = (const char *)p;
+        p = nul + 1;
+    }
+    if (p != end)
+        return false;
+    if (key) *key = strs[0];
+    if (desc) *desc = strs[1];
+    if (aux) *aux = strs[2];
+    return true;
+}
+
+/*
+ * Platform layer: open the file, bring pool->data up to date with
+ * its current contents, append a record to it, and lock and unlock
+ * it.
+ */
+#ifndef NO_MMAP
+
+static const char *pool_sys_open(puzzle_pool *pool)
+{
+    pool->fd = open(pool->filename, O_RDWR | O_APPEND);
+    if (pool->fd < 0 && errno == ENOENT) {
+        /*
+         * Write a new file's magic number under a temporary name and
+         * then link it into place, so that nobody can ever open the
+         * pool file and find it empty. If somebody else creates it
+         * first, our link fails and we use theirs.
+         */
+        char *tmpname = snewn(strlen(pool->filename) + 32, char);
+        int fd;
+        bool ok;
+
+        sprintf(tmpname, "%s.%lu.tmp", pool->filename,
+                (unsigned long)getpid());
+        fd = open(tmpname, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            sfree(tmpname);
+            return "Unable to create pool file";
+        }
+        ok = write(fd, POOL_MAGIC, POOL_MAGIC_LEN) == POOL_MAGIC_LEN;
+        if (close(fd) < 0)
+            ok = false;
+        if (ok && link(tmpname, pool->filename) < 0 && errno != EEXIST)
+            ok = false;
+        unlink(tmpname);
+        sfree(tmpname);
+        if (!ok)
+            return "Unable to write to pool file";
+
+        pool->fd = open(pool->filename, O_RDWR | O_APPEND);
+    }
+    if (pool->fd < 0)
+        return "Unable to open pool file";
+    return NULL;
+}
+
+static bool pool_sys_load(puzzle_pool *pool)
+{
+    struct stat st;
+    void *map;
+
+    if (fstat(pool->fd, &st) < 0)
+        return false;
+    if ((size_t)st.st_size <= pool->datalen)
+        return true;
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, pool->fd, 0);
+    if (map == MAP_FAILED)
+        return false;
+    if (pool->data)
+        munmap(pool->data, pool->datalen);
+    pool->data = map;
+    pool->datalen = st.st_size;
+    return true;
+}
+
+static bool pool_sys_append(puzzle_pool *pool, const void *buf, size_t len)
+{
+    return write(pool->fd, buf, len) == (ssize_t)len;
+}
+
+static bool pool_sys_lock(puzzle_pool *pool, bool lock)
+{
+    struct flock fl;
+
+    fl.l_type = lock ? F_WRLCK : F_UNLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = 0;
+    fl.l_len = 0;                      /* the whole file, however long */
+    while (fcntl(pool->fd, F_SETLKW, &fl) < 0)
+        if (errno != EINTR)
+            return false;
+    return true;
+}
+
+static void pool_sys_close(puzzle_pool *pool)
+{
+    if (pool->data)
+        munmap(pool->data, pool->datalen);
+    if (pool->fd >= 0)
+        close(pool->fd);
+}
+
+#else /* NO_MMAP */
+
+static const char *pool_sys_open(puzzle_pool *pool)
+{
+    long len;
+
+    pool->fp = fopen(pool->filename, "ab");
+    if (!pool->fp)
+        return "Unable to open pool file";
+    fseek(pool->fp, 0, SEEK_END);
+    len = ftell(pool->fp);
+    if (len == 0 && (fwrite(POOL_MAGIC, 1, POOL_MAGIC_LEN, pool->fp) !=
+                     POOL_MAGIC_LEN || fflush(pool->fp)))
+        return "Unable to write to pool file";
+    return NULL;
+}
+
+static bool pool_sys_load(puzzle_pool *pool)
+{
+    FILE *fp = fopen(pool->filename, "rb");
+    long len;
+
+    if (!fp)
+        return false;
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    if (len > 0 && (size_t)len > pool->datalen) {
+        pool->data = sresize(pool->data, len, unsigned char);
+        fseek(fp, pool->datalen, SEEK_SET);
+        pool->datalen += fread(pool->data + pool->datalen, 1,
+                               len - pool->datalen, fp);
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool pool_sys_append(puzzle_pool *pool, const void *buf, size_t len)
+{
+    return (fwrite(buf, 1, len, pool->fp) == len && !fflush(pool->fp));
+}
+
+/*
+ * Standard C has no file locking, so here we have to trust that only
+ * one process takes games out of the pool at a time.
+ */
+static bool pool_sys_lock(puzzle_pool *pool, bool lock)
+{
+    return true;
+}
+
+static void pool_sys_close(puzzle_pool *pool)
+{
+    sfree(pool->data);
+    if (pool->fp)
+        fclose(pool->fp);
+}
+
+#endif /* NO_MMAP */
+
+/*
+ * Index any whole records which have appeared at the end of the file
+ * since we last looked.
+ */
+static void pool_scan(puzzle_pool *pool)
+{
+    const char *key;
+
+    while (pool->datalen - pool->scanned >= POOL_HEADER_LEN) {
+        const unsigned char *p = pool->data + pool->scanned;
+        unsigned long len = get_le32(p);
+        size_t offset = pool->scanned;
+
+        if (len > pool->datalen - pool->scanned - POOL_HEADER_LEN)
+            break;                     /* incomplete record */
+        pool->scanned += POOL_HEADER_LEN + len;
+
+        if (p[4] == 'G') {
+            if (game_record(pool, offset, &key, NULL, NULL))
+                stock_push(find_stock(pool, key, true), offset);
+        } else if (p[4] == 'T' && len == POOL_OFFSET_LEN) {
+            size_t taken = get_offset(p + POOL_HEADER_LEN);
+            struct pool_stock *stock;
+            if (game_record(pool, taken, &key, NULL, NULL) &&
+                (stock = find_stock(pool, key, false)) != NULL)
+                stock_remove(stock, taken);
+        }
+    }
+}
+
+static bool pool_append(puzzle_pool *pool, char type,
+                        const void *payload, size_t len)
+{
+    unsigned char *buf = snewn(POOL_HEADER_LEN + len, unsigned char);
+    bool ret;
+
+    put_le32(buf, len);
+    buf[4] = type;
+    memcpy(buf + POOL_HEADER_LEN, payload, len);
+    ret = pool_sys_append(pool, buf, POOL_HEADER_LEN + len);
+    sfree(buf);
+    return ret;
+}
+
+puzzle_pool *pool_open(const char *filename, const char **error)
+{
+    puzzle_pool *pool = snew(puzzle_pool);
+    const char *err;
+
+    pool->filename = dupstr(filename);
+#ifndef NO_MMAP
+    pool->fd = -1;
+#else
+    pool->fp = NULL;
+#endif
+    pool->data = NULL;
+    pool->datalen = 0;
+    pool->scanned = POOL_MAGIC_LEN;
+    pool->stocks = newtree234(stockcmp);
+    pool->lowwater = 0;
+    pool->refill = NULL;
+    pool->refillctx = NULL;
+
+    err = pool_sys_open(pool);
+    if (!err && !pool_sys_load(pool))
+        err = "Unable to read pool file";
+    if (!err && (pool->datalen < POOL_MAGIC_LEN ||
+                 memcmp(pool->data, POOL_MAGIC, POOL_MAGIC_LEN)))
+        err = "File is not a puzzle pool";
+    if (err) {
+        if (error)
+            *error = err;
+        pool_free(pool);
+        return NULL;
+    }
+
+    pool_scan(pool);
+    return pool;
+}
+
+void pool_free(puzzle_pool *pool)
+{
+    struct pool_stock *stock;
+
+    if (!pool)
+        return;
+    pool_sys_close(pool);
+    while ((stock = delpos234(pool->stocks, 0)) != NULL) {
+        sfree(stock->key);
+        sfree(stock->offsets);
+        sfree(stock);
+    }
+    freetree234(pool->stocks);
+    sfree(pool->filename);
+    sfree(pool);
+}
+
+void pool_refresh(puzzle_pool *pool)
+{
+    if (pool_sys_load(pool))
+        pool_scan(pool);
+}
+
+char *pool_key(const game *thegame, const game_params *params)
+{
+    char *encoded = thegame->encode_params(params, true);
+    char *key = snewn(strlen(thegame->htmlhelp_topic) +
+                      strlen(encoded) + 2, char);
+    sprintf(key, "%s:%s", thegame->htmlhelp_topic, encoded);
+    sfree(encoded);
+    return key;
+}
+
+int pool_count(puzzle_pool *pool, const char *key)
+{
+    struct pool_stock *stock = find_stock(pool, key, false);
+    return stock ? stock->count : 0;
+}
+
+bool pool_add(puzzle_pool *pool, const char *key, const char *desc,
+              const char *aux)
+{
+    size_t keylen = strlen(key) + 1, desclen = strlen(desc) + 1;
+    size_t auxlen = (aux ? strlen(aux) : 0) + 1;
+    char *payload = snewn(keylen + desclen + auxlen, char);
+    bool ret;
+
+    memcpy(payload, key, keylen);
+    memcpy(payload + keylen, desc, desclen);
+    memcpy(payload + keylen + desclen, aux ? aux : "", auxlen);
+    ret = pool_append(pool, 'G', payload, keylen + desclen + auxlen);
+    sfree(payload);
+
+    /*
+     * Other processes may have appended to the file too, so we don't
+     * know our record's offset until we scan for it.
+     */
+    if (ret)
+        pool_refresh(pool);
+    return ret;
+}
+
+bool pool_take(puzzle_pool *pool, const char *key, char **desc, char **aux)
+{
+    struct pool_stock *stock;
+    unsigned char taken[POOL_OFFSET_LEN];
+    const char *d, *a;
+    size_t offset;
+    bool ok = false;
+
+    /*
+     * Other processes may be taking games from the same file. So,
+     * holding the lock, we catch up with everything they've taken so
+     * far, and record our own take before letting go.
+     */
+    if (!pool_sys_lock(pool, true))
+        return false;
+    pool_refresh(pool);
+    stock = find_stock(pool, key, false);
+    if (stock && stock->count > 0) {
+        offset = stock_pop(stock);
+        put_offset(taken, offset);
+        /* If we can't record the take, we mustn't hand the game out. */
+        ok = (game_record(pool, offset, NULL, &d, &a) &&
+              pool_append(pool, 'T', taken, POOL_OFFSET_LEN));
+    }
+    pool_sys_lock(pool, false);
+    if (!ok)
+        return false;
+
+    *desc = dupstr(d);
+    *aux = *a ? dupstr(a) : NULL;
+
+    if (pool->refill && stock->count < pool->lowwater)
+        pool->refill(pool->refillctx, key, stock->count);
+    return true;
+}
+
+void pool_set_refill(puzzle_pool *pool, int lowwater,
+                     void (*refill)(void *ctx, const char *key, int count),
+                     void *ctx)
+{
+    pool->lowwater = lowwater;
+    pool->refill = refill;
+    pool->refillctx = ctx;
+}
+
+bool pool_compact(puzzle_pool *pool)
+{
+    char *tmpname = snewn(strlen(pool->filename) + 5, char);
+    struct pool_stock *stock;
+    puzzle_pool *newpool;
+    FILE *fp;
+    bool ok;
+    int i, j;
+
+    pool_refresh(pool);
+
+    sprintf(tmpname, "%s.new", pool->filename);
+    fp = fopen(tmpname, "wb");
+    if (!fp) {
+        sfree(tmpname);
+        return false;
+    }
+    ok = fwrite(POOL_MAGIC, 1, POOL_MAGIC_LEN, fp) == POOL_MAGIC_LEN;
+    for (i = 0; ok && (stock = index234(pool->stocks, i)) != NULL; i++) {
+        for (j = 0; ok && j < stock->count; j++) {
+            size_t offset = stock->offsets[(stock->start + j) % stock->size];
+            size_t len = POOL_HEADER_LEN + get_le32(pool->data + offset);
+            ok = fwrite(pool->data + offset, 1, len, fp) == len;
+        }
+    }
+    if (fclose(fp))
+        ok = false;
+
+    /* rename() may refuse to replace an existing file on some systems */
+    if (ok && rename(tmpname, pool->filename) != 0)
+        ok = (remove(pool->filename) == 0 &&
+              rename(tmpname, pool->filename) == 0);
+    if (!ok) {
+        remove(tmpname);
+        sfree(tmpname);
+        return false;
+    }
+    sfree(tmpname);
+
+    /*
+     * Swap the freshly opened pool's innards into the caller's
+     * handle, keeping the refill settings.
+     */
+    newpool = pool_open(pool->filename, NULL);
+    if (!newpool)
+        return false;
+    newpool->lowwater = pool->lowwater;
+    newpool->refill = pool->refill;
+    newpool->refillctx = pool->refillctx;
+    {
+        puzzle_pool tmp = *pool;
+        *pool = *newpool;
+        *newpool = tmp;
+    }
+    pool_free(newpool);
+    return true;
+}
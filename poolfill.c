@@ -0,0 +1,270 @@
+/*
+ * poolfill.c: Top up a puzzle pool (see pool.c) with freshly
+ * generated games.
+ *
+ * Usage:
+ *
+ *   poolfill [--stock <n>] [--seed <seed>] [--compact] <poolfile>
+ *            [<game>[:<params>] ...]
+ *
+ * For every preset of every puzzle (or just the ones named on the
+ * command line), games are generated until the pool holds at least
+ * <n> untaken games for that preset (default 100). Each game is
+ * checked with validate_desc, and if the puzzle supplied aux_info, by
+ * solving the game with it, before it goes into the pool.
+ *
+ * <game> is matched against either the puzzle's name or its help
+ * topic (e.g. "Same Game" or "samegame"). If <params> is given, only
+ * that parameter string is filled, instead of every preset.
+ *
+ * This is meant to be run in the background, either periodically or
+ * from the refill callback of a program handing games out of the
+ * pool with midend_new_game_from_pool. Several copies can safely
+ * fill the same pool at once, e.g. one per slow preset. Without
+ * --seed, each copy seeds itself from the time and its process ID,
+ * so copies started together still generate different games.
+ *
+ * --compact first rewrites the pool file without the games already
+ * taken from it. Nothing else may have the pool open while that
+ * happens.
+ */
+
+#if !defined NO_MMAP && !defined _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* for getpid under -std=c99 */
+#endif
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef NO_MMAP                        /* i.e. as pool.c, we have POSIX */
+#include <unistd.h>
+#endif
+
+#include "puzzles.h"
+
+struct fill_options {
+    int stock;
+    random_state *rs;
+};
+
+/*
+ * Generate one game, returning NULL on success with the
+ * description and aux_info filled in, or an error message.
+ */
+static const char *generate_one(midend *me, const game *ourgame,
+                                const game_params *params,
+                                random_state *rs, char **descp, char **auxp)
+{
+    char *desc, *aux = NULL;
+    const char *err;
+
+    desc = ourgame->new_desc(params, rs, &aux, true);
+    err = ourgame->validate_desc(params, desc);
+
+    if (!err && aux && ourgame->can_solve) {
+        game_state *state = ourgame->new_game(me, params, desc), *solved;
+        char *move = ourgame->solve(state, state, aux, &err);
+
+        if (move) {
+            solved = ourgame->execute_move(state, move);
+            if (solved)
+                ourgame->free_game(solved);
+            else
+                err = "Solution from aux_info could not be executed";
+            sfree(move);
+        } else if (!err) {
+            err = "Game could not be solved from its aux_info";
+        }
+        ourgame->free_game(state);
+    }
+
+    if (err) {
+        sfree(desc);
+        sfree(aux);
+        return err;
+    }
+    *descp = desc;
+    *auxp = aux;
+    return NULL;
+}
+
+static bool fill_params(puzzle_pool *pool, midend *me, const game *ourgame,
+                        const game_params *params,
+                        const struct fill_options *opts)
+{
+    char *key = pool_key(ourgame, params), *desc = NULL, *aux = NULL;
+    const char *err = NULL;
+    int added = 0;
+
+    pool_refresh(pool);
+    while (pool_count(pool, key) < opts->stock) {
+        bool written;
+
+        err = generate_one(me, ourgame, params, opts->rs, &desc, &aux);
+        if (err)
+            break;
+        written = pool_add(pool, key, desc, aux);
+        sfree(desc);
+        sfree(aux);
+        if (!written) {
+            err = "Unable to write to pool file";
+            break;
+        }
+        added++;
+    }
+
+    if (err)
+        fprintf(stderr, "%s: %s\n", key, err);
+    else
+        printf("%s: added %d, stock %d\n", key, added, pool_count(pool, key));
+    fflush(stdout);
+    sfree(key);
+    return err == NULL;
+}
+
+static bool fill_menu(puzzle_pool *pool, midend *me, const game *ourgame,
+                      struct preset_menu *menu,
+                      const struct fill_options *opts)
+{
+    bool ok = true;
+    int i;
+
+    for (i = 0; i < menu->n_entries; i++) {
+        if (menu->entries[i].params) {
+            if (!fill_params(pool, me, ourgame, menu->entries[i].params,
+                             opts))
+                ok = false;
+        } else {
+            if (!fill_menu(pool, me, ourgame, menu->entries[i].submenu,
+                           opts))
+                ok = false;
+        }
+    }
+    return ok;
+}
+
+static bool fill_game(puzzle_pool *pool, const game *ourgame,
+                      const char *paramstr, const struct fill_options *opts)
+{
+    midend *me = midend_new(NULL, ourgame, NULL, NULL);
+    bool ok;
+
+    if (paramstr) {
+        game_params *params = ourgame->default_params();
+        const char *err;
+
+        ourgame->decode_params(params, paramstr);
+        err = ourgame->validate_params(params, true);
+        if (err) {
+            fprintf(stderr, "%s %s: %s\n", ourgame->name, paramstr, err);
+            ok = false;
+        } else {
+            ok = fill_params(pool, me, ourgame, params, opts);
+        }
+        ourgame->free_params(params);
+    } else {
+        ok = fill_menu(pool, me, ourgame, midend_get_presets(me, NULL), opts);
+    }
+
+    midend_free(me);
+    return ok;
+}
+
+static const char usage[] =
+    "[--stock <n>] [--seed <seed>] [--compact] "
+    "<poolfile> [<game>[:<params>] ...]";
+
+int main(int argc, char **argv)
+{
+    const char *pname = argv[0];
+    const char *poolfile = NULL, *seed = NULL, *err;
+    const char **games = snewn(argc, const char *);
+    struct fill_options opts;
+    puzzle_pool *pool;
+    bool compact = false, ok = true;
+    int ngames = 0, i;
+
+    opts.stock = 100;
+
+    while (--argc > 0) {
+        const char *p = *++argv;
+        if (!strcmp(p, "--stock")) {
+            if (--argc <= 0)
+                usage_exit(pname, "option requires an argument", usage);
+            opts.stock = atoi(*++argv);
+            if (opts.stock < 1)
+                usage_exit(pname, "--stock must be at least 1", usage);
+        } else if (!strcmp(p, "--seed")) {
+            if (--argc <= 0)
+                usage_exit(pname, "option requires an argument", usage);
+            seed = *++argv;
+        } else if (!strcmp(p, "--compact")) {
+            compact = true;
+        } else if (!strcmp(p, "--help")) {
+            usage_exit(pname, NULL, usage);
+        } else if (p[0] == '-') {
+            usage_exit(pname, "unrecognised option", usage);
+        } else if (!poolfile) {
+            poolfile = p;
+        } else {
+            games[ngames++] = p;
+        }
+    }
+    if (!poolfile)
+        usage_exit(pname, "no pool file specified", usage);
+
+    pool = pool_open(poolfile, &err);
+    if (!pool) {
+        fprintf(stderr, "%s: %s: %s\n", pname, poolfile, err);
+        sfree(games);
+        return 1;
+    }
+    if (compact && !pool_compact(pool)) {
+        fprintf(stderr, "%s: %s: unable to compact pool\n", pname, poolfile);
+        pool_free(pool);
+        sfree(games);
+        return 1;
+    }
+
+    if (seed) {
+        opts.rs = random_new(seed, strlen(seed));
+    } else {
+        char buf[80];
+        unsigned long pid = 0;
+#ifndef NO_MMAP
+        pid = (unsigned long)getpid();
+#endif
+        sprintf(buf, "%lu.%lu.%lu", (unsigned long)time(NULL), pid,
+                (unsigned long)clock());
+        opts.rs = random_new(buf, strlen(buf));
+    }
+
+    if (ngames == 0) {
+        for (i = 0; i < gamecount; i++)
+            if (!fill_game(pool, gamelist[i], NULL, &opts))
+                ok = false;
+    } else {
+        for (i = 0; i < ngames; i++) {
+            const char *colon = strchr(games[i], ':');
+            size_t len = colon ? colon - games[i] : strlen(games[i]);
+            const game *ourgame = find_game(games[i], len);
+
+            if (!ourgame) {
+                fprintf(stderr, "%s: unrecognised game '%.*s'\n",
+                        pname, (int)len, games[i]);
+                ok = false;
+                continue;
+            }
+            if (!fill_game(pool, ourgame, colon ? colon + 1 : NULL, &opts))
+                ok = false;
+        }
+    }
+
+    random_free(opts.rs);
+    pool_free(pool);
+    sfree(games);
+    return ok ? 0 : 1;
+}
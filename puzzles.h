@@ -102,6 +102,7 @@ typedef struct document document;
 typedef struct drawing_api drawing_api;
 typedef struct drawing drawing;
 typedef struct psdata psdata;
+typedef struct puzzle_pool puzzle_pool;
 
 #define ALIGN_VNORMAL 0x000
 #define ALIGN_VCENTRE 0x100
@@ -299,6 +300,7 @@ void print_line_dotted(drawing *dr, bool dotted);
 midend *midend_new(frontend *fe, const game *ourgame,
 		   const drawing_api *drapi, void *drhandle);
 void midend_free(midend *me);
+void midend_reseed(midend *me, const void *seed, int len);
 const game *midend_which_game(midend *me);
 void midend_set_params(midend *me, game_params *params);
 game_params *midend_get_params(midend *me);
@@ -306,6 +308,7 @@ void midend_size(midend *me, int *x, int *y, bool user_size,
                  double device_pixel_ratio);
 void midend_reset_tilesize(midend *me);
 void midend_new_game(midend *me);
+bool midend_new_game_from_pool(midend *me, puzzle_pool *pool);
 void midend_restart_game(midend *me);
 void midend_stop_anim(midend *me);
 bool midend_process_key(midend *me, int x, int y, int button, bool *handled);
@@ -331,15 +334,23 @@ const char *midend_solve(midend *me);
 int midend_status(midend *me);
 bool midend_can_undo(midend *me);
 bool midend_can_redo(midend *me);
+void midend_set_undo_checkpoint(midend *me, int interval);
+void midend_set_lazy_replay(midend *me, bool lazy);
 void midend_supersede_game_desc(midend *me, const char *desc,
                                 const char *privdesc);
 char *midend_rewrite_statusbar(midend *me, const char *text);
 void midend_serialise(midend *me,
                       void (*write)(void *ctx, const void *buf, int len),
                       void *wctx);
+void midend_serialise_binary(midend *me,
+                             void (*write)(void *ctx, const void *buf,
+                                           int len),
+                             void *wctx);
 const char *midend_deserialise(midend *me,
                                bool (*read)(void *ctx, void *buf, int len),
                                void *rctx);
+const char *midend_deserialise_trusted(
+    midend *me, bool (*read)(void *ctx, void *buf, int len), void *rctx);
 const char *identify_game(char **name,
                           bool (*read)(void *ctx, void *buf, int len),
                           void *rctx);
@@ -364,6 +375,31 @@ char *dupstr(const char *s);
 #define sresize(array, number, type) \
     ( (type *) srealloc ((array), (number) * sizeof (type)) )
 
+/*
+ * Arena (region) allocator, for scratch memory that is all thrown
+ * away at once. A generator typically creates one arena at the top
+ * of new_desc, allocates its solver scratch from it on every retry,
+ * and frees the lot on the way out; arena_save and arena_restore
+ * let a callee give back everything it allocated without returning
+ * the underlying blocks to malloc. Memory from an arena must never
+ * be passed to sfree or srealloc.
+ */
+typedef struct arena arena;
+typedef struct arena_mark {
+    struct arena_block *block;
+    size_t used;
+} arena_mark;
+arena *arena_new(void);
+void *arena_alloc(arena *a, size_t size);
+arena_mark arena_save(arena *a);
+void arena_restore(arena *a, arena_mark mark);
+void arena_reset(arena *a);
+void arena_free(arena *a);
+#define anew(a, type) \
+    ( (type *) arena_alloc ((a), sizeof (type)) )
+#define anewn(a, number, type) \
+    ( (type *) arena_alloc ((a), (number) * sizeof (type)) )
+
 /*
  * misc.c
  */
@@ -379,6 +415,49 @@ unsigned char *hex2bin(const char *in, int outlen);
 
 bool getenv_bool(const char *name, bool dflt);
 
+/*
+ * Sets of small non-negative integers, packed 32 to an unsigned long,
+ * for solvers to keep track of which squares (faces, regions, ...)
+ * still need looking at. pending_next takes out and returns the
+ * first member of the set which is at least i, or returns n (the
+ * size of the set's universe) if there isn't one; since it looks
+ * afresh at the set each time, iterating with it also visits members
+ * added beyond the current position meanwhile.
+ */
+#define PENDING_BITS 32
+#define PENDING_WORDS(n) (((n) + PENDING_BITS - 1) / PENDING_BITS)
+#define pending_has(set, i) \
+    (((set)[(i) / PENDING_BITS] >> ((i) % PENDING_BITS)) & 1)
+#define pending_add(set, i) \
+    ((set)[(i) / PENDING_BITS] |= 1UL << ((i) % PENDING_BITS))
+void pending_fill(unsigned long *set, int n);
+int pending_next(unsigned long *set, int i, int n);
+
+/*
+ * A growable string, for building game descriptions and move strings
+ * a piece at a time in linear time. strbuf_to_str frees the strbuf
+ * and returns its contents as a dynamically allocated string.
+ */
+typedef struct strbuf strbuf;
+strbuf *strbuf_new(void);
+void strbuf_free(strbuf *sb);
+char *strbuf_to_str(strbuf *sb);
+int strbuf_len(const strbuf *sb);
+void strbuf_addc(strbuf *sb, char c);
+void strbuf_adds(strbuf *sb, const char *str);
+void strbuf_addf(strbuf *sb, const char *fmt, ...);
+void strbuf_addint(strbuf *sb, int n);
+/* Appends a run length as letters a-z, using as many 'z's as needed. */
+void strbuf_addrun(strbuf *sb, int run);
+
+/*
+ * Parse a decimal number or a single run-length letter from *pp,
+ * advancing *pp past it. read_number returns -1 (and read_run 0)
+ * without moving if there is nothing of the right kind there.
+ */
+int read_number(const char **pp);
+int read_run(const char **pp);
+
 /* Mixes two colours in specified proportions. */
 void colour_mix(const float src1[3], const float src2[3], float p,
                 float dst[3]);
@@ -483,6 +562,35 @@ void tdq_add(tdq *tdq, int k);
 int tdq_remove(tdq *tdq);        /* returns -1 if nothing available */
 void tdq_fill(tdq *tdq);         /* add everything to the tdq at once */
 
+/*
+ * pool.c
+ */
+
+/*
+ * A puzzle pool is an on-disk stock of pre-generated game
+ * descriptions, with their aux_info, filed under a key made by
+ * pool_key from the puzzle and its full parameter string. Games are
+ * handed out oldest first by pool_take, which runs the refill
+ * callback (if any) when fewer than 'lowwater' games with that key
+ * are left. Several processes may add and take games in one pool
+ * file at once (taking is done under a file lock); pool_refresh
+ * picks up anything they have added since the pool was opened.
+ * pool_compact rewrites the file without the games that have been
+ * taken, and must not be run while anything else has the file open.
+ */
+puzzle_pool *pool_open(const char *filename, const char **error);
+void pool_free(puzzle_pool *pool);
+void pool_refresh(puzzle_pool *pool);
+char *pool_key(const game *thegame, const game_params *params);
+int pool_count(puzzle_pool *pool, const char *key);
+bool pool_add(puzzle_pool *pool, const char *key, const char *desc,
+              const char *aux);
+bool pool_take(puzzle_pool *pool, const char *key, char **desc, char **aux);
+void pool_set_refill(puzzle_pool *pool, int lowwater,
+                     void (*refill)(void *ctx, const char *key, int count),
+                     void *ctx);
+bool pool_compact(puzzle_pool *pool);
+
 /*
  * laydomino.c
  */
@@ -498,7 +606,12 @@ extern char ver[];
  * random.c
  */
 random_state *random_new(const char *seed, int len);
+random_state *random_new_fast(const char *seed, int len);
+/* Random seed strings with this prefix select random_new_fast(). */
+#define RANDOM_FAST_SEED_PREFIX "v2-"
+random_state *random_new_from_seed(const char *seedstr);
 random_state *random_copy(random_state *tocopy);
+random_state *random_fork(random_state *parent, unsigned long index);
 unsigned long random_bits(random_state *state, int bits);
 unsigned long random_upto(random_state *state, unsigned long limit);
 void random_free(random_state *state);
@@ -613,6 +726,22 @@ bool findloop_is_loop_edge(struct findloopstate *state, int u, int v);
 bool findloop_is_bridge(
     struct findloopstate *pv, int u, int v, int *u_vertices, int *v_vertices);
 
+/*
+ * Update the output of findloop_run after adding or removing a single
+ * edge u-v of the graph, which must not be a self-loop or duplicate
+ * an existing edge. Returns true on success, or false if this change
+ * can't be handled incrementally, in which case the state is no
+ * longer valid and the caller must call findloop_run again.
+ *
+ * If 'changed' is not NULL, findloop_add_edge calls it for each
+ * existing edge that the new one turns from a bridge into a loop
+ * edge. No other edge can change status as a result of either call.
+ */
+typedef void (*findloop_changed_fn_t)(int u, int v, void *ctx);
+bool findloop_add_edge(struct findloopstate *state, int u, int v,
+                       findloop_changed_fn_t changed, void *ctx);
+bool findloop_remove_edge(struct findloopstate *state, int u, int v);
+
 /*
  * Helper function to sort an array. Differs from standard qsort in
  * that it takes a context parameter that is passed to the compare
@@ -673,6 +802,9 @@ struct game {
     char *(*interpret_move)(const game_state *state, game_ui *ui,
                             const game_drawstate *ds, int x, int y, int button);
     game_state *(*execute_move)(const game_state *state, const char *move);
+    char *(*encode_state)(const game_state *state);
+    game_state *(*decode_state)(const game_state *initial,
+                                const char *encoding);
     int preferred_tilesize;
     void (*compute_size)(const game_params *params, int tilesize,
                          int *x, int *y);
@@ -752,6 +884,8 @@ struct drawing_api {
 #ifdef COMBINED
 extern const game *gamelist[];
 extern const int gamecount;
+const game *find_game(const char *name, size_t len);
+void usage_exit(const char *pname, const char *msg, const char *usage);
 /* Also pre-declare every individual 'struct game' we expect */
 #define GAME(x) extern const game x;
 #include "generated-games.h"
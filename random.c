@@ -8,6 +8,14 @@
  * The generator is based on SHA-1. This is almost certainly
  * overkill, but I had the SHA-1 code kicking around and it was
  * easier to reuse it than to do anything else!
+ *
+ * Unfortunately, it's also slow enough to show up in the profiles of
+ * the more random-number-hungry puzzle generators. So there's a
+ * second, much faster generator (xoshiro128**, seeded from a SHA-1
+ * hash of the seed data), which random seed strings can opt into by
+ * starting with RANDOM_FAST_SEED_PREFIX. Changing the generator used
+ * for existing seeds would change every puzzle they generate, so
+ * anything not using that prefix still gets the SHA-1 generator.
  */
 
 #include <assert.h>
@@ -202,9 +210,11 @@ void SHA_Simple(const void *p, int len, unsigned char *output)
  */
 
 struct random_state {
+    bool fast;                         /* use xs[] rather than SHA-1 */
     unsigned char seedbuf[40];
     unsigned char databuf[20];
     int pos;
+    uint32 xs[4];                      /* xoshiro128** state */
 };
 
 random_state *random_new(const char *seed, int len)
@@ -213,6 +223,7 @@ random_state *random_new(const char *seed, int len)
 
     state = snew(random_state);
 
+    state->fast = false;
     SHA_Simple(seed, len, state->seedbuf);
     SHA_Simple(state->seedbuf, 20, state->seedbuf + 20);
     SHA_Simple(state->seedbuf, 40, state->databuf);
@@ -221,21 +232,97 @@ random_state *random_new(const char *seed, int len)
     return state;
 }
 
+random_state *random_new_fast(const char *seed, int len)
+{
+    random_state *state;
+    unsigned char digest[20];
+    int i;
+
+    state = snew(random_state);
+    memset(state, 0, sizeof(*state));
+
+    state->fast = true;
+    SHA_Simple(seed, len, digest);
+    for (i = 0; i < 4; i++)
+        state->xs[i] = (((uint32)digest[4*i+0] << 24) |
+                        ((uint32)digest[4*i+1] << 16) |
+                        ((uint32)digest[4*i+2] << 8) |
+                        ((uint32)digest[4*i+3]));
+    /* xoshiro's one forbidden state; astronomically unlikely, but... */
+    if (!(state->xs[0] | state->xs[1] | state->xs[2] | state->xs[3]))
+        state->xs[0] = 1;
+
+    return state;
+}
+
+random_state *random_new_from_seed(const char *seedstr)
+{
+    size_t plen = strlen(RANDOM_FAST_SEED_PREFIX);
+
+    if (!strncmp(seedstr, RANDOM_FAST_SEED_PREFIX, plen))
+        return random_new_fast(seedstr, strlen(seedstr));
+    return random_new(seedstr, strlen(seedstr));
+}
+
 random_state *random_copy(random_state *tocopy)
 {
     random_state *result;
     result = snew(random_state);
-    memcpy(result->seedbuf, tocopy->seedbuf, sizeof(result->seedbuf));
-    memcpy(result->databuf, tocopy->databuf, sizeof(result->databuf));
-    result->pos = tocopy->pos;
+    *result = *tocopy;
+    return result;
+}
+
+random_state *random_fork(random_state *parent, unsigned long index)
+{
+    /*
+     * Seed a generator of the same kind from a hash of the parent's
+     * entire state and the index. Going via the encoded form of the
+     * state keeps the result the same on every platform.
+     */
+    char *enc = random_state_encode(parent);
+    char *buf = snewn(strlen(enc) + 40, char);
+    random_state *result;
+    int len;
+
+    len = sprintf(buf, "%s/%lu", enc, index);
+    if (parent->fast)
+        result = random_new_fast(buf, len);
+    else
+        result = random_new(buf, len);
+    sfree(buf);
+    sfree(enc);
     return result;
 }
 
+#define rol32(x,y) ( (((x) << (y)) | ((x) >> (32-(y)))) & 0xFFFFFFFFUL )
+
+/* One step of xoshiro128**, returning 32 fresh bits. */
+static uint32 xoshiro_next(uint32 *s)
+{
+    uint32 ret = (rol32((s[1] * 5) & 0xFFFFFFFFUL, 7) * 9) & 0xFFFFFFFFUL;
+    uint32 t = (s[1] << 9) & 0xFFFFFFFFUL;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rol32(s[3], 11);
+
+    return ret;
+}
+
 unsigned long random_bits(random_state *state, int bits)
 {
     unsigned long ret = 0;
     int n;
 
+    if (state->fast) {
+        /* The top bits of xoshiro128** output are the best ones. */
+        assert(bits >= 1 && bits <= 32);
+        return xoshiro_next(state->xs) >> (32 - bits);
+    }
+
     for (n = 0; n < bits; n += 8) {
 	if (state->pos >= 20) {
 	    int i;
@@ -295,6 +382,17 @@ char *random_state_encode(random_state *state)
     char retbuf[256];
     int len = 0, i;
 
+    if (state->fast) {
+        /*
+         * The old encoding is nothing but hex digits, so a leading
+         * 'x' is enough to tell the two apart.
+         */
+        retbuf[len++] = 'x';
+        for (i = 0; i < lenof(state->xs); i++)
+            len += sprintf(retbuf+len, "%08lx", (unsigned long)state->xs[i]);
+        return dupstr(retbuf);
+    }
+
     for (i = 0; i < lenof(state->seedbuf); i++)
 	len += sprintf(retbuf+len, "%02x", state->seedbuf[i]);
     for (i = 0; i < lenof(state->databuf); i++)
@@ -310,10 +408,29 @@ random_state *random_state_decode(const char *input)
     int pos, byte, digits;
 
     state = snew(random_state);
-
-    memset(state->seedbuf, 0, sizeof(state->seedbuf));
-    memset(state->databuf, 0, sizeof(state->databuf));
-    state->pos = 0;
+    memset(state, 0, sizeof(*state));
+
+    if (*input == 'x') {
+        state->fast = true;
+        input++;
+        for (pos = 0; pos < 8 * lenof(state->xs) && *input; pos++) {
+            int v = *input++;
+
+            if (v >= '0' && v <= '9')
+                v = v - '0';
+            else if (v >= 'A' && v <= 'F')
+                v = v - 'A' + 10;
+            else if (v >= 'a' && v <= 'f')
+                v = v - 'a' + 10;
+            else
+                v = 0;
+
+            state->xs[pos / 8] = (state->xs[pos / 8] << 4) | v;
+        }
+        if (!(state->xs[0] | state->xs[1] | state->xs[2] | state->xs[3]))
+            state->xs[0] = 1;
+        return state;
+    }
 
     byte = digits = 0;
     pos = 0;
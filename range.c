@@ -1036,8 +1036,7 @@ static const char *validate_params(const game_params *params, bool full)
 
 static char *newdesc_encode_game_description(int area, puzzle_size *grid)
 {
-    char *desc = NULL;
-    int desclen = 0, descsize = 0;
+    strbuf *sb = strbuf_new();
     int run, i;
 
     run = 0;
@@ -1047,34 +1046,23 @@ static char *newdesc_encode_game_description(int area, puzzle_size *grid)
 	if (!n)
 	    run++;
 	else {
-	    if (descsize < desclen + 40) {
-		descsize = desclen * 3 / 2 + 40;
-		desc = sresize(desc, descsize, char);
-	    }
 	    if (run) {
-		while (run > 0) {
-		    int c = 'a' - 1 + run;
-		    if (run > 26)
-			c = 'z';
-		    desc[desclen++] = c;
-		    run -= c - ('a' - 1);
-		}
+		strbuf_addrun(sb, run);
 	    } else {
 		/*
 		 * If there's a number in the very top left or
 		 * bottom right, there's no point putting an
 		 * unnecessary _ before or after it.
 		 */
-		if (desclen > 0 && n > 0)
-		    desc[desclen++] = '_';
+		if (strbuf_len(sb) > 0 && n > 0)
+		    strbuf_addc(sb, '_');
 	    }
 	    if (n > 0)
-		desclen += sprintf(desc+desclen, "%d", n);
+		strbuf_addint(sb, n);
 	    run = 0;
 	}
     }
-    desc[desclen] = '\0';
-    return desc;
+    return strbuf_to_str(sb);
 }
 
 static const char *validate_desc(const game_params *params, const char *desc)
@@ -1084,18 +1072,15 @@ static const char *validate_desc(const game_params *params, const char *desc)
     int range = params->w + params->h - 1;   /* maximum cell value */
 
     while (*desc && *desc != ',') {
-        int c = *desc++;
-        if (c >= 'a' && c <= 'z') {
-            squares += c - 'a' + 1;
-        } else if (c == '_') {
-            /* do nothing */;
-        } else if (c > '0' && c <= '9') {
-            int val = atoi(desc-1);
+        int run = read_run(&desc), val;
+        if (run) {
+            squares += run;
+        } else if (*desc == '_') {
+            desc++;
+        } else if ((val = read_number(&desc)) >= 0) {
             if (val < 1 || val > range)
                 return "Out-of-range number in game description";
             squares++;
-            while (*desc >= '0' && *desc <= '9')
-                desc++;
         } else
             return "Invalid character in game description";
     }
@@ -1126,19 +1111,16 @@ static game_state *new_game(midend *me, const game_params *params,
     p = desc;
     i = 0;
     while (i < n && *p) {
-        int c = *p++;
-        if (c >= 'a' && c <= 'z') {
-            int squares = c - 'a' + 1;
+        int squares = read_run(&p);
+        if (squares) {
 	    while (squares--)
 		state->grid[i++] = 0;
-        } else if (c == '_') {
-            /* do nothing */;
-        } else if (c > '0' && c <= '9') {
-            int val = atoi(p-1);
+        } else if (*p == '_') {
+            p++;
+        } else {
+            int val = read_number(&p);
             assert(val >= 1 && val <= params->w+params->h-1);
             state->grid[i++] = val;
-            while (*p >= '0' && *p <= '9')
-                p++;
         }
     }
     assert(i == n);
@@ -1838,6 +1820,7 @@ struct game const thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -922,8 +922,8 @@ static void gen_grid_random(int w, int h, int nc, int *grid, random_state *rs)
 static char *new_game_desc(const game_params *params, random_state *rs,
 			   char **aux, bool interactive)
 {
-    char *ret;
-    int n, i, retlen, *tiles;
+    strbuf *sb;
+    int n, i, *tiles;
 
     n = params->w * params->h;
     tiles = snewn(n, int);
@@ -933,21 +933,15 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     else
 	gen_grid_random(params->w, params->h, params->ncols, tiles, rs);
 
-    ret = NULL;
-    retlen = 0;
+    sb = strbuf_new();
     for (i = 0; i < n; i++) {
-	char buf[80];
-	int k;
-
-	k = sprintf(buf, "%d,", tiles[i]);
-	ret = sresize(ret, retlen + k + 1, char);
-	strcpy(ret + retlen, buf);
-	retlen += k;
+	if (i > 0)
+	    strbuf_addc(sb, ',');
+	strbuf_addint(sb, tiles[i]);
     }
-    ret[retlen-1] = '\0'; /* delete last comma */
 
     sfree(tiles);
-    return ret;
+    return strbuf_to_str(sb);
 }
 
 static const char *validate_desc(const game_params *params, const char *desc)
@@ -956,20 +950,17 @@ static const char *validate_desc(const game_params *params, const char *desc)
     const char *p = desc;
 
     for (i = 0; i < area; i++) {
-	const char *q = p;
-	int n;
+	int n = read_number(&p);
 
-	if (!isdigit((unsigned char)*p))
+	if (n < 0)
 	    return "Not enough numbers in string";
-	while (isdigit((unsigned char)*p)) p++;
 
 	if (i < area-1 && *p != ',')
 	    return "Expected comma after number";
 	else if (i == area-1 && *p)
 	    return "Excess junk at end of string";
 
-	n = atoi(q);
-	if (n < 0 || n > params->ncols)
+	if (n > params->ncols)
 	    return "Colour out of range";
 
 	if (*p) p++; /* eat comma */
@@ -989,10 +980,8 @@ static game_state *new_game(midend *me, const game_params *params,
     state->tiles = snewn(state->n, int);
 
     for (i = 0; i < state->n; i++) {
-	assert(*p);
-	state->tiles[i] = atoi(p);
-	while (*p && *p != ',')
-            p++;
+	state->tiles[i] = read_number(&p);
+	assert(state->tiles[i] >= 0);
         if (*p) p++;                   /* eat comma */
     }
     state->complete = false;
@@ -1684,6 +1673,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -560,25 +560,17 @@ done:
 
 static char *generate_desc(game_state *state, bool issolve)
 {
-    char *ret, buf[80];
-    int retlen, i, k;
+    strbuf *sb = strbuf_new();
+    int i;
 
-    ret = NULL; retlen = 0;
-    if (issolve) {
-        ret = sresize(ret, 2, char);
-        ret[0] = 'S'; ret[1] = '\0';
-        retlen += 1;
-    }
+    if (issolve)
+        strbuf_addc(sb, 'S');
     for (i = 0; i < state->n; i++) {
         if (state->nums[i])
-            k = sprintf(buf, "%d%c", state->nums[i], (int)(state->dirs[i]+'a'));
-        else
-            k = sprintf(buf, "%c", (int)(state->dirs[i]+'a'));
-        ret = sresize(ret, retlen + k + 1, char);
-        strcpy(ret + retlen, buf);
-        retlen += k;
+            strbuf_addint(sb, state->nums[i]);
+        strbuf_addc(sb, state->dirs[i]+'a');
     }
-    return ret;
+    return strbuf_to_str(sb);
 }
 
 /* --- Game generation --- */
@@ -2300,6 +2292,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
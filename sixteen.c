@@ -205,8 +205,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     int x1, x2, p1, p2;
     int *tiles;
     bool *used;
-    char *ret;
-    int retlen;
+    strbuf *sb;
 
     n = params->w * params->h;
 
@@ -384,23 +383,16 @@ static char *new_game_desc(const game_params *params, random_state *rs,
      * Now construct the game description, by describing the tile
      * array as a simple sequence of comma-separated integers.
      */
-    ret = NULL;
-    retlen = 0;
+    sb = strbuf_new();
     for (i = 0; i < n; i++) {
-        char buf[80];
-        int k;
-
-        k = sprintf(buf, "%d,", tiles[i]+1);
-
-        ret = sresize(ret, retlen + k + 1, char);
-        strcpy(ret + retlen, buf);
-        retlen += k;
+        if (i > 0)
+            strbuf_addc(sb, ',');
+        strbuf_addint(sb, tiles[i]+1);
     }
-    ret[retlen-1] = '\0';              /* delete last comma */
 
     sfree(tiles);
 
-    return ret;
+    return strbuf_to_str(sb);
 }
 
 
@@ -419,15 +411,12 @@ static const char *validate_desc(const game_params *params, const char *desc)
 	used[i] = false;
 
     for (i = 0; i < area; i++) {
-	const char *q = p;
-	int n;
+	int n = read_number(&p);
 
-	if (*p < '0' || *p > '9') {
+	if (n < 0) {
 	    err = "Not enough numbers in string";
 	    goto leave;
 	}
-	while (*p >= '0' && *p <= '9')
-	    p++;
 	if (i < area-1 && *p != ',') {
 	    err = "Expected comma after number";
 	    goto leave;
@@ -436,7 +425,6 @@ static const char *validate_desc(const game_params *params, const char *desc)
 	    err = "Excess junk at end of string";
 	    goto leave;
 	}
-	n = atoi(q);
 	if (n < 1 || n > area) {
 	    err = "Number out of range";
 	    goto leave;
@@ -470,10 +458,8 @@ static game_state *new_game(midend *me, const game_params *params,
     p = desc;
     i = 0;
     for (i = 0; i < state->n; i++) {
-        assert(*p);
-        state->tiles[i] = atoi(p);
-        while (*p && *p != ',')
-            p++;
+        state->tiles[i] = read_number(&p);
+        assert(state->tiles[i] >= 0);
         if (*p) p++;                   /* eat comma */
     }
     assert(!*p);
@@ -1209,6 +1195,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -1481,6 +1481,11 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	 * If we already have the solution, save ourselves some
 	 * time.
 	 */
+	for (x = 0; x < w*h; x++)
+	    if (aux[x] != '\\' && aux[x] != '/') {
+		*error = "invalid char in aux";
+		return NULL;
+	    }
 	soln = (signed char *)aux;
 	bs = (signed char)'\\';
 	free_soln = false;
@@ -2193,6 +2198,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILESIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
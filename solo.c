@@ -712,14 +712,17 @@ struct solver_usage {
     int cr;
     struct block_structure *blocks, *kblocks, *extra_cages;
     /*
-     * We set up a cubic array, indexed by x, y and digit; each
-     * element of this array is true or false according to whether
-     * or not that digit _could_ in principle go in that position.
+     * We keep a bitmask of candidate digits for each square: bit
+     * n-1 of cube[y*cr+x] is set according to whether or not digit
+     * n _could_ in principle go in that position. (Hence cr must
+     * not exceed the number of bits in an unsigned int, which
+     * validate_params ensures.)
      *
-     * The way to index this array is cube[(y*cr+x)*cr+n-1]; there
-     * are macros below to help with this.
+     * There are macros below to help with reading this array; it
+     * should only be written to via solver_rule_out() and
+     * solver_place().
      */
-    bool *cube;
+    unsigned int *cube;
     /*
      * This is the grid in which we write down our final
      * deductions. y-coordinates in here are _not_ transformed.
@@ -735,29 +738,57 @@ struct solver_usage {
      * have yet to work out, to prevent doing the same deduction
      * many times.
      */
-    /* row[y*cr+n-1] true if digit n has been placed in row y */
-    bool *row;
-    /* col[x*cr+n-1] true if digit n has been placed in row x */
-    bool *col;
-    /* blk[i*cr+n-1] true if digit n has been placed in block i */
-    bool *blk;
-    /* diag[i*cr+n-1] true if digit n has been placed in diagonal i */
-    bool *diag;                        /* diag 0 is \, 1 is / */
+    /* bit n-1 of row[y] set if digit n has been placed in row y */
+    unsigned int *row;
+    /* bit n-1 of col[x] set if digit n has been placed in column x */
+    unsigned int *col;
+    /* bit n-1 of blk[i] set if digit n has been placed in block i */
+    unsigned int *blk;
+    /* bit n-1 of diag[i] set if digit n has been placed in diagonal i */
+    unsigned int *diag;                /* diag 0 is \, 1 is / */
 
     int *regions;
     int nr_regions;
     int **sq2region;
 };
-#define cubepos2(xy,n) ((xy)*usage->cr+(n)-1)
-#define cubepos(x,y,n) cubepos2((y)*usage->cr+(x),n)
-#define cube(x,y,n) (usage->cube[cubepos(x,y,n)])
-#define cube2(xy,n) (usage->cube[cubepos2(xy,n)])
+#define DIGITBIT(n) (1U << ((n)-1))
+#define cube2(xy,n) ((usage->cube[xy] & DIGITBIT(n)) != 0)
+#define cube(x,y,n) cube2((y)*usage->cr+(x),n)
 
 #define ondiag0(xy) ((xy) % (cr+1) == 0)
 #define ondiag1(xy) ((xy) % (cr-1) == 0 && (xy) > 0 && (xy) < cr*cr-1)
 #define diag0(i) ((i) * (cr+1))
 #define diag1(i) ((i+1) * (cr-1))
 
+static int bitcount32(unsigned int word)
+{
+    word = ((word & 0xAAAAAAAAU) >> 1) + (word & 0x55555555U);
+    word = ((word & 0xCCCCCCCCU) >> 2) + (word & 0x33333333U);
+    word = ((word & 0xF0F0F0F0U) >> 4) + (word & 0x0F0F0F0FU);
+    word = ((word & 0xFF00FF00U) >> 8) + (word & 0x00FF00FFU);
+    word = ((word & 0xFFFF0000U) >> 16) + (word & 0x0000FFFFU);
+
+    return (int)word;
+}
+
+/* Index of the lowest set bit in a nonzero word. */
+static int lowbit(unsigned int word)
+{
+    int i = 0;
+
+    assert(word);
+    while (!(word & 1)) {
+        word >>= 1;
+        i++;
+    }
+    return i;
+}
+
+static void solver_rule_out(struct solver_usage *usage, int sqindex, int n)
+{
+    usage->cube[sqindex] &= ~DIGITBIT(n);
+}
+
 /*
  * Function called when we are certain that a particular square has
  * a particular number in it. The y-coordinate passed in here is
@@ -774,23 +805,21 @@ static void solver_place(struct solver_usage *usage, int x, int y, int n)
     /*
      * Rule out all other numbers in this square.
      */
-    for (i = 1; i <= cr; i++)
-	if (i != n)
-	    cube(x,y,i) = false;
+    usage->cube[sqindex] = DIGITBIT(n);
 
     /*
      * Rule out this number in all other positions in the row.
      */
     for (i = 0; i < cr; i++)
 	if (i != y)
-	    cube(x,i,n) = false;
+	    solver_rule_out(usage, i*cr+x, n);
 
     /*
      * Rule out this number in all other positions in the column.
      */
     for (i = 0; i < cr; i++)
 	if (i != x)
-	    cube(i,y,n) = false;
+	    solver_rule_out(usage, y*cr+i, n);
 
     /*
      * Rule out this number in all other positions in the block.
@@ -799,7 +828,7 @@ static void solver_place(struct solver_usage *usage, int x, int y, int n)
     for (i = 0; i < cr; i++) {
 	int bp = usage->blocks->blocks[bi][i];
 	if (bp != sqindex)
-	    cube2(bp,n) = false;
+	    solver_rule_out(usage, bp, n);
     }
 
     /*
@@ -811,21 +840,22 @@ static void solver_place(struct solver_usage *usage, int x, int y, int n)
      * Cross out this number from the list of numbers left to place
      * in its row, its column and its block.
      */
-    usage->row[y*cr+n-1] = usage->col[x*cr+n-1] =
-	usage->blk[bi*cr+n-1] = true;
+    usage->row[y] |= DIGITBIT(n);
+    usage->col[x] |= DIGITBIT(n);
+    usage->blk[bi] |= DIGITBIT(n);
 
     if (usage->diag) {
 	if (ondiag0(sqindex)) {
 	    for (i = 0; i < cr; i++)
 		if (diag0(i) != sqindex)
-		    cube2(diag0(i),n) = false;
-	    usage->diag[n-1] = true;
+		    solver_rule_out(usage, diag0(i), n);
+	    usage->diag[0] |= DIGITBIT(n);
 	}
 	if (ondiag1(sqindex)) {
 	    for (i = 0; i < cr; i++)
 		if (diag1(i) != sqindex)
-		    cube2(diag1(i),n) = false;
-	    usage->diag[cr+n-1] = true;
+		    solver_rule_out(usage, diag1(i), n);
+	    usage->diag[1] |= DIGITBIT(n);
 	}
     }
 }
@@ -837,47 +867,58 @@ static void solver_place(struct solver_usage *usage, int x, int y, int n)
  * gets debugged.
  */
 struct solver_scratch;
-static int solver_elim(struct solver_usage *usage, int *indices,
+static int solver_elim(struct solver_usage *usage, int *squares, int n,
                        const char *fmt, ...)
-    __attribute__((format(printf,3,4)));
-static int solver_intersect(struct solver_usage *usage,
-                            int *indices1, int *indices2, const char *fmt, ...)
     __attribute__((format(printf,4,5)));
+static int solver_intersect(struct solver_usage *usage,
+                            int *squares1, int *squares2, int n,
+                            const char *fmt, ...)
+    __attribute__((format(printf,5,6)));
 static int solver_set(struct solver_usage *usage,
                       struct solver_scratch *scratch,
-                      int *indices, const char *fmt, ...)
-    __attribute__((format(printf,4,5)));
+                      int *squares, int number, const char *fmt, ...)
+    __attribute__((format(printf,5,6)));
 #endif
 
-static int solver_elim(struct solver_usage *usage, int *indices
+/*
+ * Positional elimination of the number n within the cr squares
+ * listed in squares[]; or, if n is zero, numeric elimination within
+ * the single square squares[0].
+ */
+static int solver_elim(struct solver_usage *usage, int *squares, int n
 #ifdef STANDALONE_SOLVER
                        , const char *fmt, ...
 #endif
                        )
 {
     int cr = usage->cr;
-    int fpos, m, i;
+    int fsq, m, i;
 
     /*
      * Count the number of set bits within this section of the
      * cube.
      */
-    m = 0;
-    fpos = -1;
-    for (i = 0; i < cr; i++)
-	if (usage->cube[indices[i]]) {
-	    fpos = indices[i];
-	    m++;
-	}
+    if (n) {
+        m = 0;
+        fsq = -1;
+        for (i = 0; i < cr; i++)
+            if (cube2(squares[i], n)) {
+                fsq = squares[i];
+                m++;
+            }
+    } else {
+        fsq = squares[0];
+        m = bitcount32(usage->cube[fsq]);
+        if (m == 1)
+            n = 1 + lowbit(usage->cube[fsq]);
+    }
 
     if (m == 1) {
-	int x, y, n;
-	assert(fpos >= 0);
+	int x, y;
+	assert(fsq >= 0);
 
-	n = 1 + fpos % cr;
-	x = fpos / cr;
-	y = x / cr;
-	x %= cr;
+	x = fsq % cr;
+	y = fsq / cr;
 
         if (!usage->grid[y*cr+x]) {
 #ifdef STANDALONE_SOLVER
@@ -912,8 +953,12 @@ static int solver_elim(struct solver_usage *usage, int *indices
     return 0;
 }
 
+/*
+ * Intersectional analysis of the number n between two regions, each
+ * given as a sorted list of cr squares.
+ */
 static int solver_intersect(struct solver_usage *usage,
-                            int *indices1, int *indices2
+                            int *squares1, int *squares2, int n
 #ifdef STANDALONE_SOLVER
                             , const char *fmt, ...
 #endif
@@ -927,11 +972,11 @@ static int solver_intersect(struct solver_usage *usage,
      * not also in the second.
      */
     for (i = j = 0; i < cr; i++) {
-        int p = indices1[i];
-	while (j < cr && indices2[j] < p)
+        int p = squares1[i];
+	while (j < cr && squares2[j] < p)
 	    j++;
-        if (usage->cube[p]) {
-	    if (j < cr && indices2[j] == p)
+        if (cube2(p, n)) {
+	    if (j < cr && squares2[j] == p)
 		continue;	       /* both domains contain this index */
 	    else
 		return 0;	       /* there is, so we can't deduce */
@@ -946,14 +991,12 @@ static int solver_intersect(struct solver_usage *usage,
      */
     ret = 0;
     for (i = j = 0; i < cr; i++) {
-        int p = indices2[i];
-	while (j < cr && indices1[j] < p)
+        int p = squares2[i];
+	while (j < cr && squares1[j] < p)
 	    j++;
-        if (usage->cube[p] && (j >= cr || indices1[j] != p)) {
+        if (cube2(p, n) && (j >= cr || squares1[j] != p)) {
 #ifdef STANDALONE_SOLVER
             if (solver_show_working) {
-                int px, py, pn;
-
                 if (!ret) {
                     va_list ap;
 		    printf("%*s", solver_recurse_depth*4, "");
@@ -963,17 +1006,12 @@ static int solver_intersect(struct solver_usage *usage,
                     printf(":\n");
                 }
 
-                pn = 1 + p % cr;
-                px = p / cr;
-                py = px / cr;
-                px %= cr;
-
                 printf("%*s  ruling out %d at (%d,%d)\n",
-                       solver_recurse_depth*4, "", pn, 1+px, 1+py);
+                       solver_recurse_depth*4, "", n, 1+p%cr, 1+p/cr);
             }
 #endif
             ret = +1;		       /* we did something */
-            usage->cube[p] = false;
+            solver_rule_out(usage, p, n);
         }
     }
 
@@ -981,17 +1019,25 @@ static int solver_intersect(struct solver_usage *usage,
 }
 
 struct solver_scratch {
-    unsigned char *grid, *rowidx, *colidx, *set;
+    unsigned char *grid, *rowidx, *colidx;
+    unsigned int *rows;
     int *neighbours, *bfsqueue;
-    int *indexlist, *indexlist2;
+    int *indexlist;
 #ifdef STANDALONE_SOLVER
     int *bfsprev;
 #endif
 };
 
+/*
+ * Set elimination. If number is zero, the matrix we work on has a
+ * row for each of the cr squares listed in squares[], and a column
+ * for each digit. Otherwise, it has a row for each row of the grid
+ * and a column for each column, and says where the given number
+ * can go (and squares[] is not used).
+ */
 static int solver_set(struct solver_usage *usage,
                       struct solver_scratch *scratch,
-                      int *indices
+                      int *squares, int number
 #ifdef STANDALONE_SOLVER
                       , const char *fmt, ...
 #endif
@@ -999,10 +1045,10 @@ static int solver_set(struct solver_usage *usage,
 {
     int cr = usage->cr;
     int i, j, n, count;
-    unsigned char *grid = scratch->grid;
     unsigned char *rowidx = scratch->rowidx;
     unsigned char *colidx = scratch->colidx;
-    unsigned char *set = scratch->set;
+    unsigned int *rows = scratch->rows;
+    unsigned int set, full;
 
     /*
      * We are passed a cr-by-cr matrix of booleans. Our first job
@@ -1013,16 +1059,20 @@ static int solver_set(struct solver_usage *usage,
     memset(rowidx, 1, cr);
     memset(colidx, 1, cr);
     for (i = 0; i < cr; i++) {
-        int count = 0, first = -1;
-        for (j = 0; j < cr; j++)
-            if (usage->cube[indices[i*cr+j]])
-                first = j, count++;
+        if (number) {
+            rows[i] = 0;
+            for (j = 0; j < cr; j++)
+                if (cube2(i*cr+j, number))
+                    rows[i] |= 1U << j;
+        } else {
+            rows[i] = usage->cube[squares[i]];
+        }
 
 	/*
 	 * If count == 0, then there's a row with no 1s at all and
 	 * the puzzle is internally inconsistent.
 	 */
-        if (count == 0) {
+        if (rows[i] == 0) {
 #ifdef STANDALONE_SOLVER
             if (solver_show_working) {
                 va_list ap;
@@ -1037,8 +1087,8 @@ static int solver_set(struct solver_usage *usage,
 #endif
             return -1;
         }
-        if (count == 1)
-            rowidx[i] = colidx[first] = 0;
+        if (bitcount32(rows[i]) == 1)
+            rowidx[i] = colidx[lowbit(rows[i])] = 0;
     }
 
     /*
@@ -1055,11 +1105,19 @@ static int solver_set(struct solver_usage *usage,
     assert(n == j);
 
     /*
-     * And create the smaller matrix.
+     * And create the smaller matrix, as a bitmask per row. Column j
+     * of the smaller matrix goes in bit n-1-j, so that counting
+     * upwards through the candidate sets of columns below visits
+     * them in the same order as a binary counter whose least
+     * significant digit is column n-1.
      */
-    for (i = 0; i < n; i++)
+    for (i = 0; i < n; i++) {
+        unsigned int row = rows[rowidx[i]];
+        rows[i] = 0;
         for (j = 0; j < n; j++)
-            grid[i*cr+j] = usage->cube[indices[rowidx[i]*cr+colidx[j]]];
+            if (row & (1U << colidx[j]))
+                rows[i] |= 1U << (n-1-j);
+    }
 
     /*
      * Having done that, we now have a matrix in which every row
@@ -1069,9 +1127,10 @@ static int solver_set(struct solver_usage *usage,
      * columns) whose width and height add up to n.
      */
 
-    memset(set, 0, n);
-    count = 0;
-    while (1) {
+    full = n ? (1U << (n-1) << 1) - 1 : 0;
+    for (set = 0;; set++) {
+        count = bitcount32(set);
+
         /*
          * We have a candidate set. If its size is <=1 or >=n-1
          * then we move on immediately.
@@ -1082,17 +1141,10 @@ static int solver_set(struct solver_usage *usage,
              * find that many rows which each have a zero in all
              * the positions listed in `set'.
              */
-            int rows = 0;
-            for (i = 0; i < n; i++) {
-                bool ok = true;
-                for (j = 0; j < n; j++)
-                    if (set[j] && grid[i*cr+j]) {
-                        ok = false;
-                        break;
-                    }
-                if (ok)
-                    rows++;
-            }
+            int nrows = 0;
+            for (i = 0; i < n; i++)
+                if (!(rows[i] & set))
+                    nrows++;
 
             /*
              * We expect never to be able to get _more_ than
@@ -1102,7 +1154,7 @@ static int solver_set(struct solver_usage *usage,
              * indicates a faulty deduction before this point or
              * even a bogus clue.
              */
-            if (rows > n - count) {
+            if (nrows > n - count) {
 #ifdef STANDALONE_SOLVER
 		if (solver_show_working) {
 		    va_list ap;
@@ -1118,7 +1170,7 @@ static int solver_set(struct solver_usage *usage,
 		return -1;
 	    }
 
-            if (rows >= n - count) {
+            if (nrows >= n - count) {
                 bool progress = false;
 
                 /*
@@ -1133,44 +1185,39 @@ static int solver_set(struct solver_usage *usage,
                  * positions in the cube to meddle with.
                  */
                 for (i = 0; i < n; i++) {
-                    bool ok = true;
+                    if (!(rows[i] & set))
+                        continue;
                     for (j = 0; j < n; j++)
-                        if (set[j] && grid[i*cr+j]) {
-                            ok = false;
-                            break;
-                        }
-                    if (!ok) {
-                        for (j = 0; j < n; j++)
-                            if (!set[j] && grid[i*cr+j]) {
-                                int fpos = indices[rowidx[i]*cr+colidx[j]];
+                        if (rows[i] & ~set & (1U << (n-1-j))) {
+                            int fsq, fn;
+
+                            if (number) {
+                                fsq = rowidx[i]*cr+colidx[j];
+                                fn = number;
+                            } else {
+                                fsq = squares[rowidx[i]];
+                                fn = colidx[j] + 1;
+                            }
 #ifdef STANDALONE_SOLVER
-                                if (solver_show_working) {
-                                    int px, py, pn;
-
-                                    if (!progress) {
-                                        va_list ap;
-					printf("%*s", solver_recurse_depth*4,
-					       "");
-                                        va_start(ap, fmt);
-                                        vprintf(fmt, ap);
-                                        va_end(ap);
-                                        printf(":\n");
-                                    }
-
-                                    pn = 1 + fpos % cr;
-                                    px = fpos / cr;
-                                    py = px / cr;
-                                    px %= cr;
-
-                                    printf("%*s  ruling out %d at (%d,%d)\n",
-					   solver_recurse_depth*4, "",
-                                           pn, 1+px, 1+py);
+                            if (solver_show_working) {
+                                if (!progress) {
+                                    va_list ap;
+                                    printf("%*s", solver_recurse_depth*4,
+                                           "");
+                                    va_start(ap, fmt);
+                                    vprintf(fmt, ap);
+                                    va_end(ap);
+                                    printf(":\n");
                                 }
-#endif
-                                progress = true;
-                                usage->cube[fpos] = false;
+
+                                printf("%*s  ruling out %d at (%d,%d)\n",
+                                       solver_recurse_depth*4, "",
+                                       fn, 1+fsq%cr, 1+fsq/cr);
                             }
-                    }
+#endif
+                            progress = true;
+                            solver_rule_out(usage, fsq, fn);
+                        }
                 }
 
                 if (progress) {
@@ -1179,16 +1226,7 @@ static int solver_set(struct solver_usage *usage,
             }
         }
 
-        /*
-         * Binary increment: change the rightmost 0 to a 1, and
-         * change all 1s to the right of it to 0s.
-         */
-        i = n;
-        while (i > 0 && set[i-1])
-            set[--i] = 0, count--;
-        if (i > 0)
-            set[--i] = 1, count++;
-        else
+        if (set == full)
             break;                     /* done */
     }
 
@@ -1245,28 +1283,21 @@ static int solver_forcing(struct solver_usage *usage,
 
     for (y = 0; y < cr; y++)
         for (x = 0; x < cr; x++) {
-            int count, t, n;
+            unsigned int cands = usage->cube[y*cr+x];
+            int n;
 
             /*
              * If this square doesn't have exactly two candidate
              * numbers, don't try it.
-             * 
-             * In this loop we also sum the candidate numbers,
-             * which is a nasty hack to allow us to quickly find
-             * `the other one' (since we will shortly know there
-             * are exactly two).
              */
-            for (count = t = 0, n = 1; n <= cr; n++)
-                if (cube(x, y, n))
-                    count++, t += n;
-            if (count != 2)
+            if (bitcount32(cands) != 2)
                 continue;
 
             /*
              * Now attempt a bfs for each candidate.
              */
             for (n = 1; n <= cr; n++)
-                if (cube(x, y, n)) {
+                if (cands & DIGITBIT(n)) {
                     int orign, currn, head, tail;
 
                     /*
@@ -1280,7 +1311,7 @@ static int solver_forcing(struct solver_usage *usage,
 #ifdef STANDALONE_SOLVER
                     bfsprev[y*cr+x] = -1;
 #endif
-                    number[y*cr+x] = t - n;
+                    number[y*cr+x] = 1 + lowbit(cands & ~DIGITBIT(n));
 
                     while (head < tail) {
                         int xx, yy, nneighbours, xt, yt, i;
@@ -1318,7 +1349,7 @@ static int solver_forcing(struct solver_usage *usage,
                          * Try visiting each of those neighbours.
                          */
                         for (i = 0; i < nneighbours; i++) {
-                            int cc, tt, nn;
+                            unsigned int tcands;
 
                             xt = neighbours[i] % cr;
                             yt = neighbours[i] / cr;
@@ -1345,15 +1376,14 @@ static int solver_forcing(struct solver_usage *usage,
                              * this square to have exactly two
                              * possible numbers.
                              */
-                            for (cc = tt = 0, nn = 1; nn <= cr; nn++)
-                                if (cube(xt, yt, nn))
-                                    cc++, tt += nn;
-                            if (cc == 2) {
+                            tcands = usage->cube[yt*cr+xt];
+                            if (bitcount32(tcands) == 2) {
                                 bfsqueue[tail++] = yt*cr+xt;
 #ifdef STANDALONE_SOLVER
                                 bfsprev[yt*cr+xt] = yy*cr+xx;
 #endif
-                                number[yt*cr+xt] = tt - currn;
+                                number[yt*cr+xt] =
+                                    1 + lowbit(tcands & ~DIGITBIT(currn));
                             }
 
                             /*
@@ -1391,7 +1421,7 @@ static int solver_forcing(struct solver_usage *usage,
                                            orign, 1+xt, 1+yt);
                                 }
 #endif
-                                cube(xt, yt, orign) = false;
+                                solver_rule_out(usage, yt*cr+xt, orign);
                                 return 1;
                             }
                         }
@@ -1442,7 +1472,7 @@ static int solver_killer_minmax(struct solver_usage *usage,
 			}
 		}
 		if (maxval + n < clues[b]) {
-		    cube2(x, n) = false;
+		    solver_rule_out(usage, x, n);
 		    ret = 1;
 #ifdef STANDALONE_SOLVER
 		    if (solver_show_working)
@@ -1452,7 +1482,7 @@ static int solver_killer_minmax(struct solver_usage *usage,
 #endif
 		}
 		if (minval + n > clues[b]) {
-		    cube2(x, n) = false;
+		    solver_rule_out(usage, x, n);
 		    ret = 1;
 #ifdef STANDALONE_SOLVER
 		    if (solver_show_working)
@@ -1556,12 +1586,9 @@ static int solver_killer_sums(struct solver_usage *usage, int b,
 	    break;
 
 	for (j = 0; j < nsquares; j++) {
-	    int n;
-	    unsigned long square_bits = bits;
 	    int x = cages->blocks[b][j];
-	    for (n = 1; n <= cr; n++)
-		if (!cube2(x, n))
-		    square_bits &= ~(1L << n);
+	    unsigned long square_bits =
+		bits & ((unsigned long)usage->cube[x] << 1);
 	    if (square_bits == 0) {
 		break;
 	    }
@@ -1585,7 +1612,7 @@ static int solver_killer_sums(struct solver_usage *usage, int b,
 	    if (!cube2(x, n))
 		continue;
 	    if ((possible_addends & (1 << n)) == 0) {
-		cube2(x, n) = false;
+		solver_rule_out(usage, x, n);
 		ret = 1;
 #ifdef STANDALONE_SOLVER
 		if (solver_show_working) {
@@ -1659,40 +1686,24 @@ static int filter_whole_cages(struct solver_usage *usage, int *squares, int n,
     return off;
 }
 
-static struct solver_scratch *solver_new_scratch(struct solver_usage *usage)
+static struct solver_scratch *solver_new_scratch(struct solver_usage *usage,
+                                                 arena *ar)
 {
-    struct solver_scratch *scratch = snew(struct solver_scratch);
+    struct solver_scratch *scratch = anew(ar, struct solver_scratch);
     int cr = usage->cr;
-    scratch->grid = snewn(cr*cr, unsigned char);
-    scratch->rowidx = snewn(cr, unsigned char);
-    scratch->colidx = snewn(cr, unsigned char);
-    scratch->set = snewn(cr, unsigned char);
-    scratch->neighbours = snewn(5*cr, int);
-    scratch->bfsqueue = snewn(cr*cr, int);
+    scratch->grid = anewn(ar, cr*cr, unsigned char);
+    scratch->rowidx = anewn(ar, cr, unsigned char);
+    scratch->colidx = anewn(ar, cr, unsigned char);
+    scratch->rows = anewn(ar, cr, unsigned int);
+    scratch->neighbours = anewn(ar, 5*cr, int);
+    scratch->bfsqueue = anewn(ar, cr*cr, int);
 #ifdef STANDALONE_SOLVER
-    scratch->bfsprev = snewn(cr*cr, int);
+    scratch->bfsprev = anewn(ar, cr*cr, int);
 #endif
-    scratch->indexlist = snewn(cr*cr, int);   /* used for set elimination */
-    scratch->indexlist2 = snewn(cr, int);   /* only used for intersect() */
+    scratch->indexlist = anewn(ar, cr, int);
     return scratch;
 }
 
-static void solver_free_scratch(struct solver_scratch *scratch)
-{
-#ifdef STANDALONE_SOLVER
-    sfree(scratch->bfsprev);
-#endif
-    sfree(scratch->bfsqueue);
-    sfree(scratch->neighbours);
-    sfree(scratch->set);
-    sfree(scratch->colidx);
-    sfree(scratch->rowidx);
-    sfree(scratch->grid);
-    sfree(scratch->indexlist);
-    sfree(scratch->indexlist2);
-    sfree(scratch);
-}
-
 /*
  * Used for passing information about difficulty levels between the solver
  * and its callers.
@@ -1704,12 +1715,18 @@ struct difficulty {
     int diff, kdiff;
 };
 
+/*
+ * All of the solver's working memory comes from the arena 'ar', and
+ * is handed back to it (but not to malloc) before returning.
+ */
 static void solver(int cr, struct block_structure *blocks,
 		  struct block_structure *kblocks, bool xtype,
-		  digit *grid, digit *kgrid, struct difficulty *dlev)
+		  digit *grid, digit *kgrid, struct difficulty *dlev,
+                  arena *ar)
 {
     struct solver_usage *usage;
     struct solver_scratch *scratch;
+    arena_mark mark = arena_save(ar);
     int x, y, b, i, n, ret;
     int diff = DIFF_BLOCK;
     int kdiff = DIFF_KSINGLE;
@@ -1718,19 +1735,19 @@ static void solver(int cr, struct block_structure *blocks,
      * Set up a usage structure as a clean slate (everything
      * possible).
      */
-    usage = snew(struct solver_usage);
+    usage = anew(ar, struct solver_usage);
     usage->cr = cr;
     usage->blocks = blocks;
     if (kblocks) {
 	usage->kblocks = dup_block_structure(kblocks);
 	usage->extra_cages = alloc_block_structure (kblocks->c, kblocks->r,
 						    cr * cr, cr, cr * cr);
-	usage->extra_clues = snewn(cr*cr, digit);
+	usage->extra_clues = anewn(ar, cr*cr, digit);
     } else {
 	usage->kblocks = usage->extra_cages = NULL;
 	usage->extra_clues = NULL;
     }
-    usage->cube = snewn(cr*cr*cr, bool);
+    usage->cube = anewn(ar, cr*cr, unsigned int);
     usage->grid = grid;		       /* write straight back to the input */
     if (kgrid) {
 	int nclues;
@@ -1741,7 +1758,7 @@ static void solver(int cr, struct block_structure *blocks,
 	 * Allow for expansion of the killer regions, the absolute
 	 * limit is obviously one region per square.
 	 */
-	usage->kclues = snewn(cr*cr, digit);
+	usage->kclues = anewn(ar, cr*cr, digit);
 	for (i = 0; i < nclues; i++) {
 	    for (n = 0; n < kblocks->nr_squares[i]; n++)
 		if (kgrid[kblocks->blocks[i][n]] != 0)
@@ -1753,25 +1770,25 @@ static void solver(int cr, struct block_structure *blocks,
 	usage->kclues = NULL;
     }
 
-    for (i = 0; i < cr*cr*cr; i++)
-        usage->cube[i] = true;
+    for (i = 0; i < cr*cr; i++)
+        usage->cube[i] = (1U << (cr-1) << 1) - 1;
 
-    usage->row = snewn(cr * cr, bool);
-    usage->col = snewn(cr * cr, bool);
-    usage->blk = snewn(cr * cr, bool);
-    memset(usage->row, 0, cr * cr * sizeof(bool));
-    memset(usage->col, 0, cr * cr * sizeof(bool));
-    memset(usage->blk, 0, cr * cr * sizeof(bool));
+    usage->row = anewn(ar, cr, unsigned int);
+    usage->col = anewn(ar, cr, unsigned int);
+    usage->blk = anewn(ar, cr, unsigned int);
+    memset(usage->row, 0, cr * sizeof(unsigned int));
+    memset(usage->col, 0, cr * sizeof(unsigned int));
+    memset(usage->blk, 0, cr * sizeof(unsigned int));
 
     if (xtype) {
-	usage->diag = snewn(cr * 2, bool);
-	memset(usage->diag, 0, cr * 2 * sizeof(bool));
+	usage->diag = anewn(ar, 2, unsigned int);
+	memset(usage->diag, 0, 2 * sizeof(unsigned int));
     } else
 	usage->diag = NULL; 
 
     usage->nr_regions = cr * 3 + (xtype ? 2 : 0);
-    usage->regions = snewn(cr * usage->nr_regions, int);
-    usage->sq2region = snewn(cr * cr * 3, int *);
+    usage->regions = anewn(ar, cr * usage->nr_regions, int);
+    usage->sq2region = anewn(ar, cr * cr * 3, int *);
 
     for (n = 0; n < cr; n++) {
 	for (i = 0; i < cr; i++) {
@@ -1787,7 +1804,7 @@ static void solver(int cr, struct block_structure *blocks,
 	}
     }
 
-    scratch = solver_new_scratch(usage);
+    scratch = solver_new_scratch(usage, ar);
 
     /*
      * Place all the clue numbers we are given.
@@ -1826,10 +1843,8 @@ static void solver(int cr, struct block_structure *blocks,
 	 */
 	for (b = 0; b < cr; b++)
 	    for (n = 1; n <= cr; n++)
-		if (!usage->blk[b*cr+n-1]) {
-		    for (i = 0; i < cr; i++)
-			scratch->indexlist[i] = cubepos2(usage->blocks->blocks[b][i],n);
-		    ret = solver_elim(usage, scratch->indexlist
+		if (!(usage->blk[b] & DIGITBIT(n))) {
+		    ret = solver_elim(usage, usage->blocks->blocks[b], n
 #ifdef STANDALONE_SOLVER
 				      , "positional elimination,"
 				      " %d in block %s", n,
@@ -1872,7 +1887,7 @@ static void solver(int cr, struct block_structure *blocks,
 		     * about the other squares in the cage.
 		     */
 		    for (n = 0; n < usage->kblocks->nr_squares[b]; n++) {
-			cube2(usage->kblocks->blocks[b][n], t) = false;
+			solver_rule_out(usage, usage->kblocks->blocks[b][n], t);
 		    }
 		}
 
@@ -2087,10 +2102,10 @@ static void solver(int cr, struct block_structure *blocks,
 	 */
 	for (y = 0; y < cr; y++)
 	    for (n = 1; n <= cr; n++)
-		if (!usage->row[y*cr+n-1]) {
+		if (!(usage->row[y] & DIGITBIT(n))) {
 		    for (x = 0; x < cr; x++)
-			scratch->indexlist[x] = cubepos(x, y, n);
-		    ret = solver_elim(usage, scratch->indexlist
+			scratch->indexlist[x] = y*cr+x;
+		    ret = solver_elim(usage, scratch->indexlist, n
 #ifdef STANDALONE_SOLVER
 				      , "positional elimination,"
 				      " %d in row %d", n, 1+y
@@ -2109,10 +2124,10 @@ static void solver(int cr, struct block_structure *blocks,
 	 */
 	for (x = 0; x < cr; x++)
 	    for (n = 1; n <= cr; n++)
-		if (!usage->col[x*cr+n-1]) {
+		if (!(usage->col[x] & DIGITBIT(n))) {
 		    for (y = 0; y < cr; y++)
-			scratch->indexlist[y] = cubepos(x, y, n);
-		    ret = solver_elim(usage, scratch->indexlist
+			scratch->indexlist[y] = y*cr+x;
+		    ret = solver_elim(usage, scratch->indexlist, n
 #ifdef STANDALONE_SOLVER
 				      , "positional elimination,"
 				      " %d in column %d", n, 1+x
@@ -2132,10 +2147,10 @@ static void solver(int cr, struct block_structure *blocks,
 	 */
 	if (usage->diag) {
 	    for (n = 1; n <= cr; n++)
-		if (!usage->diag[n-1]) {
+		if (!(usage->diag[0] & DIGITBIT(n))) {
 		    for (i = 0; i < cr; i++)
-			scratch->indexlist[i] = cubepos2(diag0(i), n);
-		    ret = solver_elim(usage, scratch->indexlist
+			scratch->indexlist[i] = diag0(i);
+		    ret = solver_elim(usage, scratch->indexlist, n
 #ifdef STANDALONE_SOLVER
 				      , "positional elimination,"
 				      " %d in \\-diagonal", n
@@ -2150,10 +2165,10 @@ static void solver(int cr, struct block_structure *blocks,
 		    }
                 }
 	    for (n = 1; n <= cr; n++)
-		if (!usage->diag[cr+n-1]) {
+		if (!(usage->diag[1] & DIGITBIT(n))) {
 		    for (i = 0; i < cr; i++)
-			scratch->indexlist[i] = cubepos2(diag1(i), n);
-		    ret = solver_elim(usage, scratch->indexlist
+			scratch->indexlist[i] = diag1(i);
+		    ret = solver_elim(usage, scratch->indexlist, n
 #ifdef STANDALONE_SOLVER
 				      , "positional elimination,"
 				      " %d in /-diagonal", n
@@ -2175,9 +2190,8 @@ static void solver(int cr, struct block_structure *blocks,
 	for (x = 0; x < cr; x++)
 	    for (y = 0; y < cr; y++)
 		if (!usage->grid[y*cr+x]) {
-		    for (n = 1; n <= cr; n++)
-			scratch->indexlist[n-1] = cubepos(x, y, n);
-		    ret = solver_elim(usage, scratch->indexlist
+		    scratch->indexlist[0] = y*cr+x;
+		    ret = solver_elim(usage, scratch->indexlist, 0
 #ifdef STANDALONE_SOLVER
 				      , "numeric elimination at (%d,%d)",
 				      1+x, 1+y
@@ -2201,26 +2215,23 @@ static void solver(int cr, struct block_structure *blocks,
         for (y = 0; y < cr; y++)
             for (b = 0; b < cr; b++)
                 for (n = 1; n <= cr; n++) {
-                    if (usage->row[y*cr+n-1] ||
-                        usage->blk[b*cr+n-1])
+                    if ((usage->row[y] | usage->blk[b]) & DIGITBIT(n))
 			continue;
-		    for (i = 0; i < cr; i++) {
-			scratch->indexlist[i] = cubepos(i, y, n);
-			scratch->indexlist2[i] = cubepos2(usage->blocks->blocks[b][i], n);
-		    }
+		    for (i = 0; i < cr; i++)
+			scratch->indexlist[i] = y*cr+i;
 		    /*
 		     * solver_intersect() never returns -1.
 		     */
 		    if (solver_intersect(usage, scratch->indexlist,
-					 scratch->indexlist2
+					 usage->blocks->blocks[b], n
 #ifdef STANDALONE_SOLVER
                                           , "intersectional analysis,"
                                           " %d in row %d vs block %s",
                                           n, 1+y, usage->blocks->blocknames[b]
 #endif
                                           ) ||
-                         solver_intersect(usage, scratch->indexlist2,
-					 scratch->indexlist
+                         solver_intersect(usage, usage->blocks->blocks[b],
+					 scratch->indexlist, n
 #ifdef STANDALONE_SOLVER
                                           , "intersectional analysis,"
                                           " %d in block %s vs row %d",
@@ -2238,23 +2249,20 @@ static void solver(int cr, struct block_structure *blocks,
         for (x = 0; x < cr; x++)
             for (b = 0; b < cr; b++)
                 for (n = 1; n <= cr; n++) {
-                    if (usage->col[x*cr+n-1] ||
-                        usage->blk[b*cr+n-1])
+                    if ((usage->col[x] | usage->blk[b]) & DIGITBIT(n))
 			continue;
-		    for (i = 0; i < cr; i++) {
-			scratch->indexlist[i] = cubepos(x, i, n);
-			scratch->indexlist2[i] = cubepos2(usage->blocks->blocks[b][i], n);
-		    }
+		    for (i = 0; i < cr; i++)
+			scratch->indexlist[i] = i*cr+x;
 		    if (solver_intersect(usage, scratch->indexlist,
-					 scratch->indexlist2
+					 usage->blocks->blocks[b], n
 #ifdef STANDALONE_SOLVER
                                           , "intersectional analysis,"
                                           " %d in column %d vs block %s",
                                           n, 1+x, usage->blocks->blocknames[b]
 #endif
                                           ) ||
-                         solver_intersect(usage, scratch->indexlist2,
-					 scratch->indexlist
+                         solver_intersect(usage, usage->blocks->blocks[b],
+					 scratch->indexlist, n
 #ifdef STANDALONE_SOLVER
                                           , "intersectional analysis,"
                                           " %d in block %s vs column %d",
@@ -2272,23 +2280,20 @@ static void solver(int cr, struct block_structure *blocks,
 	     */
             for (b = 0; b < cr; b++)
                 for (n = 1; n <= cr; n++) {
-                    if (usage->diag[n-1] ||
-                        usage->blk[b*cr+n-1])
+                    if ((usage->diag[0] | usage->blk[b]) & DIGITBIT(n))
 			continue;
-		    for (i = 0; i < cr; i++) {
-			scratch->indexlist[i] = cubepos2(diag0(i), n);
-			scratch->indexlist2[i] = cubepos2(usage->blocks->blocks[b][i], n);
-		    }
+		    for (i = 0; i < cr; i++)
+			scratch->indexlist[i] = diag0(i);
 		    if (solver_intersect(usage, scratch->indexlist,
-					 scratch->indexlist2
+					 usage->blocks->blocks[b], n
 #ifdef STANDALONE_SOLVER
                                           , "intersectional analysis,"
                                           " %d in \\-diagonal vs block %s",
                                           n, usage->blocks->blocknames[b]
 #endif
                                           ) ||
-                         solver_intersect(usage, scratch->indexlist2,
-					 scratch->indexlist
+                         solver_intersect(usage, usage->blocks->blocks[b],
+					 scratch->indexlist, n
 #ifdef STANDALONE_SOLVER
                                           , "intersectional analysis,"
                                           " %d in block %s vs \\-diagonal",
@@ -2305,23 +2310,20 @@ static void solver(int cr, struct block_structure *blocks,
 	     */
             for (b = 0; b < cr; b++)
                 for (n = 1; n <= cr; n++) {
-                    if (usage->diag[cr+n-1] ||
-                        usage->blk[b*cr+n-1])
+                    if ((usage->diag[1] | usage->blk[b]) & DIGITBIT(n))
 			continue;
-		    for (i = 0; i < cr; i++) {
-			scratch->indexlist[i] = cubepos2(diag1(i), n);
-			scratch->indexlist2[i] = cubepos2(usage->blocks->blocks[b][i], n);
-		    }
+		    for (i = 0; i < cr; i++)
+			scratch->indexlist[i] = diag1(i);
 		    if (solver_intersect(usage, scratch->indexlist,
-					 scratch->indexlist2
+					 usage->blocks->blocks[b], n
 #ifdef STANDALONE_SOLVER
                                           , "intersectional analysis,"
                                           " %d in /-diagonal vs block %s",
                                           n, usage->blocks->blocknames[b]
 #endif
                                           ) ||
-                         solver_intersect(usage, scratch->indexlist2,
-					 scratch->indexlist
+                         solver_intersect(usage, usage->blocks->blocks[b],
+					 scratch->indexlist, n
 #ifdef STANDALONE_SOLVER
                                           , "intersectional analysis,"
                                           " %d in block %s vs /-diagonal",
@@ -2341,10 +2343,7 @@ static void solver(int cr, struct block_structure *blocks,
 	 * Blockwise set elimination.
 	 */
 	for (b = 0; b < cr; b++) {
-	    for (i = 0; i < cr; i++)
-		for (n = 1; n <= cr; n++)
-		    scratch->indexlist[i*cr+n-1] = cubepos2(usage->blocks->blocks[b][i], n);
-	    ret = solver_set(usage, scratch, scratch->indexlist
+	    ret = solver_set(usage, scratch, usage->blocks->blocks[b], 0
 #ifdef STANDALONE_SOLVER
 			     , "set elimination, block %s",
 			     usage->blocks->blocknames[b]
@@ -2364,9 +2363,8 @@ static void solver(int cr, struct block_structure *blocks,
 	 */
 	for (y = 0; y < cr; y++) {
 	    for (x = 0; x < cr; x++)
-		for (n = 1; n <= cr; n++)
-		    scratch->indexlist[x*cr+n-1] = cubepos(x, y, n);
-	    ret = solver_set(usage, scratch, scratch->indexlist
+		scratch->indexlist[x] = y*cr+x;
+	    ret = solver_set(usage, scratch, scratch->indexlist, 0
 #ifdef STANDALONE_SOLVER
 			     , "set elimination, row %d", 1+y
 #endif
@@ -2385,9 +2383,8 @@ static void solver(int cr, struct block_structure *blocks,
 	 */
 	for (x = 0; x < cr; x++) {
 	    for (y = 0; y < cr; y++)
-		for (n = 1; n <= cr; n++)
-		    scratch->indexlist[y*cr+n-1] = cubepos(x, y, n);
-            ret = solver_set(usage, scratch, scratch->indexlist
+		scratch->indexlist[y] = y*cr+x;
+            ret = solver_set(usage, scratch, scratch->indexlist, 0
 #ifdef STANDALONE_SOLVER
 			     , "set elimination, column %d", 1+x
 #endif
@@ -2406,9 +2403,8 @@ static void solver(int cr, struct block_structure *blocks,
 	     * \-diagonal set elimination.
 	     */
 	    for (i = 0; i < cr; i++)
-		for (n = 1; n <= cr; n++)
-		    scratch->indexlist[i*cr+n-1] = cubepos2(diag0(i), n);
-            ret = solver_set(usage, scratch, scratch->indexlist
+		scratch->indexlist[i] = diag0(i);
+            ret = solver_set(usage, scratch, scratch->indexlist, 0
 #ifdef STANDALONE_SOLVER
 			     , "set elimination, \\-diagonal"
 #endif
@@ -2425,9 +2421,8 @@ static void solver(int cr, struct block_structure *blocks,
 	     * /-diagonal set elimination.
 	     */
 	    for (i = 0; i < cr; i++)
-		for (n = 1; n <= cr; n++)
-		    scratch->indexlist[i*cr+n-1] = cubepos2(diag1(i), n);
-            ret = solver_set(usage, scratch, scratch->indexlist
+		scratch->indexlist[i] = diag1(i);
+            ret = solver_set(usage, scratch, scratch->indexlist, 0
 #ifdef STANDALONE_SOLVER
 			     , "set elimination, /-diagonal"
 #endif
@@ -2448,10 +2443,7 @@ static void solver(int cr, struct block_structure *blocks,
 	 * Row-vs-column set elimination on a single number.
 	 */
 	for (n = 1; n <= cr; n++) {
-	    for (y = 0; y < cr; y++)
-		for (x = 0; x < cr; x++)
-		    scratch->indexlist[y*cr+x] = cubepos(x, y, n);
-            ret = solver_set(usage, scratch, scratch->indexlist
+            ret = solver_set(usage, scratch, NULL, n
 #ifdef STANDALONE_SOLVER
 			     , "positional set elimination, number %d", n
 #endif
@@ -2502,10 +2494,7 @@ static void solver(int cr, struct block_structure *blocks,
 		     * An unfilled square. Count the number of
 		     * possible digits in it.
 		     */
-		    count = 0;
-		    for (n = 1; n <= cr; n++)
-			if (cube(x,y,n))
-			    count++;
+		    count = bitcount32(usage->cube[y*cr+x]);
 
 		    /*
 		     * We should have found any impossibilities
@@ -2531,9 +2520,9 @@ static void solver(int cr, struct block_structure *blocks,
 	    y = best / cr;
 	    x = best % cr;
 
-	    list = snewn(cr, digit);
-	    ingrid = snewn(cr * cr, digit);
-	    outgrid = snewn(cr * cr, digit);
+	    list = anewn(ar, cr, digit);
+	    ingrid = anewn(ar, cr * cr, digit);
+	    outgrid = anewn(ar, cr * cr, digit);
 	    memcpy(ingrid, grid, cr * cr);
 
 	    /* Make a list of the possible digits. */
@@ -2569,7 +2558,7 @@ static void solver(int cr, struct block_structure *blocks,
 		solver_recurse_depth++;
 #endif
 
-		solver(cr, blocks, kblocks, xtype, outgrid, kgrid, dlev);
+		solver(cr, blocks, kblocks, xtype, outgrid, kgrid, dlev, ar);
 
 #ifdef STANDALONE_SOLVER
 		solver_recurse_depth--;
@@ -2605,10 +2594,6 @@ static void solver(int cr, struct block_structure *blocks,
 		if (diff == DIFF_AMBIGUOUS)
 		    break;
 	    }
-
-	    sfree(outgrid);
-	    sfree(ingrid);
-	    sfree(list);
 	}
 
     } else {
@@ -2636,21 +2621,12 @@ static void solver(int cr, struct block_structure *blocks,
 	       "one solution");
 #endif
 
-    sfree(usage->sq2region);
-    sfree(usage->regions);
-    sfree(usage->cube);
-    sfree(usage->row);
-    sfree(usage->col);
-    sfree(usage->blk);
     if (usage->kblocks) {
 	free_block_structure(usage->kblocks);
 	free_block_structure(usage->extra_cages);
-	sfree(usage->extra_clues);
     }
-    if (usage->kclues) sfree(usage->kclues);
-    sfree(usage);
 
-    solver_free_scratch(scratch);
+    arena_restore(ar, mark);
 }
 
 /* ----------------------------------------------------------------------
@@ -2714,6 +2690,8 @@ struct gridgen_usage {
     int nspaces;
     /* If we need randomisation in the solve, this is our random state. */
     random_state *rs;
+    /* All the above arrays, and gridgen_real's digit lists, live here. */
+    arena *ar;
 };
 
 static void gridgen_place(struct gridgen_usage *usage, int x, int y, digit n)
@@ -2767,6 +2745,7 @@ static bool gridgen_real(struct gridgen_usage *usage, digit *grid, int *steps)
     bool ret;
     int *digits;
     unsigned int used;
+    arena_mark mark;
 
     /*
      * Firstly, check for completion! If there are no spaces left
@@ -2843,7 +2822,8 @@ static bool gridgen_real(struct gridgen_usage *usage, digit *grid, int *steps)
      * simply go through all possible values, shuffling them
      * randomly first if necessary.
      */
-    digits = snewn(bestm, int);
+    mark = arena_save(usage->ar);
+    digits = anewn(usage->ar, bestm, int);
 
     j = 0;
     for (n = 1; n <= cr; n++) {
@@ -2876,7 +2856,7 @@ static bool gridgen_real(struct gridgen_usage *usage, digit *grid, int *steps)
 	usage->nspaces++;
     }
 
-    sfree(digits);
+    arena_restore(usage->ar, mark);
     return ret;
 }
 
@@ -2886,9 +2866,10 @@ static bool gridgen_real(struct gridgen_usage *usage, digit *grid, int *steps)
  */
 static bool gridgen(int cr, struct block_structure *blocks,
                     struct block_structure *kblocks, bool xtype,
-                    digit *grid, random_state *rs, int maxsteps)
+                    digit *grid, random_state *rs, int maxsteps, arena *ar)
 {
     struct gridgen_usage *usage;
+    arena_mark mark = arena_save(ar);
     int x, y;
     bool ret;
 
@@ -2900,19 +2881,20 @@ static bool gridgen(int cr, struct block_structure *blocks,
     /*
      * Create a gridgen_usage structure.
      */
-    usage = snew(struct gridgen_usage);
+    usage = anew(ar, struct gridgen_usage);
 
+    usage->ar = ar;
     usage->cr = cr;
     usage->blocks = blocks;
 
     usage->grid = grid;
 
-    usage->row = snewn(cr, unsigned int);
-    usage->col = snewn(cr, unsigned int);
-    usage->blk = snewn(cr, unsigned int);
+    usage->row = anewn(ar, cr, unsigned int);
+    usage->col = anewn(ar, cr, unsigned int);
+    usage->blk = anewn(ar, cr, unsigned int);
     if (kblocks != NULL) {
 	usage->kblocks = kblocks;
-	usage->cge = snewn(usage->kblocks->nr_blocks, unsigned int);
+	usage->cge = anewn(ar, usage->kblocks->nr_blocks, unsigned int);
 	memset(usage->cge, 0, kblocks->nr_blocks * sizeof *usage->cge);
     } else {
 	usage->cge = NULL;
@@ -2923,7 +2905,7 @@ static bool gridgen(int cr, struct block_structure *blocks,
     memset(usage->blk, 0, cr * sizeof *usage->blk);
 
     if (xtype) {
-	usage->diag = snewn(2, unsigned int);
+	usage->diag = anewn(ar, 2, unsigned int);
 	memset(usage->diag, 0, 2 * sizeof *usage->diag);
     } else {
 	usage->diag = NULL;
@@ -2942,7 +2924,7 @@ static bool gridgen(int cr, struct block_structure *blocks,
     for (x = 0; x < cr; x++)
 	gridgen_place(usage, x, 0, grid[x]);
 
-    usage->spaces = snewn(cr * cr, struct gridgen_coord);
+    usage->spaces = anewn(ar, cr * cr, struct gridgen_coord);
     usage->nspaces = 0;
 
     usage->rs = rs;
@@ -2968,12 +2950,7 @@ static bool gridgen(int cr, struct block_structure *blocks,
     /*
      * Clean up the usage structure now we have our answer.
      */
-    sfree(usage->spaces);
-    sfree(usage->cge);
-    sfree(usage->blk);
-    sfree(usage->col);
-    sfree(usage->row);
-    sfree(usage);
+    arena_restore(ar, mark);
 
     return ret;
 }
@@ -3650,6 +3627,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     int coords[16], ncoords;
     int x, y, i, j;
     struct difficulty dlev;
+    arena *ar;
 
     precompute_sum_bits();
 
@@ -3665,14 +3643,20 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     if ((c == 2 && r == 2) || (r == 1 && c < 4))
         dlev.maxdiff = DIFF_BLOCK;
 
-    grid = snewn(area, digit);
-    locs = snewn(area, struct xy);
-    grid2 = snewn(area, digit);
+    /*
+     * Everything we only need until the desc is encoded, including
+     * all the solver and grid generator scratch space for every
+     * attempt, comes out of one arena.
+     */
+    ar = arena_new();
+    grid = anewn(ar, area, digit);
+    locs = anewn(ar, area, struct xy);
+    grid2 = anewn(ar, area, digit);
 
     blocks = alloc_block_structure (c, r, area, cr, cr);
 
     kblocks = NULL;
-    kgrid = (params->killer) ? snewn(area, digit) : NULL;
+    kgrid = (params->killer) ? anewn(ar, area, digit) : NULL;
 
 #ifdef STANDALONE_SOLVER
     assert(!"This should never happen, so we don't need to create blocknames");
@@ -3706,7 +3690,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	    kblocks = gen_killer_cages(cr, rs, params->kdiff > DIFF_KSINGLE);
 	}
 
-        if (!gridgen(cr, blocks, kblocks, params->xtype, grid, rs, area*area))
+        if (!gridgen(cr, blocks, kblocks, params->xtype, grid, rs, area*area,
+                     ar))
 	    continue;
         assert(check_valid(cr, blocks, kblocks, NULL, params->xtype, grid));
 
@@ -3744,7 +3729,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 		compute_kclues(kblocks, kgrid, grid2, area);
 
 		memset(grid, 0, area * sizeof *grid);
-		solver(cr, blocks, kblocks, params->xtype, grid, kgrid, &dlev);
+		solver(cr, blocks, kblocks, params->xtype, grid, kgrid, &dlev,
+                       ar);
 		if (dlev.diff == dlev.maxdiff && dlev.kdiff == dlev.maxkdiff) {
 		    /*
 		     * We have one that matches our difficulty.  Store it for
@@ -3843,7 +3829,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
             for (j = 0; j < ncoords; j++)
                 grid2[coords[2*j+1]*cr+coords[2*j]] = 0;
 
-            solver(cr, blocks, kblocks, params->xtype, grid2, kgrid, &dlev);
+            solver(cr, blocks, kblocks, params->xtype, grid2, kgrid, &dlev,
+                   ar);
             if (dlev.diff <= dlev.maxdiff &&
 		(!params->killer || dlev.kdiff <= dlev.maxkdiff)) {
                 for (j = 0; j < ncoords; j++)
@@ -3853,27 +3840,22 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 
         memcpy(grid2, grid, area);
 
-	solver(cr, blocks, kblocks, params->xtype, grid2, kgrid, &dlev);
+	solver(cr, blocks, kblocks, params->xtype, grid2, kgrid, &dlev, ar);
 	if (dlev.diff == dlev.maxdiff &&
 	    (!params->killer || dlev.kdiff == dlev.maxkdiff))
 	    break;		       /* found one! */
     }
 
-    sfree(grid2);
-    sfree(locs);
-
     /*
      * Now we have the grid as it will be presented to the user.
      * Encode it in a game desc.
      */
     desc = encode_puzzle_desc(params, grid, blocks, kgrid, kblocks);
 
-    sfree(grid);
     free_block_structure(blocks);
-    if (params->killer) {
+    if (params->killer)
         free_block_structure(kblocks);
-        sfree(kgrid);
-    }
+    arena_free(ar);
 
     return desc;
 }
@@ -4289,6 +4271,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     char *ret;
     digit *grid;
     struct difficulty dlev;
+    arena *ar;
 
     /*
      * If we already have the solution in ai, save ourselves some
@@ -4297,12 +4280,13 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     if (ai)
         return dupstr(ai);
 
-    grid = snewn(cr*cr, digit);
+    ar = arena_new();
+    grid = anewn(ar, cr*cr, digit);
     memcpy(grid, state->grid, cr*cr);
     dlev.maxdiff = DIFF_RECURSIVE;
     dlev.maxkdiff = DIFF_KINTERSECT;
     solver(cr, state->blocks, state->kblocks, state->xtype, grid,
-	   state->kgrid, &dlev);
+	   state->kgrid, &dlev, ar);
 
     *error = NULL;
 
@@ -4312,13 +4296,13 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	*error = "Multiple solutions exist for this puzzle";
 
     if (*error) {
-        sfree(grid);
+        arena_free(ar);
         return NULL;
     }
 
     ret = encode_solve_move(cr, grid);
 
-    sfree(grid);
+    arena_free(ar);
 
     return ret;
 }
@@ -5646,6 +5630,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -5709,7 +5694,12 @@ int main(int argc, char **argv)
 
     dlev.maxdiff = DIFF_RECURSIVE;
     dlev.maxkdiff = DIFF_KINTERSECT;
-    solver(s->cr, s->blocks, s->kblocks, s->xtype, s->grid, s->kgrid, &dlev);
+    {
+        arena *ar = arena_new();
+        solver(s->cr, s->blocks, s->kblocks, s->xtype, s->grid, s->kgrid,
+               &dlev, ar);
+        arena_free(ar);
+    }
     if (grade) {
 	printf("Difficulty rating: %s\n",
 	       dlev.diff==DIFF_BLOCK ? "Trivial (blockwise positional elimination only)":
@@ -428,32 +428,151 @@ enum { N, U, L, R, D, MAXDIR };	       /* link directions */
 struct solver_scratch {
     char *links;		       /* mapping between trees and tents */
     int *locs;
-    char *place, *mrows, *trows;
+    char *mrows;
+    char *fwd, *bwd;                   /* see solver_line */
 };
 
 static struct solver_scratch *new_scratch(int w, int h)
 {
     struct solver_scratch *ret = snew(struct solver_scratch);
+    int len = max(w, h);
 
     ret->links = snewn(w*h, char);
-    ret->locs = snewn(max(w, h), int);
-    ret->place = snewn(max(w, h), char);
-    ret->mrows = snewn(3 * max(w, h), char);
-    ret->trows = snewn(3 * max(w, h), char);
+    ret->locs = snewn(len, int);
+    ret->mrows = snewn(3 * len, char);
+    ret->fwd = snewn((len+1) * (len+1) * 2, char);
+    ret->bwd = snewn((len+1) * (len+1) * 2, char);
 
     return ret;
 }
 
 static void free_scratch(struct solver_scratch *sc)
 {
-    sfree(sc->trows);
+    sfree(sc->bwd);
+    sfree(sc->fwd);
     sfree(sc->mrows);
-    sfree(sc->place);
     sfree(sc->locs);
     sfree(sc->links);
     sfree(sc);
 }
 
+/*
+ * Work out what can be deduced about a row or column from its
+ * number, given that there are k tents still to place in the n free
+ * squares whose positions are in sc->locs, and that no two of them
+ * may be adjacent.
+ *
+ * The results go in sc->mrows, which has three sections of 'len'
+ * squares. The first describes the line itself: a free square is
+ * TENT or NONTENT if every valid placement of the tents agrees on
+ * it, and BLANK otherwise. The other two describe each of the
+ * neighbouring lines: a square there is NONTENT if every valid
+ * placement puts a tent next to it, and BLANK otherwise. Everything
+ * else is MAGIC, and if there is no valid placement at all, then
+ * everything is MAGIC.
+ *
+ * Trying every placement in turn would take exponential time in a
+ * long line, so instead we use dynamic programming.
+ * fwd[LINEIDX(j,t,s)] says whether the first j free squares can hold
+ * t tents, with square j-1 holding one iff s; bwd[LINEIDX(j,t,s)]
+ * says whether the free squares from j onwards can hold t tents,
+ * given that square j-1 holds one iff s.
+ */
+#define LINEIDX(j, t, s) ((((j) * (k+1)) + (t)) * 2 + (s))
+static void solver_line(struct solver_scratch *sc, int n, int k, int len)
+{
+    const int *locs = sc->locs;
+    char *fwd = sc->fwd, *bwd = sc->bwd;
+    char *mrow = sc->mrows, *mrow1 = sc->mrows + len, *mrow2 = mrow1 + len;
+    int j, t, s, a, b;
+
+    /*
+     * A number that can't be met at all (which can only happen in
+     * an inconsistent puzzle) counts as the nearest one that can.
+     */
+    if (k < 0)
+        k = 0;
+    if (k > n)
+        k = n;
+
+    memset(mrow, MAGIC, 3*len);
+    memset(fwd, 0, (n+1) * (k+1) * 2);
+    memset(bwd, 0, (n+1) * (k+1) * 2);
+
+    fwd[LINEIDX(0, 0, 0)] = 1;
+    for (j = 0; j < n; j++) {
+        bool adj = (j > 0 && locs[j] == locs[j-1] + 1);
+        for (t = 0; t <= k; t++)
+            for (s = 0; s < 2; s++)
+                if (fwd[LINEIDX(j, t, s)]) {
+                    fwd[LINEIDX(j+1, t, 0)] = 1;
+                    if (t < k && !(s && adj))
+                        fwd[LINEIDX(j+1, t+1, 1)] = 1;
+                }
+    }
+
+    bwd[LINEIDX(n, 0, 0)] = bwd[LINEIDX(n, 0, 1)] = 1;
+    for (j = n-1; j >= 0; j--) {
+        bool adj = (j > 0 && locs[j] == locs[j-1] + 1);
+        for (t = 0; t <= k; t++)
+            for (s = 0; s < 2; s++)
+                bwd[LINEIDX(j, t, s)] =
+                    bwd[LINEIDX(j+1, t, 0)] ||
+                    (t > 0 && !(s && adj) && bwd[LINEIDX(j+1, t-1, 1)]);
+    }
+
+    if (!bwd[LINEIDX(0, k, 0)])
+        return;                        /* no valid placement */
+
+    /*
+     * A free square can hold a tent if some valid way of filling
+     * the squares before it leaves room for one there and for the
+     * rest after it, and similarly for a non-tent.
+     */
+    for (j = 0; j < n; j++) {
+        bool adj = (j > 0 && locs[j] == locs[j-1] + 1);
+        bool cantent = false, cannontent = false;
+
+        for (t = 0; t <= k; t++)
+            for (s = 0; s < 2; s++)
+                if (fwd[LINEIDX(j, t, s)]) {
+                    if (t < k && !(s && adj) &&
+                        bwd[LINEIDX(j+1, k-t-1, 1)])
+                        cantent = true;
+                    if (bwd[LINEIDX(j+1, k-t, 0)])
+                        cannontent = true;
+                }
+
+        mrow[locs[j]] = (cantent && cannontent ? BLANK :
+                         cantent ? TENT : NONTENT);
+    }
+
+    /*
+     * A square in a neighbouring line can avoid having a tent next
+     * to it iff the free squares a,...,b-1 which are next to it can
+     * all be non-tents at once.
+     */
+    a = b = 0;
+    for (j = 0; j < len; j++) {
+        bool avoidable = false;
+
+        while (a < n && locs[a] < j-1)
+            a++;
+        while (b < n && locs[b] <= j+1)
+            b++;
+
+        if (a == b)
+            avoidable = true;
+        for (t = 0; t <= k && !avoidable; t++)
+            for (s = 0; s < 2; s++)
+                if (fwd[LINEIDX(a, t, s)] && bwd[LINEIDX(b, k-t, 0)])
+                    avoidable = true;
+
+        mrow1[j] = mrow2[j] = (avoidable ? BLANK : NONTENT);
+    }
+}
+#undef LINEIDX
+
 /*
  * Solver. Returns 0 for impossibility, 1 for success, 2 for
  * ambiguity or failure to converge.
@@ -462,7 +581,7 @@ static int tents_solve(int w, int h, const char *grid, int *numbers,
 		       char *soln, struct solver_scratch *sc, int diff)
 {
     int x, y, d, i, j;
-    char *mrow, *trow, *trow1, *trow2;
+    char *mrow;
 
     /*
      * Set up solver data.
@@ -668,10 +787,10 @@ static int tents_solve(int w, int h, const char *grid, int *numbers,
 	 * If localised deductions about the trees and tents
 	 * themselves haven't helped us, it's time to resort to the
 	 * numbers round the grid edge. For each row and column, we
-	 * go through all possible combinations of locations for
-	 * the unplaced tents, rule out any which have adjacent
-	 * tents, and spot any square which is given the same state
-	 * by all remaining combinations.
+	 * consider all possible combinations of locations for the
+	 * unplaced tents, rule out any which have adjacent tents, and
+	 * spot any square which is given the same state by all
+	 * remaining combinations. (See solver_line.)
 	 */
 	for (i = 0; i < w+h; i++) {
 	    int start, step, len, start1, start2, n, k;
@@ -735,114 +854,8 @@ static int tents_solve(int w, int h, const char *grid, int *numbers,
 	    if (n == 0)
 		continue;	       /* nothing left to do here */
 
-	    /*
-	     * Now we know we're placing k tents in n squares. Set
-	     * up the first possibility.
-	     */
-	    for (j = 0; j < n; j++)
-		sc->place[j] = (j < k ? TENT : NONTENT);
-
-	    /*
-	     * We're aiming to find squares in this row which are
-	     * invariant over all valid possibilities. Thus, we
-	     * maintain the current state of that invariance. We
-	     * start everything off at MAGIC to indicate that it
-	     * hasn't been set up yet.
-	     */
+	    solver_line(sc, n, k, len);
 	    mrow = sc->mrows;
-	    trow = sc->trows;
-	    trow1 = sc->trows + len;
-	    trow2 = sc->trows + 2*len;
-	    memset(mrow, MAGIC, 3*len);
-
-	    /*
-	     * And iterate over all possibilities.
-	     */
-	    while (1) {
-		int p;
-                bool valid;
-
-		/*
-		 * See if this possibility is valid. The only way
-		 * it can fail to be valid is if it contains two
-		 * adjacent tents. (Other forms of invalidity, such
-		 * as containing a tent adjacent to one already
-		 * placed, will have been dealt with already by
-		 * other parts of the solver.)
-		 */
-		valid = true;
-		for (j = 0; j+1 < n; j++)
-		    if (sc->place[j] == TENT &&
-			sc->place[j+1] == TENT &&
-			sc->locs[j+1] == sc->locs[j]+1) {
-			valid = false;
-			break;
-		    }
-
-		if (valid) {
-		    /*
-		     * Merge this valid combination into mrow.
-		     */
-		    memset(trow, MAGIC, len);
-		    memset(trow+len, BLANK, 2*len);
-		    for (j = 0; j < n; j++) {
-			trow[sc->locs[j]] = sc->place[j];
-			if (sc->place[j] == TENT) {
-			    int jj;
-			    for (jj = sc->locs[j]-1; jj <= sc->locs[j]+1; jj++)
-				if (jj >= 0 && jj < len)
-				    trow1[jj] = trow2[jj] = NONTENT;
-			}
-		    }
-
-		    for (j = 0; j < 3*len; j++) {
-			if (trow[j] == MAGIC)
-			    continue;
-			if (mrow[j] == MAGIC || mrow[j] == trow[j]) {
-			    /*
-			     * Either this is the first valid
-			     * placement we've found at all, or
-			     * this square's contents are
-			     * consistent with every previous valid
-			     * combination.
-			     */
-			    mrow[j] = trow[j];
-			} else {
-			    /*
-			     * This square's contents fail to match
-			     * what they were in a different
-			     * combination, so we cannot deduce
-			     * anything about this square.
-			     */
-			    mrow[j] = BLANK;
-			}
-		    }
-		}
-
-		/*
-		 * Find the next combination of k choices from n.
-		 * We do this by finding the rightmost tent which
-		 * can be moved one place right, doing so, and
-		 * shunting all tents to the right of that as far
-		 * left as they can go.
-		 */
-		p = 0;
-		for (j = n-1; j > 0; j--) {
-		    if (sc->place[j] == TENT)
-			p++;
-		    if (sc->place[j] == NONTENT && sc->place[j-1] == TENT) {
-			sc->place[j-1] = NONTENT;
-			sc->place[j] = TENT;
-			while (p--)
-			    sc->place[++j] = TENT;
-			while (++j < n)
-			    sc->place[j] = NONTENT;
-			break;
-		    }
-		}
-		if (j <= 0)
-		    break;	       /* we've finished */
-	    }
 
 	    /*
 	     * It's just possible that _no_ placement was valid, in
@@ -923,6 +936,9 @@ static char *new_game_desc(const game_params *params_in, random_state *rs,
     int **adjlists = snewn(ntrees, int *);
     int *adjsizes = snewn(ntrees, int);
     int *outr = snewn(4*ntrees, int);
+    /* There are never more than 4*ntrees potential tree squares, so
+     * this is big enough for every attempt's matching. */
+    void *mscratch = smalloc(matching_scratch_size(ntrees, 4*ntrees));
     struct solver_scratch *sc = new_scratch(w, h);
     char *ret, *p;
     int i, j, nl, nr;
@@ -1059,7 +1075,8 @@ static char *new_game_desc(const game_params *params_in, random_state *rs,
 	/*
 	 * Call the matching algorithm to actually place the trees.
 	 */
-	j = matching(ntrees, nr, adjlists, adjsizes, rs, NULL, outr);
+	j = matching_with_scratch(mscratch, ntrees, nr, adjlists, adjsizes,
+                                  rs, NULL, outr);
 
 	if (j < ntrees)
 	    continue;		       /* couldn't place all the trees */
@@ -1181,6 +1198,7 @@ static char *new_game_desc(const game_params *params_in, random_state *rs,
     *aux = sresize(*aux, p - *aux, char);
 
     free_scratch(sc);
+    sfree(mscratch);
     sfree(outr);
     sfree(adjdata);
     sfree(adjlists);
@@ -2663,6 +2681,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILESIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -289,7 +289,7 @@ static int solver_easy(struct latin_solver *solver, void *vctx)
 		CSTARTSTEP(cstart, cstep, c, w);
 		pos = start + (ctx->clues[c]-1)*step;
 		cpos = cstart + (ctx->clues[c]-1)*cstep;
-		if (solver->cube[cpos*w+w-1]) {
+		if (cubebit(cpos, w)) {
 #ifdef STANDALONE_SOLVER
 		    if (solver_show_working) {
 			printf("%*sfacing clues on %s %d are maximal:\n",
@@ -370,7 +370,7 @@ static int solver_easy(struct latin_solver *solver, void *vctx)
 		if (ctx->dscratch[i-1] < w && ctx->dscratch[i-1] >= furthest)
 		    continue;	       /* skip this number, it's elsewhere */
 		j--;
-		if (solver->cube[cstart*w+i-1]) {
+		if (cubebit(cstart, i)) {
 #ifdef STANDALONE_SOLVER
 		    if (solver_show_working) {
 			printf("%s%*s  ruling out %d at (%d,%d)\n",
@@ -379,7 +379,7 @@ static int solver_easy(struct latin_solver *solver, void *vctx)
 			prefix[0] = '\0';
 		    }
 #endif
-		    solver->cube[cstart*w+i-1] = 0;
+		    latin_solver_rule_out(solver, start%w, start/w, i);
 		    ret = 1;
 		}
 	    }
@@ -419,17 +419,17 @@ static int solver_easy(struct latin_solver *solver, void *vctx)
 	    }
 
 	    for (j = 0; j < clue - i - 1; j++)
-		if (solver->cube[(cstart + j*cstep)*w+n-1]) {
+		if (cubebit(cstart + j*cstep, n)) {
+		    pos = start+j*step;
 #ifdef STANDALONE_SOLVER
 		    if (solver_show_working) {
-			int pos = start+j*step;
 			printf("%s%*s  ruling out %d at (%d,%d)\n",
 			       prefix, solver_recurse_depth*4, "",
 			       n, pos%w+1, pos/w+1);
 			prefix[0] = '\0';
 		    }
 #endif
-		    solver->cube[(cstart + j*cstep)*w+n-1] = 0;
+		    latin_solver_rule_out(solver, pos%w, pos/w, n);
 		    ret = 1;
 		}
 	    i++;
@@ -485,7 +485,7 @@ static int solver_hard(struct latin_solver *solver, void *vctx)
 		for (j = ctx->dscratch[i] + 1; j <= limit; j++) {
 		    if (bitmap & (1L << j))
 			continue;      /* used this one already */
-		    if (!solver->cube[pos*w+j-1])
+		    if (!cubebit(pos, j))
 			continue;      /* ruled out already */
 
 		    /* Found one. */
@@ -546,7 +546,7 @@ static int solver_hard(struct latin_solver *solver, void *vctx)
 	for (i = 0; i < w; i++) {
 	    int pos = start + step * i;
 	    for (j = 1; j <= w; j++) {
-		if (solver->cube[pos*w+j-1] &&
+		if (cubebit(pos, j) &&
 		    !(ctx->iscratch[i] & (1L << j))) {
 #ifdef STANDALONE_SOLVER
 		    if (solver_show_working) {
@@ -556,7 +556,7 @@ static int solver_hard(struct latin_solver *solver, void *vctx)
 			prefix[0] = '\0';
 		    }
 #endif
-		    solver->cube[pos*w+j-1] = 0;
+		    latin_solver_rule_out(solver, pos/w, pos%w, j);
 		    ret = 1;
 		}
 	    }
@@ -610,7 +610,11 @@ static bool towers_valid(struct latin_solver *solver, void *vctx)
     return true;
 }
 
-static int solver(int w, int *clues, digit *soln, int maxdiff)
+/*
+ * 'ar' may be NULL, in which case the Latin square solver uses a
+ * private arena for its scratch space.
+ */
+static int solver(int w, int *clues, digit *soln, int maxdiff, arena *ar)
 {
     int ret;
     struct solver_ctx ctx;
@@ -625,7 +629,7 @@ static int solver(int w, int *clues, digit *soln, int maxdiff)
     ret = latin_solver(soln, w, maxdiff,
 		       DIFF_EASY, DIFF_HARD, DIFF_EXTREME,
 		       DIFF_EXTREME, DIFF_UNREASONABLE,
-		       towers_solvers, towers_valid, &ctx, NULL, NULL);
+		       towers_solvers, towers_valid, &ctx, NULL, NULL, ar);
 
     sfree(ctx.iscratch);
     sfree(ctx.dscratch);
@@ -646,6 +650,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     int i, ret;
     int diff = params->diff;
     char *desc, *p;
+    arena *ar;
 
     /*
      * Difficulty exceptions: some combinations of size and
@@ -677,6 +682,7 @@ done
     soln = snewn(a, digit);
     soln2 = snewn(a, digit);
     order = snewn(max(4*w,a), int);
+    ar = arena_new();                  /* scratch space for every solve */
 
     while (1) {
 	/*
@@ -715,7 +721,7 @@ done
 	     * grids.
 	     */
 	    memset(soln2, 0, a);
-	    ret = solver(w, clues, soln2, diff);
+	    ret = solver(w, clues, soln2, diff, ar);
 	    if (ret > diff)
 		continue;
 	}
@@ -728,7 +734,7 @@ done
 
 	    memcpy(soln2, grid, a);
 	    soln2[j] = 0;
-	    ret = solver(w, clues, soln2, diff);
+	    ret = solver(w, clues, soln2, diff, ar);
 	    if (ret <= diff)
 		grid[j] = 0;
 	}
@@ -743,7 +749,7 @@ done
 
 		memcpy(soln2, grid, a);
 		clues[j] = 0;
-		ret = solver(w, clues, soln2, diff);
+		ret = solver(w, clues, soln2, diff, ar);
 		if (ret > diff)
 		    clues[j] = clue;
 	    }
@@ -754,7 +760,7 @@ done
 	 * level, but not at the one below.
 	 */
 	memcpy(soln2, grid, a);
-	ret = solver(w, clues, soln2, diff);
+	ret = solver(w, clues, soln2, diff, ar);
 	if (ret != diff)
 	    continue;		       /* go round again */
 
@@ -827,6 +833,7 @@ done
     sfree(soln);
     sfree(soln2);
     sfree(order);
+    arena_free(ar);
 
     return desc;
 }
@@ -1037,7 +1044,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     soln = snewn(a, digit);
     memcpy(soln, state->clues->immutable, a);
 
-    ret = solver(w, state->clues->clues, soln, DIFFCOUNT-1);
+    ret = solver(w, state->clues->clues, soln, DIFFCOUNT-1, NULL);
 
     if (ret == diff_impossible) {
 	*error = "No solution exists for this puzzle";
@@ -2070,6 +2077,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILESIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -2143,7 +2151,7 @@ int main(int argc, char **argv)
     solver_show_working = 0;
     for (diff = 0; diff < DIFFCOUNT; diff++) {
 	memcpy(s->grid, s->clues->immutable, p->w * p->w);
-	ret = solver(p->w, s->clues->clues, s->grid, diff);
+	ret = solver(p->w, s->clues->clues, s->grid, diff, NULL);
 	if (ret <= diff)
 	    break;
     }
@@ -2156,7 +2164,7 @@ int main(int argc, char **argv)
         solver_show_working = really_show_working;
         memcpy(s->grid, s->clues->immutable, p->w * p->w);
         ret = solver(p->w, s->clues->clues, s->grid,
-                     diff < DIFFCOUNT ? diff : DIFFCOUNT-1);
+                     diff < DIFFCOUNT ? diff : DIFFCOUNT-1, NULL);
     }
 
     if (diff == DIFFCOUNT) {
@@ -59,6 +59,73 @@ tree234 *newtree234(cmpfn234 cmp) {
     return ret;
 }
 
+/*
+ * Build a subtree from n elements, where maxsize is the most elements
+ * a subtree of the height we want can hold (so 3 for a leaf, 15 for
+ * a node with leaves below it, and so on). n must be at least the
+ * least such a subtree can hold, and the choice of the number of
+ * children below makes sure that remains true all the way down.
+ */
+static node234 *build234_internal(void **elems, int n, long long maxsize) {
+    node234 *node = snew(node234);
+    long long submax = (maxsize - 3) / 4;
+    int nkids, i, start, sub;
+
+    node->parent = NULL;
+    for (i = 0; i < 4; i++) {
+	node->kids[i] = NULL;
+	node->counts[i] = 0;
+    }
+    for (i = 0; i < 3; i++)
+	node->elems[i] = NULL;
+
+    if (maxsize == 3) {
+	assert(n >= 1 && n <= 3);
+	for (i = 0; i < n; i++)
+	    node->elems[i] = elems[i];
+	return node;
+    }
+
+    /*
+     * Use as few children as will hold everything, and share the
+     * elements between them as evenly as possible.
+     */
+    for (nkids = 2; nkids < 4 && n - (nkids-1) > nkids * submax; nkids++);
+    sub = n - (nkids-1);
+    start = 0;
+    for (i = 0; i < nkids; i++) {
+	int size = (int)((long long)sub * (i+1) / nkids -
+			 (long long)sub * i / nkids);
+	node->kids[i] = build234_internal(elems + start, size, submax);
+	node->kids[i]->parent = node;
+	node->counts[i] = size;
+	start += size;
+	if (i < nkids-1)
+	    node->elems[i] = elems[start++];
+    }
+
+    return node;
+}
+
+/*
+ * Create a 2-3-4 tree from an array of elements already in order.
+ */
+tree234 *buildtree234(cmpfn234 cmp, void **elems, int n) {
+    tree234 *ret = newtree234(cmp);
+    long long maxsize;
+    int i;
+
+    if (cmp)
+	for (i = 1; i < n; i++)
+	    assert(cmp(elems[i-1], elems[i]) < 0);
+
+    if (n > 0) {
+	for (maxsize = 3; maxsize < n; maxsize = maxsize * 4 + 3);
+	ret->root = build234_internal(elems, n, maxsize);
+    }
+    return ret;
+}
+
 /*
  * Free a 2-3-4 tree (not including freeing the elements).
  */
@@ -429,6 +496,96 @@ void *index234(tree234 *t, int index) {
     return NULL;
 }
 
+/*
+ * Cursors. A cursor points at an element by its node and position
+ * within the node, and steps to the next one by going down to the
+ * start of the following subtree, or back up past the subtrees it's
+ * finished with.
+ */
+void *cursorindex234(tree234 *t, int index, cursor234 *c) {
+    node234 *n;
+    int ki;
+
+    c->node = NULL;
+    if (!t->root || index < 0 || index >= countnode234(t->root))
+	return NULL;		       /* out of range */
+
+    n = t->root;
+    while (1) {
+	for (ki = 0; ki < 3; ki++) {
+	    if (index < n->counts[ki])
+		break;
+	    index -= n->counts[ki] + 1;
+	    if (index < 0) {
+		c->node = n;
+		c->pos = ki;
+		return n->elems[ki];
+	    }
+	}
+	n = n->kids[ki];
+    }
+}
+void *cursornext234(cursor234 *c) {
+    node234 *n = (node234 *)c->node, *child;
+    int ki;
+
+    if (!n)
+	return NULL;
+
+    ki = c->pos + 1;
+    if (n->kids[ki]) {
+	n = n->kids[ki];
+	while (n->kids[0])
+	    n = n->kids[0];
+	ki = 0;
+    } else {
+	while (ki > 2 || !n->elems[ki]) {
+	    child = n;
+	    n = n->parent;
+	    if (!n) {
+		c->node = NULL;
+		return NULL;
+	    }
+	    for (ki = 0; n->kids[ki] != child; ki++);
+	}
+    }
+
+    c->node = n;
+    c->pos = ki;
+    return n->elems[ki];
+}
+void *cursorprev234(cursor234 *c) {
+    node234 *n = (node234 *)c->node, *child;
+    int ki;
+
+    if (!n)
+	return NULL;
+
+    ki = c->pos;
+    if (n->kids[ki]) {
+	n = n->kids[ki];
+	while (n->kids[0])
+	    n = n->kids[n->elems[2] ? 3 : n->elems[1] ? 2 : 1];
+	ki = (n->elems[2] ? 2 : n->elems[1] ? 1 : 0);
+    } else {
+	ki--;
+	while (ki < 0) {
+	    child = n;
+	    n = n->parent;
+	    if (!n) {
+		c->node = NULL;
+		return NULL;
+	    }
+	    for (ki = 0; n->kids[ki] != child; ki++);
+	    ki--;
+	}
+    }
+
+    c->node = n;
+    c->pos = ki;
+    return n->elems[ki];
+}
+
 /*
  * Find an element e in a sorted 2-3-4 tree t. Returns NULL if not
  * found. e is always passed as the first argument to cmp, so cmp
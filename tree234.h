@@ -36,6 +36,9 @@
  * subsidiary node structure, as long as you're prepared to commit to
  * responding to changes in the internals (which probably means you're
  * tree234.c itself or tree234-test.c).
+ *
+ * (btree234.c implements this same API as a B+-tree, with internals
+ * of its own which aren't exposed here.)
  */
 typedef struct tree234_Tag tree234;
 
@@ -68,6 +71,14 @@ int height234(tree234 *t);
  */
 tree234 *newtree234(cmpfn234 cmp);
 
+/*
+ * Create a 2-3-4 tree containing the n elements in the array
+ * `elems', in that order, in O(n) time. If `cmp' is non-NULL, the
+ * elements must already be sorted by it with no duplicates. The
+ * array itself is not retained.
+ */
+tree234 *buildtree234(cmpfn234 cmp, void **elems, int n);
+
 /*
  * Free a 2-3-4 tree (not including freeing the elements).
  */
@@ -109,6 +120,33 @@ void *addpos234(tree234 *t, void *e, int index);
  */
 void *index234(tree234 *t, int index);
 
+/*
+ * A cursor remembers a position in a tree, so that you can step to
+ * the next or previous element without the full root-to-leaf search
+ * that each index234 call does. Over a whole pass through the tree,
+ * each step takes constant time on average:
+ *
+ *   cursor234 c;
+ *   for (p = cursorindex234(tree, 0, &c); p; p = cursornext234(&c))
+ *       consume(p);
+ *
+ * cursorindex234 returns the element at a given index, like
+ * index234, and points the cursor at it. cursornext234 and
+ * cursorprev234 move the cursor one element along and return the
+ * element there. All three return NULL when they run off either end
+ * of the tree, after which the cursor is no longer usable.
+ *
+ * A cursor is invalidated by any change to the tree it points into.
+ * Its contents are private to the tree implementation.
+ */
+typedef struct cursor234_Tag {
+    void *node;
+    int pos;
+} cursor234;
+void *cursorindex234(tree234 *t, int index, cursor234 *c);
+void *cursornext234(cursor234 *c);
+void *cursorprev234(cursor234 *c);
+
 /*
  * Find an element e in a sorted 2-3-4 tree t. Returns NULL if not
  * found. e is always passed as the first argument to cmp, so cmp
@@ -314,8 +314,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     int *grid;
     int w = params->w, h = params->h, n = params->n, wh = w*h;
     int i;
-    char *ret;
-    int retlen;
+    strbuf *sb;
     int total_moves;
 
     /*
@@ -412,24 +411,17 @@ static char *new_game_desc(const game_params *params, random_state *rs,
      * unless the puzzle is orientable in which case they're
      * separated by orientation letters `u', `d', `l' and `r'.
      */
-    ret = NULL;
-    retlen = 0;
+    sb = strbuf_new();
     for (i = 0; i < wh; i++) {
-        char buf[80];
-        int k;
-
-        k = sprintf(buf, "%d%c", grid[i] / 4,
-		    (char)(params->orientable ? "uldr"[grid[i] & 3] : ','));
-
-        ret = sresize(ret, retlen + k + 1, char);
-        strcpy(ret + retlen, buf);
-        retlen += k;
+        if (!params->orientable && i > 0)
+            strbuf_addc(sb, ',');
+        strbuf_addint(sb, grid[i] / 4);
+        if (params->orientable)
+            strbuf_addc(sb, "uldr"[grid[i] & 3]);
     }
-    if (!params->orientable)
-	ret[retlen-1] = '\0';	       /* delete last comma */
 
     sfree(grid);
-    return ret;
+    return strbuf_to_str(sb);
 }
 
 static const char *validate_desc(const game_params *params, const char *desc)
@@ -441,10 +433,8 @@ static const char *validate_desc(const game_params *params, const char *desc)
     p = desc;
 
     for (i = 0; i < wh; i++) {
-	if (*p < '0' || *p > '9')
+	if (read_number(&p) < 0)
 	    return "Not enough numbers in string";
-	while (*p >= '0' && *p <= '9')
-	    p++;
 	if (!params->orientable && i < wh-1) {
 	    if (*p != ',')
 		return "Expected comma after number";
@@ -484,9 +474,7 @@ static game_state *new_game(midend *me, const game_params *params,
     p = desc;
 
     for (i = 0; i < wh; i++) {
-	state->grid[i] = 4 * atoi(p);
-	while (*p >= '0' && *p <= '9')
-	    p++;
+	state->grid[i] = 4 * read_number(&p);
 	if (*p) {
 	    if (params->orientable) {
 		switch (*p) {
@@ -1323,6 +1311,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -606,20 +606,20 @@ static void free_ctx(void *vctx)
 
 static void solver_nminmax(struct latin_solver *solver,
                            int x, int y, int *min_r, int *max_r,
-                           unsigned char **ns_r)
+                           latin_mask *ns_r)
 {
     int o = solver->o, min = o, max = 0, n;
-    unsigned char *ns;
+    latin_mask ns;
 
     assert(x >= 0 && y >= 0 && x < o && y < o);
 
-    ns = solver->cube + cubepos(x,y,1);
+    ns = solver->cube[cubecell(x,y)];
 
     if (grid(x,y) > 0) {
         min = max = grid(x,y)-1;
     } else {
         for (n = 0; n < o; n++) {
-            if (ns[n]) {
+            if (ns & (1UL << n)) {
                 if (n > max) max = n;
                 if (n < min) min = n;
             }
@@ -634,7 +634,7 @@ static int solver_links(struct latin_solver *solver, void *vctx)
 {
     struct solver_ctx *ctx = (struct solver_ctx *)vctx;
     int i, j, lmin, gmax, nchanged = 0;
-    unsigned char *gns, *lns;
+    latin_mask gns, lns;
     struct solver_link *link;
 
     for (i = 0; i < ctx->nlinks; i++) {
@@ -645,7 +645,7 @@ static int solver_links(struct latin_solver *solver, void *vctx)
         for (j = 0; j < solver->o; j++) {
             /* For the 'greater' end of the link, discount all numbers
              * too small to satisfy the inequality. */
-            if (gns[j]) {
+            if (gns & (1UL << j)) {
                 if (j < (lmin+link->len)) {
 #ifdef STANDALONE_SOLVER
                     if (solver_show_working) {
@@ -657,13 +657,13 @@ static int solver_links(struct latin_solver *solver, void *vctx)
                                j+1, link->gx+1, link->gy+1);
                     }
 #endif
-                    cube(link->gx, link->gy, j+1) = false;
+                    latin_solver_rule_out(solver, link->gx, link->gy, j+1);
                     nchanged++;
                 }
             }
             /* For the 'lesser' end of the link, discount all numbers
              * too large to satisfy inequality. */
-            if (lns[j]) {
+            if (lns & (1UL << j)) {
                 if (j > (gmax-link->len)) {
 #ifdef STANDALONE_SOLVER
                     if (solver_show_working) {
@@ -675,7 +675,7 @@ static int solver_links(struct latin_solver *solver, void *vctx)
                                j+1, link->lx+1, link->ly+1);
                     }
 #endif
-                    cube(link->lx, link->ly, j+1) = false;
+                    latin_solver_rule_out(solver, link->lx, link->ly, j+1);
                     nchanged++;
                 }
             }
@@ -725,7 +725,7 @@ static int solver_adjacent(struct latin_solver *solver, void *vctx)
                                solver_recurse_depth*4, "", n+1, nx+1, ny+1);
                     }
 #endif
-                    cube(nx, ny, n+1) = false;
+                    latin_solver_rule_out(solver, nx, ny, n+1);
                     nchanged++;
                 }
             }
@@ -790,7 +790,7 @@ static int solver_adjacent_set(struct latin_solver *solver, void *vctx)
                                solver_recurse_depth*4, "", n+1, nx+1, ny+1);
                     }
 #endif
-                    cube(nx, ny, n+1) = false;
+                    latin_solver_rule_out(solver, nx, ny, n+1);
                     nchanged++;
                 }
             }
@@ -889,13 +889,17 @@ static bool unequal_valid(struct latin_solver *solver, void *vctx)
     return true;
 }
 
-static int solver_state(game_state *state, int maxdiff)
+/*
+ * 'ar' may be NULL, in which case the Latin square solver uses a
+ * private arena for its scratch space.
+ */
+static int solver_state(game_state *state, int maxdiff, arena *ar)
 {
     struct solver_ctx *ctx = new_ctx(state);
     struct latin_solver solver;
     int diff;
 
-    if (latin_solver_alloc(&solver, state->nums, state->order))
+    if (latin_solver_alloc(&solver, state->nums, state->order, ar))
         diff = latin_solver_main(&solver, maxdiff,
                                  DIFF_LATIN, DIFF_SET, DIFF_EXTREME,
                                  DIFF_EXTREME, DIFF_RECURSIVE,
@@ -904,7 +908,7 @@ static int solver_state(game_state *state, int maxdiff)
     else
         diff = DIFF_IMPOSSIBLE;
 
-    memcpy(state->hints, solver.cube, state->order*state->order*state->order);
+    latin_solver_copy_cube(&solver, state->hints);
 
     free_ctx(ctx);
 
@@ -926,7 +930,7 @@ static game_state *solver_hint(const game_state *state, int *diff_r,
     int diff, r = 0;
 
     for (diff = mindiff; diff <= maxdiff; diff++) {
-        r = solver_state(ret, diff);
+        r = solver_state(ret, diff, NULL);
         debug(("solver_state after %s %d", unequal_diffnames[diff], r));
         if (r != 0) goto done;
     }
@@ -1087,7 +1091,7 @@ static int maxtries;
 static int gg_solved;
 
 static int game_assemble(game_state *new, int *scratch, digit *latin,
-                         int difficulty)
+                         int difficulty, arena *ar)
 {
     game_state *copy = dup_game(new);
     int best;
@@ -1110,7 +1114,7 @@ static int game_assemble(game_state *new, int *scratch, digit *latin,
 
     while(1) {
         gg_solved++;
-        if (solver_state(copy, difficulty) == 1) break;
+        if (solver_state(copy, difficulty, ar) == 1) break;
 
         best = gg_best_clue(copy, scratch, latin);
         gg_place_clue(new, scratch[best], latin, false);
@@ -1128,7 +1132,7 @@ static int game_assemble(game_state *new, int *scratch, digit *latin,
 }
 
 static void game_strip(game_state *new, int *scratch, digit *latin,
-                       int difficulty)
+                       int difficulty, arena *ar)
 {
     int o = new->order, o2 = o*o, lscratch = o2*5, i;
     game_state *copy = blank_game(new->order, new->mode);
@@ -1141,7 +1145,7 @@ static void game_strip(game_state *new, int *scratch, digit *latin,
         memcpy(copy->nums,  new->nums,  o2 * sizeof(digit));
         memcpy(copy->flags, new->flags, o2 * sizeof(unsigned int));
         gg_solved++;
-        if (solver_state(copy, difficulty) != 1) {
+        if (solver_state(copy, difficulty, ar) != 1) {
             /* put clue back, we can't solve without it. */
             bool ret = gg_place_clue(new, scratch[i], latin, false);
             assert(ret);
@@ -1191,11 +1195,12 @@ static char *new_game_desc(const game_params *params_in, random_state *rs,
     game_params params_copy = *params_in; /* structure copy */
     game_params *params = &params_copy;
     digit *sq = NULL;
-    int i, x, y, retlen, k, nsol;
+    int i, x, y, nsol;
     int o2 = params->order * params->order, ntries = 1;
     int *scratch, lscratch = o2*5;
-    char *ret, buf[80];
+    strbuf *sb;
     game_state *state = blank_game(params->order, params->mode);
+    arena *ar = arena_new();           /* scratch space for every solve */
 
     /* Generate a list of 'things to strip' (randomised later) */
     scratch = snewn(lscratch, int);
@@ -1224,13 +1229,13 @@ generate:
     }
 
     gg_solved = 0;
-    if (game_assemble(state, scratch, sq, params->diff) < 0)
+    if (game_assemble(state, scratch, sq, params->diff, ar) < 0)
         goto generate;
-    game_strip(state, scratch, sq, params->diff);
+    game_strip(state, scratch, sq, params->diff, ar);
 
     if (params->diff > 0) {
         game_state *copy = dup_game(state);
-        nsol = solver_state(copy, params->diff-1);
+        nsol = solver_state(copy, params->diff-1, ar);
         free_game(copy);
         if (nsol > 0) {
 #ifdef STANDALONE_SOLVER
@@ -1256,20 +1261,16 @@ generate:
                unequal_diffnames[params->diff], ntries, gg_solved);
 #endif
 
-    ret = NULL; retlen = 0;
+    sb = strbuf_new();
     for (y = 0; y < params->order; y++) {
         for (x = 0; x < params->order; x++) {
             unsigned int f = GRID(state, flags, x, y);
-            k = sprintf(buf, "%d%s%s%s%s,",
-                        GRID(state, nums, x, y),
-                        (f & F_ADJ_UP)    ? "U" : "",
-                        (f & F_ADJ_RIGHT) ? "R" : "",
-                        (f & F_ADJ_DOWN)  ? "D" : "",
-                        (f & F_ADJ_LEFT)  ? "L" : "");
-
-            ret = sresize(ret, retlen + k + 1, char);
-            strcpy(ret + retlen, buf);
-            retlen += k;
+            strbuf_addint(sb, GRID(state, nums, x, y));
+            if (f & F_ADJ_UP)    strbuf_addc(sb, 'U');
+            if (f & F_ADJ_RIGHT) strbuf_addc(sb, 'R');
+            if (f & F_ADJ_DOWN)  strbuf_addc(sb, 'D');
+            if (f & F_ADJ_LEFT)  strbuf_addc(sb, 'L');
+            strbuf_addc(sb, ',');
         }
     }
     *aux = latin_desc(sq, params->order);
@@ -1277,8 +1278,9 @@ generate:
     free_game(state);
     sfree(sq);
     sfree(scratch);
+    arena_free(ar);
 
-    return ret;
+    return strbuf_to_str(sb);
 }
 
 static game_state *load_game(const game_params *params, const char *desc,
@@ -1423,7 +1425,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
         if (!(solved->flags[r] & F_IMMUTABLE))
             solved->nums[r] = 0;
     }
-    r = solver_state(solved, DIFFCOUNT-1);   /* always use full solver */
+    r = solver_state(solved, DIFFCOUNT-1, NULL);   /* always use full solver */
     if (r > 0) ret = latin_desc(solved->nums, solved->order);
     free_game(solved);
     return ret;
@@ -2170,6 +2172,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILE_SIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -2262,7 +2265,7 @@ static int solve(game_params *p, char *desc, int debug)
     solver_show_working = debug;
     game_debug(state);
 
-    if (latin_solver_alloc(&solver, state->nums, state->order))
+    if (latin_solver_alloc(&solver, state->nums, state->order, NULL))
         diff = latin_solver_main(&solver, DIFF_RECURSIVE,
                                  DIFF_LATIN, DIFF_SET, DIFF_EXTREME,
                                  DIFF_EXTREME, DIFF_RECURSIVE,
@@ -2329,7 +2332,7 @@ static void soak(game_params *p, random_state *rs)
         p->diff = realdiff;
         desc = new_game_desc(p, rs, &aux, false);
         st = new_game(NULL, p, desc);
-        solver_state(st, DIFF_RECURSIVE);
+        solver_state(st, DIFF_RECURSIVE, NULL);
         free_game(st);
         sfree(aux);
         sfree(desc);
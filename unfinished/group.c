@@ -337,7 +337,7 @@ static int solver_normal(struct latin_solver *solver, void *vctx)
 			       names[n-1], x+1, y+1);
 		    }
 #endif
-		    if (solver->cube[(x*w+y)*w+n-1]) {
+		    if (cube(x, y, n)) {
 			latin_solver_place(solver, x, y, n);
 			return 1;
 		    } else {
@@ -365,7 +365,7 @@ static int solver_normal(struct latin_solver *solver, void *vctx)
 			       names[n-1], x+1, y+1);
 		    }
 #endif
-		    if (solver->cube[(x*w+y)*w+n-1]) {
+		    if (cube(x, y, n)) {
 			latin_solver_place(solver, x, y, n);
 			return 1;
 		    } else {
@@ -518,7 +518,7 @@ static int solver_hard(struct latin_solver *solver, void *vctx)
                                solver_recurse_depth*4, "", names[j], i, j);
                     }
 #endif
-                    cube(i, j, j+1) = false;
+                    latin_solver_rule_out(solver, i, j, j+1);
                 }
                 if (cube(j, i, j+1)) {
 #ifdef STANDALONE_SOLVER
@@ -532,7 +532,7 @@ static int solver_hard(struct latin_solver *solver, void *vctx)
                                solver_recurse_depth*4, "", names[j], j, i);
                     }
 #endif
-                    cube(j, i, j+1) = false;
+                    latin_solver_rule_out(solver, j, i, j+1);
                 }
             }
         }
@@ -579,7 +579,12 @@ static bool group_valid(struct latin_solver *solver, void *ctx)
     return true;
 }
 
-static int solver(const game_params *params, digit *grid, int maxdiff)
+/*
+ * 'ar' may be NULL, in which case the Latin square solver uses a
+ * private arena for its scratch space.
+ */
+static int solver(const game_params *params, digit *grid, int maxdiff,
+                  arena *ar)
 {
     int w = params->w;
     int ret;
@@ -597,7 +602,7 @@ static int solver(const game_params *params, digit *grid, int maxdiff)
     solver.names = names;
 #endif
 
-    if (latin_solver_alloc(&solver, grid, w))
+    if (latin_solver_alloc(&solver, grid, w, ar))
         ret = latin_solver_main(&solver, maxdiff,
                                 DIFF_TRIVIAL, DIFF_HARD, DIFF_EXTREME,
                                 DIFF_EXTREME, DIFF_UNREASONABLE,
@@ -823,6 +828,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     int i, j, k, qh, qt;
     int diff = params->diff;
     const struct group *group;
+    arena *ar;
     char *desc, *p;
 
     /*
@@ -862,6 +868,7 @@ done
     soln = snewn(a, digit);
     soln2 = snewn(a, digit);
     indices = snewn(a, int);
+    ar = arena_new();                  /* scratch space for every solve */
 
     while (1) {
 	/*
@@ -937,7 +944,7 @@ done
 	    }
 
 	    memcpy(soln2, grid, a);
-	    if (solver(params, soln2, diff) > diff)
+	    if (solver(params, soln2, diff, ar) > diff)
 		continue;	       /* go round again if that didn't work */
 	}
 
@@ -951,7 +958,7 @@ done
 	for (i = 0; i < k; i++) {
 	    memcpy(soln2, grid, a);
 	    soln2[indices[i]] = 0;
-	    if (solver(params, soln2, diff) <= diff)
+	    if (solver(params, soln2, diff, ar) <= diff)
 		grid[indices[i]] = 0;
 	}
 
@@ -960,7 +967,7 @@ done
 	 */
 	if (diff > 0) {
 	    memcpy(soln2, grid, a);
-	    if (solver(params, soln2, diff-1) < diff)
+	    if (solver(params, soln2, diff-1, ar) < diff)
 		continue;	       /* go round and try again */
 	}
 
@@ -991,6 +998,7 @@ done
     sfree(soln);
     sfree(soln2);
     sfree(indices);
+    arena_free(ar);
 
     return desc;
 }
@@ -1148,7 +1156,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     soln = snewn(a, digit);
     memcpy(soln, state->grid, a*sizeof(digit));
 
-    ret = solver(&state->par, soln, DIFFCOUNT-1);
+    ret = solver(&state->par, soln, DIFFCOUNT-1, NULL);
 
     if (ret == diff_impossible) {
 	*error = "No solution exists for this puzzle";
@@ -2339,6 +2347,7 @@ const struct game thegame = {
     current_key_label,
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILESIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -2415,7 +2424,7 @@ int main(int argc, char **argv)
     solver_show_working = 0;
     for (diff = 0; diff < DIFFCOUNT; diff++) {
 	memcpy(grid, s->grid, p->w * p->w);
-	ret = solver(&s->par, grid, diff);
+	ret = solver(&s->par, grid, diff, NULL);
 	if (ret <= diff)
 	    break;
     }
@@ -2424,7 +2433,7 @@ int main(int argc, char **argv)
         if (really_show_working) {
 	    solver_show_working = true;
 	    memcpy(grid, s->grid, p->w * p->w);
-	    ret = solver(&s->par, grid, DIFFCOUNT - 1);
+	    ret = solver(&s->par, grid, DIFFCOUNT - 1, NULL);
         }
 	if (grade)
 	    printf("Difficulty rating: ambiguous\n");
@@ -2439,7 +2448,7 @@ int main(int argc, char **argv)
 	} else {
 	    solver_show_working = really_show_working;
 	    memcpy(grid, s->grid, p->w * p->w);
-	    ret = solver(&s->par, grid, diff);
+	    ret = solver(&s->par, grid, diff, NULL);
 	    if (ret != diff)
 		printf("Puzzle is inconsistent\n");
 	    else {
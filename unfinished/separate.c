@@ -852,6 +852,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     20 /* FIXME */, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,
@@ -90,15 +90,22 @@ struct game_params {
 struct graph {
     int refcount;		       /* for deallocation */
     tree234 *edges;		       /* stores `edge' structures */
+    /*
+     * The same edges as a flat array, in the same order as the tree,
+     * and for each vertex v the indices in that array of the edges
+     * incident to it: vedges[vstart[v]] to vedges[vstart[v+1]-1].
+     */
+    int nedges;
+    edge *elist;
+    int *vstart, *vedges;
 };
 
 struct game_state {
     game_params params;
     int w, h;			       /* extent of coordinate system only */
     point *pts;
-#ifdef SHOW_CROSSINGS
-    int *crosses;		       /* mark edges which are crossed */
-#endif
+    int *crosses;		       /* how many edges cross each edge */
+    int ncrossings;		       /* number of crossing pairs of edges */
     struct graph *graph;
     bool completed, cheated, just_solved;
 };
@@ -463,6 +470,116 @@ static int vertcmpC(const void *av, const void *bv)
 }
 static int vertcmp(void *av, void *bv) { return vertcmpC(av, bv); }
 
+/* ----------------------------------------------------------------------
+ * Finding all the crossings among a set of edges.
+ */
+
+/*
+ * Determine whether two edges cross. Edges sharing an endpoint
+ * don't count as crossing, since every vertex is a place where its
+ * edges meet.
+ */
+static bool edges_cross(const point *pts, const edge *e, const edge *e2)
+{
+    if (e2->a == e->a || e2->a == e->b ||
+	e2->b == e->a || e2->b == e->b)
+	return false;
+    return cross(pts[e2->a], pts[e2->b], pts[e->a], pts[e->b]);
+}
+
+struct sweepedge {
+    double x0, x1, y0, y1;	       /* bounding box of the edge */
+    int index;			       /* index of the edge itself */
+};
+
+static int sweepcmp(const void *av, const void *bv)
+{
+    const struct sweepedge *a = (const struct sweepedge *)av;
+    const struct sweepedge *b = (const struct sweepedge *)bv;
+
+    if (a->x0 < b->x0)
+	return -1;
+    else if (a->x0 > b->x0)
+	return +1;
+    else if (a->index < b->index)
+	return -1;
+    else if (a->index > b->index)
+	return +1;
+    return 0;
+}
+
+/*
+ * Count the pairs of edges in elist which cross, and if `crosses' is
+ * non-NULL, fill it in with the number of other edges crossing each
+ * one. If `stop' is set, give up as soon as any crossing is found.
+ *
+ * Rather than test every pair of edges, we sweep a vertical line
+ * across the plane from left to right, keeping a list of the edges
+ * it currently passes through. Each edge is tested only against the
+ * edges in that list when the sweep reaches its left end, and only
+ * then with cross() if their bounding boxes overlap vertically too.
+ *
+ * The bounding boxes are only computed in floating point, but that's
+ * safe: rounding can make two different coordinates compare equal,
+ * but it can never reverse their order, so no pair of boxes that
+ * really overlap can be thought not to.
+ */
+static int count_crossings(const point *pts, const edge *elist, int nedges,
+			   int *crosses, bool stop)
+{
+    struct sweepedge *se = snewn(nedges, struct sweepedge);
+    int *active = snewn(nedges, int);
+    int nactive = 0, count = 0, i, j, k;
+
+    for (i = 0; i < nedges; i++) {
+	const point *p1 = &pts[elist[i].a], *p2 = &pts[elist[i].b];
+	double x1 = (double)p1->x / p1->d, y1 = (double)p1->y / p1->d;
+	double x2 = (double)p2->x / p2->d, y2 = (double)p2->y / p2->d;
+
+	se[i].x0 = min(x1, x2);
+	se[i].x1 = max(x1, x2);
+	se[i].y0 = min(y1, y2);
+	se[i].y1 = max(y1, y2);
+	se[i].index = i;
+	if (crosses)
+	    crosses[i] = 0;
+    }
+    qsort(se, nedges, sizeof(*se), sweepcmp);
+
+    for (i = 0; i < nedges; i++) {
+	const struct sweepedge *s = &se[i];
+
+	/* Forget the edges which the sweep line has passed. */
+	for (j = k = 0; j < nactive; j++)
+	    if (se[active[j]].x1 >= s->x0)
+		active[k++] = active[j];
+	nactive = k;
+
+	for (j = 0; j < nactive; j++) {
+	    const struct sweepedge *s2 = &se[active[j]];
+
+	    if (s2->y1 < s->y0 || s->y1 < s2->y0)
+		continue;
+	    if (edges_cross(pts, &elist[s2->index], &elist[s->index])) {
+		count++;
+		if (crosses) {
+		    crosses[s->index]++;
+		    crosses[s2->index]++;
+		}
+		if (stop)
+		    goto done;
+	    }
+	}
+
+	active[nactive++] = i;
+    }
+
+  done:
+    sfree(active);
+    sfree(se);
+    return count;
+}
+
 /*
  * Construct point coordinates for n points arranged in a circle,
  * within the bounding box (0,0) to (w,w).
@@ -500,12 +617,12 @@ static void make_circle(point *pts, int n, int w)
 static char *new_game_desc(const game_params *params, random_state *rs,
 			   char **aux, bool interactive)
 {
-    int n = params->n, i;
+    int n = params->n, nedges, i;
     long w, h, j, k, m;
-    point *pts, *pts2;
+    point *pts, *pts2, *pts3;
     long *tmp;
     tree234 *edges, *vertices;
-    edge *e, *e2;
+    edge *e, *elist;
     vertex *v, *vs, *vlist;
     char *ret;
 
@@ -587,6 +704,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	    for (k = 0; k < m; k++) {
 		int p;
 		int ki = vlist[k].vindex;
+		cursor234 cur;
 
 		/*
 		 * Check to see whether this edge intersects any
@@ -598,7 +716,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 			break;
 		if (p < n)
 		    continue;
-		for (p = 0; (e = index234(edges, p)) != NULL; p++)
+		for (e = cursorindex234(edges, 0, &cur); e;
+		     e = cursornext234(&cur))
 		    if (e->a != ki && e->a != j &&
 			e->b != ki && e->b != j &&
 			cross(pts[ki], pts[j], pts[e->a], pts[e->b]))
@@ -639,23 +758,20 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	tmp[i] = i;
     pts2 = snewn(n, point);
     make_circle(pts2, n, w);
+    pts3 = snewn(n, point);
+    nedges = count234(edges);
+    elist = snewn(nedges, edge);
+    for (i = 0; (e = index234(edges, i)) != NULL; i++)
+	elist[i] = *e;
     while (1) {
 	shuffle(tmp, n, sizeof(*tmp), rs);
-	for (i = 0; (e = index234(edges, i)) != NULL; i++) {
-	    for (j = i+1; (e2 = index234(edges, j)) != NULL; j++) {
-		if (e2->a == e->a || e2->a == e->b ||
-		    e2->b == e->a || e2->b == e->b)
-		    continue;
-		if (cross(pts2[tmp[e2->a]], pts2[tmp[e2->b]],
-			  pts2[tmp[e->a]], pts2[tmp[e->b]]))
-		    break;
-	    }
-	    if (e2)
-		break;
-	}
-	if (e)
+	for (i = 0; i < n; i++)
+	    pts3[i] = pts2[tmp[i]];
+	if (count_crossings(pts3, elist, nedges, NULL, true))
 	    break;		       /* we've found a crossing */
     }
+    sfree(elist);
+    sfree(pts3);
 
     /*
      * We're done. Now encode the graph in a string format. Let's
@@ -770,45 +886,35 @@ static const char *validate_desc(const game_params *params, const char *desc)
 
 static void mark_crossings(game_state *state)
 {
-    bool ok = true;
-    int i, j;
-    edge *e, *e2;
+    state->ncrossings = count_crossings(state->pts, state->graph->elist,
+					state->graph->nedges,
+					state->crosses, false);
+}
 
-#ifdef SHOW_CROSSINGS
-    for (i = 0; (e = index234(state->graph->edges, i)) != NULL; i++)
-	state->crosses[i] = false;
-#endif
+/*
+ * Update the crossing counts after point p has moved, given where
+ * all the points were beforehand. Only the edges incident to p can
+ * have started or stopped crossing anything, so only those need
+ * testing against the rest.
+ */
+static void move_crossings(game_state *state, const point *oldpts, int p)
+{
+    const struct graph *g = state->graph;
+    int i, j;
 
-    /*
-     * Check correctness: for every pair of edges, see whether they
-     * cross.
-     */
-    for (i = 0; (e = index234(state->graph->edges, i)) != NULL; i++) {
-	for (j = i+1; (e2 = index234(state->graph->edges, j)) != NULL; j++) {
-	    if (e2->a == e->a || e2->a == e->b ||
-		e2->b == e->a || e2->b == e->b)
-		continue;
-	    if (cross(state->pts[e2->a], state->pts[e2->b],
-		      state->pts[e->a], state->pts[e->b])) {
-		ok = false;
-#ifdef SHOW_CROSSINGS
-		state->crosses[i] = state->crosses[j] = true;
-#else
-		goto done;	       /* multi-level break - sorry */
-#endif
-	    }
+    for (i = g->vstart[p]; i < g->vstart[p+1]; i++) {
+	int ei = g->vedges[i];
+
+	for (j = 0; j < g->nedges; j++) {
+	    int diff = ((int)edges_cross(state->pts, &g->elist[ei],
+					 &g->elist[j]) -
+			(int)edges_cross(oldpts, &g->elist[ei],
+					 &g->elist[j]));
+	    state->crosses[ei] += diff;
+	    state->crosses[j] += diff;
+	    state->ncrossings += diff;
 	}
     }
-
-    /*
-     * e == NULL if we've gone through all the edge pairs
-     * without finding a crossing.
-     */
-#ifndef SHOW_CROSSINGS
-    done:
-#endif
-    if (ok)
-	state->completed = true;
 }
 
 static game_state *new_game(midend *me, const game_params *params,
@@ -816,7 +922,9 @@ static game_state *new_game(midend *me, const game_params *params,
 {
     int n = params->n;
     game_state *state = snew(game_state);
-    int a, b;
+    struct graph *g;
+    edge *e;
+    int a, b, i;
 
     state->params = *params;
     state->w = state->h = COORDLIMIT(n);
@@ -843,10 +951,27 @@ static game_state *new_game(midend *me, const game_params *params,
 	addedge(state->graph->edges, a, b);
     }
 
-#ifdef SHOW_CROSSINGS
-    state->crosses = snewn(count234(state->graph->edges), int);
-    mark_crossings(state);	       /* sets up `crosses' and `completed' */
-#endif
+    g = state->graph;
+    g->nedges = count234(g->edges);
+    g->elist = snewn(g->nedges, edge);
+    g->vstart = snewn(n+1, int);
+    g->vedges = snewn(2 * g->nedges, int);
+    for (i = 0; i <= n; i++)
+	g->vstart[i] = 0;
+    for (i = 0; (e = index234(g->edges, i)) != NULL; i++) {
+	g->elist[i] = *e;
+	g->vstart[e->a]++;
+	g->vstart[e->b]++;
+    }
+    for (i = 0; i < n; i++)
+	g->vstart[i+1] += g->vstart[i];
+    for (i = g->nedges - 1; i >= 0; i--) {
+	g->vedges[--g->vstart[g->elist[i].a]] = i;
+	g->vedges[--g->vstart[g->elist[i].b]] = i;
+    }
+
+    state->crosses = snewn(g->nedges, int);
+    mark_crossings(state);
 
     return state;
 }
@@ -866,11 +991,9 @@ static game_state *dup_game(const game_state *state)
     ret->completed = state->completed;
     ret->cheated = state->cheated;
     ret->just_solved = state->just_solved;
-#ifdef SHOW_CROSSINGS
-    ret->crosses = snewn(count234(ret->graph->edges), int);
-    memcpy(ret->crosses, state->crosses,
-	   count234(ret->graph->edges) * sizeof(int));
-#endif
+    ret->crosses = snewn(ret->graph->nedges, int);
+    memcpy(ret->crosses, state->crosses, ret->graph->nedges * sizeof(int));
+    ret->ncrossings = state->ncrossings;
 
     return ret;
 }
@@ -882,8 +1005,12 @@ static void free_game(game_state *state)
 	while ((e = delpos234(state->graph->edges, 0)) != NULL)
 	    sfree(e);
 	freetree234(state->graph->edges);
+	sfree(state->graph->elist);
+	sfree(state->graph->vstart);
+	sfree(state->graph->vedges);
 	sfree(state->graph);
     }
+    sfree(state->crosses);
     sfree(state->pts);
     sfree(state);
 }
@@ -1155,7 +1282,7 @@ static char *interpret_move(const game_state *state, game_ui *ui,
 static game_state *execute_move(const game_state *state, const char *move)
 {
     int n = state->params.n;
-    int p, k;
+    int p, k, moved = 0, lastp = -1;
     long x, y, d;
     game_state *ret = dup_game(state);
 
@@ -1173,6 +1300,8 @@ static game_state *execute_move(const game_state *state, const char *move)
 	    ret->pts[p].x = x;
 	    ret->pts[p].y = y;
 	    ret->pts[p].d = d;
+	    moved++;
+	    lastp = p;
 
 	    move += k+1;
 	    if (*move == ';') move++;
@@ -1182,7 +1311,16 @@ static game_state *execute_move(const game_state *state, const char *move)
 	}
     }
 
-    mark_crossings(ret);
+    /*
+     * A single dragged point only affects its own edges; anything
+     * more (i.e. a solve move) is cheaper to recount from scratch.
+     */
+    if (moved == 1)
+	move_crossings(ret, state->pts, lastp);
+    else if (moved > 1)
+	mark_crossings(ret);
+    if (ret->ncrossings == 0)
+	ret->completed = true;
 
     return ret;
 }
@@ -1472,6 +1610,7 @@ const struct game thegame = {
     NULL, /* current_key_label */
     interpret_move,
     execute_move,
+    NULL, NULL, /* encode_state, decode_state */
     PREFERRED_TILESIZE, game_compute_size, game_set_size,
     game_colours,
     game_new_drawstate,